@@ -1,50 +1,173 @@
-#version 330 core
+#version 430 core
+
+// Texture binding variant, Shader::setDefines puts one of TEXTURE_BINDLESS or TEXTURE_ARRAYS after the version line
+// (see TexturePool). Without either, and for textures the pool couldn't take, draws bind their textures to units 0-4.
+#if defined(TEXTURE_BINDLESS)
+#extension GL_ARB_bindless_texture : require
+#endif
 
 in vec3 FragPos;
 in vec3 Normal;
 in vec2 TexCoords;
 in vec3 Tangent;
 in vec3 Bitangent;
+flat in uint MaterialIndex;
 
 out vec4 FragColor;
 
+// Mirrors LightBlock in shader_bindings.h
 struct Light {
-    int type;           // 0 = directional, 1 = point, 2 = spot
-    vec3 position;      // Used for point lights
-    vec3 direction;     // Used for directional lights
-    vec3 color;
+    vec3 position;      // Used for point and spot lights
     float intensity;
+    vec3 direction;     // Used for directional and spot lights
     float cutoff;
+    vec3 color;
     float outerCutoff;
+    int type;           // 0 = directional, 1 = point, 2 = spot
+    float range;        // Faded out to zero here, used for point and spot lights
 };
 
+// Mirrors CameraBlock in shader_bindings.h
+layout (std140, binding = 0) uniform CameraBlock {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec3 viewPos;
+};
+
+// Mirrors MaterialBlock in shader_bindings.h
 struct Material {
     vec3 albedo;
     float metallic;
+    vec3 emissive;
     float roughness;
     float ao;
-    vec3 emissive;
     float transparency;
-    
-    // Texture flags
-    bool hasAlbedoTexture;
-    bool hasMetallicTexture;
-    bool hasRoughnessTexture;
-    bool hasNormalTexture;
-    bool hasLegacySpecular;
+    uint flags;
+    uint textures[5];   // TexturePool index per texture slot
+};
+
+// Every registered material, the vertex shader passes on which one the draw uses
+layout (std430, binding = 6) readonly buffer MaterialBuffer {
+    Material materials[];
+};
+
+Material material;
+
+// Texture flags
+const uint ALBEDO_TEXTURE    = 1u << 0;
+const uint METALLIC_TEXTURE  = 1u << 1;
+const uint ROUGHNESS_TEXTURE = 1u << 2;
+const uint NORMAL_TEXTURE    = 1u << 3;
+const uint LEGACY_SPECULAR   = 1u << 4;
+
+// Enabled lights only, rewritten by LightManager when one changes. Directional lights come first.
+layout (std430, binding = 2) readonly buffer LightBuffer {
+    uint lightCount;
+    uint directionalCount;
+    Light lights[];
+};
+
+// Mirrors ClusterBufferHeader and ClusterRange in shader_bindings.h, rebuilt every frame by LightClusters
+layout (std430, binding = 3) readonly buffer ClusterBuffer {
+    uvec4 clusterDimensions;
+    vec4 clusterParams;         // Clusters per pixel along x and y, depth slice scale and bias
+    uvec2 clusters[];           // Offset and count into lightIndices
 };
 
-uniform Material material;
-uniform Light lights[4];
-uniform int numLights;
-uniform vec3 viewPos;
+layout (std430, binding = 4) readonly buffer LightIndexBuffer {
+    uint lightIndices[];
+};
+
+// Texture slots, match Mesh::SAMPLER_TYPES
+const uint ALBEDO_SLOT    = 0u;
+const uint METALLIC_SLOT  = 1u;
+const uint ROUGHNESS_SLOT = 2u;
+const uint NORMAL_SLOT    = 3u;
+const uint SPECULAR_SLOT  = 4u;
+
+// Units match the slots. Without resident textures every draw binds its textures here, with them only the ones
+// TexturePool couldn't take (their material entry is INVALID_TEXTURE).
+layout (binding = 0) uniform sampler2D texture_albedo1;
+layout (binding = 1) uniform sampler2D texture_metallic1;
+layout (binding = 2) uniform sampler2D texture_roughness1;
+layout (binding = 3) uniform sampler2D texture_normal1;
+layout (binding = 4) uniform sampler2D texture_specular1;
+
+const uint INVALID_TEXTURE = 0xFFFFFFFFu;
+
+vec4 sampleBoundTexture(uint slot, vec2 uv)
+{
+    switch (slot) {
+    case ALBEDO_SLOT:
+        return texture(texture_albedo1, uv);
+    case METALLIC_SLOT:
+        return texture(texture_metallic1, uv);
+    case ROUGHNESS_SLOT:
+        return texture(texture_roughness1, uv);
+    case NORMAL_SLOT:
+        return texture(texture_normal1, uv);
+    default:
+        return texture(texture_specular1, uv);
+    }
+}
+
+#if defined(TEXTURE_BINDLESS)
+
+// Resident texture handles, indexed by the material's texture slots
+layout (std430, binding = 7) readonly buffer TextureBuffer {
+    uvec2 textureHandles[];
+};
+
+vec4 sampleTexture(uint slot, vec2 uv)
+{
+    uint index = material.textures[slot];
+    if (index == INVALID_TEXTURE) {
+        return sampleBoundTexture(slot, uv);
+    }
+    return texture(sampler2D(textureHandles[index]), uv);
+}
+
+#elif defined(TEXTURE_ARRAYS)
+
+// Pool and layer of every pooled texture, indexed by the material's texture slots
+layout (std430, binding = 7) readonly buffer TextureBuffer {
+    uvec2 textureLayers[];
+};
 
-// Texture samplers
-uniform sampler2D texture_albedo1;
-uniform sampler2D texture_metallic1;
-uniform sampler2D texture_roughness1;
-uniform sampler2D texture_normal1;
-uniform sampler2D texture_specular1;
+// Pool i is bound to unit 5 + i (TexturePool::FIRST_POOL_UNIT), TEXTURE_POOL_COUNT comes with TEXTURE_ARRAYS
+layout (binding = 5) uniform sampler2DArray texturePools[TEXTURE_POOL_COUNT];
+
+#if defined(MULTI_DRAW)
+// A sampler array index has to be dynamically uniform and the material changes between the commands of one call.
+// The render queue splits multi-draws wherever a slot's pool changes and sets the pools here.
+layout (location = 6) uniform uint slotPools[5];
+#endif
+
+vec4 sampleTexture(uint slot, vec2 uv)
+{
+    uint index = material.textures[slot];
+    if (index == INVALID_TEXTURE) {
+        return sampleBoundTexture(slot, uv);
+    }
+
+    uvec2 layer = textureLayers[index];
+#if defined(MULTI_DRAW)
+    uint pool = slotPools[slot];
+#else
+    uint pool = layer.x;
+#endif
+    return texture(texturePools[pool], vec3(uv, float(layer.y)));
+}
+
+#else
+
+vec4 sampleTexture(uint slot, vec2 uv)
+{
+    return sampleBoundTexture(slot, uv);
+}
+
+#endif
 
 const float PI = 3.14159265359;
 
@@ -90,10 +213,15 @@ vec3 fresnelSchlick(float cosTheta, vec3 F0)
 }
 
 // Material sampling functions
+bool hasFlag(uint flag)
+{
+    return (material.flags & flag) != 0u;
+}
+
 vec3 sampleAlbedo()
 {
-    if (material.hasAlbedoTexture) {
-        vec3 texColor = texture(texture_albedo1, TexCoords).rgb;
+    if (hasFlag(ALBEDO_TEXTURE)) {
+        vec3 texColor = sampleTexture(ALBEDO_SLOT, TexCoords).rgb;
         texColor = max(texColor, vec3(0.1));
         return pow(texColor, vec3(2.2)) * material.albedo;
     }
@@ -102,18 +230,18 @@ vec3 sampleAlbedo()
 
 float sampleMetallic()
 {
-    if (material.hasMetallicTexture) {
-        return texture(texture_metallic1, TexCoords).b * material.metallic;
+    if (hasFlag(METALLIC_TEXTURE)) {
+        return sampleTexture(METALLIC_SLOT, TexCoords).b * material.metallic;
     }
     return material.metallic;
 }
 
 float sampleRoughness()
 {
-    if (material.hasRoughnessTexture) {
-        return texture(texture_roughness1, TexCoords).g * material.roughness;
-    } else if (material.hasLegacySpecular) {
-        vec3 specular = texture(texture_specular1, TexCoords).rgb;
+    if (hasFlag(ROUGHNESS_TEXTURE)) {
+        return sampleTexture(ROUGHNESS_SLOT, TexCoords).g * material.roughness;
+    } else if (hasFlag(LEGACY_SPECULAR)) {
+        vec3 specular = sampleTexture(SPECULAR_SLOT, TexCoords).rgb;
         float specularIntensity = dot(specular, vec3(0.299, 0.587, 0.114));
         return mix(0.2, 0.9, 1.0 - specularIntensity);
     }
@@ -122,8 +250,10 @@ float sampleRoughness()
 
 vec3 sampleNormal()
 {
-    if (material.hasNormalTexture) {
-        vec3 normal = texture(texture_normal1, TexCoords).rgb * 2.0 - 1.0;
+    if (hasFlag(NORMAL_TEXTURE)) {
+        // Only xy is trusted, BC5 normal maps have no blue channel.
+        vec2 xy = sampleTexture(NORMAL_SLOT, TexCoords).rg * 2.0 - 1.0;
+        vec3 normal = vec3(xy, sqrt(max(1.0 - dot(xy, xy), 0.0)));
         
         vec3 N = normalize(Normal);
         vec3 T = normalize(Tangent);
@@ -135,8 +265,54 @@ vec3 sampleNormal()
     return normalize(Normal);
 }
 
+// Outgoing radiance from one light
+vec3 evaluateLight(Light light, vec3 N, vec3 V, vec3 F0, vec3 albedo, float metallic, float roughness)
+{
+    vec3 L;
+    vec3 radiance;
+
+    if (light.type == 0) { // Directional light
+        L = normalize(-light.direction);
+        radiance = light.color * light.intensity;
+    } else {
+        L = normalize(light.position - FragPos);
+        float distance = length(light.position - FragPos);
+
+        // Inverse square, windowed to reach zero at the range the light was clustered with
+        float falloff = clamp(1.0 - pow(distance / light.range, 4.0), 0.0, 1.0);
+        float attenuation = falloff * falloff / (distance * distance);
+        radiance = light.color * light.intensity * attenuation;
+
+        if (light.type == 2) { // Spot light
+            float theta = dot(L, normalize(-light.direction));
+            float epsilon = light.cutoff - light.outerCutoff;
+            radiance *= clamp((theta - light.outerCutoff) / epsilon, 0.0, 1.0);
+        }
+    }
+
+    vec3 H = normalize(V + L);
+
+    // PBR calculations
+    float NDF = DistributionGGX(N, H, roughness);
+    float G = GeometrySmith(N, V, L, roughness);
+    vec3 F = fresnelSchlick(max(dot(H, V), 0.0), F0);
+
+    vec3 kS = F;
+    vec3 kD = vec3(1.0) - kS;
+    kD *= 1.0 - metallic;
+
+    vec3 numerator = NDF * G * F;
+    float denominator = 4.0 * max(dot(N, V), 0.0) * max(dot(N, L), 0.0) + 0.0001;
+    vec3 specular = numerator / denominator;
+
+    float NdotL = max(dot(N, L), 0.0);
+    return (kD * albedo / PI + specular) * radiance * NdotL;
+}
+
 void main()
 {
+    material = materials[MaterialIndex];
+
     vec3 albedo = sampleAlbedo();
     float metallic = sampleMetallic();
     float roughness = sampleRoughness();
@@ -147,50 +323,19 @@ void main()
     F0 = mix(F0, albedo, metallic);
 
     vec3 Lo = vec3(0.0);
-    
-    // Calculate lighting contribution from each light
-    for(int i = 0; i < numLights && i < 4; ++i) {
-        vec3 L;
-        vec3 radiance;
-        
-        if (lights[i].type == 0) { // Directional light
-            L = normalize(-lights[i].direction);
-            radiance = lights[i].color * lights[i].intensity;
-        } else if (lights[i].type == 1) { // Point light
-            L = normalize(lights[i].position - FragPos);
-            float distance = length(lights[i].position - FragPos);
-            float attenuation = 1.0 / (distance * distance);
-            radiance = lights[i].color * lights[i].intensity * attenuation;
-        } else if (lights[i].type == 2) { // Spot light
-            vec3 lightDir = normalize(lights[i].position - FragPos);
-            float distance = length(lights[i].position - FragPos);
-            float attenuation = 1.0 / (distance * distance);
-
-            float theta = dot(lightDir, normalize(-lights[i].direction));
-            float epsilon = lights[i].cutoff - lights[i].outerCutoff;
-            float intensity = clamp((theta - lights[i].outerCutoff) / epsilon, 0.0, 1.0);
-
-            L = lightDir;
-            radiance = lights[i].color * lights[i].intensity * attenuation * intensity;
-        }
-                
-        vec3 H = normalize(V + L);
-        
-        // PBR calculations
-        float NDF = DistributionGGX(N, H, roughness);
-        float G = GeometrySmith(N, V, L, roughness);
-        vec3 F = fresnelSchlick(max(dot(H, V), 0.0), F0);
-
-        vec3 kS = F;
-        vec3 kD = vec3(1.0) - kS;
-        kD *= 1.0 - metallic;
+    for (uint i = 0; i < directionalCount; ++i) {
+        Lo += evaluateLight(lights[i], N, V, F0, albedo, metallic, roughness);
+    }
 
-        vec3 numerator = NDF * G * F;
-        float denominator = 4.0 * max(dot(N, V), 0.0) * max(dot(N, L), 0.0) + 0.0001;
-        vec3 specular = numerator / denominator;
+    // Point and spot lights come from the fragment's cluster only
+    float viewDepth = -(view * vec4(FragPos, 1.0)).z;
+    uvec3 cluster;
+    cluster.xy = uvec2(clamp(gl_FragCoord.xy * clusterParams.xy, vec2(0.0), vec2(clusterDimensions.xy - 1u)));
+    cluster.z = uint(clamp(log(max(viewDepth, 1e-4)) * clusterParams.z + clusterParams.w, 0.0, float(clusterDimensions.z - 1u)));
 
-        float NdotL = max(dot(N, L), 0.0);
-        Lo += (kD * albedo / PI + specular) * radiance * NdotL;
+    uvec2 range = clusters[cluster.x + (cluster.y + cluster.z * clusterDimensions.y) * clusterDimensions.x];
+    for (uint i = 0; i < range.y; ++i) {
+        Lo += evaluateLight(lights[lightIndices[range.x + i]], N, V, F0, albedo, metallic, roughness);
     }
 
     vec3 ambient = vec3(0.1) * albedo * material.ao;
@@ -1,27 +1,106 @@
-#version 330 core
+#version 430 core
 
-layout (location = 0) in vec3 aPos;
+// Submission variant, Shader::setDefines puts MULTI_DRAW after the version line when the render queue draws through
+// glMultiDrawElementsIndirect (see RenderQueue). Per-draw state then comes from DrawBuffer instead of uniforms.
+#if defined(MULTI_DRAW)
+#extension GL_ARB_shader_draw_parameters : require
+#endif
+
+// Float layout: everything as is. Packed layout (PackedVertex in vertex.h): position is unorm16 in the mesh bounds
+// with the bitangent sign in w, normal and tangent are octahedral snorm16 in xy, the bitangent attribute is disabled.
+layout (location = 0) in vec4 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
 layout (location = 3) in vec3 aTangent;
 layout (location = 4) in vec3 aBitangent;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+// Every instance drawn this frame, a draw's instances start at its first instance (the base instance of an indirect command)
+layout (std430, binding = 5) readonly buffer InstanceBuffer {
+    mat4 instanceModels[];
+};
+
+// Mirrors VertexFormat and VertexQuantization
+const int VERTEX_FORMAT_PACKED = 1;
+
+#if defined(MULTI_DRAW)
+
+// Mirrors DrawBlock in shader_bindings.h, one per indirect command
+struct Draw {
+    vec3 positionOffset;
+    int vertexFormat;
+    vec3 positionScale;
+    uint materialIndex;
+};
+
+layout (std430, binding = 8) readonly buffer DrawBuffer {
+    Draw draws[];
+};
+
+// gl_DrawIDARB restarts at zero for every multi-draw, this is where the call's commands start in DrawBuffer
+layout (location = 5) uniform int firstDraw;
+
+#else
+
+layout (location = 0) uniform int firstInstance;
+layout (location = 1) uniform int vertexFormat;
+layout (location = 2) uniform vec3 positionOffset;
+layout (location = 3) uniform vec3 positionScale;
+layout (location = 4) uniform uint materialIndex;
+
+#endif
+
+// Mirrors CameraBlock in shader_bindings.h
+layout (std140, binding = 0) uniform CameraBlock {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec3 viewPos;
+};
 
 out vec3 FragPos;
 out vec3 Normal;
 out vec2 TexCoords;
 out vec3 Tangent;
 out vec3 Bitangent;
+flat out uint MaterialIndex;
+
+vec3 decodeOctahedral(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
 
 void main()
 {
-    FragPos = vec3(model * vec4(aPos, 1.0));
-    Normal = mat3(transpose(inverse(model))) * aNormal;
-    Tangent = mat3(transpose(inverse(model))) * aTangent;
-    Bitangent = mat3(transpose(inverse(model))) * aBitangent;
+#if defined(MULTI_DRAW)
+    Draw draw = draws[firstDraw + gl_DrawIDARB];
+    mat4 model = instanceModels[gl_BaseInstanceARB + gl_InstanceID];
+    vec3 position = draw.positionOffset + aPos.xyz * draw.positionScale;
+    bool isPacked = draw.vertexFormat == VERTEX_FORMAT_PACKED;
+    MaterialIndex = draw.materialIndex;
+#else
+    mat4 model = instanceModels[firstInstance + gl_InstanceID];
+    vec3 position = positionOffset + aPos.xyz * positionScale;
+    bool isPacked = vertexFormat == VERTEX_FORMAT_PACKED;
+    MaterialIndex = materialIndex;
+#endif
+
+    vec3 normal = aNormal;
+    vec3 tangent = aTangent;
+    vec3 bitangent = aBitangent;
+    if (isPacked) {
+        normal = decodeOctahedral(aNormal.xy);
+        tangent = decodeOctahedral(aTangent.xy);
+        bitangent = cross(normal, tangent) * (aPos.w * 2.0 - 1.0);
+    }
+
+    FragPos = vec3(model * vec4(position, 1.0));
+    Normal = mat3(transpose(inverse(model))) * normal;
+    Tangent = mat3(transpose(inverse(model))) * tangent;
+    Bitangent = mat3(transpose(inverse(model))) * bitangent;
     TexCoords = aTexCoords;
-    gl_Position = projection * view * vec4(FragPos, 1.0);
+    gl_Position = viewProjection * vec4(FragPos, 1.0);
 }
\ No newline at end of file
@@ -49,7 +49,8 @@ solution "enginex"
             "opengl32",
             "user32",
             "shell32",
-            "ole32"
+            "ole32",
+            "psapi"
         }
         postbuildcommands { "{COPY} %{cfg.buildtarget.relpath} %{prj.location}../" }
         
@@ -0,0 +1,30 @@
+#ifndef UTILITIES_CPU_FEATURES_H_
+#define UTILITIES_CPU_FEATURES_H_
+
+#include <immintrin.h>
+#include <intrin.h>
+
+// Runtime instruction set checks. The build targets baseline x64 (SSE2), so AVX paths are picked at runtime.
+class CpuFeatures
+{
+  public:
+    static bool hasAVX()
+    {
+        static const bool avx = detectAVX();
+        return avx;
+    }
+
+  private:
+    static bool detectAVX()
+    {
+        int info[4] = {};
+        __cpuid(info, 1);
+
+        // The OS has to save the YMM registers as well, CPU support alone isn't enough.
+        bool osxsave = (info[2] & (1 << 27)) != 0;
+        bool avx     = (info[2] & (1 << 28)) != 0;
+        return osxsave && avx && (_xgetbv(0) & 0x6) == 0x6;
+    }
+};
+
+#endif // UTILITIES_CPU_FEATURES_H_
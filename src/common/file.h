@@ -40,6 +40,25 @@ class FileSystem
         file.read(content.data(), size);
         return content;
     }
+
+    // Last write time and size, what the disk caches use to notice a changed source file.
+    static bool getFileInfo(const std::string& filePath, int64_t& writeTime, uint64_t& fileSize)
+    {
+        std::error_code error;
+        auto            time = std::filesystem::last_write_time(filePath, error);
+        if (error) {
+            return false;
+        }
+
+        auto size = std::filesystem::file_size(filePath, error);
+        if (error) {
+            return false;
+        }
+
+        writeTime = static_cast<int64_t>(time.time_since_epoch().count());
+        fileSize  = static_cast<uint64_t>(size);
+        return true;
+    }
 };
 
 #endif // UTILITIES_FILE_H_
\ No newline at end of file
@@ -0,0 +1,28 @@
+#ifndef UTILITIES_HASH_H_
+#define UTILITIES_HASH_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// 64-bit FNV-1a. Not cryptographic, used to fingerprint file contents for the disk caches.
+class Hash
+{
+  public:
+    static constexpr uint64_t FNV_OFFSET_BASIS = 14695981039346656037ull;
+    static constexpr uint64_t FNV_PRIME        = 1099511628211ull;
+
+    static uint64_t fnv1a(const void* data, size_t size, uint64_t hash = FNV_OFFSET_BASIS)
+    {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        for (size_t i = 0; i < size; i++) {
+            hash ^= bytes[i];
+            hash *= FNV_PRIME;
+        }
+        return hash;
+    }
+
+    static uint64_t fnv1a(std::string_view text, uint64_t hash = FNV_OFFSET_BASIS) { return fnv1a(text.data(), text.size(), hash); }
+};
+
+#endif // UTILITIES_HASH_H_
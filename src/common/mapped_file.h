@@ -0,0 +1,86 @@
+#ifndef UTILITIES_MAPPED_FILE_H_
+#define UTILITIES_MAPPED_FILE_H_
+
+#include "common/logger.h"
+
+#include <windows.h>
+#include <string>
+
+// Read-only memory mapping of a whole file. The view stays valid until close() or destruction.
+class MappedFile
+{
+  public:
+    MappedFile() = default;
+    ~MappedFile() { close(); }
+
+    MappedFile(const MappedFile&)            = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const std::string& filePath)
+    {
+        close();
+
+        m_file = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (m_file == INVALID_HANDLE_VALUE) {
+            LOG_DEBUG("MappedFile: {} could not be opened.", filePath);
+            m_file = nullptr;
+            return false;
+        }
+
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(m_file, &fileSize) || fileSize.QuadPart == 0) {
+            LOG_DEBUG("MappedFile: {} is empty.", filePath);
+            close();
+            return false;
+        }
+
+        m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!m_mapping) {
+            LOG_DEBUG("MappedFile: Failed to create mapping for {}.", filePath);
+            close();
+            return false;
+        }
+
+        m_data = MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+        if (!m_data) {
+            LOG_DEBUG("MappedFile: Failed to map view of {}.", filePath);
+            close();
+            return false;
+        }
+
+        m_size = static_cast<size_t>(fileSize.QuadPart);
+        return true;
+    }
+
+    void close()
+    {
+        if (m_data) {
+            UnmapViewOfFile(m_data);
+            m_data = nullptr;
+        }
+
+        if (m_mapping) {
+            CloseHandle(m_mapping);
+            m_mapping = nullptr;
+        }
+
+        if (m_file) {
+            CloseHandle(m_file);
+            m_file = nullptr;
+        }
+
+        m_size = 0;
+    }
+
+    bool           isOpen() const { return m_data != nullptr; }
+    const uint8_t* getData() const { return static_cast<const uint8_t*>(m_data); }
+    size_t         getSize() const { return m_size; }
+
+  private:
+    HANDLE m_file    = nullptr;
+    HANDLE m_mapping = nullptr;
+    void*  m_data    = nullptr;
+    size_t m_size    = 0;
+};
+
+#endif // UTILITIES_MAPPED_FILE_H_
@@ -0,0 +1,29 @@
+#ifndef UTILITIES_MEMORY_USAGE_H_
+#define UTILITIES_MEMORY_USAGE_H_
+
+#include <windows.h>
+#include <psapi.h>
+
+#include <cstddef>
+
+// Process memory as the OS sees it, for comparing load paths. Private bytes are what the process committed itself,
+// the peak is the high water mark since startup and never goes back down.
+class MemoryUsage
+{
+  public:
+    static size_t getPrivateBytes()
+    {
+        PROCESS_MEMORY_COUNTERS counters = {};
+        return GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)) ? counters.PagefileUsage : 0;
+    }
+
+    static size_t getPeakPrivateBytes()
+    {
+        PROCESS_MEMORY_COUNTERS counters = {};
+        return GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)) ? counters.PeakPagefileUsage : 0;
+    }
+
+    static float toMegabytes(size_t bytes) { return static_cast<float>(bytes) / (1024.0f * 1024.0f); }
+};
+
+#endif // UTILITIES_MEMORY_USAGE_H_
@@ -29,17 +29,11 @@ void App::onInit()
         return;
     }
 
-    // Load the chair model
-    // auto chairModel = GET_MODEL("assets/models/chair/modern_arm_chair_01_1k.gltf");
-    auto chairModel = GET_MODEL("assets/models/korean_fire_extinguisher_01_4k/korean_fire_extinguisher_01_4k.gltf");
-    if (chairModel) {
-        glm::mat4 transform = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, 0.0f));
-        m_scene->addModel(chairModel, transform);
-    } else {
-        LOG_ERROR("App: Failed to load chair model!");
-    }
-
-    RESOURCE_MANAGER.logStats();
+    // Load the chair model in the background, the editor keeps running while it decodes
+    // auto chairModel = GET_MODEL_ASYNC("assets/models/chair/modern_arm_chair_01_1k.gltf");
+    auto      chairModel = GET_MODEL_ASYNC("assets/models/korean_fire_extinguisher_01_4k/korean_fire_extinguisher_01_4k.gltf");
+    glm::mat4 transform  = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, 0.0f));
+    m_pendingModels.emplace_back(chairModel, transform);
 }
 
 void App::onUpdate(float deltaTime)
@@ -49,10 +43,46 @@ void App::onUpdate(float deltaTime)
     ImDrawList* draw      = ImGui::GetForegroundDrawList();
     draw->AddText(ImVec2(0, 0), ImColor(255, 255, 255, 255), fpsFormat.c_str());
 
+    processPendingModels();
     processInput(deltaTime);
     m_scene->update(deltaTime);
 }
 
+void App::processPendingModels()
+{
+    // One pass with erase_if, erasing entries one at a time is quadratic once thousands of instances are queued.
+    bool added = false;
+    std::erase_if(m_pendingModels, [&](const auto& pending) {
+        if (pending.first.isPending()) {
+            return false;
+        }
+
+        if (auto model = pending.first.get()) {
+            m_scene->addModel(model, pending.second);
+            added = true;
+        } else {
+            LOG_ERROR("App: Failed to load model {}!", pending.first.getPath());
+        }
+        return true;
+    });
+
+    if (added) {
+        RESOURCE_MANAGER.logStats();
+    }
+}
+
+void App::spawnInstances(const std::string& path, int count)
+{
+    // Every copy shares the one cached resource, so they are drawn instanced.
+    auto model = GET_MODEL_ASYNC(path);
+    int  side  = static_cast<int>(std::ceil(std::sqrt(static_cast<float>(count))));
+    for (int i = 0; i < count; i++) {
+        glm::vec3 position(static_cast<float>(i % side - side / 2), 0.0f, static_cast<float>(i / side - side / 2));
+        m_pendingModels.emplace_back(model, glm::translate(glm::mat4(1.0f), position * INSTANCE_SPACING));
+    }
+    LOG_INFO("App: Spawning {} instances of {}", count, path);
+}
+
 void App::onRender()
 {
     m_renderer->beginFrame();
@@ -145,13 +175,43 @@ void App::renderSidebar()
 
     if (ImGui::CollapsingHeader("Scene", ImGuiTreeNodeFlags_DefaultOpen)) {
         ImGui::Text("Models: %zu", m_scene->getModels().size());
+
+        const RenderStats& stats = m_renderer->getRenderStats();
+        ImGui::Text("Draws: %u for %u instances", stats.drawCalls, stats.instances);
+        ImGui::SliderInt("Instances", &m_stressInstanceCount, 100, 20000);
+        if (ImGui::Button("Spawn wine barrels")) {
+            spawnInstances(STRESS_INSTANCE_MODEL, m_stressInstanceCount);
+        }
+
+        // Toggled live so the viewport's GPU time and triangle count can be compared with and without.
+        LodSelector& lodSelector = m_renderer->getLodSelector();
+        bool         lodEnabled  = lodSelector.isEnabled();
+        float        pixelError  = lodSelector.getMaxPixelError();
+        if (ImGui::Checkbox("LODs", &lodEnabled)) {
+            lodSelector.setEnabled(lodEnabled);
+        }
+        if (ImGui::SliderFloat("Max pixel error", &pixelError, 0.25f, 8.0f)) {
+            lodSelector.setMaxPixelError(pixelError);
+        }
+        ImGui::Text("Triangles: %.2fM", stats.triangles / 1000000.0);
         ImGui::Separator();
     }
 
     if (ImGui::CollapsingHeader("Lighting", ImGuiTreeNodeFlags_DefaultOpen)) {
         LightManager* lightManager = m_scene->getLightManager();
         auto          lightCount   = lightManager->getLightCount();
-        for (int i = 0; i < lightCount; i++) {
+        ImGui::Text("Lights: %zu, buffer uploads: %zu", lightCount, lightManager->getUploadCount());
+
+        ImGui::SliderInt("Count", &m_stressLightCount, 16, 4096);
+        if (ImGui::Button("Spawn random lights")) {
+            lightManager->addRandomLights(static_cast<size_t>(m_stressLightCount), glm::vec3(-10.0f, -2.0f, -10.0f), glm::vec3(10.0f, 6.0f, 10.0f), m_stressLightSeed++);
+            lightCount = lightManager->getLightCount();
+        }
+        ImGui::Separator();
+
+        // Editing thousands of stress test lights one by one isn't useful, and building their widgets is slow.
+        int listedCount = static_cast<int>(std::min<size_t>(lightCount, MAX_LISTED_LIGHTS));
+        for (int i = 0; i < listedCount; i++) {
             auto        light    = lightManager->getLight(i);
             std::string typeName = light->getTypeName();
 
@@ -183,10 +243,14 @@ void App::renderSidebar()
                 ImGui::TreePop();
             }
 
-            if (i < lightCount - 1) {
+            if (i < listedCount - 1) {
                 ImGui::Separator();
             }
         }
+
+        if (lightCount > listedCount) {
+            ImGui::Text("... and %zu more", lightCount - listedCount);
+        }
     }
 
     if (ImGui::CollapsingHeader("Camera", ImGuiTreeNodeFlags_DefaultOpen)) {
@@ -3,6 +3,10 @@
 
 #include "common/forward_dec.h"
 #include "editor/app_interface.h"
+#include "engine/renderer/resources/resource_manager.h"
+
+#include <glm/glm.hpp>
+#include <vector>
 
 class InputManager;
 class Scene;
@@ -25,9 +29,25 @@ class App : public IApp
     std::unique_ptr<Renderer> m_renderer;
     InputManager*             m_inputManager = nullptr;
 
+    // Models still loading in the background, added to the scene once they are ready.
+    std::vector<std::pair<ResourceHandle<ModelResource>, glm::mat4>> m_pendingModels;
+
+    // Lighting stress test, random lights are spawned around the origin from the sidebar.
+    int      m_stressLightCount = 256;
+    uint32_t m_stressLightSeed  = 1;
+
+    // Instancing stress test, copies of one model are laid out on a grid from the sidebar.
+    int m_stressInstanceCount = 10000;
+
     static constexpr float DEFAULT_CAMERA_SPEED_MULTIPLIER = 3.0f;
+    static constexpr int   MAX_LISTED_LIGHTS               = 16;
+    static constexpr float INSTANCE_SPACING                = 1.5f;
+
+    static constexpr const char* STRESS_INSTANCE_MODEL = "assets/models/wine_barrel_01_4k/wine_barrel_01_4k.gltf";
 
     void processInput(float deltaTime);
+    void processPendingModels();
+    void spawnInstances(const std::string& path, int count);
     void renderUI();
     void renderSidebar();
 };
@@ -0,0 +1,1078 @@
+#include "pch.h"
+
+#include "editor/tools/benchmark.h"
+#include "engine/core/path_id.h"
+#include "engine/core/thread_pool.h"
+#include "engine/renderer/culling/bvh.h"
+#include "engine/renderer/culling/frustum_culler.h"
+#include "engine/renderer/geometry/mesh_lod.h"
+#include "engine/renderer/geometry/model_importer.h"
+#include "engine/renderer/geometry/vertex_packing.h"
+#include "engine/renderer/lighting/light_clusters.h"
+#include "engine/renderer/lighting/light_manager.h"
+#include "engine/renderer/resources/model_cooker.h"
+#include "engine/renderer/resources/resource_manager.h"
+#include "engine/renderer/resources/texture_resource.h"
+#include "engine/renderer/textures/block_compressor.h"
+#include "engine/renderer/textures/mip_generator.h"
+
+#include "common/logger.h"
+#include "common/memory_usage.h"
+#include "common/timer.h"
+#include "common/stb_image.h"
+
+#include <cstring>
+#include <filesystem>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace
+{
+    const char* MODELS_DIRECTORY = "assets/models";
+
+    std::vector<std::string> findModels()
+    {
+        std::vector<std::string> models;
+        if (!std::filesystem::exists(MODELS_DIRECTORY)) {
+            return models;
+        }
+
+        for (const auto& entry : std::filesystem::recursive_directory_iterator(MODELS_DIRECTORY)) {
+            if (entry.is_regular_file() && entry.path().extension() == ".gltf") {
+                models.push_back(entry.path().generic_string());
+            }
+        }
+
+        std::sort(models.begin(), models.end());
+        return models;
+    }
+
+    std::vector<std::string> findTextures()
+    {
+        std::vector<std::string> textures;
+        if (!std::filesystem::exists(MODELS_DIRECTORY)) {
+            return textures;
+        }
+
+        for (const auto& entry : std::filesystem::recursive_directory_iterator(MODELS_DIRECTORY)) {
+            auto extension = entry.path().extension();
+            if (entry.is_regular_file() && (extension == ".png" || extension == ".jpg")) {
+                textures.push_back(entry.path().generic_string());
+            }
+        }
+
+        std::sort(textures.begin(), textures.end());
+        return textures;
+    }
+
+    // Texture that "loads" without touching the disk or GL, so only the cache itself is measured.
+    class NullTexture : public TextureResource
+    {
+      public:
+        bool load(const std::string& path) override
+        {
+            m_path = path;
+            return true;
+        }
+    };
+} // namespace
+
+bool Benchmark::run(const std::string& name)
+{
+    LOG_INFO("Benchmark: Running '{}'", name);
+
+    if (name == "import") {
+        return runImport();
+    }
+
+    if (name == "cooked") {
+        return runCookedLoad();
+    }
+
+    if (name == "cache") {
+        return runCacheLookup();
+    }
+
+    if (name == "textures") {
+        return runTextureDedup();
+    }
+
+    if (name == "bc") {
+        return runBlockCompression();
+    }
+
+    if (name == "mips") {
+        return runMipGeneration();
+    }
+
+    if (name == "lights") {
+        return runLightClustering();
+    }
+
+    if (name == "culling") {
+        return runFrustumCulling();
+    }
+
+    if (name == "bvh") {
+        return runBvh();
+    }
+
+    if (name == "meshopt") {
+        return runMeshOptimization();
+    }
+
+    if (name == "vertices") {
+        return runVertexPacking();
+    }
+
+    if (name == "lods") {
+        return runLods();
+    }
+
+    LOG_ERROR("Benchmark: Unknown benchmark '{}'", name);
+    return false;
+}
+
+bool Benchmark::runImport()
+{
+    auto models = findModels();
+    if (models.empty()) {
+        LOG_ERROR("Benchmark: No models found in {}", MODELS_DIRECTORY);
+        return false;
+    }
+
+    LOG_INFO("Benchmark: {} worker threads", THREAD_POOL.getWorkerCount());
+
+    // GL upload can't run headless, it is reported by Model when loading in the editor along with the process peak.
+    // The peak here only grows when an import needs more than any before it, so it is an upper bound per model.
+    for (const auto& path : models) {
+        for (bool threaded : {false, true}) {
+            size_t        peakBefore = MemoryUsage::getPeakPrivateBytes();
+            ImportedModel imported;
+            ModelImporter importer;
+            importer.setThreaded(threaded);
+
+            if (!importer.import(path, imported)) {
+                LOG_ERROR("Benchmark: Failed to import {}", path);
+                return false;
+            }
+
+            size_t geometryBytes = 0;
+            for (const auto& mesh : imported.meshes) {
+                geometryBytes += mesh.vertices.capacity() * sizeof(Vertex) + mesh.indices.capacity() * sizeof(uint32_t);
+            }
+            size_t peak = MemoryUsage::getPeakPrivateBytes();
+
+            const ImportStats& stats = imported.stats;
+            LOG_INFO("{} [{}] meshes {}, vertices {}, indices {} - read {:.2f}ms, process {:.2f}ms - geometry {:.1f} MB, process peak {:.1f} MB (+{:.1f} MB)", path,
+                     threaded ? "parallel" : "serial", stats.meshCount, stats.vertexCount, stats.indexCount, stats.readMs, stats.processMs, MemoryUsage::toMegabytes(geometryBytes),
+                     MemoryUsage::toMegabytes(peak), MemoryUsage::toMegabytes(peak - peakBefore));
+            LOG_INFO("{} [{}] arena served {} allocations ({:.1f} MB) from {} heap blocks ({:.1f} MB)", path, threaded ? "parallel" : "serial", stats.arenaAllocations,
+                     MemoryUsage::toMegabytes(stats.arenaBytes), stats.arenaBlockAllocations, MemoryUsage::toMegabytes(stats.arenaBlockBytes));
+        }
+    }
+
+    return true;
+}
+
+bool Benchmark::runCookedLoad()
+{
+    auto models = findModels();
+    if (models.empty()) {
+        LOG_ERROR("Benchmark: No models found in {}", MODELS_DIRECTORY);
+        return false;
+    }
+
+    // Compares the CPU side of both load paths, GL upload is the same for both.
+    for (const auto& path : models) {
+        Timer         timer;
+        ImportedModel imported;
+        ModelImporter importer;
+        if (!importer.import(path, imported)) {
+            LOG_ERROR("Benchmark: Failed to import {}", path);
+            return false;
+        }
+        float assimpMs = timer.getDeltaTime() * 1000.0f;
+
+        ModelCooker cooker;
+        std::string cookedPath = ModelCooker::getCookedPath(path);
+        if (!cooker.isUpToDate(path, cookedPath) && !cooker.cook(path, imported, cookedPath)) {
+            LOG_ERROR("Benchmark: Failed to cook {}", path);
+            return false;
+        }
+        timer.getDeltaTime();
+
+        CookedModel cooked;
+        if (!cooker.isUpToDate(path, cookedPath) || !cooked.open(cookedPath)) {
+            LOG_ERROR("Benchmark: Failed to open {}", cookedPath);
+            return false;
+        }
+
+        // Touch every index so the mapped pages are actually read in.
+        uint64_t checksum = 0;
+        for (uint32_t i = 0; i < cooked.getMeshCount(); i++) {
+            for (uint32_t index : cooked.getIndices(i)) {
+                checksum += index;
+            }
+            checksum += cooked.getVertices(i).size();
+        }
+        float cookedMs = timer.getDeltaTime() * 1000.0f;
+
+        LOG_INFO("{} - assimp {:.2f}ms, cooked {:.2f}ms ({:.1f}x) [checksum {}]", path, assimpMs, cookedMs, cookedMs > 0.0f ? assimpMs / cookedMs : 0.0f, checksum);
+    }
+
+    return true;
+}
+
+bool Benchmark::runCacheLookup()
+{
+    const size_t LOOKUPS = 1000000;
+
+    // Lookup cost should stay flat as the cache grows. With a sweep per lookup it grew with the entry count.
+    for (size_t entryCount : {100, 1000, 10000}) {
+        ResourceCache<TextureResource>                cache;
+        auto                                          makeNull = []() -> std::shared_ptr<TextureResource> { return std::make_shared<NullTexture>(); };
+        std::vector<std::string>                      paths;
+        std::vector<std::shared_ptr<TextureResource>> held;
+
+        for (size_t i = 0; i < entryCount; i++) {
+            paths.push_back(std::format("assets/textures/texture_{}.png", i));
+            held.push_back(cache.get(paths.back(), makeNull));
+        }
+
+        Timer timer;
+        for (size_t i = 0; i < LOOKUPS; i++) {
+            if (!cache.get(paths[i % entryCount], makeNull)) {
+                LOG_ERROR("Benchmark: Lookup failed for {}", paths[i % entryCount]);
+                return false;
+            }
+        }
+        float hitMs = timer.getDeltaTime() * 1000.0f;
+
+        // Release every other entry and reload it, the expired entries are reclaimed as they are reported.
+        for (size_t i = 0; i < entryCount; i += 2) {
+            held[i].reset();
+        }
+        timer.getDeltaTime();
+        for (size_t i = 0; i < entryCount; i += 2) {
+            held[i] = cache.get(paths[i], makeNull);
+        }
+        float reloadMs = timer.getDeltaTime() * 1000.0f;
+
+        LOG_INFO("{} entries - {} lookups in {:.2f}ms ({:.1f}ns each), {} reloads after release in {:.2f}ms", entryCount, LOOKUPS, hitMs, hitMs * 1000000.0f / LOOKUPS, entryCount / 2, reloadMs);
+    }
+
+    return true;
+}
+
+bool Benchmark::runTextureDedup()
+{
+    auto models = findModels();
+    if (models.empty()) {
+        LOG_ERROR("Benchmark: No models found in {}", MODELS_DIRECTORY);
+        return false;
+    }
+
+    // Every texture slot of every bundled model, as directory and relative path the way Model sees them.
+    std::vector<std::pair<std::string, std::string>> slots;
+    for (const auto& path : models) {
+        ImportedModel imported;
+        ModelImporter importer;
+        if (!importer.import(path, imported)) {
+            LOG_ERROR("Benchmark: Failed to import {}", path);
+            return false;
+        }
+
+        for (const auto& mesh : imported.meshes) {
+            for (const auto& texture : mesh.textures) {
+                slots.emplace_back(imported.directory, std::string(texture.path));
+            }
+        }
+    }
+
+    if (slots.empty()) {
+        LOG_ERROR("Benchmark: The models in {} reference no textures", MODELS_DIRECTORY);
+        return false;
+    }
+
+    // Each slot is requested as written and again through another spelling of the same file, which used to be a
+    // second decode of it.
+    ResourceCache<TextureResource>                cache;
+    auto                                          makeNull = []() -> std::shared_ptr<TextureResource> { return std::make_shared<NullTexture>(); };
+    std::vector<std::shared_ptr<TextureResource>> held;
+    std::unordered_set<std::string>               rawPaths;
+    std::unordered_set<std::string>               canonicalPaths;
+
+    for (const auto& [directory, relative] : slots) {
+        std::string written   = directory + '/' + relative;
+        std::string respelled = "./" + directory + "/./" + relative;
+        std::replace(respelled.begin(), respelled.end(), '/', '\\');
+
+        for (const std::string& path : {written, respelled}) {
+            rawPaths.insert(path);
+            canonicalPaths.insert(PathId::normalize(path));
+            held.push_back(cache.get(path, makeNull));
+        }
+    }
+
+    if (cache.getCount() != canonicalPaths.size()) {
+        LOG_ERROR("Benchmark: Cache holds {} textures for {} distinct files", cache.getCount(), canonicalPaths.size());
+        return false;
+    }
+
+    LOG_INFO("{} models, {} texture slots - {} distinct paths as written, {} textures after canonicalization", models.size(), slots.size(), rawPaths.size(), cache.getCount());
+
+    // Model's lookup for a slot it may have seen already. Keyed by string it has to build the joined path first.
+    const size_t                                     LOOKUPS = 1000000;
+    std::unordered_map<std::string, size_t>          byString;
+    std::unordered_map<PathId, size_t, PathId::Hash> byId;
+    for (size_t i = 0; i < slots.size(); i++) {
+        byString.emplace(slots[i].first + '/' + slots[i].second, i);
+        byId.emplace(PathId(slots[i].first, slots[i].second), i);
+    }
+
+    Timer  timer;
+    size_t stringHits = 0;
+    for (size_t i = 0; i < LOOKUPS; i++) {
+        const auto& [directory, relative] = slots[i % slots.size()];
+        stringHits += byString.count(directory + '/' + relative);
+    }
+    float stringMs = timer.getDeltaTime() * 1000.0f;
+
+    size_t idHits = 0;
+    for (size_t i = 0; i < LOOKUPS; i++) {
+        const auto& [directory, relative] = slots[i % slots.size()];
+        idHits += byId.count(PathId(directory, relative));
+    }
+    float idMs = timer.getDeltaTime() * 1000.0f;
+
+    if (stringHits != LOOKUPS || idHits != LOOKUPS) {
+        LOG_ERROR("Benchmark: {} string and {} id lookups of {} hit", stringHits, idHits, LOOKUPS);
+        return false;
+    }
+
+    LOG_INFO("{} slot lookups - string key {:.2f}ms ({:.1f}ns each), path id {:.2f}ms ({:.1f}ns each, {:.1f}x)", LOOKUPS, stringMs, stringMs * 1000000.0f / LOOKUPS, idMs,
+             idMs * 1000000.0f / LOOKUPS, idMs > 0.0f ? stringMs / idMs : 0.0f);
+    return true;
+}
+
+bool Benchmark::runBlockCompression()
+{
+    auto textures = findTextures();
+    if (textures.empty()) {
+        LOG_ERROR("Benchmark: No textures found in {}", MODELS_DIRECTORY);
+        return false;
+    }
+
+    // A handful is enough, the 4k textures take seconds each in BC7 on one thread.
+    const size_t MAX_TEXTURES = 4;
+    textures.resize(std::min(textures.size(), MAX_TEXTURES));
+
+    for (const auto& path : textures) {
+        int            width    = 0;
+        int            height   = 0;
+        int            channels = 0;
+        unsigned char* pixels   = stbi_load(path.c_str(), &width, &height, &channels, 4);
+        if (!pixels) {
+            LOG_ERROR("Benchmark: Failed to load {} - {}", path, stbi_failure_reason());
+            return false;
+        }
+
+        double megapixels = static_cast<double>(width) * height / 1000000.0;
+        for (BlockFormat format : {BlockFormat::BC1, BlockFormat::BC4, BlockFormat::BC5, BlockFormat::BC7}) {
+            BlockCompressor      compressor;
+            std::vector<uint8_t> blocks;
+            std::vector<uint8_t> decoded;
+
+            Timer timer;
+            compressor.setThreaded(false);
+            compressor.compress(pixels, width, height, format, blocks);
+            float serialMs = timer.getDeltaTime() * 1000.0f;
+
+            compressor.setThreaded(true);
+            compressor.compress(pixels, width, height, format, blocks);
+            float threadedMs = timer.getDeltaTime() * 1000.0f;
+
+            BlockCompressor::decompress(blocks.data(), width, height, format, decoded);
+            float psnr = BlockCompressor::computePSNR(pixels, decoded.data(), width, height, format);
+
+            LOG_INFO("{} {} - {}x{}, serial {:.1f} MPix/s, threaded {:.1f} MPix/s, PSNR {:.2f} dB", path, BlockCompressor::getFormatName(format), width, height, megapixels * 1000.0 / serialMs,
+                     megapixels * 1000.0 / threadedMs, psnr);
+        }
+
+        stbi_image_free(pixels);
+    }
+
+    return true;
+}
+
+bool Benchmark::runMipGeneration()
+{
+    const uint32_t SIZE = 4096;
+
+    // Noise keeps every filter tap busy, a real texture wouldn't change the cost.
+    TextureData source;
+    source.width    = SIZE;
+    source.height   = SIZE;
+    source.channels = 4;
+    source.levels.resize(1);
+    source.levels[0].width  = SIZE;
+    source.levels[0].height = SIZE;
+    source.levels[0].data.resize(static_cast<size_t>(SIZE) * SIZE * 4);
+
+    uint32_t state = 0x12345678;
+    for (auto& value : source.levels[0].data) {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        value = static_cast<uint8_t>(state);
+    }
+
+    double megapixels = static_cast<double>(SIZE) * SIZE / 1000000.0;
+    for (MipFilter filter : {MipFilter::Box, MipFilter::Kaiser, MipFilter::Lanczos}) {
+        MipGenerator generator;
+        generator.setFilter(filter);
+        generator.setSRGB(true);
+
+        TextureData reference  = source;
+        TextureData vectorized = source;
+        TextureData threaded   = source;
+
+        Timer timer;
+        generator.setVectorized(false);
+        generator.setThreaded(false);
+        generator.generate(reference);
+        float scalarMs = timer.getDeltaTime() * 1000.0f;
+
+        generator.setVectorized(true);
+        generator.generate(vectorized);
+        float simdMs = timer.getDeltaTime() * 1000.0f;
+
+        generator.setThreaded(true);
+        generator.generate(threaded);
+        float threadedMs = timer.getDeltaTime() * 1000.0f;
+
+        for (size_t i = 1; i < reference.levels.size(); i++) {
+            if (reference.levels[i].data != vectorized.levels[i].data || reference.levels[i].data != threaded.levels[i].data) {
+                LOG_ERROR("Benchmark: {} level {} differs from the scalar reference", MipGenerator::getFilterName(filter), i);
+                return false;
+            }
+        }
+
+        LOG_INFO("{} {}x{} - scalar {:.1f}ms ({:.1f} MPix/s), SIMD {:.1f}ms ({:.1f}x), SIMD + threads {:.1f}ms ({:.1f}x)", MipGenerator::getFilterName(filter), SIZE, SIZE, scalarMs,
+                 megapixels * 1000.0 / scalarMs, simdMs, scalarMs / simdMs, threadedMs, scalarMs / threadedMs);
+    }
+
+    return true;
+}
+
+bool Benchmark::runLightClustering()
+{
+    const int   ITERATIONS = 20;
+    const float ASPECT     = 16.0f / 9.0f;
+
+    // The camera sits at the edge of the box looking through it, so most lights are in view at some depth.
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 2.0f, 12.0f), glm::vec3(0.0f, 2.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+    for (size_t count : {64, 256, 1024, 4096, 16384}) {
+        LightManager manager;
+        manager.addLight(Light::createSunLight());
+        manager.addRandomLights(count, glm::vec3(-20.0f, -2.0f, -40.0f), glm::vec3(20.0f, 8.0f, 10.0f));
+
+        const std::vector<LightBlock>& lights = manager.getPackedLights();
+
+        LightClusters reference;
+        reference.setProjection(glm::radians(45.0f), ASPECT, 0.1f, 100.0f);
+        reference.setVectorized(false);
+        reference.setThreaded(false);
+
+        LightClusters clusters;
+        clusters.setProjection(glm::radians(45.0f), ASPECT, 0.1f, 100.0f);
+
+        float scalarMs   = 0.0f;
+        float simdMs     = 0.0f;
+        float threadedMs = 0.0f;
+        for (int i = 0; i < ITERATIONS; i++) {
+            reference.assign(lights, manager.getDirectionalCount(), view);
+            scalarMs += reference.getAssignMs();
+
+            clusters.setThreaded(false);
+            clusters.assign(lights, manager.getDirectionalCount(), view);
+            simdMs += clusters.getAssignMs();
+
+            clusters.setThreaded(true);
+            clusters.assign(lights, manager.getDirectionalCount(), view);
+            threadedMs += clusters.getAssignMs();
+        }
+
+        if (clusters.getLightIndices() != reference.getLightIndices()) {
+            LOG_ERROR("Benchmark: {} lights assigned differently than the scalar reference", count);
+            return false;
+        }
+
+        size_t assignments = clusters.getLightIndices().size();
+        LOG_INFO("{:>5} lights - scalar {:.3f}ms, SIMD {:.3f}ms ({:.1f}x), SIMD + threads {:.3f}ms ({:.1f}x), {} assignments, {:.1f} per cluster, max {}", count,
+                 scalarMs / ITERATIONS, simdMs / ITERATIONS, scalarMs / simdMs, threadedMs / ITERATIONS, scalarMs / threadedMs, assignments,
+                 static_cast<double>(assignments) / LightClusters::CLUSTER_COUNT, clusters.getMaxLightsPerCluster());
+    }
+
+    LOG_INFO("GPU time needs a context, spawn the same lights from the editor sidebar and read it from the viewport overlay.");
+    return true;
+}
+
+bool Benchmark::runFrustumCulling()
+{
+    const uint32_t BOX_COUNT  = 100000;
+    const int      ITERATIONS = 50;
+
+    glm::mat4 projection     = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 100.0f);
+    glm::mat4 view           = glm::lookAt(glm::vec3(0.0f, 5.0f, 0.0f), glm::vec3(0.0f, 5.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 viewProjection = projection * view;
+
+    // Unit boxes with random scale and rotation scattered around the camera, about one in twenty ends up in view.
+    uint32_t state  = 0x2545F491;
+    auto     random = [&state]() {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return static_cast<float>(state & 0xFFFFFF) / static_cast<float>(0xFFFFFF);
+    };
+
+    std::vector<glm::mat4> transforms(BOX_COUNT);
+    for (auto& transform : transforms) {
+        glm::vec3 position(random() * 400.0f - 200.0f, random() * 20.0f - 5.0f, random() * 400.0f - 200.0f);
+        transform = glm::translate(glm::mat4(1.0f), position);
+        transform = glm::rotate(transform, random() * 6.2831853f, glm::normalize(glm::vec3(random(), random(), random()) + glm::vec3(0.01f)));
+        transform = glm::scale(transform, glm::vec3(0.2f + random() * 4.0f));
+    }
+
+    const glm::vec3 localMin(-0.5f);
+    const glm::vec3 localMax(0.5f);
+
+    std::vector<uint8_t> reference;
+    std::vector<CullPath> paths = {CullPath::Scalar, CullPath::SSE};
+    if (FrustumCuller::getBestPath() == CullPath::AVX) {
+        paths.push_back(CullPath::AVX);
+    }
+
+    const char* pathNames[] = {"scalar", "SSE", "AVX"};
+    float       scalarMs    = 0.0f;
+    for (CullPath path : paths) {
+        FrustumCuller culler;
+        culler.setPath(path);
+        culler.setFrustum(viewProjection);
+
+        Timer timer;
+        for (int i = 0; i < ITERATIONS; i++) {
+            culler.clear();
+            for (const auto& transform : transforms) {
+                culler.add(localMin, localMax, transform);
+            }
+        }
+        float addMs = timer.getDeltaTime() * 1000.0f / ITERATIONS;
+
+        for (int i = 0; i < ITERATIONS; i++) {
+            culler.cull();
+        }
+        float cullMs = timer.getDeltaTime() * 1000.0f / ITERATIONS;
+
+        std::vector<uint8_t> visible(BOX_COUNT);
+        for (uint32_t i = 0; i < BOX_COUNT; i++) {
+            visible[i] = culler.isVisible(i) ? 1 : 0;
+        }
+
+        if (path == CullPath::Scalar) {
+            reference = visible;
+            scalarMs  = cullMs;
+        } else if (visible != reference) {
+            LOG_ERROR("Benchmark: {} culling disagrees with the scalar reference", pathNames[static_cast<uint32_t>(path)]);
+            return false;
+        }
+
+        LOG_INFO("{:>6} - {} boxes, transform {:.3f}ms, cull {:.3f}ms ({:.2f} ns/box, {:.1f}x), {} visible", pathNames[static_cast<uint32_t>(path)], BOX_COUNT, addMs, cullMs,
+                 cullMs * 1000000.0f / BOX_COUNT, scalarMs / cullMs, culler.getVisibleCount());
+    }
+
+    // Against the exact answer from clip space: a box with any corner inside the frustum must never be culled.
+    uint32_t wronglyCulled = 0;
+    uint32_t looseVisible  = 0;
+    for (uint32_t i = 0; i < BOX_COUNT; i++) {
+        bool cornerInside = false;
+        for (int corner = 0; corner < 8 && !cornerInside; corner++) {
+            glm::vec3 local((corner & 1) ? localMax.x : localMin.x, (corner & 2) ? localMax.y : localMin.y, (corner & 4) ? localMax.z : localMin.z);
+            glm::vec4 clip = viewProjection * transforms[i] * glm::vec4(local, 1.0f);
+            cornerInside   = std::abs(clip.x) <= clip.w && std::abs(clip.y) <= clip.w && std::abs(clip.z) <= clip.w;
+        }
+
+        if (cornerInside && !reference[i]) {
+            wronglyCulled++;
+        } else if (!cornerInside && reference[i]) {
+            looseVisible++;
+        }
+    }
+
+    if (wronglyCulled > 0) {
+        LOG_ERROR("Benchmark: {} boxes with a corner in view were culled", wronglyCulled);
+        return false;
+    }
+
+    LOG_INFO("No visible box was culled, {} kept without a corner in view (large boxes and the conservative corner case)", looseVisible);
+    return true;
+}
+
+bool Benchmark::runBvh()
+{
+    const uint32_t RAY_COUNT   = 1000;
+    const uint32_t QUERY_COUNT = 100;
+
+    uint32_t state  = 0x6C078965;
+    auto     random = [&state]() {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return static_cast<float>(state & 0xFFFFFF) / static_cast<float>(0xFFFFFF);
+    };
+
+    auto sorted = [](std::vector<uint32_t>& items) -> std::vector<uint32_t>& {
+        std::sort(items.begin(), items.end());
+        return items;
+    };
+
+    for (uint32_t count : {10000u, 100000u, 1000000u}) {
+        // Same density at every size, the world grows with the instance count. The camera sits in the middle.
+        float half = 100.0f * std::cbrt(count / 10000.0f);
+
+        std::vector<Aabb> bounds(count);
+        for (auto& box : bounds) {
+            glm::vec3 center(random() * 2.0f * half - half, random() * 20.0f - 5.0f, random() * 2.0f * half - half);
+            glm::vec3 extent = glm::vec3(0.1f) + glm::vec3(random(), random(), random()) * 2.0f;
+            box              = Aabb(center - extent, center + extent);
+        }
+
+        glm::mat4 projection     = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, half);
+        glm::mat4 view           = glm::lookAt(glm::vec3(0.0f, 5.0f, 0.0f), glm::vec3(1.0f, 4.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+        Frustum   frustum        = Frustum::fromMatrix(projection * view);
+        glm::mat4 viewProjection = projection * view;
+
+        Timer timer;
+        Bvh   bvh;
+        bvh.build(bounds);
+        float buildMs = timer.getDeltaTime() * 1000.0f;
+
+        // Frustum: the BVH against a linear SIMD pass over every box, both checked against testing each box on its own.
+        std::vector<uint32_t> found;
+        for (uint32_t i = 0; i < QUERY_COUNT; i++) {
+            found.clear();
+            bvh.queryFrustum(frustum, found);
+        }
+        float frustumMs = timer.getDeltaTime() * 1000.0f / QUERY_COUNT;
+
+        FrustumCuller culler;
+        culler.setFrustum(viewProjection);
+        for (const auto& box : bounds) {
+            culler.add(box);
+        }
+        timer.getDeltaTime();
+        for (uint32_t i = 0; i < QUERY_COUNT; i++) {
+            culler.cull();
+        }
+        float linearMs = timer.getDeltaTime() * 1000.0f / QUERY_COUNT;
+
+        auto checkFrustum = [&](const char* when) {
+            std::vector<uint32_t> expected;
+            for (uint32_t i = 0; i < count; i++) {
+                if (frustum.test(bounds[i]) != FrustumTest::Outside) {
+                    expected.push_back(i);
+                }
+            }
+
+            found.clear();
+            bvh.queryFrustum(frustum, found);
+            if (sorted(found) != expected) {
+                LOG_ERROR("Benchmark: BVH frustum query {} returned {} boxes, testing every box gives {}", when, found.size(), expected.size());
+                return false;
+            }
+            return true;
+        };
+
+        if (!checkFrustum("after the build")) {
+            return false;
+        }
+
+        // Rays from inside the world in random directions, checked against the closest hit over every box.
+        std::vector<glm::vec3> origins(RAY_COUNT);
+        std::vector<glm::vec3> directions(RAY_COUNT);
+        for (uint32_t i = 0; i < RAY_COUNT; i++) {
+            origins[i]    = glm::vec3(random() * 2.0f * half - half, random() * 20.0f - 5.0f, random() * 2.0f * half - half);
+            directions[i] = glm::normalize(glm::vec3(random() - 0.5f, (random() - 0.5f) * 0.2f, random() - 0.5f) + glm::vec3(0.0f, 0.0f, 0.001f));
+        }
+
+        std::vector<RayHit> hits(RAY_COUNT);
+        timer.getDeltaTime();
+        for (uint32_t i = 0; i < RAY_COUNT; i++) {
+            hits[i] = bvh.raycast(origins[i], directions[i]);
+        }
+        float rayMs = timer.getDeltaTime() * 1000.0f;
+
+        uint32_t rayHits = 0;
+        for (uint32_t i = 0; i < RAY_COUNT; i += 10) {
+            float closest = FLT_MAX;
+            for (const auto& box : bounds) {
+                glm::vec3 t1    = (box.min - origins[i]) / directions[i];
+                glm::vec3 t2    = (box.max - origins[i]) / directions[i];
+                glm::vec3 near  = glm::min(t1, t2);
+                glm::vec3 far   = glm::max(t1, t2);
+                float     entry = std::max(std::max(near.x, near.y), std::max(near.z, 0.0f));
+                if (entry <= std::min(std::min(far.x, far.y), far.z)) {
+                    closest = std::min(closest, entry);
+                }
+            }
+
+            if (std::abs(closest - hits[i].distance) > 0.001f * std::max(1.0f, closest)) {
+                LOG_ERROR("Benchmark: BVH ray {} hit at {}, testing every box gives {}", i, hits[i].distance, closest);
+                return false;
+            }
+            rayHits += hits[i].isHit();
+        }
+
+        // Sphere and box overlap around random points, the kind of query gameplay and editor tools make.
+        std::vector<uint32_t> expected;
+        float                 sphereMs = 0.0f;
+        float                 boxMs    = 0.0f;
+        for (uint32_t i = 0; i < QUERY_COUNT; i++) {
+            glm::vec3 center(random() * 2.0f * half - half, random() * 20.0f - 5.0f, random() * 2.0f * half - half);
+            float     radius = 5.0f + random() * 20.0f;
+            Aabb      area(center - glm::vec3(radius), center + glm::vec3(radius));
+
+            found.clear();
+            timer.getDeltaTime();
+            bvh.querySphere(center, radius, found);
+            sphereMs += timer.getDeltaTime() * 1000.0f;
+
+            expected.clear();
+            for (uint32_t item = 0; item < count; item++) {
+                if (bounds[item].getDistanceSquared(center) <= radius * radius) {
+                    expected.push_back(item);
+                }
+            }
+            if (sorted(found) != expected) {
+                LOG_ERROR("Benchmark: BVH sphere query returned {} boxes, testing every box gives {}", found.size(), expected.size());
+                return false;
+            }
+
+            found.clear();
+            timer.getDeltaTime();
+            bvh.queryBox(area, found);
+            boxMs += timer.getDeltaTime() * 1000.0f;
+
+            expected.clear();
+            for (uint32_t item = 0; item < count; item++) {
+                if (bounds[item].overlaps(area)) {
+                    expected.push_back(item);
+                }
+            }
+            if (sorted(found) != expected) {
+                LOG_ERROR("Benchmark: BVH box query returned {} boxes, testing every box gives {}", found.size(), expected.size());
+                return false;
+            }
+        }
+
+        // Move one instance in ten and refit, against building from scratch.
+        for (uint32_t i = 0; i < count; i += 10) {
+            glm::vec3 offset = glm::vec3(random() - 0.5f, random() - 0.5f, random() - 0.5f) * 10.0f;
+            bounds[i]        = Aabb(bounds[i].min + offset, bounds[i].max + offset);
+        }
+
+        timer.getDeltaTime();
+        for (uint32_t i = 0; i < count; i += 10) {
+            bvh.update(i, bounds[i]);
+        }
+        bvh.refit();
+        float refitMs = timer.getDeltaTime() * 1000.0f;
+
+        if (!checkFrustum("after the refit")) {
+            return false;
+        }
+        float refitRatio = bvh.getRefitRatio();
+
+        timer.getDeltaTime();
+        bvh.build(bounds);
+        float rebuildMs = timer.getDeltaTime() * 1000.0f;
+
+        LOG_INFO("{:>7} instances - build {:.2f}ms ({} nodes), refit 10% {:.3f}ms (area {:.2f}x, rebuild {:.2f}ms)", count, buildMs, bvh.getNodeCount(), refitMs, refitRatio, rebuildMs);
+        LOG_INFO("{:>7} frustum {:.3f}ms vs linear {:.3f}ms ({:.1f}x), {} visible", "", frustumMs, linearMs, linearMs / frustumMs, culler.getVisibleCount());
+        LOG_INFO("{:>7} {} rays {:.3f}ms ({:.2f} us/ray, {} of {} checked hit), sphere {:.3f}ms, box {:.3f}ms per query", "", RAY_COUNT, rayMs, rayMs * 1000.0f / RAY_COUNT, rayHits,
+                 RAY_COUNT / 10, sphereMs / QUERY_COUNT, boxMs / QUERY_COUNT);
+    }
+
+    LOG_INFO("Every BVH query matched testing each box on its own");
+    return true;
+}
+
+bool Benchmark::runMeshOptimization()
+{
+    auto models = findModels();
+    if (models.empty()) {
+        LOG_ERROR("Benchmark: No models found in {}", MODELS_DIRECTORY);
+        return false;
+    }
+
+    // The cache numbers come from the simulated FIFO cache, see MeshOptimizer::analyzeVertexCache.
+    for (const auto& path : models) {
+        ImportedModel first;
+        ImportedModel second;
+        ModelImporter importer;
+        if (!importer.import(path, first) || !importer.import(path, second)) {
+            LOG_ERROR("Benchmark: Failed to import {}", path);
+            return false;
+        }
+
+        // Cooked blobs are compared byte for byte between runs, so the same input has to give the same order.
+        for (size_t i = 0; i < first.meshes.size(); i++) {
+            const ImportedMesh& a = first.meshes[i];
+            const ImportedMesh& b = second.meshes[i];
+            if (a.indices != b.indices || a.vertices.size() != b.vertices.size() || std::memcmp(a.vertices.data(), b.vertices.data(), a.vertices.size() * sizeof(Vertex)) != 0) {
+                LOG_ERROR("Benchmark: Mesh {} of {} came out different on the second import", i, path);
+                return false;
+            }
+        }
+
+        const ImportStats& stats = first.stats;
+        LOG_INFO("{} - {} triangles, optimize {:.2f}ms, ACMR {:.3f} -> {:.3f}, ATVR {:.3f} -> {:.3f}", path, stats.cacheBefore.triangles, stats.optimizeMs, stats.cacheBefore.getAcmr(),
+                 stats.cacheAfter.getAcmr(), stats.cacheBefore.getAtvr(), stats.cacheAfter.getAtvr());
+    }
+
+    return true;
+}
+
+bool Benchmark::runVertexPacking()
+{
+    auto models = findModels();
+    if (models.empty()) {
+        LOG_ERROR("Benchmark: No models found in {}", MODELS_DIRECTORY);
+        return false;
+    }
+
+    // Tolerances the packed layout is expected to meet against the float path. Octahedral snorm16 with the best of
+    // four codes stays under 0.003 degrees, positions within half a step of the mesh bounds, UVs within half a ULP.
+    const float MAX_DIRECTION_DEGREES = 0.005f;
+    const float DEGREES_PER_RADIAN    = 57.2957795f;
+
+    auto getAngle = [&](const glm::vec3& a, const glm::vec3& b) {
+        glm::vec3 x = glm::normalize(a);
+        glm::vec3 y = glm::normalize(b);
+        return std::atan2(glm::length(glm::cross(x, y)), glm::dot(x, y)) * DEGREES_PER_RADIAN;
+    };
+
+    for (const auto& path : models) {
+        ImportedModel imported;
+        ModelImporter importer;
+        if (!importer.import(path, imported)) {
+            LOG_ERROR("Benchmark: Failed to import {}", path);
+            return false;
+        }
+
+        size_t vertexCount      = 0;
+        float  packMs           = 0.0f;
+        float  maxPosition      = 0.0f; // Relative to the mesh bounds diagonal
+        float  maxNormal        = 0.0f;
+        float  maxTangent       = 0.0f;
+        float  maxTexCoord      = 0.0f;
+        size_t flippedBitangent = 0;
+
+        for (const auto& mesh : imported.meshes) {
+            if (mesh.vertices.empty()) {
+                continue;
+            }
+
+            glm::vec3 min = mesh.vertices[0].pos;
+            glm::vec3 max = mesh.vertices[0].pos;
+            for (const auto& vertex : mesh.vertices) {
+                min = glm::min(min, vertex.pos);
+                max = glm::max(max, vertex.pos);
+            }
+            VertexQuantization quantization = VertexQuantization::fromBounds(min, max);
+            float              diagonal     = std::max(glm::length(max - min), 1e-8f);
+
+            Timer                     timer;
+            std::vector<PackedVertex> packed;
+            VertexPacking::pack(mesh.vertices, quantization, packed);
+            packMs += timer.getTime() * 1000.0f;
+
+            for (size_t i = 0; i < packed.size(); i++) {
+                const Vertex& source   = mesh.vertices[i];
+                Vertex        unpacked = VertexPacking::unpack(packed[i], quantization);
+
+                glm::vec3 positionError = glm::abs(unpacked.pos - source.pos);
+                glm::vec3 step          = quantization.scale / 65535.0f;
+                if (positionError.x > step.x || positionError.y > step.y || positionError.z > step.z) {
+                    LOG_ERROR("Benchmark: Vertex {} of {} moved more than one quantization step", i, path);
+                    return false;
+                }
+                maxPosition = std::max(maxPosition, glm::length(positionError) / diagonal);
+
+                if (glm::length(source.normal) > 0.0f) {
+                    maxNormal = std::max(maxNormal, getAngle(source.normal, unpacked.normal));
+                }
+                if (glm::length(source.tangent) > 0.0f) {
+                    maxTangent = std::max(maxTangent, getAngle(source.tangent, unpacked.tangent));
+                }
+
+                // Only the handedness is kept, so the rebuilt bitangent has to point to the same side as the source one.
+                if (glm::length(source.bitangent) > 0.0f && glm::dot(source.bitangent, unpacked.bitangent) < 0.0f) {
+                    flippedBitangent++;
+                }
+
+                glm::vec2 uvError(std::abs(unpacked.texCoords.x - source.texCoords.x), std::abs(unpacked.texCoords.y - source.texCoords.y));
+                glm::vec2 uvLimit(std::max(std::abs(source.texCoords.x) / 2048.0f, 1.0f / 33554432.0f), std::max(std::abs(source.texCoords.y) / 2048.0f, 1.0f / 33554432.0f));
+                if (uvError.x > uvLimit.x || uvError.y > uvLimit.y) {
+                    LOG_ERROR("Benchmark: UV {} of {} is off by more than half a ULP", i, path);
+                    return false;
+                }
+                maxTexCoord = std::max(maxTexCoord, std::max(uvError.x, uvError.y));
+            }
+            vertexCount += packed.size();
+        }
+
+        if (maxNormal > MAX_DIRECTION_DEGREES || maxTangent > MAX_DIRECTION_DEGREES || flippedBitangent > 0) {
+            LOG_ERROR("Benchmark: {} normal {:.4f} deg, tangent {:.4f} deg, {} flipped bitangents", path, maxNormal, maxTangent, flippedBitangent);
+            return false;
+        }
+
+        size_t floatBytes  = vertexCount * Mesh::getVertexSize(VertexFormat::Float);
+        size_t packedBytes = vertexCount * Mesh::getVertexSize(VertexFormat::Packed);
+        LOG_INFO("{} - {} vertices, {:.2f} MB -> {:.2f} MB ({:.1f}x), pack {:.2f}ms", path, vertexCount, floatBytes / (1024.0f * 1024.0f), packedBytes / (1024.0f * 1024.0f),
+                 static_cast<float>(floatBytes) / std::max<size_t>(packedBytes, 1), packMs);
+        LOG_INFO("{:>4} max error: position {:.2e} of the diagonal, normal {:.4f} deg, tangent {:.4f} deg, uv {:.2e}", "", maxPosition, maxNormal, maxTangent, maxTexCoord);
+    }
+
+    return true;
+}
+
+bool Benchmark::runLods()
+{
+    auto models = findModels();
+    if (models.empty()) {
+        LOG_ERROR("Benchmark: No models found in {}", MODELS_DIRECTORY);
+        return false;
+    }
+
+    // A field of copies on a grid spaced by the model's size, seen from a camera that flies in over it from outside.
+    // Without a GL context the GPU side isn't measured here, the viewport overlay shows its time and throughput.
+    const uint32_t FIELD_SIZE      = 1000;
+    const int      FRAME_COUNT     = 60;
+    const float    VIEWPORT_HEIGHT = 1080.0f;
+    const float    MAX_PIXEL_ERROR = 1.0f;
+
+    LodSelector selector;
+    selector.setProjection(glm::radians(45.0f), VIEWPORT_HEIGHT);
+    selector.setMaxPixelError(MAX_PIXEL_ERROR);
+
+    for (const auto& path : models) {
+        ImportedModel imported;
+        ModelImporter importer;
+        if (!importer.import(path, imported)) {
+            LOG_ERROR("Benchmark: Failed to import {}", path);
+            return false;
+        }
+
+        struct MeshBounds {
+            glm::vec3 center;
+            float     radius;
+        };
+
+        std::vector<MeshBounds> meshBounds;
+        glm::vec3               modelMin(FLT_MAX);
+        glm::vec3               modelMax(-FLT_MAX);
+        uint64_t                levelTriangles[MeshLod::MAX_COUNT] = {};
+        float                   levelErrors[MeshLod::MAX_COUNT]    = {};
+
+        for (size_t i = 0; i < imported.meshes.size(); i++) {
+            const ImportedMesh& mesh = imported.meshes[i];
+            if (mesh.lods.empty() || mesh.lods[0].firstIndex != 0) {
+                LOG_ERROR("Benchmark: Mesh {} of {} has no full detail level", i, path);
+                return false;
+            }
+
+            glm::vec3 min(FLT_MAX);
+            glm::vec3 max(-FLT_MAX);
+            for (const auto& vertex : mesh.vertices) {
+                min = glm::min(min, vertex.pos);
+                max = glm::max(max, vertex.pos);
+            }
+            modelMin = glm::min(modelMin, min);
+            modelMax = glm::max(modelMax, max);
+            meshBounds.push_back({(min + max) * 0.5f, glm::length(max - min) * 0.5f});
+
+            // Every level is a valid range of fewer triangles with at least the error of the one before. Meshes with
+            // a shorter chain count their coarsest level for the levels they don't have.
+            for (uint32_t level = 0; level < MeshLod::MAX_COUNT; level++) {
+                const MeshLod& lod = mesh.lods[std::min<size_t>(level, mesh.lods.size() - 1)];
+                if (level < mesh.lods.size()) {
+                    bool inRange  = static_cast<size_t>(lod.firstIndex) + lod.indexCount <= mesh.indices.size() && lod.indexCount % 3 == 0;
+                    bool smaller  = level == 0 || lod.indexCount < mesh.lods[level - 1].indexCount;
+                    bool rougher  = level == 0 || lod.error >= mesh.lods[level - 1].error;
+                    bool validIds = inRange && std::all_of(mesh.indices.begin() + lod.firstIndex, mesh.indices.begin() + lod.firstIndex + lod.indexCount,
+                                                           [&](uint32_t index) { return index < mesh.vertices.size(); });
+                    if (!smaller || !rougher || !validIds) {
+                        LOG_ERROR("Benchmark: LOD {} of mesh {} of {} is invalid", level, i, path);
+                        return false;
+                    }
+                }
+
+                levelTriangles[level] += lod.indexCount / 3;
+                levelErrors[level] = std::max(levelErrors[level], lod.error);
+            }
+        }
+
+        uint64_t fullTriangles = levelTriangles[0];
+        float    modelSize     = std::max(glm::length(modelMax - modelMin), 1e-6f);
+        LOG_INFO("{} - {} meshes, {} triangles, {} LODs built in {:.2f}ms ({:.2f}M triangles/s)", path, imported.meshes.size(), fullTriangles, imported.stats.lodCount,
+                 imported.stats.lodMs, imported.stats.lodMs > 0.0f ? fullTriangles / (imported.stats.lodMs * 1000.0f) : 0.0f);
+        for (uint32_t level = 1; level < MeshLod::MAX_COUNT; level++) {
+            LOG_INFO("{:>4} LOD {}: {} triangles ({:.1f}%), max error {:.5f} ({:.3f}% of the model size)", "", level, levelTriangles[level],
+                     100.0f * levelTriangles[level] / std::max<uint64_t>(fullTriangles, 1), levelErrors[level], 100.0f * levelErrors[level] / modelSize);
+        }
+
+        uint32_t               side    = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<float>(FIELD_SIZE))));
+        float                  spacing = modelSize * 1.5f;
+        std::vector<glm::mat4> transforms(FIELD_SIZE);
+        for (uint32_t i = 0; i < FIELD_SIZE; i++) {
+            glm::vec3 position(static_cast<float>(i % side) - side * 0.5f, 0.0f, static_cast<float>(i / side) - side * 0.5f);
+            transforms[i] = glm::translate(glm::mat4(1.0f), position * spacing);
+        }
+
+        uint64_t drawnTriangles = 0;
+        uint64_t instances      = 0;
+        uint32_t lodHistogram[MeshLod::MAX_COUNT] = {};
+        Timer    timer;
+        for (int frame = 0; frame < FRAME_COUNT; frame++) {
+            float     t      = static_cast<float>(frame) / (FRAME_COUNT - 1);
+            float     reach  = side * spacing;
+            glm::vec3 eye    = glm::vec3(0.0f, modelSize, -reach * (1.5f - t));
+            glm::mat4 view   = glm::lookAt(eye, glm::vec3(0.0f, 0.0f, reach * 0.5f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+            for (const auto& transform : transforms) {
+                for (size_t i = 0; i < imported.meshes.size(); i++) {
+                    const ImportedMesh& mesh   = imported.meshes[i];
+                    glm::vec3           center = glm::vec3(view * (transform * glm::vec4(meshBounds[i].center, 1.0f)));
+                    uint32_t            lod    = selector.select(mesh.lods, center, meshBounds[i].radius, transform);
+
+                    drawnTriangles += mesh.lods[lod].indexCount / 3;
+                    lodHistogram[lod]++;
+                    instances++;
+                }
+            }
+        }
+        float selectMs = timer.getTime() * 1000.0f / FRAME_COUNT;
+
+        double drawnPerFrame = static_cast<double>(drawnTriangles) / FRAME_COUNT;
+        double fullPerFrame  = static_cast<double>(fullTriangles) * FIELD_SIZE;
+        LOG_INFO("{:>4} Field of {}: {:.2f}M triangles per frame with LODs, {:.2f}M without ({:.1f}x fewer), LOD selection {:.3f}ms per frame ({:.1f} ns per mesh)", "", FIELD_SIZE,
+                 drawnPerFrame / 1000000.0, fullPerFrame / 1000000.0, fullPerFrame / std::max(drawnPerFrame, 1.0), selectMs, selectMs * 1000000.0f / std::max<uint64_t>(instances / FRAME_COUNT, 1));
+        LOG_INFO("{:>4} Mesh instances per level: {:.1f}% / {:.1f}% / {:.1f}% / {:.1f}% / {:.1f}%", "", 100.0f * lodHistogram[0] / instances, 100.0f * lodHistogram[1] / instances,
+                 100.0f * lodHistogram[2] / instances, 100.0f * lodHistogram[3] / instances, 100.0f * lodHistogram[4] / instances);
+    }
+
+    return true;
+}
@@ -0,0 +1,27 @@
+#ifndef EDITOR_TOOLS_BENCHMARK_H_
+#define EDITOR_TOOLS_BENCHMARK_H_
+
+#include <string>
+
+// Headless benchmarks, run with `engine --bench <name>`. None of them create a window or GL context.
+class Benchmark
+{
+  public:
+    static bool run(const std::string& name);
+
+  private:
+    static bool runImport();
+    static bool runCookedLoad();
+    static bool runCacheLookup();
+    static bool runTextureDedup();
+    static bool runBlockCompression();
+    static bool runMipGeneration();
+    static bool runLightClustering();
+    static bool runFrustumCulling();
+    static bool runBvh();
+    static bool runMeshOptimization();
+    static bool runVertexPacking();
+    static bool runLods();
+};
+
+#endif // EDITOR_TOOLS_BENCHMARK_H_
@@ -1,5 +1,6 @@
 #include "pch.h"
 #include "line_renderer.h"
+#include "engine/renderer/buffers/ring_buffer.h"
 #include "common/logger.h"
 
 const char* LineRenderer::s_vertexShaderSource = R"(
@@ -30,7 +31,6 @@ void main() {
 LineRenderer::LineRenderer()
     : m_shaderProgram(0)
     , m_VAO(0)
-    , m_VBO(0)
     , m_initialized(false)
 {
 }
@@ -65,11 +65,6 @@ void LineRenderer::cleanup()
         m_VAO = 0;
     }
 
-    if (m_VBO) {
-        glDeleteBuffers(1, &m_VBO);
-        m_VBO = 0;
-    }
-
     if (m_shaderProgram) {
         glDeleteProgram(m_shaderProgram);
         m_shaderProgram = 0;
@@ -134,16 +129,16 @@ bool LineRenderer::createShaderProgram()
 
 void LineRenderer::setupGeometry()
 {
+    // Only the layout lives in the VAO, the vertices are in a different part of the frame ring every frame.
     glGenVertexArrays(1, &m_VAO);
-    glGenBuffers(1, &m_VBO);
-
     glBindVertexArray(m_VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
 
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
+    glVertexAttribFormat(0, 3, GL_FLOAT, GL_FALSE, 0);
+    glVertexAttribBinding(0, 0);
     glEnableVertexAttribArray(0);
 
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
+    glVertexAttribFormat(1, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float));
+    glVertexAttribBinding(1, 0);
     glEnableVertexAttribArray(1);
 
     glBindVertexArray(0);
@@ -174,29 +169,25 @@ void LineRenderer::endFrame()
         return;
     }
 
-    std::vector<float> vertices;
-    vertices.reserve(m_lines.size() * 12);
+    // Position and color of both ends, written straight into the mapped ring.
+    const size_t   stride     = 6 * sizeof(float);
+    RingAllocation allocation = FRAME_RING.allocate(m_lines.size() * 2 * stride);
+    float*         vertices   = static_cast<float*>(allocation.data);
 
     for (const auto& line : m_lines) {
-
-        vertices.push_back(line.start.x);
-        vertices.push_back(line.start.y);
-        vertices.push_back(line.start.z);
-        vertices.push_back(line.color.r);
-        vertices.push_back(line.color.g);
-        vertices.push_back(line.color.b);
-
-        vertices.push_back(line.end.x);
-        vertices.push_back(line.end.y);
-        vertices.push_back(line.end.z);
-        vertices.push_back(line.color.r);
-        vertices.push_back(line.color.g);
-        vertices.push_back(line.color.b);
+        for (const glm::vec3& position : {line.start, line.end}) {
+            vertices[0] = position.x;
+            vertices[1] = position.y;
+            vertices[2] = position.z;
+            vertices[3] = line.color.r;
+            vertices[4] = line.color.g;
+            vertices[5] = line.color.b;
+            vertices += 6;
+        }
     }
 
     glBindVertexArray(m_VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_DYNAMIC_DRAW);
+    glBindVertexBuffer(0, allocation.buffer, static_cast<GLintptr>(allocation.offset), stride);
 
     glUseProgram(m_shaderProgram);
     glUniformMatrix4fv(glGetUniformLocation(m_shaderProgram, "viewProjection"), 1, GL_FALSE, glm::value_ptr(m_viewProjection));
@@ -33,7 +33,7 @@ class LineRenderer
     void setupGeometry();
 
     uint32_t  m_shaderProgram;
-    uint32_t  m_VAO, m_VBO;
+    uint32_t  m_VAO;
     glm::mat4 m_viewProjection;
 
     std::vector<DebugLine> m_lines;
@@ -94,6 +94,9 @@ void Engine::run()
         float deltaTime = timer.getDeltaTime();
         m_inputManager->update();
 
+        // Finish any async loads whose decode completed since last frame.
+        RESOURCE_MANAGER.processUploads();
+
         ImGui_ImplOpenGL3_NewFrame();
         ImGui_ImplWin32_NewFrame();
         ImGui::NewFrame();
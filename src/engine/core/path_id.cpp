@@ -0,0 +1,150 @@
+#include "pch.h"
+
+#include "engine/core/path_id.h"
+
+#include "common/hash.h"
+#include "common/logger.h"
+
+#include <mutex>
+#include <unordered_map>
+
+namespace
+{
+    std::mutex                                s_internMutex;
+    std::unordered_map<uint64_t, std::string> s_interned;
+
+    bool isSeparator(char c)
+    {
+        return c == '/' || c == '\\';
+    }
+
+    char toLower(char c)
+    {
+        return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+    }
+} // namespace
+
+PathId::PathId(std::string_view path)
+{
+    char   buffer[MAX_INLINE_LENGTH];
+    size_t length = append(path, buffer, 0, MAX_INLINE_LENGTH);
+    if (length <= MAX_INLINE_LENGTH) {
+        m_value = ::Hash::fnv1a(std::string_view(buffer, length));
+        return;
+    }
+
+    m_value = ::Hash::fnv1a(normalize(path));
+}
+
+PathId::PathId(std::string_view directory, std::string_view relative)
+{
+    if (directory.empty() || isAbsolute(relative)) {
+        *this = PathId(relative);
+        return;
+    }
+
+    char   buffer[MAX_INLINE_LENGTH];
+    size_t length = append(directory, buffer, 0, MAX_INLINE_LENGTH);
+    if (length <= MAX_INLINE_LENGTH) {
+        length = append(relative, buffer, length, MAX_INLINE_LENGTH);
+    }
+    if (length <= MAX_INLINE_LENGTH) {
+        m_value = ::Hash::fnv1a(std::string_view(buffer, length));
+        return;
+    }
+
+    std::string joined;
+    joined.reserve(directory.size() + 1 + relative.size());
+    joined.append(directory).append(1, '/').append(relative);
+    m_value = ::Hash::fnv1a(normalize(joined));
+}
+
+std::string PathId::normalize(std::string_view path)
+{
+    // The canonical form is never longer than the input.
+    std::string result(path.size(), '\0');
+    result.resize(append(path, result.data(), 0, result.size()));
+    return result;
+}
+
+PathId PathId::intern(std::string_view path)
+{
+    std::string canonical = normalize(path);
+    PathId      id;
+    id.m_value = ::Hash::fnv1a(canonical);
+
+    std::lock_guard<std::mutex> lock(s_internMutex);
+    auto [it, inserted] = s_interned.try_emplace(id.m_value, std::move(canonical));
+    if (!inserted && it->second != normalize(path)) {
+        LOG_ERROR("PathId: {} and {} hash to the same id {:016x}", it->second, path, id.m_value);
+    }
+    return id;
+}
+
+std::string PathId::getString(PathId id)
+{
+    std::lock_guard<std::mutex> lock(s_internMutex);
+    auto                        it = s_interned.find(id.m_value);
+    return it != s_interned.end() ? it->second : std::string();
+}
+
+size_t PathId::append(std::string_view path, char* out, size_t length, size_t capacity)
+{
+    if (length == 0 && !path.empty() && isSeparator(path[0])) {
+        if (capacity < 1) {
+            return capacity + 1;
+        }
+        out[length++] = '/';
+    }
+
+    size_t i = 0;
+    while (i < path.size()) {
+        size_t end = i;
+        while (end < path.size() && !isSeparator(path[end])) {
+            end++;
+        }
+
+        std::string_view segment = path.substr(i, end - i);
+        i                        = end + 1;
+        if (segment.empty() || segment == ".") {
+            continue;
+        }
+
+        size_t start = length;
+        while (start > 0 && out[start - 1] != '/') {
+            start--;
+        }
+        std::string_view last(out + start, length - start);
+
+        if (segment == "..") {
+            bool root  = length == 1 && out[0] == '/';
+            bool drive = start == 0 && !last.empty() && last.back() == ':';
+            if (root || drive) {
+                continue; // Nothing above the root
+            }
+            if (!last.empty() && last != "..") {
+                length = start > 1 ? start - 1 : start;
+                continue;
+            }
+        }
+
+        size_t separator = length > 0 && out[length - 1] != '/' ? 1 : 0;
+        if (length + separator + segment.size() > capacity) {
+            return capacity + 1;
+        }
+
+        if (separator) {
+            out[length++] = '/';
+        }
+        for (char c : segment) {
+            out[length++] = toLower(c);
+        }
+    }
+
+    return length;
+}
+
+bool PathId::isAbsolute(std::string_view path)
+{
+    return (!path.empty() && isSeparator(path[0])) || (path.size() >= 2 && path[1] == ':');
+}
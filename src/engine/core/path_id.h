@@ -0,0 +1,50 @@
+#ifndef ENGINE_CORE_PATH_ID_H_
+#define ENGINE_CORE_PATH_ID_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// 64-bit FNV-1a of a canonical path, so every spelling of the same file maps to one key. Canonical means forward
+// slashes, no empty or "." segments, ".." folded into the segment before it where there is one, and lower case since
+// the file system is case insensitive. "./textures/x.png", "textures\X.png" and "a/../textures/x.png" are all the
+// same id. Relative and absolute spellings of one file still differ, nothing is resolved against the disk.
+//
+// Building an id doesn't allocate for paths up to MAX_INLINE_LENGTH, lookups by id are plain integer hashing.
+class PathId
+{
+  public:
+    PathId() = default;
+    explicit PathId(std::string_view path);
+    // directory + '/' + relative without building the joined string, relative is taken as is if it is absolute.
+    PathId(std::string_view directory, std::string_view relative);
+
+    uint64_t getValue() const { return m_value; }
+    bool     isValid() const { return m_value != 0; }
+
+    bool operator==(const PathId&) const = default;
+
+    struct Hash {
+        size_t operator()(PathId id) const { return static_cast<size_t>(id.m_value); }
+    };
+
+    static std::string normalize(std::string_view path);
+
+    // Remembers the canonical string of the id, so caches keyed by id can still list and log their paths. Only
+    // worth it once per new path, a second spelling that hashes to the same id with different text is reported.
+    static PathId      intern(std::string_view path);
+    static std::string getString(PathId id);
+
+    static constexpr size_t MAX_INLINE_LENGTH = 512;
+
+  private:
+    uint64_t m_value = 0;
+
+    // Appends the canonical segments of path to out[0, length). Returns the new length, or capacity + 1 if it
+    // doesn't fit.
+    static size_t append(std::string_view path, char* out, size_t length, size_t capacity);
+    static bool   isAbsolute(std::string_view path);
+};
+
+#endif // ENGINE_CORE_PATH_ID_H_
@@ -4,6 +4,8 @@
 #include <memory>
 #include <string>
 
+enum class ResourceState { Pending, Ready, Failed };
+
 class IResource
 {
   public:
@@ -12,6 +14,19 @@ class IResource
     virtual void unload()                      = 0;
     virtual bool isLoaded() const              = 0;
 
+    // Bytes this resource keeps alive on the CPU and GPU, used for the cache budget.
+    virtual size_t getMemoryUsage() const { return 0; }
+
+    // Async loads are split in two: decode() runs on a worker thread and must not touch GL, upload() finishes
+    // the load on the main thread. Resources that don't split their loading do all of it in upload().
+    virtual bool decode(const std::string& path)
+    {
+        m_path = path;
+        return true;
+    }
+    virtual bool upload() { return load(m_path); }
+    virtual bool isReadyToUpload() const { return true; }
+
     const std::string& getPath() const { return m_path; }
 
   protected:
@@ -0,0 +1,131 @@
+#include "pch.h"
+
+#include "engine/core/thread_pool.h"
+#include "common/logger.h"
+
+ThreadPool& ThreadPool::getInstance()
+{
+    static ThreadPool instance;
+    return instance;
+}
+
+ThreadPool::ThreadPool()
+{
+    // Leave one core for the main/render thread.
+    uint32_t hardwareThreads = std::thread::hardware_concurrency();
+    uint32_t workerCount     = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+
+    m_workers.reserve(workerCount);
+    for (uint32_t i = 0; i < workerCount; i++) {
+        m_workers.emplace_back([this]() { workerLoop(); });
+    }
+
+    LOG_INFO("ThreadPool: Started {} worker threads.", workerCount);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_condition.notify_all();
+
+    for (auto& worker : m_workers) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+}
+
+void ThreadPool::enqueue(std::function<void()> task)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_tasks.push(std::move(task));
+    }
+    m_condition.notify_one();
+}
+
+void ThreadPool::workerLoop()
+{
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_condition.wait(lock, [this]() { return m_stopping || !m_tasks.empty(); });
+
+            if (m_stopping && m_tasks.empty()) {
+                return;
+            }
+
+            task = std::move(m_tasks.front());
+            m_tasks.pop();
+        }
+
+        task();
+    }
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)>& func)
+{
+    if (count == 0) {
+        return;
+    }
+
+    if (count == 1 || m_workers.empty()) {
+        for (size_t i = 0; i < count; i++) {
+            func(i);
+        }
+        return;
+    }
+
+    // Shared between the caller and the helpers, helpers that start after all work is claimed just return.
+    struct ForState {
+        std::atomic<size_t>     next      = 0;
+        std::atomic<size_t>     completed = 0;
+        size_t                  count     = 0;
+        std::mutex              mutex;
+        std::condition_variable done;
+        std::exception_ptr      error;
+    };
+
+    auto state   = std::make_shared<ForState>();
+    state->count = count;
+
+    auto runItems = [state, &func]() {
+        size_t index;
+        while ((index = state->next.fetch_add(1)) < state->count) {
+            try {
+                func(index);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                if (!state->error) {
+                    state->error = std::current_exception();
+                }
+            }
+
+            if (state->completed.fetch_add(1) + 1 == state->count) {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                state->done.notify_all();
+            }
+        }
+    };
+
+    size_t helperCount = std::min(m_workers.size(), count - 1);
+    for (size_t i = 0; i < helperCount; i++) {
+        enqueue(runItems);
+    }
+
+    runItems();
+
+    // Only wait for items other threads have already claimed, so nested calls can't deadlock.
+    {
+        std::unique_lock<std::mutex> lock(state->mutex);
+        state->done.wait(lock, [&state]() { return state->completed.load() == state->count; });
+    }
+
+    if (state->error) {
+        std::rethrow_exception(state->error);
+    }
+}
@@ -0,0 +1,56 @@
+#ifndef ENGINE_CORE_THREAD_POOL_H_
+#define ENGINE_CORE_THREAD_POOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+class ThreadPool
+{
+  public:
+    static ThreadPool& getInstance();
+
+    // Queues a task on a worker thread, the returned future holds its result.
+    template <typename F> auto submit(F&& task) -> std::future<std::invoke_result_t<F>>
+    {
+        using Result = std::invoke_result_t<F>;
+
+        auto packaged = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(task));
+        auto future   = packaged->get_future();
+        enqueue([packaged]() { (*packaged)(); });
+        return future;
+    }
+
+    // Runs func(i) for every i in [0, count) across the workers. The calling thread takes part in the work,
+    // so it is safe to call from inside a worker task.
+    void parallelFor(size_t count, const std::function<void(size_t)>& func);
+
+    size_t getWorkerCount() const { return m_workers.size(); }
+
+  private:
+    ThreadPool();
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&)            = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void enqueue(std::function<void()> task);
+    void workerLoop();
+
+    std::vector<std::thread>          m_workers;
+    std::queue<std::function<void()>> m_tasks;
+    std::mutex                        m_mutex;
+    std::condition_variable           m_condition;
+    bool                              m_stopping = false;
+};
+
+#define THREAD_POOL ThreadPool::getInstance()
+
+#endif // ENGINE_CORE_THREAD_POOL_H_
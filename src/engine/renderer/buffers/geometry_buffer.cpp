@@ -0,0 +1,129 @@
+#include "pch.h"
+
+#include "engine/renderer/buffers/geometry_buffer.h"
+#include "engine/renderer/geometry/mesh.h"
+#include "engine/renderer/geometry/vertex_packing.h"
+
+#include "common/logger.h"
+
+#include <vector>
+
+GeometryBuffer::GeometryBuffer(VertexFormat format) : m_format(format)
+{
+    //
+}
+
+GeometryBuffer::~GeometryBuffer()
+{
+    release();
+}
+
+void GeometryBuffer::allocate(uint32_t vertexCount, uint32_t indexCount)
+{
+    release();
+
+    glGenVertexArrays(1, &m_vao);
+    glGenBuffers(1, &m_vbo);
+    glGenBuffers(1, &m_ebo);
+
+    glBindVertexArray(m_vao);
+    glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+    glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(vertexCount * Mesh::getVertexSize(m_format)), nullptr, GL_STATIC_DRAW);
+
+    if (m_format == VertexFormat::Packed) {
+        // Attribute 4 (bitangent) stays disabled, the shader rebuilds it.
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 4, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, position));
+
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, normal));
+
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, texCoords));
+
+        glEnableVertexAttribArray(3);
+        glVertexAttribPointer(3, 2, GL_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, tangent));
+    } else {
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, normal));
+
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, texCoords));
+
+        glEnableVertexAttribArray(3);
+        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, tangent));
+
+        glEnableVertexAttribArray(4);
+        glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, bitangent));
+    }
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, static_cast<GLsizeiptr>(indexCount * sizeof(uint32_t)), nullptr, GL_STATIC_DRAW);
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    m_vertexCapacity = vertexCount;
+    m_indexCapacity  = indexCount;
+}
+
+GeometryRange GeometryBuffer::add(std::span<const Vertex> vertices, std::span<const uint32_t> indices, const VertexQuantization& quantization)
+{
+    if (m_vertexCount + vertices.size() > m_vertexCapacity || m_indexCount + indices.size() > m_indexCapacity) {
+        LOG_ERROR("GeometryBuffer: {} vertices and {} indices don't fit, {}/{} and {}/{} used", vertices.size(), indices.size(), m_vertexCount, m_vertexCapacity, m_indexCount,
+                  m_indexCapacity);
+        return {};
+    }
+
+    GeometryRange range;
+    range.baseVertex  = m_vertexCount;
+    range.firstIndex  = m_indexCount;
+    range.vertexCount = static_cast<uint32_t>(vertices.size());
+    range.indexCount  = static_cast<uint32_t>(indices.size());
+
+    size_t vertexSize = Mesh::getVertexSize(m_format);
+    glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+    if (m_format == VertexFormat::Packed) {
+        std::vector<PackedVertex> packed;
+        VertexPacking::pack(vertices, quantization, packed);
+        glBufferSubData(GL_ARRAY_BUFFER, static_cast<GLintptr>(range.baseVertex * vertexSize), static_cast<GLsizeiptr>(packed.size() * vertexSize), packed.data());
+    } else {
+        glBufferSubData(GL_ARRAY_BUFFER, static_cast<GLintptr>(range.baseVertex * vertexSize), static_cast<GLsizeiptr>(vertices.size_bytes()), vertices.data());
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    // The element binding is VAO state, this leaves whatever VAO is current alone.
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_ebo);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, static_cast<GLintptr>(range.firstIndex * sizeof(uint32_t)), static_cast<GLsizeiptr>(indices.size_bytes()), indices.data());
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    m_vertexCount += range.vertexCount;
+    m_indexCount += range.indexCount;
+    return range;
+}
+
+void GeometryBuffer::release()
+{
+    if (m_vao) {
+        glDeleteVertexArrays(1, &m_vao);
+        glDeleteBuffers(1, &m_vbo);
+        glDeleteBuffers(1, &m_ebo);
+        m_vao = m_vbo = m_ebo = 0;
+    }
+
+    m_vertexCapacity = m_indexCapacity = 0;
+    m_vertexCount = m_indexCount = 0;
+}
+
+void GeometryBuffer::bind() const
+{
+    glBindVertexArray(m_vao);
+}
+
+size_t GeometryBuffer::getMemoryUsage() const
+{
+    return m_vertexCapacity * Mesh::getVertexSize(m_format) + m_indexCapacity * sizeof(uint32_t);
+}
@@ -0,0 +1,64 @@
+#ifndef ENGINE_RENDERER_GEOMETRY_BUFFER_H_
+#define ENGINE_RENDERER_GEOMETRY_BUFFER_H_
+
+#include "engine/renderer/geometry/vertex.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+// Where one mesh lives in a GeometryBuffer. Indices stay relative to the mesh's own vertices, the draw adds baseVertex.
+struct GeometryRange {
+    uint32_t baseVertex  = 0;
+    uint32_t firstIndex  = 0;
+    uint32_t vertexCount = 0;
+    uint32_t indexCount  = 0;
+};
+
+// DrawElementsIndirectCommand, as glMultiDrawElementsIndirect reads it from the indirect buffer.
+struct IndirectCommand {
+    uint32_t count         = 0;
+    uint32_t instanceCount = 0;
+    uint32_t firstIndex    = 0;
+    int32_t  baseVertex    = 0;
+    uint32_t baseInstance  = 0;
+};
+
+// One VAO with a single vertex and index buffer shared by every mesh of a model, so drawing the model's meshes back to
+// back needs one vertex array bind. Storage is sized once up front and the meshes are appended into it. GL thread only.
+class GeometryBuffer
+{
+  public:
+    explicit GeometryBuffer(VertexFormat format);
+    ~GeometryBuffer();
+
+    GeometryBuffer(const GeometryBuffer&)            = delete;
+    GeometryBuffer& operator=(const GeometryBuffer&) = delete;
+
+    // Creates the GL objects and the attribute layout for the format, contents are filled in by add.
+    void allocate(uint32_t vertexCount, uint32_t indexCount);
+    // Uploads one mesh behind the previous one. Packed vertices are quantized with the given bounds. Returns an empty
+    // range if it doesn't fit.
+    GeometryRange add(std::span<const Vertex> vertices, std::span<const uint32_t> indices, const VertexQuantization& quantization);
+    void          release();
+
+    void bind() const;
+
+    VertexFormat getFormat() const { return m_format; }
+    uint32_t     getVertexArray() const { return m_vao; }
+    uint32_t     getVertexCount() const { return m_vertexCount; }
+    uint32_t     getIndexCount() const { return m_indexCount; }
+    size_t       getMemoryUsage() const;
+
+  private:
+    VertexFormat m_format;
+    uint32_t     m_vao            = 0;
+    uint32_t     m_vbo            = 0;
+    uint32_t     m_ebo            = 0;
+    uint32_t     m_vertexCapacity = 0;
+    uint32_t     m_indexCapacity  = 0;
+    uint32_t     m_vertexCount    = 0;
+    uint32_t     m_indexCount     = 0;
+};
+
+#endif // ENGINE_RENDERER_GEOMETRY_BUFFER_H_
@@ -0,0 +1,58 @@
+#include "pch.h"
+
+#include "engine/renderer/buffers/gpu_buffer.h"
+
+#include "common/logger.h"
+
+GpuBuffer::GpuBuffer(uint32_t target) : m_target(target)
+{
+    //
+}
+
+GpuBuffer::~GpuBuffer()
+{
+    release();
+}
+
+void GpuBuffer::allocate(size_t size, const void* data)
+{
+    if (!m_id) {
+        glGenBuffers(1, &m_id);
+    }
+
+    glBindBuffer(m_target, m_id);
+    glBufferData(m_target, static_cast<GLsizeiptr>(size), data, GL_DYNAMIC_DRAW);
+    glBindBuffer(m_target, 0);
+    m_size = size;
+}
+
+void GpuBuffer::update(size_t offset, size_t size, const void* data)
+{
+    if (!m_id || offset + size > m_size) {
+        LOG_ERROR("GpuBuffer: Update of {} bytes at {} is outside the {} byte buffer", size, offset, m_size);
+        return;
+    }
+
+    glBindBuffer(m_target, m_id);
+    glBufferSubData(m_target, static_cast<GLintptr>(offset), static_cast<GLsizeiptr>(size), data);
+    glBindBuffer(m_target, 0);
+}
+
+void GpuBuffer::release()
+{
+    if (m_id) {
+        glDeleteBuffers(1, &m_id);
+        m_id   = 0;
+        m_size = 0;
+    }
+}
+
+void GpuBuffer::bindBase(uint32_t binding) const
+{
+    glBindBufferBase(m_target, binding, m_id);
+}
+
+void GpuBuffer::bindRange(uint32_t binding, size_t offset, size_t size) const
+{
+    glBindBufferRange(m_target, binding, m_id, static_cast<GLintptr>(offset), static_cast<GLsizeiptr>(size));
+}
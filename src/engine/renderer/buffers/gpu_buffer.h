@@ -0,0 +1,35 @@
+#ifndef ENGINE_RENDERER_GPU_BUFFER_H_
+#define ENGINE_RENDERER_GPU_BUFFER_H_
+
+#include <cstddef>
+#include <cstdint>
+
+// Owns one GL buffer object for an indexed target (uniform or shader storage). The GL name is created on the first
+// allocate, so the owner can be constructed before there is a context. GL thread only.
+class GpuBuffer
+{
+  public:
+    explicit GpuBuffer(uint32_t target);
+    ~GpuBuffer();
+
+    GpuBuffer(const GpuBuffer&)            = delete;
+    GpuBuffer& operator=(const GpuBuffer&) = delete;
+
+    // Reallocates the storage, previous contents are lost. data may be null.
+    void allocate(size_t size, const void* data = nullptr);
+    void update(size_t offset, size_t size, const void* data);
+    void release();
+
+    void bindBase(uint32_t binding) const;
+    void bindRange(uint32_t binding, size_t offset, size_t size) const;
+
+    uint32_t getId() const { return m_id; }
+    size_t   getSize() const { return m_size; }
+
+  private:
+    uint32_t m_target = 0;
+    uint32_t m_id     = 0;
+    size_t   m_size   = 0;
+};
+
+#endif // ENGINE_RENDERER_GPU_BUFFER_H_
@@ -0,0 +1,122 @@
+#include "pch.h"
+
+#include "engine/renderer/buffers/material_buffer.h"
+#include "common/hash.h"
+#include "common/logger.h"
+
+#include <algorithm>
+
+namespace
+{
+    template <typename T> uint64_t hashValue(const T& value, uint64_t seed)
+    {
+        return Hash::fnv1a(&value, sizeof(value), seed);
+    }
+} // namespace
+
+MaterialBuffer& MaterialBuffer::getInstance()
+{
+    static MaterialBuffer instance;
+    return instance;
+}
+
+MaterialBuffer::MaterialBuffer() : m_buffer(GL_SHADER_STORAGE_BUFFER)
+{
+    //
+}
+
+// Field by field, the struct has padding between the bools and the vectors.
+size_t MaterialBuffer::KeyHash::operator()(const Key& key) const
+{
+    const Material& material = key.material;
+
+    uint64_t hash = Hash::FNV_OFFSET_BASIS;
+    hash          = hashValue(material.albedo, hash);
+    hash          = hashValue(material.metallic, hash);
+    hash          = hashValue(material.roughness, hash);
+    hash          = hashValue(material.ao, hash);
+    hash          = hashValue(material.emissive, hash);
+    hash          = hashValue(material.transparency, hash);
+    hash          = hashValue(material.diffuse, hash);
+    hash          = hashValue(material.specular, hash);
+    hash          = hashValue(material.ambient, hash);
+    hash          = hashValue(material.shininess, hash);
+    hash          = hashValue(key.textures, hash);
+
+    uint32_t flags = material.hasAlbedoTexture | material.hasMetallicTexture << 1 | material.hasRoughnessTexture << 2 | material.hasNormalTexture << 3 | material.hasAoTexture << 4 |
+                     material.hasEmissiveTexture << 5 | material.hasLegacyDiffuse << 6 | material.hasLegacySpecular << 7;
+    return static_cast<size_t>(hashValue(flags, hash));
+}
+
+MaterialBlock MaterialBuffer::pack(const Material& material, const TextureSlots& textures)
+{
+    MaterialBlock block;
+    block.albedo       = material.albedo;
+    block.metallic     = material.metallic;
+    block.emissive     = material.emissive;
+    block.roughness    = material.roughness;
+    block.ao           = material.ao;
+    block.transparency = material.transparency;
+    block.flags        = 0;
+
+    if (material.hasAlbedoTexture) block.flags |= MaterialBlock::ALBEDO_TEXTURE;
+    if (material.hasMetallicTexture) block.flags |= MaterialBlock::METALLIC_TEXTURE;
+    if (material.hasRoughnessTexture) block.flags |= MaterialBlock::ROUGHNESS_TEXTURE;
+    if (material.hasNormalTexture) block.flags |= MaterialBlock::NORMAL_TEXTURE;
+    if (material.hasLegacySpecular) block.flags |= MaterialBlock::LEGACY_SPECULAR;
+
+    std::copy(textures.begin(), textures.end(), block.textures);
+
+    return block;
+}
+
+uint32_t MaterialBuffer::add(const Material& material, const TextureSlots& textures)
+{
+    auto [it, inserted] = m_ids.try_emplace(Key{material, textures}, static_cast<uint32_t>(m_blocks.size()));
+    if (!inserted) {
+        return it->second;
+    }
+
+    m_blocks.push_back(pack(material, textures));
+    if (m_blocks.size() > m_capacity) {
+        grow(std::max(INITIAL_CAPACITY, m_capacity * 2));
+    } else {
+        m_buffer.update(it->second * sizeof(MaterialBlock), sizeof(MaterialBlock), &m_blocks.back());
+    }
+
+    return it->second;
+}
+
+void MaterialBuffer::bindBuffer() const
+{
+    m_buffer.bindBase(ShaderBinding::MATERIALS);
+}
+
+void MaterialBuffer::bind(uint32_t id) const
+{
+    if (id >= m_blocks.size()) {
+        LOG_ERROR("MaterialBuffer: Invalid material id {}, {} materials registered", id, m_blocks.size());
+        return;
+    }
+
+    glUniform1ui(ShaderBinding::MATERIAL_INDEX, id);
+}
+
+void MaterialBuffer::release()
+{
+    m_buffer.release();
+    m_blocks.clear();
+    m_ids.clear();
+    m_capacity = 0;
+}
+
+void MaterialBuffer::grow(size_t capacity)
+{
+    // Growing is rare (doubling from 64), so the whole buffer is rebuilt from the CPU copy. std430 packs the blocks
+    // back to back, there is no offset alignment to pad to as with uniform buffer ranges.
+    m_buffer.allocate(capacity * sizeof(MaterialBlock));
+    m_buffer.update(0, m_blocks.size() * sizeof(MaterialBlock), m_blocks.data());
+    m_capacity = capacity;
+
+    LOG_DEBUG("MaterialBuffer: Grew to {} slots of {} bytes", m_capacity, sizeof(MaterialBlock));
+}
@@ -0,0 +1,67 @@
+#ifndef ENGINE_RENDERER_MATERIAL_BUFFER_H_
+#define ENGINE_RENDERER_MATERIAL_BUFFER_H_
+
+#include "engine/renderer/buffers/gpu_buffer.h"
+#include "engine/renderer/geometry/mesh.h"
+#include "engine/renderer/shaders/shader_bindings.h"
+
+#include <array>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Every unique material gets a slot in one shader storage buffer when the first mesh using it is created. The buffer
+// is bound once per frame and a draw picks its material with one uniform, the id. With resident textures the slot also
+// holds the TexturePool index of every texture, so the draw binds nothing else. GL thread only.
+class MaterialBuffer
+{
+  public:
+    using TextureSlots = std::array<uint32_t, MaterialBlock::TEXTURE_SLOT_COUNT>;
+
+    static MaterialBuffer& getInstance();
+
+    // Equal materials with the same textures share an id, new ones are packed and uploaded right away. Ids are dense
+    // and never reused.
+    uint32_t add(const Material& material, const TextureSlots& textures);
+
+    void bindBuffer() const;     // Once per frame
+    void bind(uint32_t id) const; // On the current program
+
+    // Drops every slot and the GL buffer, meshes created before must not be drawn afterwards.
+    void release();
+
+    size_t getCount() const { return m_blocks.size(); }
+
+    static MaterialBlock pack(const Material& material, const TextureSlots& textures);
+
+  private:
+    MaterialBuffer();
+    ~MaterialBuffer() = default;
+
+    MaterialBuffer(const MaterialBuffer&)            = delete;
+    MaterialBuffer& operator=(const MaterialBuffer&) = delete;
+
+    struct Key {
+        Material     material;
+        TextureSlots textures;
+
+        bool operator==(const Key&) const = default;
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key& key) const;
+    };
+
+    static constexpr size_t INITIAL_CAPACITY = 64;
+
+    GpuBuffer                                  m_buffer;
+    std::vector<MaterialBlock>                 m_blocks;
+    std::unordered_map<Key, uint32_t, KeyHash> m_ids;
+    size_t                                     m_capacity = 0;
+
+    void grow(size_t capacity);
+};
+
+#define MATERIAL_BUFFER MaterialBuffer::getInstance()
+
+#endif // ENGINE_RENDERER_MATERIAL_BUFFER_H_
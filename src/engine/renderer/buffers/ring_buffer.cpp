@@ -0,0 +1,176 @@
+#include "pch.h"
+
+#include "engine/renderer/buffers/ring_buffer.h"
+
+#include "common/logger.h"
+#include "common/timer.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+    const GLbitfield MAP_FLAGS = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+    size_t alignUp(size_t value, size_t alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+} // namespace
+
+RingBuffer& RingBuffer::getInstance()
+{
+    static RingBuffer instance;
+    return instance;
+}
+
+void RingBuffer::beginFrame()
+{
+    m_lastUsed = m_used;
+    m_used     = 0;
+    m_offset   = 0;
+    m_frame++;
+
+    m_waitMs = 0.0f;
+    wait(static_cast<uint32_t>(m_frame % FRAME_COUNT));
+
+    // The fence just waited for covers the last frame that could still read a retired buffer.
+    std::erase_if(m_retired, [this](const Retired& retired) {
+        if (m_frame < retired.frame + FRAME_COUNT) {
+            return false;
+        }
+        glDeleteBuffers(1, &retired.id);
+        return true;
+    });
+}
+
+void RingBuffer::endFrame()
+{
+    uint32_t region = static_cast<uint32_t>(m_frame % FRAME_COUNT);
+    if (m_fences[region]) {
+        glDeleteSync(m_fences[region]);
+    }
+    m_fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+RingAllocation RingBuffer::allocate(size_t size, size_t alignment)
+{
+    if (!m_id) {
+        grow(std::max(INITIAL_FRAME_SIZE, size));
+    }
+    if (alignment == 0) {
+        alignment = m_alignment;
+    }
+
+    size_t base   = (m_frame % FRAME_COUNT) * m_frameSize;
+    size_t offset = alignUp(base + m_offset, alignment);
+    if (offset + size > base + m_frameSize) {
+        grow(std::max(m_frameSize * 2, size + alignment));
+        base   = (m_frame % FRAME_COUNT) * m_frameSize;
+        offset = alignUp(base, alignment);
+    }
+
+    m_offset = offset + size - base;
+    m_used += size;
+
+    RingAllocation allocation;
+    allocation.data   = m_mapped + offset;
+    allocation.buffer = m_id;
+    allocation.offset = offset;
+    allocation.size   = size;
+    return allocation;
+}
+
+RingAllocation RingBuffer::write(const void* data, size_t size, size_t alignment)
+{
+    RingAllocation allocation = allocate(size, alignment);
+    std::memcpy(allocation.data, data, size);
+    return allocation;
+}
+
+void RingBuffer::bindRange(uint32_t target, uint32_t binding, const RingAllocation& allocation) const
+{
+    glBindBufferRange(target, binding, allocation.buffer, static_cast<GLintptr>(allocation.offset), static_cast<GLsizeiptr>(allocation.size));
+}
+
+void RingBuffer::release()
+{
+    for (auto& fence : m_fences) {
+        if (fence) {
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+    }
+
+    for (const auto& retired : m_retired) {
+        glDeleteBuffers(1, &retired.id);
+    }
+    m_retired.clear();
+
+    if (m_id) {
+        glDeleteBuffers(1, &m_id);
+        m_id = 0;
+    }
+
+    m_mapped    = nullptr;
+    m_frameSize = 0;
+    m_offset    = 0;
+}
+
+void RingBuffer::grow(size_t frameSize)
+{
+    if (m_alignment == 0) {
+        GLint uniformAlignment = 0;
+        GLint storageAlignment = 0;
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniformAlignment);
+        glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &storageAlignment);
+        m_alignment = static_cast<size_t>(std::max({uniformAlignment, storageAlignment, 16}));
+    }
+
+    // Storage is immutable, a bigger one replaces it. The old buffer lives on until the frames using it are done, this
+    // frame's earlier allocations still point into it.
+    if (m_id) {
+        m_retired.push_back({m_id, m_frame});
+    }
+
+    m_frameSize = alignUp(frameSize, m_alignment);
+    m_offset    = 0;
+
+    glGenBuffers(1, &m_id);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_id);
+    glBufferStorage(GL_COPY_WRITE_BUFFER, static_cast<GLsizeiptr>(m_frameSize * FRAME_COUNT), nullptr, MAP_FLAGS);
+    m_mapped = static_cast<uint8_t*>(glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, static_cast<GLsizeiptr>(m_frameSize * FRAME_COUNT), MAP_FLAGS));
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    if (!m_mapped) {
+        LOG_ERROR("RingBuffer: Mapping {} bytes failed", m_frameSize * FRAME_COUNT);
+    }
+
+    LOG_DEBUG("RingBuffer: Grew to {} regions of {} KB", FRAME_COUNT, m_frameSize / 1024);
+}
+
+void RingBuffer::wait(uint32_t region)
+{
+    GLsync fence = m_fences[region];
+    if (!fence) {
+        return;
+    }
+
+    // Usually signaled long ago, only a CPU that is FRAME_COUNT frames ahead waits here.
+    GLenum result = glClientWaitSync(fence, 0, 0);
+    if (result == GL_TIMEOUT_EXPIRED) {
+        Timer timer;
+        m_stalls++;
+        do {
+            result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, WAIT_TIMEOUT_NS);
+        } while (result == GL_TIMEOUT_EXPIRED);
+        m_waitMs = timer.getTime() * 1000.0f;
+    }
+
+    if (result == GL_WAIT_FAILED) {
+        LOG_ERROR("RingBuffer: Waiting for the fence of region {} failed", region);
+    }
+
+    glDeleteSync(fence);
+    m_fences[region] = nullptr;
+}
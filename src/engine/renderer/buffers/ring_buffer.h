@@ -0,0 +1,85 @@
+#ifndef ENGINE_RENDERER_RING_BUFFER_H_
+#define ENGINE_RENDERER_RING_BUFFER_H_
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Where an allocation landed in the ring. data stays writable until the end of the frame, nothing has to be flushed.
+// The buffer is the one to bind, it only differs from RingBuffer::getId() for allocations made before the ring grew.
+struct RingAllocation {
+    void*    data   = nullptr;
+    uint32_t buffer = 0;
+    size_t   offset = 0;
+    size_t   size   = 0;
+};
+
+// One buffer for everything rewritten every frame (camera, light clusters, instances, indirect commands, debug lines),
+// persistently and coherently mapped and split into FRAME_COUNT regions. A frame writes into its own region while the
+// GPU still reads the previous ones, a fence per region says when it can be written again. Nothing is reallocated or
+// orphaned per frame, the CPU only waits when it gets FRAME_COUNT frames ahead of the GPU. GL thread only.
+class RingBuffer
+{
+  public:
+    static constexpr uint32_t FRAME_COUNT = 3;
+
+    static RingBuffer& getInstance();
+
+    // Moves on to the next region, waiting for its fence if the GPU isn't done with it yet.
+    void beginFrame();
+    // Fences the commands that read this frame's region.
+    void endFrame();
+
+    // Room for size bytes in this frame's region. The default alignment suits uniform and shader storage ranges. When
+    // the region is full the ring grows, earlier allocations of the frame stay valid.
+    RingAllocation allocate(size_t size, size_t alignment = 0);
+    RingAllocation write(const void* data, size_t size, size_t alignment = 0);
+
+    void bindRange(uint32_t target, uint32_t binding, const RingAllocation& allocation) const;
+    void release();
+
+    uint32_t getId() const { return m_id; }
+    size_t   getFrameSize() const { return m_frameSize; }
+    size_t   getUsed() const { return m_lastUsed; }     // Bytes allocated in the last finished frame
+    uint32_t getStallCount() const { return m_stalls; } // Frames that had to wait for the GPU, since startup
+    float    getWaitMs() const { return m_waitMs; }     // Time the last beginFrame waited
+
+  private:
+    RingBuffer()  = default;
+    ~RingBuffer() = default;
+
+    RingBuffer(const RingBuffer&)            = delete;
+    RingBuffer& operator=(const RingBuffer&) = delete;
+
+    // A buffer outgrown mid-frame, its regions may still be read and earlier bindings of the frame point at it.
+    struct Retired {
+        uint32_t id;
+        uint64_t frame;
+    };
+
+    static constexpr size_t   INITIAL_FRAME_SIZE = 1024 * 1024;
+    static constexpr uint64_t WAIT_TIMEOUT_NS    = 1000000;
+
+    uint32_t             m_id                  = 0;
+    uint8_t*             m_mapped              = nullptr;
+    size_t               m_frameSize           = 0;
+    size_t               m_alignment           = 0;
+    size_t               m_offset              = 0; // Within the current region
+    size_t               m_used                = 0;
+    size_t               m_lastUsed            = 0;
+    uint64_t             m_frame               = 0;
+    GLsync               m_fences[FRAME_COUNT] = {};
+    std::vector<Retired> m_retired;
+
+    uint32_t m_stalls = 0;
+    float    m_waitMs = 0.0f;
+
+    void grow(size_t frameSize);
+    void wait(uint32_t region);
+};
+
+#define FRAME_RING RingBuffer::getInstance()
+
+#endif // ENGINE_RENDERER_RING_BUFFER_H_
@@ -0,0 +1,68 @@
+#ifndef ENGINE_RENDERER_AABB_H_
+#define ENGINE_RENDERER_AABB_H_
+
+#include <glm/glm.hpp>
+
+#include <cfloat>
+#include <cmath>
+
+// Axis aligned box. The default one is empty (inverted), so growing it by anything gives that thing's bounds.
+struct Aabb {
+    glm::vec3 min = glm::vec3(FLT_MAX);
+    glm::vec3 max = glm::vec3(-FLT_MAX);
+
+    Aabb() = default;
+    Aabb(const glm::vec3& min, const glm::vec3& max) : min(min), max(max) {}
+
+    bool      isEmpty() const { return min.x > max.x; }
+    glm::vec3 getCenter() const { return (min + max) * 0.5f; }
+    glm::vec3 getExtent() const { return (max - min) * 0.5f; }
+
+    void grow(const glm::vec3& point)
+    {
+        min = glm::min(min, point);
+        max = glm::max(max, point);
+    }
+
+    void grow(const Aabb& other)
+    {
+        min = glm::min(min, other.min);
+        max = glm::max(max, other.max);
+    }
+
+    float getSurfaceArea() const
+    {
+        if (isEmpty()) {
+            return 0.0f;
+        }
+        glm::vec3 size = max - min;
+        return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+    }
+
+    bool overlaps(const Aabb& other) const
+    {
+        return min.x <= other.max.x && max.x >= other.min.x && min.y <= other.max.y && max.y >= other.min.y && min.z <= other.max.z && max.z >= other.min.z;
+    }
+
+    float getDistanceSquared(const glm::vec3& point) const
+    {
+        glm::vec3 d = glm::max(glm::max(min - point, point - max), glm::vec3(0.0f));
+        return d.x * d.x + d.y * d.y + d.z * d.z;
+    }
+
+    bool operator==(const Aabb& other) const { return min == other.min && max == other.max; }
+
+    // Box enclosing this one after the transform (Arvo): the center moves with the matrix, the extents are scaled by |M|.
+    Aabb transformed(const glm::mat4& transform) const
+    {
+        glm::vec3 center = glm::vec3(transform * glm::vec4(getCenter(), 1.0f));
+        glm::vec3 local  = getExtent();
+        glm::vec3 extent(0.0f);
+        for (int axis = 0; axis < 3; axis++) {
+            extent += glm::vec3(std::abs(transform[axis][0]), std::abs(transform[axis][1]), std::abs(transform[axis][2])) * local[axis];
+        }
+        return Aabb(center - extent, center + extent);
+    }
+};
+
+#endif // ENGINE_RENDERER_AABB_H_
@@ -0,0 +1,408 @@
+#include "pch.h"
+
+#include "engine/renderer/culling/bvh.h"
+
+#include <algorithm>
+
+namespace
+{
+    // Past this depth nodes are split at the median, which bounds the depth of any tree to MAX_DEPTH.
+    const uint32_t MEDIAN_SPLIT_DEPTH = 32;
+
+    // Entry distance of the ray into the box, FLT_MAX if it misses or enters beyond maxDistance.
+    float intersectRay(const Aabb& box, const glm::vec3& origin, const glm::vec3& inverseDirection, float maxDistance)
+    {
+        glm::vec3 t1   = (box.min - origin) * inverseDirection;
+        glm::vec3 t2   = (box.max - origin) * inverseDirection;
+        glm::vec3 near = glm::min(t1, t2);
+        glm::vec3 far  = glm::max(t1, t2);
+
+        float entry = std::max(std::max(near.x, near.y), std::max(near.z, 0.0f));
+        float exit  = std::min(std::min(far.x, far.y), far.z);
+        return entry <= exit && entry < maxDistance ? entry : FLT_MAX;
+    }
+
+    FrustumTest testSphere(const Aabb& box, const glm::vec3& center, float radius)
+    {
+        float radiusSquared = radius * radius;
+        if (box.getDistanceSquared(center) > radiusSquared) {
+            return FrustumTest::Outside;
+        }
+
+        // Inside when the farthest corner is.
+        glm::vec3 far = glm::max(glm::abs(box.min - center), glm::abs(box.max - center));
+        return far.x * far.x + far.y * far.y + far.z * far.z <= radiusSquared ? FrustumTest::Inside : FrustumTest::Intersects;
+    }
+
+    FrustumTest testBox(const Aabb& box, const Aabb& query)
+    {
+        if (!box.overlaps(query)) {
+            return FrustumTest::Outside;
+        }
+
+        bool contained = box.min.x >= query.min.x && box.min.y >= query.min.y && box.min.z >= query.min.z && box.max.x <= query.max.x && box.max.y <= query.max.y && box.max.z <= query.max.z;
+        return contained ? FrustumTest::Inside : FrustumTest::Intersects;
+    }
+} // namespace
+
+void Bvh::build(std::span<const Aabb> bounds)
+{
+    clear();
+    if (bounds.empty()) {
+        return;
+    }
+
+    m_itemBounds.assign(bounds.begin(), bounds.end());
+    m_itemLeaf.assign(bounds.size(), NO_LEAF);
+
+    std::vector<BuildItem> items;
+    items.reserve(bounds.size());
+    for (uint32_t i = 0; i < bounds.size(); i++) {
+        if (!bounds[i].isEmpty()) {
+            items.push_back({bounds[i], bounds[i].getCenter(), i});
+        }
+    }
+
+    uint32_t count = static_cast<uint32_t>(items.size());
+    if (count == 0) {
+        return;
+    }
+
+    // A binary tree with at least one item per leaf never needs more than 2n - 1 nodes, so references stay valid.
+    m_nodes.reserve(static_cast<size_t>(count) * 2);
+    m_parents.reserve(static_cast<size_t>(count) * 2);
+
+    Node root;
+    root.first = 0;
+    root.count = count;
+    m_nodes.push_back(root);
+    m_parents.push_back(0);
+
+    std::vector<std::pair<uint32_t, uint32_t>> pending = {{0, 0}};
+    while (!pending.empty()) {
+        auto [node, depth] = pending.back();
+        pending.pop_back();
+
+        split(node, depth, items);
+        if (!m_nodes[node].isLeaf()) {
+            pending.push_back({m_nodes[node].left, depth + 1});
+            pending.push_back({m_nodes[node].left + 1, depth + 1});
+        }
+    }
+
+    m_items.resize(count);
+    for (uint32_t i = 0; i < count; i++) {
+        m_items[i] = items[i].item;
+    }
+    for (const auto& node : m_nodes) {
+        for (uint32_t i = node.first; node.isLeaf() && i < node.first + node.count; i++) {
+            m_itemLeaf[m_items[i]] = static_cast<uint32_t>(&node - m_nodes.data());
+        }
+    }
+
+    m_builtArea = getInternalArea();
+}
+
+void Bvh::clear()
+{
+    m_nodes.clear();
+    m_items.clear();
+    m_itemBounds.clear();
+    m_itemLeaf.clear();
+    m_parents.clear();
+    m_dirtyLeaves.clear();
+    m_builtArea = 0.0f;
+}
+
+void Bvh::split(uint32_t index, uint32_t depth, std::vector<BuildItem>& items)
+{
+    Node& node = m_nodes[index];
+
+    Aabb centroidBounds;
+    for (uint32_t i = node.first; i < node.first + node.count; i++) {
+        node.bounds.grow(items[i].bounds);
+        centroidBounds.grow(items[i].centroid);
+    }
+
+    if (node.count <= MAX_LEAF) {
+        return;
+    }
+
+    // Binned SAH over all three axes, cost of a split is area * count summed over both sides.
+    struct Bin {
+        Aabb     bounds;
+        uint32_t count = 0;
+    };
+
+    // One pass over the items fills the bins of all three axes.
+    Bin       bins[3][BIN_COUNT];
+    glm::vec3 extent = centroidBounds.max - centroidBounds.min;
+    glm::vec3 scale(0.0f);
+    for (int axis = 0; axis < 3; axis++) {
+        scale[axis] = extent[axis] > 0.0f ? BIN_COUNT / extent[axis] : 0.0f;
+    }
+
+    for (uint32_t i = node.first; i < node.first + node.count; i++) {
+        glm::vec3 binPos = (items[i].centroid - centroidBounds.min) * scale;
+        for (int axis = 0; axis < 3; axis++) {
+            Bin& bin = bins[axis][std::min(BIN_COUNT - 1, static_cast<uint32_t>(binPos[axis]))];
+            bin.bounds.grow(items[i].bounds);
+            bin.count++;
+        }
+    }
+
+    float    bestCost  = FLT_MAX;
+    uint32_t bestAxis  = 0;
+    uint32_t bestSplit = 0;
+    for (uint32_t axis = 0; axis < 3; axis++) {
+        if (extent[axis] <= 0.0f) {
+            continue;
+        }
+
+        float    rightArea[BIN_COUNT];
+        uint32_t rightCount[BIN_COUNT];
+        Aabb     right;
+        uint32_t count = 0;
+        for (uint32_t bin = BIN_COUNT - 1; bin > 0; bin--) {
+            right.grow(bins[axis][bin].bounds);
+            count += bins[axis][bin].count;
+            rightArea[bin]  = right.getSurfaceArea();
+            rightCount[bin] = count;
+        }
+
+        Aabb left;
+        count = 0;
+        for (uint32_t bin = 0; bin < BIN_COUNT - 1; bin++) {
+            left.grow(bins[axis][bin].bounds);
+            count += bins[axis][bin].count;
+
+            float cost = left.getSurfaceArea() * count + rightArea[bin + 1] * rightCount[bin + 1];
+            if (count > 0 && rightCount[bin + 1] > 0 && cost < bestCost) {
+                bestCost  = cost;
+                bestAxis  = axis;
+                bestSplit = bin + 1;
+            }
+        }
+    }
+
+    // Splitting has to beat testing every item of the node, small nodes may stay leaves.
+    float leafCost = node.bounds.getSurfaceArea() * node.count;
+    if (bestCost >= leafCost && node.count <= MAX_LEAF * 4) {
+        return;
+    }
+
+    BuildItem* begin = items.data() + node.first;
+    BuildItem* end   = begin + node.count;
+    BuildItem* mid   = nullptr;
+    if (bestCost < FLT_MAX && depth < MEDIAN_SPLIT_DEPTH) {
+        mid = std::partition(begin, end, [&](const BuildItem& item) {
+            return std::min(BIN_COUNT - 1, static_cast<uint32_t>((item.centroid[bestAxis] - centroidBounds.min[bestAxis]) * scale[bestAxis])) < bestSplit;
+        });
+    } else {
+        // Deep or degenerate (every centroid in the same spot), split the count in half.
+        uint32_t axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+        mid           = begin + node.count / 2;
+        std::nth_element(begin, mid, end, [&](const BuildItem& a, const BuildItem& b) { return a.centroid[axis] < b.centroid[axis]; });
+    }
+
+    uint32_t leftCount = static_cast<uint32_t>(mid - begin);
+    uint32_t left      = static_cast<uint32_t>(m_nodes.size());
+
+    Node leftChild;
+    leftChild.first = node.first;
+    leftChild.count = leftCount;
+
+    Node rightChild;
+    rightChild.first = node.first + leftCount;
+    rightChild.count = node.count - leftCount;
+
+    node.left = left;
+    m_nodes.push_back(leftChild);
+    m_nodes.push_back(rightChild);
+    m_parents.push_back(index);
+    m_parents.push_back(index);
+}
+
+void Bvh::update(uint32_t item, const Aabb& bounds)
+{
+    if (item >= m_itemBounds.size()) {
+        return;
+    }
+
+    m_itemBounds[item] = bounds;
+    if (m_itemLeaf[item] != NO_LEAF) {
+        m_dirtyLeaves.push_back(m_itemLeaf[item]);
+    }
+}
+
+void Bvh::refit()
+{
+    for (uint32_t leaf : m_dirtyLeaves) {
+        refitLeaf(leaf);
+    }
+    m_dirtyLeaves.clear();
+}
+
+void Bvh::refitLeaf(uint32_t index)
+{
+    Node& leaf = m_nodes[index];
+
+    Aabb bounds;
+    for (uint32_t i = leaf.first; i < leaf.first + leaf.count; i++) {
+        bounds.grow(m_itemBounds[m_items[i]]);
+    }
+    if (bounds == leaf.bounds) {
+        return;
+    }
+    leaf.bounds = bounds;
+
+    // Walk up until a parent's bounds come out the same, everything above it is unaffected.
+    while (index != 0) {
+        index = m_parents[index];
+
+        Node& parent = m_nodes[index];
+        Aabb  merged = m_nodes[parent.left].bounds;
+        merged.grow(m_nodes[parent.left + 1].bounds);
+        if (merged == parent.bounds) {
+            break;
+        }
+        parent.bounds = merged;
+    }
+}
+
+template <typename Test> void Bvh::query(Test&& test, std::vector<uint32_t>& out) const
+{
+    if (m_nodes.empty()) {
+        return;
+    }
+
+    uint32_t stack[MAX_DEPTH + 1];
+    uint32_t size = 0;
+    stack[size++] = 0;
+
+    while (size > 0) {
+        const Node& node   = m_nodes[stack[--size]];
+        FrustumTest result = test(node.bounds);
+        if (result == FrustumTest::Outside) {
+            continue;
+        }
+
+        // A fully contained node takes all of its items without testing them.
+        if (result == FrustumTest::Inside) {
+            out.insert(out.end(), m_items.begin() + node.first, m_items.begin() + node.first + node.count);
+        } else if (node.isLeaf()) {
+            for (uint32_t i = node.first; i < node.first + node.count; i++) {
+                if (test(m_itemBounds[m_items[i]]) != FrustumTest::Outside) {
+                    out.push_back(m_items[i]);
+                }
+            }
+        } else {
+            stack[size++] = node.left;
+            stack[size++] = node.left + 1;
+        }
+    }
+}
+
+void Bvh::queryFrustum(const Frustum& frustum, std::vector<uint32_t>& out) const
+{
+    query([&](const Aabb& box) { return frustum.test(box); }, out);
+}
+
+void Bvh::querySphere(const glm::vec3& center, float radius, std::vector<uint32_t>& out) const
+{
+    query([&](const Aabb& box) { return testSphere(box, center, radius); }, out);
+}
+
+void Bvh::queryBox(const Aabb& box, std::vector<uint32_t>& out) const
+{
+    query([&](const Aabb& node) { return testBox(node, box); }, out);
+}
+
+RayHit Bvh::raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance) const
+{
+    RayHit hit;
+    if (m_nodes.empty()) {
+        return hit;
+    }
+
+    glm::vec3 inverse;
+    for (int axis = 0; axis < 3; axis++) {
+        inverse[axis] = direction[axis] != 0.0f ? 1.0f / direction[axis] : FLT_MAX;
+    }
+    hit.distance = maxDistance;
+
+    uint32_t stack[MAX_DEPTH + 1];
+    uint32_t size = 0;
+    if (intersectRay(m_nodes[0].bounds, origin, inverse, hit.distance) < FLT_MAX) {
+        stack[size++] = 0;
+    }
+
+    while (size > 0) {
+        const Node& node = m_nodes[stack[--size]];
+
+        // Re-test, a closer hit may have been found since this node was pushed.
+        if (intersectRay(node.bounds, origin, inverse, hit.distance) == FLT_MAX) {
+            continue;
+        }
+
+        if (node.isLeaf()) {
+            for (uint32_t i = node.first; i < node.first + node.count; i++) {
+                // The slab test takes an inverted box for an infinite one.
+                if (m_itemBounds[m_items[i]].isEmpty()) {
+                    continue;
+                }
+
+                float distance = intersectRay(m_itemBounds[m_items[i]], origin, inverse, hit.distance);
+                if (distance < hit.distance) {
+                    hit.distance = distance;
+                    hit.item     = m_items[i];
+                }
+            }
+            continue;
+        }
+
+        // Push the farther child first so the nearer one is visited first and can prune it.
+        float near = intersectRay(m_nodes[node.left].bounds, origin, inverse, hit.distance);
+        float far  = intersectRay(m_nodes[node.left + 1].bounds, origin, inverse, hit.distance);
+        uint32_t first  = node.left;
+        uint32_t second = node.left + 1;
+        if (far < near) {
+            std::swap(near, far);
+            std::swap(first, second);
+        }
+
+        if (far < FLT_MAX) {
+            stack[size++] = second;
+        }
+        if (near < FLT_MAX) {
+            stack[size++] = first;
+        }
+    }
+
+    if (!hit.isHit()) {
+        hit.distance = FLT_MAX;
+    }
+    return hit;
+}
+
+const Aabb& Bvh::getBounds() const
+{
+    static const Aabb empty;
+    return m_nodes.empty() ? empty : m_nodes[0].bounds;
+}
+
+float Bvh::getRefitRatio() const
+{
+    return m_builtArea > 0.0f ? getInternalArea() / m_builtArea : 1.0f;
+}
+
+float Bvh::getInternalArea() const
+{
+    float area = 0.0f;
+    for (const auto& node : m_nodes) {
+        if (!node.isLeaf()) {
+            area += node.bounds.getSurfaceArea();
+        }
+    }
+    return area;
+}
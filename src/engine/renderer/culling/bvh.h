@@ -0,0 +1,95 @@
+#ifndef ENGINE_RENDERER_BVH_H_
+#define ENGINE_RENDERER_BVH_H_
+
+#include "engine/renderer/culling/aabb.h"
+#include "engine/renderer/culling/frustum.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+struct RayHit {
+    uint32_t item     = ~0u;
+    float    distance = FLT_MAX; // Along the ray direction, in units of its length
+
+    bool isHit() const { return item != ~0u; }
+};
+
+// Bounding volume hierarchy over item boxes, items are identified by their index in the span given to build().
+// Items with empty boxes are left out of the tree until the next build.
+//
+// Built top down with a binned surface area heuristic. Moving items only refits the affected leaves and their parents,
+// the tree shape stays the same until the next build. Refits loosen the tree, so callers should rebuild once the
+// refitted tree is clearly worse than a fresh one (see getRefitRatio).
+class Bvh
+{
+  public:
+    Bvh()  = default;
+    ~Bvh() = default;
+
+    void build(std::span<const Aabb> bounds);
+    void clear();
+
+    // Moves an item, the tree is only fixed up by the next refit(). Items without a leaf only get their bounds stored.
+    void update(uint32_t item, const Aabb& bounds);
+    bool hasLeaf(uint32_t item) const { return item < m_itemLeaf.size() && m_itemLeaf[item] != NO_LEAF; }
+    void refit();
+
+    // Queries append matching items to out, in no particular order.
+    void queryFrustum(const Frustum& frustum, std::vector<uint32_t>& out) const;
+    void querySphere(const glm::vec3& center, float radius, std::vector<uint32_t>& out) const;
+    void queryBox(const Aabb& box, std::vector<uint32_t>& out) const;
+
+    // Closest item box the ray enters (or starts in) within maxDistance. Only boxes are tested.
+    RayHit raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance = FLT_MAX) const;
+
+    size_t      getItemCount() const { return m_itemBounds.size(); }
+    size_t      getNodeCount() const { return m_nodes.size(); }
+    const Aabb& getItemBounds(uint32_t item) const { return m_itemBounds[item]; }
+    const Aabb& getBounds() const;
+
+    // Summed internal node area now against right after the build, 1 for a fresh tree.
+    float getRefitRatio() const;
+
+  private:
+    static constexpr uint32_t BIN_COUNT = 16;
+    static constexpr uint32_t MAX_LEAF  = 4;
+    static constexpr uint32_t MAX_DEPTH = 64;
+    static constexpr uint32_t NO_LEAF   = ~0u;
+
+    // Children of an internal node are stored next to each other after it, so a reverse walk visits children first.
+    // Every node covers a contiguous range of m_items.
+    struct Node {
+        Aabb     bounds;
+        uint32_t left  = 0; // 0 for leaves, the root is never a child
+        uint32_t first = 0;
+        uint32_t count = 0;
+
+        bool isLeaf() const { return left == 0; }
+    };
+
+    std::vector<Node>     m_nodes;
+    std::vector<uint32_t> m_items;      // Item indices, ordered so every node's items are contiguous
+    std::vector<Aabb>     m_itemBounds; // By item
+    std::vector<uint32_t> m_itemLeaf;   // Leaf holding each item
+    std::vector<uint32_t> m_parents;    // By node, the root points to itself
+    std::vector<uint32_t> m_dirtyLeaves;
+    float                 m_builtArea = 0.0f;
+
+    // Item data is copied in build order so splitting walks memory linearly instead of through m_items.
+    struct BuildItem {
+        Aabb      bounds;
+        glm::vec3 centroid;
+        uint32_t  item = 0;
+    };
+
+    void  split(uint32_t node, uint32_t depth, std::vector<BuildItem>& items);
+    void  refitLeaf(uint32_t node);
+    float getInternalArea() const;
+
+    template <typename Test> void query(Test&& test, std::vector<uint32_t>& out) const;
+};
+
+#endif // ENGINE_RENDERER_BVH_H_
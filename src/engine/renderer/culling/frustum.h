@@ -0,0 +1,57 @@
+#ifndef ENGINE_RENDERER_FRUSTUM_H_
+#define ENGINE_RENDERER_FRUSTUM_H_
+
+#include "engine/renderer/culling/aabb.h"
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+
+enum class FrustumTest : uint32_t {
+    Outside,
+    Intersects,
+    Inside,
+};
+
+// Six planes pointing inwards, taken straight from a view projection matrix (Gribb/Hartmann). They are not normalized,
+// which is fine for sign tests.
+struct Frustum {
+    glm::vec4 planes[6];
+
+    static Frustum fromMatrix(const glm::mat4& viewProjection)
+    {
+        glm::vec4 rows[4];
+        for (int i = 0; i < 4; i++) {
+            rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+        }
+
+        Frustum frustum;
+        frustum.planes[0] = rows[3] + rows[0]; // Left
+        frustum.planes[1] = rows[3] - rows[0]; // Right
+        frustum.planes[2] = rows[3] + rows[1]; // Bottom
+        frustum.planes[3] = rows[3] - rows[1]; // Top
+        frustum.planes[4] = rows[3] + rows[2]; // Near
+        frustum.planes[5] = rows[3] - rows[2]; // Far
+        return frustum;
+    }
+
+    FrustumTest test(const Aabb& box) const
+    {
+        glm::vec3   center = box.getCenter();
+        glm::vec3   extent = box.getExtent();
+        FrustumTest result = FrustumTest::Inside;
+        for (const auto& plane : planes) {
+            float distance = plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w;
+            float radius   = std::abs(plane.x) * extent.x + std::abs(plane.y) * extent.y + std::abs(plane.z) * extent.z;
+            if (distance + radius < 0.0f) {
+                return FrustumTest::Outside;
+            }
+            if (distance - radius < 0.0f) {
+                result = FrustumTest::Intersects;
+            }
+        }
+        return result;
+    }
+};
+
+#endif // ENGINE_RENDERER_FRUSTUM_H_
@@ -0,0 +1,153 @@
+#include "pch.h"
+
+#include "engine/renderer/culling/frustum_culler.h"
+#include "common/cpu_features.h"
+
+#include <immintrin.h>
+
+#include <cmath>
+
+FrustumCuller::FrustumCuller()
+{
+    m_path = getBestPath();
+    setFrustum(glm::mat4(1.0f));
+}
+
+CullPath FrustumCuller::getBestPath()
+{
+    return CpuFeatures::hasAVX() ? CullPath::AVX : CullPath::SSE;
+}
+
+void FrustumCuller::clear()
+{
+    m_centerX.clear();
+    m_centerY.clear();
+    m_centerZ.clear();
+    m_extentX.clear();
+    m_extentY.clear();
+    m_extentZ.clear();
+    m_visible.clear();
+    m_visibleCount = 0;
+}
+
+uint32_t FrustumCuller::add(const glm::vec3& localMin, const glm::vec3& localMax, const glm::mat4& transform)
+{
+    return add(Aabb(localMin, localMax).transformed(transform));
+}
+
+uint32_t FrustumCuller::add(const Aabb& box)
+{
+    glm::vec3 center = box.getCenter();
+    glm::vec3 extent = box.getExtent();
+
+    m_centerX.push_back(center.x);
+    m_centerY.push_back(center.y);
+    m_centerZ.push_back(center.z);
+    m_extentX.push_back(extent.x);
+    m_extentY.push_back(extent.y);
+    m_extentZ.push_back(extent.z);
+    return static_cast<uint32_t>(m_centerX.size() - 1);
+}
+
+void FrustumCuller::cull()
+{
+    m_visible.resize(m_centerX.size());
+
+    // Each path returns how far it got, the narrower ones finish the tail.
+    size_t done = 0;
+    if (m_path == CullPath::AVX) {
+        done = cullAVX(done);
+    }
+    if (m_path != CullPath::Scalar) {
+        done = cullSSE(done);
+    }
+    cullScalar(done);
+
+    m_visibleCount = 0;
+    for (uint8_t visible : m_visible) {
+        m_visibleCount += visible;
+    }
+}
+
+// The SIMD paths below do the same operations in the same order, so all three agree bit for bit.
+size_t FrustumCuller::cullScalar(size_t first)
+{
+    size_t count = m_centerX.size();
+    for (size_t i = first; i < count; i++) {
+        bool outside = false;
+        for (const auto& plane : m_frustum.planes) {
+            float distance = plane.x * m_centerX[i] + plane.y * m_centerY[i] + plane.z * m_centerZ[i] + plane.w;
+            float radius   = std::abs(plane.x) * m_extentX[i] + std::abs(plane.y) * m_extentY[i] + std::abs(plane.z) * m_extentZ[i];
+            outside        = outside || distance + radius < 0.0f;
+        }
+        m_visible[i] = outside ? 0 : 1;
+    }
+    return count;
+}
+
+size_t FrustumCuller::cullSSE(size_t first)
+{
+    const __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+    const __m128 zero     = _mm_setzero_ps();
+
+    size_t i = first;
+    for (; i + 4 <= m_centerX.size(); i += 4) {
+        __m128 cx = _mm_loadu_ps(&m_centerX[i]);
+        __m128 cy = _mm_loadu_ps(&m_centerY[i]);
+        __m128 cz = _mm_loadu_ps(&m_centerZ[i]);
+        __m128 ex = _mm_loadu_ps(&m_extentX[i]);
+        __m128 ey = _mm_loadu_ps(&m_extentY[i]);
+        __m128 ez = _mm_loadu_ps(&m_extentZ[i]);
+
+        __m128 outside = _mm_setzero_ps();
+        for (const auto& plane : m_frustum.planes) {
+            __m128 nx = _mm_set1_ps(plane.x);
+            __m128 ny = _mm_set1_ps(plane.y);
+            __m128 nz = _mm_set1_ps(plane.z);
+
+            __m128 distance = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, cx), _mm_mul_ps(ny, cy)), _mm_mul_ps(nz, cz)), _mm_set1_ps(plane.w));
+            __m128 radius   = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_and_ps(nx, signMask), ex), _mm_mul_ps(_mm_and_ps(ny, signMask), ey)), _mm_mul_ps(_mm_and_ps(nz, signMask), ez));
+            outside         = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(distance, radius), zero));
+        }
+
+        int mask = _mm_movemask_ps(outside);
+        for (int lane = 0; lane < 4; lane++) {
+            m_visible[i + lane] = (mask >> lane) & 1 ? 0 : 1;
+        }
+    }
+    return i;
+}
+
+size_t FrustumCuller::cullAVX(size_t first)
+{
+    const __m256 signMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+    const __m256 zero     = _mm256_setzero_ps();
+
+    size_t i = first;
+    for (; i + 8 <= m_centerX.size(); i += 8) {
+        __m256 cx = _mm256_loadu_ps(&m_centerX[i]);
+        __m256 cy = _mm256_loadu_ps(&m_centerY[i]);
+        __m256 cz = _mm256_loadu_ps(&m_centerZ[i]);
+        __m256 ex = _mm256_loadu_ps(&m_extentX[i]);
+        __m256 ey = _mm256_loadu_ps(&m_extentY[i]);
+        __m256 ez = _mm256_loadu_ps(&m_extentZ[i]);
+
+        __m256 outside = _mm256_setzero_ps();
+        for (const auto& plane : m_frustum.planes) {
+            __m256 nx = _mm256_set1_ps(plane.x);
+            __m256 ny = _mm256_set1_ps(plane.y);
+            __m256 nz = _mm256_set1_ps(plane.z);
+
+            __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(nx, cx), _mm256_mul_ps(ny, cy)), _mm256_mul_ps(nz, cz)), _mm256_set1_ps(plane.w));
+            __m256 radius   = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_and_ps(nx, signMask), ex), _mm256_mul_ps(_mm256_and_ps(ny, signMask), ey)),
+                                            _mm256_mul_ps(_mm256_and_ps(nz, signMask), ez));
+            outside         = _mm256_or_ps(outside, _mm256_cmp_ps(_mm256_add_ps(distance, radius), zero, _CMP_LT_OQ));
+        }
+
+        int mask = _mm256_movemask_ps(outside);
+        for (int lane = 0; lane < 8; lane++) {
+            m_visible[i + lane] = (mask >> lane) & 1 ? 0 : 1;
+        }
+    }
+    return i;
+}
@@ -0,0 +1,67 @@
+#ifndef ENGINE_RENDERER_FRUSTUM_CULLER_H_
+#define ENGINE_RENDERER_FRUSTUM_CULLER_H_
+
+#include "engine/renderer/culling/frustum.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+enum class CullPath : uint32_t {
+    Scalar,
+    SSE, // 4 boxes per test
+    AVX, // 8 boxes per test, only picked when the CPU and OS support it
+};
+
+// What culling kept and dropped in a frame. Meshes of a culled model count as culled without being tested.
+struct CullStats {
+    uint32_t modelsVisible = 0;
+    uint32_t modelsCulled  = 0;
+    uint32_t meshesVisible = 0;
+    uint32_t meshesCulled  = 0;
+    float    cullMs        = 0.0f;
+};
+
+// Tests world space boxes against the six frustum planes in batches. Boxes are kept as center and half extents in SoA
+// arrays, a box is culled when it lies entirely behind any one plane. Conservative, boxes near a frustum corner can
+// pass while being outside.
+class FrustumCuller
+{
+  public:
+    FrustumCuller();
+    ~FrustumCuller() = default;
+
+    void setFrustum(const glm::mat4& viewProjection) { m_frustum = Frustum::fromMatrix(viewProjection); }
+    void clear();
+
+    // Adds a local box moved by transform, the world box is the one enclosing the transformed corners.
+    uint32_t add(const glm::vec3& localMin, const glm::vec3& localMax, const glm::mat4& transform);
+    uint32_t add(const Aabb& box);
+
+    // Tests every box added since clear(), isVisible is valid afterwards.
+    void cull();
+
+    bool   isVisible(uint32_t index) const { return m_visible[index] != 0; }
+    size_t getCount() const { return m_centerX.size(); }
+    size_t getVisibleCount() const { return m_visibleCount; }
+
+    void            setPath(CullPath path) { m_path = path; }
+    CullPath        getPath() const { return m_path; }
+    static CullPath getBestPath();
+
+  private:
+    Frustum m_frustum;
+
+    std::vector<float>   m_centerX, m_centerY, m_centerZ;
+    std::vector<float>   m_extentX, m_extentY, m_extentZ;
+    std::vector<uint8_t> m_visible;
+    size_t               m_visibleCount = 0;
+    CullPath             m_path         = CullPath::Scalar;
+
+    size_t cullScalar(size_t first);
+    size_t cullSSE(size_t first);
+    size_t cullAVX(size_t first);
+};
+
+#endif // ENGINE_RENDERER_FRUSTUM_CULLER_H_
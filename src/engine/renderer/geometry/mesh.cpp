@@ -2,16 +2,54 @@
 
 #include "mesh.h"
 
-#include "engine/renderer/shaders/shader.h"
+#include "engine/renderer/render_queue.h"
+#include "engine/renderer/buffers/material_buffer.h"
+#include "engine/renderer/shaders/shader_bindings.h"
+#include "engine/renderer/textures/texture_pool.h"
 
-Mesh::Mesh(std::vector<Vertex> vertices, std::vector<uint32_t> indices, std::vector<Texture> textures, Material material)
+#include <atomic>
+
+namespace
+{
+    // Texture type as named by the importer, indexed by texture unit.
+    const char* SAMPLER_TYPES[Mesh::TEXTURE_UNIT_COUNT] = {"texture_albedo", "texture_metallic", "texture_roughness", "texture_normal", "texture_specular"};
+
+    uint32_t getTextureUnit(const std::string& type)
+    {
+        for (uint32_t unit = 0; unit < Mesh::TEXTURE_UNIT_COUNT; unit++) {
+            if (type == SAMPLER_TYPES[unit]) {
+                return unit;
+            }
+        }
+
+        LOG_WARN("Mesh: Unknown texture type {}, binding it to unit 0", type);
+        return 0;
+    }
+
+    // What a unit needs for a draw, a kind and a value per unit, the texture set id is assigned from these. Pooled
+    // textures only differ by their pool, which a multi-draw sets as a uniform. Textures bound per draw are told apart by
+    // their file, the GL name is only a fallback for textures that weren't loaded from one.
+    const uint64_t UNIT_POOLED     = 1;
+    const uint64_t UNIT_BOUND_PATH = 2;
+    const uint64_t UNIT_BOUND_NAME = 3;
+
+    static_assert(TexturePool::FIRST_POOL_UNIT == Mesh::TEXTURE_UNIT_COUNT, "Pools start right after the per-draw units");
+
+    std::atomic<VertexFormat> s_defaultVertexFormat = VertexFormat::Packed;
+    std::atomic<bool>         s_keepCpuGeometry     = false;
+} // namespace
+
+Mesh::Mesh(GeometryBuffer& geometry, std::span<const Vertex> vertices, std::span<const uint32_t> indices, std::vector<Texture> textures, Material material, std::span<const MeshLod> lods)
 {
-    m_vertices = vertices;
-    m_indices  = indices;
-    m_textures = textures;
+    m_textures = std::move(textures);
     m_material = material;
 
-    setupMesh();
+    setupMesh(geometry, vertices, indices, lods);
+
+    if (s_keepCpuGeometry) {
+        m_vertices.assign(vertices.begin(), vertices.end());
+        m_indices.assign(indices.begin(), indices.end());
+    }
 }
 
 Mesh::~Mesh()
@@ -19,60 +57,168 @@ Mesh::~Mesh()
     //
 }
 
-void Mesh::draw(Shader* shader)
+void Mesh::draw() const
 {
-    shader->setVec3("material.albedo", m_material.albedo);
-    shader->setFloat("material.metallic", m_material.metallic);
-    shader->setFloat("material.roughness", m_material.roughness);
-    shader->setFloat("material.ao", m_material.ao);
-    shader->setVec3("material.emissive", m_material.emissive);
-    shader->setFloat("material.transparency", m_material.transparency);
+    BoundTextures bound = {};
 
-    shader->setBool("material.hasAlbedoTexture", m_material.hasAlbedoTexture);
-    shader->setBool("material.hasMetallicTexture", m_material.hasMetallicTexture);
-    shader->setBool("material.hasRoughnessTexture", m_material.hasRoughnessTexture);
-    shader->setBool("material.hasNormalTexture", m_material.hasNormalTexture);
-    shader->setBool("material.hasLegacySpecular", m_material.hasLegacySpecular);
+    bindGeometry();
+    bindVertexFormat();
+    bindMaterial();
+    bindTextures(bound);
+    drawElements();
 
-    for (uint32_t i = 0; i < m_textures.size(); i++) {
-        glActiveTexture(GL_TEXTURE0 + i);
-        glUniform1i(glGetUniformLocation(shader->getProgram(), (m_textures[i].type + "1").c_str()), i);
+    glBindVertexArray(0);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+void Mesh::bindGeometry() const
+{
+    m_geometry->bind();
+}
+
+void Mesh::bindVertexFormat() const
+{
+    glUniform1i(ShaderBinding::VERTEX_FORMAT, static_cast<int>(m_vertexFormat));
+    glUniform3fv(ShaderBinding::POSITION_OFFSET, 1, &m_quantization.offset[0]);
+    glUniform3fv(ShaderBinding::POSITION_SCALE, 1, &m_quantization.scale[0]);
+}
+
+void Mesh::bindMaterial() const
+{
+    MATERIAL_BUFFER.bind(m_materialId);
+}
+
+uint32_t Mesh::bindTextures(BoundTextures& bound) const
+{
+    // Resident textures are found through the material, only the ones the pool couldn't take are bound. Units without a
+    // texture keep whatever was bound, the material flags stop the shader from sampling them.
+    uint32_t changes = 0;
+    for (size_t i = 0; i < m_textures.size(); i++) {
+        uint32_t unit = m_textureUnits[i];
+        if (!(m_boundUnits & (1u << unit)) || bound[unit] == m_textures[i].id) {
+            continue;
+        }
+
+        glActiveTexture(GL_TEXTURE0 + unit);
         glBindTexture(GL_TEXTURE_2D, m_textures[i].id);
+        bound[unit] = m_textures[i].id;
+        changes++;
     }
+    return changes;
+}
 
-    glBindVertexArray(m_vao);
-    glDrawElements(GL_TRIANGLES, static_cast<uint32_t>(m_indices.size()), GL_UNSIGNED_INT, 0);
-    glBindVertexArray(0);
-    glActiveTexture(GL_TEXTURE0);
+void Mesh::bindTexturePools() const
+{
+    if (TEXTURE_POOL.getMode() == TextureBindingMode::Arrays) {
+        glUniform1uiv(ShaderBinding::TEXTURE_POOLS, TEXTURE_UNIT_COUNT, m_texturePools.data());
+    }
 }
 
-void Mesh::setupMesh()
+void Mesh::drawElements(uint32_t instanceCount, uint32_t lod) const
 {
-    glGenVertexArrays(1, &m_vao);
-    glGenBuffers(1, &m_vbo);
-    glGenBuffers(1, &m_ebo);
+    // LOD ranges are relative to the mesh's first index, the indices themselves to its base vertex.
+    const MeshLod& range = getLod(lod);
+    size_t         first = m_range.firstIndex + range.firstIndex;
+    glDrawElementsInstancedBaseVertex(GL_TRIANGLES, range.indexCount, GL_UNSIGNED_INT, (void*)(first * sizeof(uint32_t)), instanceCount, static_cast<GLint>(m_range.baseVertex));
+}
 
-    glBindVertexArray(m_vao);
-    glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
-    glBufferData(GL_ARRAY_BUFFER, m_vertices.size() * sizeof(Vertex), &m_vertices[0], GL_STATIC_DRAW);
+IndirectCommand Mesh::getIndirectCommand(uint32_t instanceCount, uint32_t firstInstance, uint32_t lod) const
+{
+    const MeshLod&  range = getLod(lod);
+    IndirectCommand command;
+    command.count         = range.indexCount;
+    command.instanceCount = instanceCount;
+    command.firstIndex    = m_range.firstIndex + range.firstIndex;
+    command.baseVertex    = static_cast<int32_t>(m_range.baseVertex);
+    command.baseInstance  = firstInstance;
+    return command;
+}
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_indices.size() * sizeof(uint32_t), &m_indices[0], GL_STATIC_DRAW);
+void Mesh::releaseCpuGeometry()
+{
+    m_vertices = {};
+    m_indices  = {};
+}
 
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+size_t Mesh::getMemoryUsage() const
+{
+    size_t gpu = m_range.vertexCount * getVertexSize(m_vertexFormat) + m_range.indexCount * sizeof(uint32_t);
+    size_t cpu = m_vertices.capacity() * sizeof(Vertex) + m_indices.capacity() * sizeof(uint32_t);
+    return gpu + cpu;
+}
 
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, normal));
+void Mesh::setupMesh(GeometryBuffer& geometry, std::span<const Vertex> vertices, std::span<const uint32_t> indices, std::span<const MeshLod> lods)
+{
+    m_lods.assign(lods.begin(), lods.end());
+    if (m_lods.empty()) {
+        m_lods.push_back({0, static_cast<uint32_t>(indices.size()), 0.0f});
+    }
 
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, texCoords));
+    MaterialBuffer::TextureSlots slots;
+    slots.fill(TexturePool::INVALID_INDEX);
+
+    std::array<uint64_t, TEXTURE_UNIT_COUNT * 2> units = {};
+
+    m_textureUnits.clear();
+    m_texturePools.fill(0);
+    m_boundUnits = 0;
+    for (const auto& texture : m_textures) {
+        uint32_t unit = getTextureUnit(texture.type);
+        m_textureUnits.push_back(unit);
+
+        // Without a pool entry the texture is bound per draw, the material keeps its flag and the shader samples the unit.
+        slots[unit] = TEXTURE_POOL.add(texture.id);
+        if (slots[unit] == TexturePool::INVALID_INDEX) {
+            m_boundUnits |= 1u << unit;
+            units[unit * 2]     = texture.pathId.isValid() ? UNIT_BOUND_PATH : UNIT_BOUND_NAME;
+            units[unit * 2 + 1] = texture.pathId.isValid() ? texture.pathId.getValue() : texture.id;
+        } else {
+            m_texturePools[unit] = TEXTURE_POOL.getPool(slots[unit]);
+            units[unit * 2]      = UNIT_POOLED;
+            units[unit * 2 + 1]  = m_texturePools[unit];
+        }
+    }
+    m_materialId   = MATERIAL_BUFFER.add(m_material, slots);
+    m_textureSetId = RenderQueue::getTextureSetId(units);
+
+    if (!vertices.empty()) {
+        m_boundsMin = m_boundsMax = vertices[0].pos;
+        for (const auto& vertex : vertices) {
+            m_boundsMin = glm::min(m_boundsMin, vertex.pos);
+            m_boundsMax = glm::max(m_boundsMax, vertex.pos);
+        }
+    }
 
-    glEnableVertexAttribArray(3);
-    glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, tangent));
+    // Quantization stays per mesh even in a shared buffer, small meshes keep their precision. It costs two uniforms
+    // per mesh change, the vertex array bind it saves is the expensive part.
+    m_vertexFormat = geometry.getFormat();
+    m_quantization = m_vertexFormat == VertexFormat::Packed ? VertexQuantization::fromBounds(m_boundsMin, m_boundsMax) : VertexQuantization();
 
-    glEnableVertexAttribArray(4);
-    glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, bitangent));
+    m_geometry = &geometry;
+    m_range    = geometry.add(vertices, indices, m_quantization);
+}
 
-    glBindVertexArray(0);
+void Mesh::setDefaultVertexFormat(VertexFormat format)
+{
+    s_defaultVertexFormat = format;
+}
+
+VertexFormat Mesh::getDefaultVertexFormat()
+{
+    return s_defaultVertexFormat;
+}
+
+void Mesh::setKeepCpuGeometry(bool keep)
+{
+    s_keepCpuGeometry = keep;
+}
+
+bool Mesh::getKeepCpuGeometry()
+{
+    return s_keepCpuGeometry;
+}
+
+size_t Mesh::getVertexSize(VertexFormat format)
+{
+    return format == VertexFormat::Packed ? sizeof(PackedVertex) : sizeof(Vertex);
 }
\ No newline at end of file
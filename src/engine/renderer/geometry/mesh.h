@@ -1,26 +1,25 @@
 #ifndef ENGINE_RENDERER_MESH_H_
 #define ENGINE_RENDERER_MESH_H_
 
+#include "engine/renderer/buffers/geometry_buffer.h"
+#include "engine/renderer/geometry/mesh_lod.h"
+#include "engine/renderer/geometry/vertex.h"
+#include "engine/core/path_id.h"
 #include "common/logger.h"
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include <array>
+#include <span>
 #include <string>
 #include <vector>
 
-struct Vertex {
-    glm::vec3 pos;
-    glm::vec3 normal;
-    glm::vec2 texCoords;
-    glm::vec3 tangent;
-    glm::vec3 bitangent;
-};
-
 struct Texture {
     uint32_t    id;
     std::string type;
     std::string path;
+    PathId      pathId; // Of the loaded file. Unlike the GL name it never comes back for a different texture.
 };
 
 struct Material {
@@ -45,33 +44,105 @@ struct Material {
 
     bool hasLegacyDiffuse  = false;
     bool hasLegacySpecular = false;
-};
 
-class Shader;
+    bool operator==(const Material&) const = default;
+};
 
 class Mesh
 {
   public:
-    Mesh(std::vector<Vertex> vertices, std::vector<uint32_t> indices, std::vector<Texture> textures, Material material);
+    // Appends the geometry to the shared buffer, which has to outlive the mesh and be allocated with room for it.
+    // Uploads straight from the given memory (the import arena or a mapped cooked model), a CPU copy is only made with
+    // setKeepCpuGeometry. Without lods the whole index buffer is the only level.
+    Mesh(GeometryBuffer& geometry, std::span<const Vertex> vertices, std::span<const uint32_t> indices, std::vector<Texture> textures, Material material,
+         std::span<const MeshLod> lods = {});
     ~Mesh();
 
-    void                  draw(Shader* shader);
-    const Material&       getMaterial() const { return m_material; }
-    std::vector<Vertex>   getVertices() const { return m_vertices; }
-    std::vector<uint32_t> getIndices() const { return m_indices; }
-    std::vector<Texture>  getTextures() const { return m_textures; }
+    // Move only, a copy would duplicate megabytes of geometry for nothing. Draw items point at meshes, so a model's
+    // meshes must not move once they can be submitted.
+    Mesh(const Mesh&)            = delete;
+    Mesh& operator=(const Mesh&) = delete;
+    Mesh(Mesh&&)                 = default;
+    Mesh& operator=(Mesh&&)      = default;
+
+    // Every sampler type has a fixed unit, declared with layout(binding = N) in the shaders.
+    static constexpr uint32_t TEXTURE_UNIT_COUNT = 5;
+    using BoundTextures                          = std::array<uint32_t, TEXTURE_UNIT_COUNT>;
+
+    // Binds everything itself, the render queue uses the split calls below to skip what is already bound. The instance
+    // buffer, first instance, camera block, material buffer and texture pool have to be set by the caller. Needs a
+    // program compiled without MULTI_DRAW, which takes its per-draw state from indirect commands (see RenderQueue).
+    void draw() const;
+
+    void     bindGeometry() const;     // The shared vertex array, same for every mesh of a model
+    void     bindVertexFormat() const; // Decode uniforms on the current program
+    void     bindMaterial() const;
+    uint32_t bindTextures(BoundTextures& bound) const; // Returns how many units changed, with resident textures only unpooled ones bind
+    void     bindTexturePools() const;                 // Slot pools of a MULTI_DRAW program, nothing unless pooled in arrays
+    void     drawElements(uint32_t instanceCount = 1, uint32_t lod = 0) const; // Expects the geometry to be bound
+
+    // The same draw as drawElements, for an indirect buffer. The instances start at firstInstance in the instance buffer.
+    IndirectCommand getIndirectCommand(uint32_t instanceCount, uint32_t firstInstance, uint32_t lod = 0) const;
+
+    const Material&             getMaterial() const { return m_material; }
+    const GeometryBuffer&       getGeometry() const { return *m_geometry; }
+    const GeometryRange&        getGeometryRange() const { return m_range; }
+    std::span<const Vertex>     getVertices() const { return m_vertices; } // Empty unless the CPU copy was kept
+    std::span<const uint32_t>   getIndices() const { return m_indices; }
+    const std::vector<Texture>& getTextures() const { return m_textures; }
+    uint32_t                    getMaterialId() const { return m_materialId; }
+    uint32_t                    getTextureSetId() const { return m_textureSetId; } // Equal for meshes needing the same texture state
+    size_t                      getTextureCount() const { return m_textures.size(); }
+    glm::vec3                   getCenter() const { return (m_boundsMin + m_boundsMax) * 0.5f; }
+    float                       getRadius() const { return glm::length(m_boundsMax - m_boundsMin) * 0.5f; }
+    const glm::vec3&            getBoundsMin() const { return m_boundsMin; } // Local space, from the vertices at load
+    const glm::vec3&            getBoundsMax() const { return m_boundsMax; }
+    VertexFormat                getVertexFormat() const { return m_vertexFormat; }
+    const VertexQuantization&   getQuantization() const { return m_quantization; }
+    std::span<const MeshLod>    getLods() const { return m_lods; }
+    uint32_t                    getTriangleCount(uint32_t lod = 0) const { return getLod(lod).indexCount / 3; }
+
+    // This mesh's share of the GPU buffers plus any CPU copy of the geometry, textures are accounted by the texture cache.
+    size_t getMemoryUsage() const;
+
+    // Frees the CPU copy of the vertices and indices, the GPU buffers stay.
+    void releaseCpuGeometry();
+
+    // Layout for models created from now on, all meshes of a model share it. Packed unless switched back for comparison.
+    static void         setDefaultVertexFormat(VertexFormat format);
+    static VertexFormat getDefaultVertexFormat();
+    static size_t       getVertexSize(VertexFormat format);
+
+    // Whether meshes created from now on keep a CPU copy of their vertices and indices. Off by default, nothing reads
+    // them back after the upload.
+    static void setKeepCpuGeometry(bool keep);
+    static bool getKeepCpuGeometry();
 
   private:
-    uint32_t m_vbo;
-    uint32_t m_ebo;
-    uint32_t m_vao;
+    const GeometryBuffer* m_geometry = nullptr;
+    GeometryRange         m_range;
 
     std::vector<Vertex>   m_vertices;
     std::vector<uint32_t> m_indices;
     std::vector<Texture>  m_textures;
+    std::vector<uint32_t> m_textureUnits; // Unit for each entry of m_textures
+
+    std::array<uint32_t, TEXTURE_UNIT_COUNT> m_texturePools = {}; // TexturePool pool of each unit, arrays only
+    uint32_t                                 m_boundUnits   = 0;  // Units bound per draw, every one without resident textures
+    std::vector<MeshLod>  m_lods;
     Material              m_material;
 
-    void setupMesh();
+    uint32_t           m_materialId   = 0;
+    uint32_t           m_textureSetId = 0;
+    glm::vec3          m_boundsMin    = glm::vec3(0.0f);
+    glm::vec3          m_boundsMax    = glm::vec3(0.0f);
+    VertexFormat       m_vertexFormat = VertexFormat::Float;
+    VertexQuantization m_quantization;
+
+    void setupMesh(GeometryBuffer& geometry, std::span<const Vertex> vertices, std::span<const uint32_t> indices, std::span<const MeshLod> lods);
+
+    // Levels past the coarsest one fall back to it, meshes don't all have the same number of levels.
+    const MeshLod& getLod(uint32_t lod) const { return m_lods[lod < m_lods.size() ? lod : m_lods.size() - 1]; }
 };
 
 #endif // ENGINE_RENDERER_MESH_H_
\ No newline at end of file
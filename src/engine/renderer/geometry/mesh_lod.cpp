@@ -0,0 +1,46 @@
+#include "pch.h"
+
+#include "engine/renderer/geometry/mesh_lod.h"
+
+#include <algorithm>
+#include <cmath>
+
+void LodSelector::setProjection(float fovY, float viewportHeight)
+{
+    m_pixelsPerUnit = viewportHeight / (2.0f * std::tan(fovY * 0.5f));
+}
+
+uint32_t LodSelector::select(std::span<const MeshLod> lods, float distance, float scale) const
+{
+    if (!m_enabled || lods.size() < 2) {
+        return 0;
+    }
+
+    // Errors grow with every level, so walk down until the next one would be visible.
+    float    allowed = m_maxPixelError * std::max(distance, MIN_DISTANCE) / (m_pixelsPerUnit * scale);
+    uint32_t lod     = 0;
+    while (lod + 1 < lods.size() && lods[lod + 1].error <= allowed) {
+        lod++;
+    }
+    return lod;
+}
+
+uint32_t LodSelector::select(std::span<const MeshLod> lods, const glm::vec3& viewCenter, float radius, const glm::mat4& transform) const
+{
+    if (!m_enabled || lods.size() < 2) {
+        return 0;
+    }
+
+    float scale = getScale(transform);
+    return select(lods, glm::length(viewCenter) - radius * scale, scale);
+}
+
+float LodSelector::getPixelError(const MeshLod& lod, float distance, float scale) const
+{
+    return lod.error * scale * m_pixelsPerUnit / std::max(distance, MIN_DISTANCE);
+}
+
+float LodSelector::getScale(const glm::mat4& transform)
+{
+    return std::max(std::max(glm::length(glm::vec3(transform[0])), glm::length(glm::vec3(transform[1]))), glm::length(glm::vec3(transform[2])));
+}
@@ -0,0 +1,52 @@
+#ifndef ENGINE_RENDERER_MESH_LOD_H_
+#define ENGINE_RENDERER_MESH_LOD_H_
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <span>
+
+// One level of detail, a range of the mesh's index buffer. Every level indexes the same vertices.
+struct MeshLod {
+    uint32_t firstIndex = 0;
+    uint32_t indexCount = 0;
+    float    error      = 0.0f; // Estimated distance to the full detail surface, in mesh units
+    uint32_t padding    = 0;
+
+    static constexpr uint32_t MAX_COUNT = 5; // Full detail plus four simplified levels
+};
+
+// Picks a level per instance from the screen space error: the coarsest one whose error, projected at the instance's
+// distance, stays under the pixel threshold.
+class LodSelector
+{
+  public:
+    LodSelector()  = default;
+    ~LodSelector() = default;
+
+    // Vertical field of view in radians and viewport height in pixels.
+    void setProjection(float fovY, float viewportHeight);
+    void setMaxPixelError(float pixels) { m_maxPixelError = pixels; }
+    void setEnabled(bool enabled) { m_enabled = enabled; }
+
+    float getMaxPixelError() const { return m_maxPixelError; }
+    bool  isEnabled() const { return m_enabled; }
+
+    // Distance from the camera to the nearest point of the mesh, scale the largest axis scale of its transform.
+    uint32_t select(std::span<const MeshLod> lods, float distance, float scale) const;
+    // Same, measured to the nearest point of the mesh's bounding sphere, so a big mesh right next to the camera stays
+    // detailed. viewCenter is the sphere center in view space, radius in mesh units.
+    uint32_t select(std::span<const MeshLod> lods, const glm::vec3& viewCenter, float radius, const glm::mat4& transform) const;
+    float    getPixelError(const MeshLod& lod, float distance, float scale) const;
+
+    static float getScale(const glm::mat4& transform);
+
+  private:
+    float m_pixelsPerUnit = 1.0f; // Size in pixels of one unit at distance one
+    float m_maxPixelError = 1.0f;
+    bool  m_enabled       = true;
+
+    static constexpr float MIN_DISTANCE = 1e-3f;
+};
+
+#endif // ENGINE_RENDERER_MESH_LOD_H_
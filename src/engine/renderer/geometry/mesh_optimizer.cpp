@@ -0,0 +1,350 @@
+#include "pch.h"
+
+#include "engine/renderer/geometry/mesh_optimizer.h"
+
+#include "common/logger.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    const uint32_t INVALID_INDEX = ~0u;
+
+    // Forsyth's scoring, see "Linear-Speed Vertex Cache Optimisation". The scoring cache is larger than the simulated
+    // one on purpose, it only ranks candidates.
+    const uint32_t SCORE_CACHE_SIZE    = 32;
+    const uint32_t MAX_VALENCE_SCORE   = 32;
+    const float    CACHE_DECAY_POWER   = 1.5f;
+    const float    LAST_TRIANGLE_SCORE = 0.75f;
+    const float    VALENCE_BOOST_SCALE = 2.0f;
+    const float    VALENCE_BOOST_POWER = 0.5f;
+
+    struct ScoreTables {
+        float cache[SCORE_CACHE_SIZE];
+        float valence[MAX_VALENCE_SCORE + 1];
+
+        ScoreTables()
+        {
+            for (uint32_t i = 0; i < SCORE_CACHE_SIZE; i++) {
+                // The last triangle's vertices get a fixed score, so the next one doesn't just reuse the same edge.
+                cache[i] = i < 3 ? LAST_TRIANGLE_SCORE : std::pow(1.0f - static_cast<float>(i - 3) / (SCORE_CACHE_SIZE - 3), CACHE_DECAY_POWER);
+            }
+
+            valence[0] = 0.0f;
+            for (uint32_t i = 1; i <= MAX_VALENCE_SCORE; i++) {
+                // Vertices with few triangles left are finished off first, so they leave the cache for good.
+                valence[i] = VALENCE_BOOST_SCALE * std::pow(static_cast<float>(i), -VALENCE_BOOST_POWER);
+            }
+        }
+
+        float getScore(uint32_t cachePosition, uint32_t liveTriangles) const
+        {
+            if (liveTriangles == 0) {
+                return 0.0f;
+            }
+
+            float score = cachePosition < SCORE_CACHE_SIZE ? cache[cachePosition] : 0.0f;
+            return score + valence[std::min(liveTriangles, MAX_VALENCE_SCORE)];
+        }
+    };
+
+    const ScoreTables s_scores;
+
+    // Triangles of every vertex, CSR style. Emitted triangles are swapped past the live count.
+    struct Adjacency {
+        std::vector<uint32_t> offsets;
+        std::vector<uint32_t> counts;
+        std::vector<uint32_t> triangles;
+
+        Adjacency(std::span<const uint32_t> indices, size_t vertexCount) : offsets(vertexCount), counts(vertexCount, 0), triangles(indices.size())
+        {
+            for (uint32_t index : indices) {
+                counts[index]++;
+            }
+
+            uint32_t offset = 0;
+            for (size_t v = 0; v < vertexCount; v++) {
+                offsets[v] = offset;
+                offset += counts[v];
+                counts[v] = 0;
+            }
+
+            for (uint32_t i = 0; i < indices.size(); i++) {
+                uint32_t v                          = indices[i];
+                triangles[offsets[v] + counts[v]++] = i / 3;
+            }
+        }
+
+        void remove(uint32_t vertex, uint32_t triangle)
+        {
+            uint32_t* begin = triangles.data() + offsets[vertex];
+            uint32_t* end   = begin + counts[vertex];
+            uint32_t* found = std::find(begin, end, triangle);
+            if (found != end) {
+                std::swap(*found, *(end - 1));
+                counts[vertex]--;
+            }
+        }
+    };
+} // namespace
+
+void MeshOptimizer::optimize(std::pmr::vector<Vertex>& vertices, std::span<uint32_t> indices) const
+{
+    if (indices.size() % 3 != 0) {
+        LOG_WARN("MeshOptimizer: {} indices is not a triangle list, leaving the mesh as is", indices.size());
+        return;
+    }
+
+    optimizeVertexCache(indices, vertices.size());
+    optimizeOverdraw(vertices, indices);
+    optimizeVertexFetch(vertices, indices);
+}
+
+void MeshOptimizer::optimizeVertexCache(std::span<uint32_t> indices, size_t vertexCount) const
+{
+    // Only triangle lists, a partial triangle would read past the end below.
+    uint32_t triangleCount = static_cast<uint32_t>(indices.size() / 3);
+    if (triangleCount == 0 || indices.size() % 3 != 0) {
+        return;
+    }
+
+    Adjacency adjacency(indices, vertexCount);
+
+    std::vector<uint32_t> cachePositions(vertexCount, INVALID_INDEX);
+    std::vector<float>    vertexScores(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++) {
+        vertexScores[v] = s_scores.getScore(INVALID_INDEX, adjacency.counts[v]);
+    }
+
+    auto getTriangleScore = [&](uint32_t t) { return vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]]; };
+
+    std::vector<bool> emitted(triangleCount, false);
+    uint32_t          best      = 0;
+    float             bestScore = -1.0f;
+    for (uint32_t t = 0; t < triangleCount; t++) {
+        float score = getTriangleScore(t);
+        if (score > bestScore) {
+            bestScore = score;
+            best      = t;
+        }
+    }
+
+    std::vector<uint32_t> cache;
+    std::vector<uint32_t> nextCache;
+    cache.reserve(SCORE_CACHE_SIZE + 3);
+    nextCache.reserve(SCORE_CACHE_SIZE + 3);
+
+    std::vector<uint32_t> result;
+    result.reserve(indices.size());
+
+    uint32_t inputCursor = 0;
+    for (uint32_t emittedCount = 0; emittedCount < triangleCount; emittedCount++) {
+        // Nothing in the cache has triangles left, continue with the next one in input order.
+        if (best == INVALID_INDEX) {
+            while (emitted[inputCursor]) {
+                inputCursor++;
+            }
+            best = inputCursor;
+        }
+
+        const uint32_t* triangle = &indices[best * 3];
+        result.insert(result.end(), triangle, triangle + 3);
+        emitted[best] = true;
+
+        // The triangle's vertices move to the front, the rest shift back and the oldest fall out.
+        nextCache.clear();
+        for (int corner = 0; corner < 3; corner++) {
+            uint32_t vertex = triangle[corner];
+            adjacency.remove(vertex, best);
+            if (std::find(nextCache.begin(), nextCache.end(), vertex) == nextCache.end()) {
+                nextCache.push_back(vertex);
+            }
+        }
+        size_t head = nextCache.size();
+        for (uint32_t vertex : cache) {
+            if (std::find(nextCache.begin(), nextCache.begin() + head, vertex) == nextCache.begin() + head) {
+                nextCache.push_back(vertex);
+            }
+        }
+
+        for (uint32_t i = 0; i < nextCache.size(); i++) {
+            uint32_t vertex        = nextCache[i];
+            cachePositions[vertex] = i < SCORE_CACHE_SIZE ? i : INVALID_INDEX;
+            vertexScores[vertex]   = s_scores.getScore(cachePositions[vertex], adjacency.counts[vertex]);
+        }
+
+        // Only triangles touching the cache changed score, the best of them is the next one to emit. Evicted
+        // vertices were rescored above but their triangles wait for the fallback.
+        best      = INVALID_INDEX;
+        bestScore = -1.0f;
+        for (uint32_t i = 0; i < nextCache.size(); i++) {
+            uint32_t        vertex = nextCache[i];
+            const uint32_t* live   = adjacency.triangles.data() + adjacency.offsets[vertex];
+            for (uint32_t j = 0; j < adjacency.counts[vertex] && i < SCORE_CACHE_SIZE; j++) {
+                float score = getTriangleScore(live[j]);
+                if (score > bestScore) {
+                    bestScore = score;
+                    best      = live[j];
+                }
+            }
+        }
+
+        nextCache.resize(std::min<size_t>(nextCache.size(), SCORE_CACHE_SIZE));
+        cache.swap(nextCache);
+    }
+
+    std::copy(result.begin(), result.end(), indices.begin());
+}
+
+void MeshOptimizer::optimizeOverdraw(std::span<const Vertex> vertices, std::span<uint32_t> indices) const
+{
+    uint32_t triangleCount = static_cast<uint32_t>(indices.size() / 3);
+    if (triangleCount < 2 || indices.size() % 3 != 0) {
+        return;
+    }
+
+    // FIFO cache by timestamp, a vertex is cached while fewer than SIMULATED_CACHE_SIZE misses happened since its own.
+    std::vector<uint32_t> timestamps(vertices.size(), 0);
+    uint32_t              time     = SIMULATED_CACHE_SIZE + 1;
+    auto                  simulate = [&](uint32_t t) {
+        uint32_t misses = 0;
+        for (int corner = 0; corner < 3; corner++) {
+            uint32_t vertex = indices[t * 3 + corner];
+            if (time - timestamps[vertex] > SIMULATED_CACHE_SIZE) {
+                timestamps[vertex] = time++;
+                misses++;
+            }
+        }
+        return misses;
+    };
+    auto flush = [&]() { time += SIMULATED_CACHE_SIZE + 1; };
+
+    // Hard boundaries: a triangle whose vertices all miss starts over anyway, splitting there costs nothing.
+    std::vector<uint32_t> hard;
+    for (uint32_t t = 0; t < triangleCount; t++) {
+        if (simulate(t) == 3 || t == 0) {
+            hard.push_back(t);
+        }
+    }
+    hard.push_back(triangleCount);
+
+    // Soft boundaries: split a hard cluster again wherever the part so far, started from a cold cache, stays within
+    // the threshold of the whole cluster's ACMR.
+    std::vector<uint32_t> clusters;
+    for (size_t c = 0; c + 1 < hard.size(); c++) {
+        uint32_t first = hard[c];
+        uint32_t last  = hard[c + 1];
+
+        flush();
+        uint32_t misses = 0;
+        for (uint32_t t = first; t < last; t++) {
+            misses += simulate(t);
+        }
+        float limit = m_overdrawThreshold * static_cast<float>(misses) / (last - first);
+
+        flush();
+        clusters.push_back(first);
+        uint32_t start = first;
+        misses         = 0;
+        for (uint32_t t = first; t < last; t++) {
+            misses += simulate(t);
+            if (t + 1 < last && misses <= limit * (t + 1 - start)) {
+                clusters.push_back(t + 1);
+                start  = t + 1;
+                misses = 0;
+                flush();
+            }
+        }
+    }
+    clusters.push_back(triangleCount);
+
+    // Area weighted centroid and normal per cluster. Clusters facing away from the mesh center are on its outside.
+    glm::vec3 meshCenter(0.0f);
+    for (uint32_t index : indices) {
+        meshCenter += vertices[index].pos;
+    }
+    meshCenter /= static_cast<float>(indices.size());
+
+    struct Cluster {
+        uint32_t first = 0;
+        uint32_t last  = 0;
+        float    key   = 0.0f;
+    };
+
+    std::vector<Cluster> sorted(clusters.size() - 1);
+    for (size_t c = 0; c + 1 < clusters.size(); c++) {
+        glm::vec3 centroid(0.0f);
+        glm::vec3 normal(0.0f);
+        float     area = 0.0f;
+        for (uint32_t t = clusters[c]; t < clusters[c + 1]; t++) {
+            const glm::vec3& a     = vertices[indices[t * 3]].pos;
+            const glm::vec3& b     = vertices[indices[t * 3 + 1]].pos;
+            const glm::vec3& d     = vertices[indices[t * 3 + 2]].pos;
+            glm::vec3        cross = glm::cross(b - a, d - a);
+            float            size  = glm::length(cross);
+
+            centroid += (a + b + d) * (size / 3.0f);
+            normal += cross;
+            area += size;
+        }
+
+        float     length = glm::length(normal);
+        glm::vec3 center = area > 0.0f ? centroid / area : glm::vec3(vertices[indices[clusters[c] * 3]].pos);
+        sorted[c].first  = clusters[c];
+        sorted[c].last   = clusters[c + 1];
+        sorted[c].key    = length > 0.0f ? glm::dot(center - meshCenter, normal / length) : 0.0f;
+    }
+
+    // Stable, so equal keys keep the cache optimized order and the output stays deterministic.
+    std::stable_sort(sorted.begin(), sorted.end(), [](const Cluster& a, const Cluster& b) { return a.key > b.key; });
+
+    std::vector<uint32_t> result;
+    result.reserve(indices.size());
+    for (const auto& cluster : sorted) {
+        result.insert(result.end(), indices.begin() + cluster.first * 3, indices.begin() + cluster.last * 3);
+    }
+    std::copy(result.begin(), result.end(), indices.begin());
+}
+
+void MeshOptimizer::optimizeVertexFetch(std::pmr::vector<Vertex>& vertices, std::span<uint32_t> indices) const
+{
+    std::vector<uint32_t> remap(vertices.size(), INVALID_INDEX);
+    std::vector<Vertex>   result;
+    result.reserve(vertices.size());
+
+    for (uint32_t& index : indices) {
+        if (remap[index] == INVALID_INDEX) {
+            remap[index] = static_cast<uint32_t>(result.size());
+            result.push_back(vertices[index]);
+        }
+        index = remap[index];
+    }
+
+    // Written back rather than swapped, so the vertices stay in their own allocation (the import arena) and the
+    // scratch copy goes back to the heap right away.
+    std::copy(result.begin(), result.end(), vertices.begin());
+    vertices.resize(result.size());
+}
+
+VertexCacheStats MeshOptimizer::analyzeVertexCache(std::span<const uint32_t> indices, size_t vertexCount, uint32_t cacheSize)
+{
+    VertexCacheStats stats;
+    stats.triangles = indices.size() / 3;
+
+    std::vector<uint32_t> timestamps(vertexCount, 0);
+    std::vector<bool>     used(vertexCount, false);
+    uint32_t              time = cacheSize + 1;
+    for (uint32_t index : indices) {
+        if (time - timestamps[index] > cacheSize) {
+            timestamps[index] = time++;
+            stats.transformed++;
+        }
+        if (!used[index]) {
+            used[index] = true;
+            stats.vertices++;
+        }
+    }
+
+    return stats;
+}
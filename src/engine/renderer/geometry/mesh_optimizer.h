@@ -0,0 +1,66 @@
+#ifndef ENGINE_RENDERER_MESH_OPTIMIZER_H_
+#define ENGINE_RENDERER_MESH_OPTIMIZER_H_
+
+#include "engine/renderer/geometry/mesh.h"
+
+#include <cstdint>
+#include <memory_resource>
+#include <span>
+#include <vector>
+
+// Post-transform cache behaviour of an index buffer, from a FIFO cache simulation. Counts rather than ratios so the
+// numbers of several meshes can be summed.
+struct VertexCacheStats {
+    uint64_t transformed = 0; // Cache misses, i.e. vertex shader invocations
+    uint64_t triangles   = 0;
+    uint64_t vertices    = 0; // Distinct vertices referenced
+
+    // Average cache miss ratio, transformed vertices per triangle. 0.5 is the ideal for a large regular grid, 3 the worst.
+    float getAcmr() const { return triangles ? static_cast<float>(transformed) / triangles : 0.0f; }
+    // Average transform to vertex ratio, 1 means every vertex ran through the vertex shader exactly once.
+    float getAtvr() const { return vertices ? static_cast<float>(transformed) / vertices : 0.0f; }
+
+    VertexCacheStats& operator+=(const VertexCacheStats& other)
+    {
+        transformed += other.transformed;
+        triangles += other.triangles;
+        vertices += other.vertices;
+        return *this;
+    }
+};
+
+// Reorders triangle lists for the GPU, run at import so the cooked blob already holds the result. Every stage is
+// single threaded and only depends on its input, so the same mesh always comes out the same.
+//
+//   1. vertex cache  Forsyth's greedy ordering, triangles whose vertices are in a simulated LRU cache go first
+//   2. overdraw      splits the result into clusters that start with a cold cache and sorts them outside in, so
+//                    the silhouette tends to be drawn before what it hides. Clusters only split where the cache
+//                    efficiency stays within the threshold of the cache optimized order.
+//   3. vertex fetch  renumbers vertices in first use order so the vertex buffer is read front to back
+class MeshOptimizer
+{
+  public:
+    MeshOptimizer()  = default;
+    ~MeshOptimizer() = default;
+
+    // All three stages in order. Unreferenced vertices are dropped. Everything is reordered in place, only the vertex
+    // vector shrinks, so the caller's allocations are kept.
+    void optimize(std::pmr::vector<Vertex>& vertices, std::span<uint32_t> indices) const;
+
+    void optimizeVertexCache(std::span<uint32_t> indices, size_t vertexCount) const;
+    void optimizeOverdraw(std::span<const Vertex> vertices, std::span<uint32_t> indices) const;
+    void optimizeVertexFetch(std::pmr::vector<Vertex>& vertices, std::span<uint32_t> indices) const;
+
+    // Threshold is the ACMR increase the overdraw stage may trade for better ordering, 1.05 allows 5%.
+    void setOverdrawThreshold(float threshold) { m_overdrawThreshold = threshold; }
+
+    // Cache size matches what current GPUs roughly behave like, the reported ACMR/ATVR use the same simulation.
+    static VertexCacheStats analyzeVertexCache(std::span<const uint32_t> indices, size_t vertexCount, uint32_t cacheSize = SIMULATED_CACHE_SIZE);
+
+    static constexpr uint32_t SIMULATED_CACHE_SIZE = 16;
+
+  private:
+    float m_overdrawThreshold = 1.05f;
+};
+
+#endif // ENGINE_RENDERER_MESH_OPTIMIZER_H_
@@ -0,0 +1,570 @@
+#include "pch.h"
+
+#include "engine/renderer/geometry/mesh_simplifier.h"
+#include "engine/renderer/geometry/mesh_optimizer.h"
+#include "common/hash.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+namespace
+{
+    const uint32_t INVALID_INDEX = ~0u;
+
+    // Open edges add a plane perpendicular to their triangle, weighted well above the surface so borders stay put.
+    const double BORDER_WEIGHT = 10.0;
+
+    // A level that keeps more than this share of the triangles before it isn't worth its memory, usually only
+    // locked vertices are left by then.
+    const float MAX_LOD_RATIO = 0.85f;
+
+    enum class VertexKind : uint8_t {
+        Manifold,
+        Border,
+        Seam,
+        Locked,
+    };
+
+    // Rows are the vertex that moves, columns the one it collapses onto.
+    const bool CAN_COLLAPSE[4][4] = {
+        {true, true, true, true},
+        {false, true, false, false},
+        {false, false, true, false},
+        {false, false, false, false},
+    };
+
+    struct Quadric {
+        double a00 = 0.0, a11 = 0.0, a22 = 0.0;
+        double a10 = 0.0, a20 = 0.0, a21 = 0.0;
+        double b0 = 0.0, b1 = 0.0, b2 = 0.0;
+        double c      = 0.0;
+        double weight = 0.0;
+
+        // Squared distance to the plane dot(normal, p) + distance = 0, the normal has to be unit length.
+        void addPlane(const glm::vec3& normal, float distance, double w)
+        {
+            double x = normal.x, y = normal.y, z = normal.z, d = distance;
+            a00 += w * x * x;
+            a11 += w * y * y;
+            a22 += w * z * z;
+            a10 += w * y * x;
+            a20 += w * z * x;
+            a21 += w * z * y;
+            b0 += w * x * d;
+            b1 += w * y * d;
+            b2 += w * z * d;
+            c += w * d * d;
+            weight += w;
+        }
+
+        // Weighted mean of the squared distances to every plane added.
+        double getError(const glm::vec3& p) const
+        {
+            double x = p.x, y = p.y, z = p.z;
+            double e = a00 * x * x + a11 * y * y + a22 * z * z + 2.0 * (a10 * x * y + a20 * x * z + a21 * y * z) + 2.0 * (b0 * x + b1 * y + b2 * z) + c;
+            return weight > 0.0 ? std::max(e, 0.0) / weight : 0.0;
+        }
+
+        Quadric& operator+=(const Quadric& other)
+        {
+            a00 += other.a00;
+            a11 += other.a11;
+            a22 += other.a22;
+            a10 += other.a10;
+            a20 += other.a20;
+            a21 += other.a21;
+            b0 += other.b0;
+            b1 += other.b1;
+            b2 += other.b2;
+            c += other.c;
+            weight += other.weight;
+            return *this;
+        }
+    };
+
+    struct PositionKey {
+        uint32_t x, y, z;
+
+        bool operator==(const PositionKey&) const = default;
+    };
+
+    struct PositionKeyHash {
+        size_t operator()(const PositionKey& key) const { return static_cast<size_t>(Hash::fnv1a(&key, sizeof(key))); }
+    };
+
+    struct Collapse {
+        uint32_t from;
+        uint32_t to;
+        float    error;
+    };
+
+    // State of one progressive simplification. run() continues from the previous result with the quadrics of the
+    // original triangles, which is what lets a whole LOD chain come out of a single pass over the mesh.
+    class Simplification
+    {
+      public:
+        Simplification(std::span<const Vertex> vertices, std::span<const uint32_t> indices);
+
+        void run(size_t targetIndexCount, float targetError);
+
+        const std::vector<uint32_t>& getIndices() const { return m_indices; }
+        float                        getError() const { return static_cast<float>(std::sqrt(m_error)) * m_extent; }
+
+      private:
+        std::vector<glm::vec3>  m_positions; // Scaled by 1 / m_extent, so the quadrics work on similar magnitudes
+        std::vector<uint32_t>   m_remap;     // First vertex at the same position
+        std::vector<uint32_t>   m_wedges;    // Next vertex at the same position, cyclic
+        std::vector<VertexKind> m_kinds;
+        std::vector<uint32_t>   m_openNext; // Along the open edge leaving the vertex, the vertex itself if there are several
+        std::vector<uint32_t>   m_openPrev;
+        std::vector<Quadric>    m_quadrics; // Indexed by remapped vertex
+        std::vector<uint32_t>   m_indices;
+        float                   m_extent = 1.0f;
+        double                  m_error  = 0.0; // Squared, in scaled units
+
+        // Rebuilt every pass. Each triangle corner stores the next and previous vertex of its triangle.
+        std::vector<uint32_t> m_adjacencyOffsets;
+        std::vector<uint32_t> m_adjacencyCounts;
+        std::vector<uint32_t> m_adjacency;
+        std::vector<Collapse> m_collapses;
+        std::vector<uint32_t> m_collapseRemap;
+        std::vector<uint8_t>  m_collapseLocked;
+
+        void   buildPositions(std::span<const Vertex> vertices);
+        void   buildAdjacency();
+        bool   hasEdge(uint32_t from, uint32_t to) const;
+        void   classifyVertices();
+        void   buildQuadrics();
+        void   collectCollapses();
+        bool   flips(uint32_t from, uint32_t to) const;
+        size_t performCollapses(size_t goal, double errorLimit);
+        void   remapIndices();
+        void   remapOpenEdges();
+    };
+
+    // A trailing partial triangle is dropped, every pass below walks whole triangles.
+    Simplification::Simplification(std::span<const Vertex> vertices, std::span<const uint32_t> indices) : m_indices(indices.begin(), indices.begin() + indices.size() / 3 * 3)
+    {
+        buildPositions(vertices);
+        buildAdjacency();
+        classifyVertices();
+        buildQuadrics();
+    }
+
+    void Simplification::run(size_t targetIndexCount, float targetError)
+    {
+        double scaledError = static_cast<double>(targetError) / m_extent;
+        double errorLimit  = targetError == FLT_MAX ? DBL_MAX : scaledError * scaledError;
+
+        while (m_indices.size() > targetIndexCount) {
+            buildAdjacency();
+            collectCollapses();
+            if (m_collapses.empty()) {
+                break;
+            }
+
+            std::sort(m_collapses.begin(), m_collapses.end(), [](const Collapse& a, const Collapse& b) {
+                if (a.error != b.error) {
+                    return a.error < b.error;
+                }
+                return a.from < b.from;
+            });
+
+            // Interior collapses remove two triangles each, aim for the target without overshooting far.
+            size_t triangleGoal = (m_indices.size() - targetIndexCount) / 3;
+            size_t edgeGoal     = triangleGoal / 2 + 1;
+            if (performCollapses(edgeGoal, errorLimit) == 0) {
+                break;
+            }
+
+            remapIndices();
+            remapOpenEdges();
+        }
+    }
+
+    void Simplification::buildPositions(std::span<const Vertex> vertices)
+    {
+        size_t count = vertices.size();
+        m_positions.resize(count);
+        m_remap.resize(count);
+        m_wedges.resize(count);
+
+        glm::vec3 min(FLT_MAX);
+        glm::vec3 max(-FLT_MAX);
+        for (const auto& vertex : vertices) {
+            min = glm::min(min, vertex.pos);
+            max = glm::max(max, vertex.pos);
+        }
+
+        glm::vec3 extent = max - min;
+        m_extent         = std::max(std::max(extent.x, extent.y), extent.z);
+        if (!(m_extent > 0.0f)) {
+            m_extent = 1.0f;
+        }
+
+        std::unordered_map<PositionKey, uint32_t, PositionKeyHash> firstAt;
+        firstAt.reserve(count);
+        for (uint32_t i = 0; i < count; i++) {
+            m_positions[i] = (vertices[i].pos - min) / m_extent;
+
+            // Adding zero folds -0 into 0, so both land in the same slot.
+            glm::vec3   position = vertices[i].pos + glm::vec3(0.0f);
+            PositionKey key;
+            std::memcpy(&key, &position, sizeof(key));
+
+            uint32_t first = firstAt.try_emplace(key, i).first->second;
+            m_remap[i]     = first;
+            m_wedges[i]    = i;
+            if (first != i) {
+                m_wedges[i]     = m_wedges[first];
+                m_wedges[first] = i;
+            }
+        }
+    }
+
+    void Simplification::buildAdjacency()
+    {
+        size_t count = m_positions.size();
+        m_adjacencyOffsets.resize(count);
+        m_adjacencyCounts.assign(count, 0);
+        m_adjacency.resize(m_indices.size() * 2);
+
+        for (uint32_t index : m_indices) {
+            m_adjacencyCounts[index]++;
+        }
+
+        uint32_t offset = 0;
+        for (size_t v = 0; v < count; v++) {
+            m_adjacencyOffsets[v] = offset;
+            offset += m_adjacencyCounts[v];
+            m_adjacencyCounts[v] = 0;
+        }
+
+        for (size_t t = 0; t < m_indices.size(); t += 3) {
+            for (int corner = 0; corner < 3; corner++) {
+                uint32_t v    = m_indices[t + corner];
+                uint32_t slot = m_adjacencyOffsets[v] + m_adjacencyCounts[v]++;
+
+                m_adjacency[slot * 2]     = m_indices[t + (corner + 1) % 3];
+                m_adjacency[slot * 2 + 1] = m_indices[t + (corner + 2) % 3];
+            }
+        }
+    }
+
+    bool Simplification::hasEdge(uint32_t from, uint32_t to) const
+    {
+        uint32_t first = m_adjacencyOffsets[from];
+        for (uint32_t slot = first; slot < first + m_adjacencyCounts[from]; slot++) {
+            if (m_adjacency[slot * 2] == to) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void Simplification::classifyVertices()
+    {
+        size_t count = m_positions.size();
+        m_openNext.assign(count, INVALID_INDEX);
+        m_openPrev.assign(count, INVALID_INDEX);
+
+        // An edge is open when no triangle runs it the other way. Seams count too, their two sides use different vertices.
+        for (uint32_t v = 0; v < count; v++) {
+            uint32_t first = m_adjacencyOffsets[v];
+            for (uint32_t slot = first; slot < first + m_adjacencyCounts[v]; slot++) {
+                uint32_t next = m_adjacency[slot * 2];
+                if (hasEdge(next, v)) {
+                    continue;
+                }
+
+                m_openNext[v]    = m_openNext[v] == INVALID_INDEX ? next : v;
+                m_openPrev[next] = m_openPrev[next] == INVALID_INDEX ? v : next;
+            }
+        }
+
+        auto isSingleOpenEdge = [&](uint32_t v) {
+            return m_openNext[v] != INVALID_INDEX && m_openNext[v] != v && m_openPrev[v] != INVALID_INDEX && m_openPrev[v] != v;
+        };
+
+        m_kinds.assign(count, VertexKind::Locked);
+        for (uint32_t v = 0; v < count; v++) {
+            if (m_remap[v] != v) {
+                continue;
+            }
+
+            uint32_t wedge = m_wedges[v];
+            if (wedge == v) {
+                if (m_openNext[v] == INVALID_INDEX && m_openPrev[v] == INVALID_INDEX) {
+                    m_kinds[v] = VertexKind::Manifold;
+                } else if (isSingleOpenEdge(v)) {
+                    m_kinds[v] = VertexKind::Border;
+                }
+            } else if (m_wedges[wedge] == v && isSingleOpenEdge(v) && isSingleOpenEdge(wedge)) {
+                // Both sides of a seam run the same edges in opposite directions.
+                uint32_t next = m_remap[m_openNext[v]];
+                uint32_t prev = m_remap[m_openPrev[v]];
+                if (next != prev && next == m_remap[m_openPrev[wedge]] && prev == m_remap[m_openNext[wedge]]) {
+                    m_kinds[v] = VertexKind::Seam;
+                }
+            }
+        }
+
+        for (uint32_t v = 0; v < count; v++) {
+            m_kinds[v] = m_kinds[m_remap[v]];
+        }
+    }
+
+    void Simplification::buildQuadrics()
+    {
+        m_quadrics.assign(m_positions.size(), Quadric());
+
+        for (size_t t = 0; t < m_indices.size(); t += 3) {
+            const uint32_t* triangle = &m_indices[t];
+            const glm::vec3& p0       = m_positions[triangle[0]];
+            const glm::vec3& p1       = m_positions[triangle[1]];
+            const glm::vec3& p2       = m_positions[triangle[2]];
+
+            glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+            float     length = glm::length(normal);
+            if (length == 0.0f) {
+                continue;
+            }
+            normal /= length;
+
+            Quadric plane;
+            plane.addPlane(normal, -glm::dot(normal, p0), length * 0.5f);
+            for (int corner = 0; corner < 3; corner++) {
+                m_quadrics[m_remap[triangle[corner]]] += plane;
+            }
+
+            for (int corner = 0; corner < 3; corner++) {
+                uint32_t from = triangle[corner];
+                uint32_t to   = triangle[(corner + 1) % 3];
+                if (hasEdge(to, from)) {
+                    continue;
+                }
+
+                const glm::vec3& start      = m_positions[from];
+                glm::vec3        edge       = m_positions[to] - start;
+                float            edgeLength = glm::length(edge);
+                if (edgeLength == 0.0f) {
+                    continue;
+                }
+
+                glm::vec3 edgeNormal = glm::normalize(glm::cross(edge, normal));
+                Quadric   border;
+                border.addPlane(edgeNormal, -glm::dot(edgeNormal, start), edgeLength * edgeLength * BORDER_WEIGHT);
+                m_quadrics[m_remap[from]] += border;
+                m_quadrics[m_remap[to]] += border;
+            }
+        }
+    }
+
+    void Simplification::collectCollapses()
+    {
+        m_collapses.clear();
+
+        for (size_t t = 0; t < m_indices.size(); t += 3) {
+            for (int corner = 0; corner < 3; corner++) {
+                uint32_t i0 = m_indices[t + corner];
+                uint32_t i1 = m_indices[t + (corner + 1) % 3];
+                uint32_t r0 = m_remap[i0];
+                uint32_t r1 = m_remap[i1];
+                if (r0 == r1) {
+                    continue;
+                }
+
+                VertexKind k0 = m_kinds[i0];
+                VertexKind k1 = m_kinds[i1];
+                if (k0 == k1 && (k0 == VertexKind::Border || k0 == VertexKind::Seam)) {
+                    // Only along the open edge itself, collapsing across would fold the border over.
+                    if (m_openNext[i0] != i1) {
+                        continue;
+                    }
+                } else if (r0 > r1) {
+                    // Interior edges show up in both of their triangles.
+                    continue;
+                }
+
+                bool forward  = CAN_COLLAPSE[static_cast<int>(k0)][static_cast<int>(k1)];
+                bool backward = CAN_COLLAPSE[static_cast<int>(k1)][static_cast<int>(k0)];
+                if (!forward && !backward) {
+                    continue;
+                }
+
+                double forwardError  = forward ? m_quadrics[r0].getError(m_positions[i1]) : DBL_MAX;
+                double backwardError = backward ? m_quadrics[r1].getError(m_positions[i0]) : DBL_MAX;
+                if (forwardError <= backwardError) {
+                    m_collapses.push_back({i0, i1, static_cast<float>(forwardError)});
+                } else {
+                    m_collapses.push_back({i1, i0, static_cast<float>(backwardError)});
+                }
+            }
+        }
+    }
+
+    bool Simplification::flips(uint32_t from, uint32_t to) const
+    {
+        uint32_t        target   = m_remap[to];
+        const glm::vec3 position = m_positions[to];
+
+        // Every vertex at the source position moves, seams have triangles on both sides.
+        uint32_t v = from;
+        do {
+            uint32_t first = m_adjacencyOffsets[v];
+            for (uint32_t slot = first; slot < first + m_adjacencyCounts[v]; slot++) {
+                uint32_t a = m_collapseRemap[m_adjacency[slot * 2]];
+                uint32_t b = m_collapseRemap[m_adjacency[slot * 2 + 1]];
+                if (m_remap[a] == target || m_remap[b] == target) {
+                    continue; // Collapses away
+                }
+
+                const glm::vec3& pv     = m_positions[v];
+                const glm::vec3& pa     = m_positions[a];
+                const glm::vec3& pb     = m_positions[b];
+                glm::vec3        before = glm::cross(pa - pv, pb - pv);
+                glm::vec3        after  = glm::cross(pa - position, pb - position);
+                if (glm::dot(before, before) > 0.0f && glm::dot(before, after) <= 0.0f) {
+                    return true;
+                }
+            }
+            v = m_wedges[v];
+        } while (v != from);
+
+        return false;
+    }
+
+    size_t Simplification::performCollapses(size_t goal, double errorLimit)
+    {
+        size_t count = m_positions.size();
+        m_collapseRemap.resize(count);
+        for (uint32_t v = 0; v < count; v++) {
+            m_collapseRemap[v] = v;
+        }
+        m_collapseLocked.assign(count, 0);
+
+        // Cheapest first, one collapse per vertex and pass since the adjacency isn't updated in between.
+        size_t performed = 0;
+        for (const auto& collapse : m_collapses) {
+            if (performed >= goal || collapse.error > errorLimit) {
+                break;
+            }
+
+            uint32_t r0 = m_remap[collapse.from];
+            uint32_t r1 = m_remap[collapse.to];
+            if (m_collapseLocked[r0] || m_collapseLocked[r1] || flips(collapse.from, collapse.to)) {
+                continue;
+            }
+
+            if (m_kinds[collapse.from] == VertexKind::Seam) {
+                // The other side of the seam collapses along its own copy of the edge.
+                uint32_t fromWedge = m_wedges[collapse.from];
+                uint32_t toWedge   = m_wedges[collapse.to];
+                if (m_openNext[fromWedge] != toWedge && m_openPrev[fromWedge] != toWedge) {
+                    continue;
+                }
+                m_collapseRemap[fromWedge] = toWedge;
+            }
+            m_collapseRemap[collapse.from] = collapse.to;
+
+            m_quadrics[r1] += m_quadrics[r0];
+            m_collapseLocked[r0] = 1;
+            m_collapseLocked[r1] = 1;
+            m_error              = std::max(m_error, static_cast<double>(collapse.error));
+            performed++;
+        }
+
+        return performed;
+    }
+
+    void Simplification::remapIndices()
+    {
+        size_t write = 0;
+        for (size_t t = 0; t < m_indices.size(); t += 3) {
+            uint32_t a = m_collapseRemap[m_indices[t]];
+            uint32_t b = m_collapseRemap[m_indices[t + 1]];
+            uint32_t c = m_collapseRemap[m_indices[t + 2]];
+            if (m_remap[a] == m_remap[b] || m_remap[b] == m_remap[c] || m_remap[a] == m_remap[c]) {
+                continue;
+            }
+
+            m_indices[write++] = a;
+            m_indices[write++] = b;
+            m_indices[write++] = c;
+        }
+        m_indices.resize(write);
+    }
+
+    void Simplification::remapOpenEdges()
+    {
+        // A vertex whose open neighbour collapsed onto it now continues to that neighbour's neighbour.
+        auto remap = [&](std::vector<uint32_t>& open) {
+            std::vector<uint32_t> previous = open;
+            for (uint32_t v = 0; v < open.size(); v++) {
+                if (previous[v] == INVALID_INDEX) {
+                    continue;
+                }
+
+                uint32_t target = m_collapseRemap[previous[v]];
+                uint32_t beyond = previous[previous[v]];
+                open[v]         = target != v ? target : beyond == INVALID_INDEX ? INVALID_INDEX : m_collapseRemap[beyond];
+            }
+        };
+
+        remap(m_openNext);
+        remap(m_openPrev);
+    }
+} // namespace
+
+float MeshSimplifier::simplify(std::span<const Vertex> vertices, std::span<const uint32_t> indices, size_t targetIndexCount, float targetError, std::vector<uint32_t>& out) const
+{
+    Simplification simplification(vertices, indices);
+    simplification.run(targetIndexCount, targetError);
+
+    out = simplification.getIndices();
+    return simplification.getError();
+}
+
+void MeshSimplifier::buildLods(std::span<const Vertex> vertices, std::pmr::vector<uint32_t>& indices, std::pmr::vector<MeshLod>& lods) const
+{
+    lods.clear();
+    lods.reserve(MeshLod::MAX_COUNT);
+    lods.push_back({0, static_cast<uint32_t>(indices.size()), 0.0f});
+    if (indices.size() % 3 != 0 || indices.size() / 3 < m_minLodTriangles * 2) {
+        return;
+    }
+
+    // Levels roughly halve, so twice the input usually fits all of them without growing. Callers filling an arena
+    // reserve this up front, there every growth leaves the old copy behind.
+    indices.reserve(indices.size() * 2);
+
+    Simplification simplification(vertices, indices);
+    MeshOptimizer  optimizer;
+    while (lods.size() < MeshLod::MAX_COUNT) {
+        uint32_t previousCount = lods.back().indexCount;
+        size_t   target        = static_cast<size_t>(previousCount / 3 * m_lodReduction) * 3;
+        if (target / 3 < m_minLodTriangles) {
+            break;
+        }
+
+        simplification.run(target, FLT_MAX);
+
+        std::vector<uint32_t> lodIndices = simplification.getIndices();
+        if (lodIndices.size() > previousCount * MAX_LOD_RATIO) {
+            break;
+        }
+
+        // The vertex order stays the one of the full detail level, only the triangles are reordered for the cache.
+        optimizer.optimizeVertexCache(lodIndices, vertices.size());
+
+        MeshLod lod;
+        lod.firstIndex = static_cast<uint32_t>(indices.size());
+        lod.indexCount = static_cast<uint32_t>(lodIndices.size());
+        lod.error      = simplification.getError();
+        indices.insert(indices.end(), lodIndices.begin(), lodIndices.end());
+        lods.push_back(lod);
+    }
+}
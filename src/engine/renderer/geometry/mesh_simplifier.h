@@ -0,0 +1,46 @@
+#ifndef ENGINE_RENDERER_MESH_SIMPLIFIER_H_
+#define ENGINE_RENDERER_MESH_SIMPLIFIER_H_
+
+#include "engine/renderer/geometry/mesh_lod.h"
+#include "engine/renderer/geometry/vertex.h"
+
+#include <cstdint>
+#include <memory_resource>
+#include <span>
+#include <vector>
+
+// Quadric error metric edge collapse (Garland and Heckbert), used at import to build LOD chains. Vertices never move,
+// an edge collapses onto one of its existing vertices, so every level shares the full detail vertex buffer and only
+// adds an index range.
+//
+// Vertices are classified once by how their triangles meet:
+//   manifold  interior, may collapse onto any neighbour
+//   border    on an open edge, only slides along that edge
+//   seam      on a UV or normal seam (same position, two vertices), slides along the seam with both sides together
+//   locked    corners, seams meeting borders and anything less regular, never moves
+//
+// The error is the root of the area weighted mean squared distance to the planes of the original triangles, so
+// levels built one after the other still report their distance to the full detail mesh.
+class MeshSimplifier
+{
+  public:
+    MeshSimplifier()  = default;
+    ~MeshSimplifier() = default;
+
+    // Collapses edges until at most targetIndexCount indices are left or the next collapse would exceed targetError
+    // (mesh units). Returns the estimated error of the result.
+    float simplify(std::span<const Vertex> vertices, std::span<const uint32_t> indices, size_t targetIndexCount, float targetError, std::vector<uint32_t>& out) const;
+
+    // Appends the simplified levels to indices, each about m_lodReduction of the triangles of the one before. Stops
+    // early once a level would be too small or barely smaller than the last. lods[0] is the input range.
+    void buildLods(std::span<const Vertex> vertices, std::pmr::vector<uint32_t>& indices, std::pmr::vector<MeshLod>& lods) const;
+
+    void setLodReduction(float reduction) { m_lodReduction = reduction; }
+    void setMinLodTriangles(uint32_t triangles) { m_minLodTriangles = triangles; }
+
+  private:
+    float    m_lodReduction    = 0.5f;
+    uint32_t m_minLodTriangles = 64;
+};
+
+#endif // ENGINE_RENDERER_MESH_SIMPLIFIER_H_
@@ -2,186 +2,204 @@
 
 #include "common/logger.h"
 #include "common/stb_image.h"
+#include "common/timer.h"
 
 #include "engine/renderer/geometry/model.h"
 #include "engine/renderer/geometry/mesh.h"
+#include "engine/renderer/render_queue.h"
+#include "engine/renderer/culling/frustum_culler.h"
 #include "engine/renderer/shaders/shader.h"
 #include "engine/renderer/resources/resource_manager.h"
 #include "engine/renderer/resources/texture_resource.h"
+#include "engine/renderer/resources/model_cooker.h"
 
 Model::Model(const std::string& path, bool gamma)
 {
     m_gammaCorrection = gamma;
     loadModel(path);
+    computeBounds();
 }
 
-void Model::draw(Shader* shader)
+Model::Model(ImportedModel& imported, bool gamma)
 {
-    for (uint32_t i = 0; i < m_meshes.size(); i++) {
-        m_meshes[i].draw(shader);
-    }
+    m_gammaCorrection = gamma;
+    m_directory       = imported.directory;
+
+    uploadMeshes(imported);
+    m_importStats = imported.stats;
+    computeBounds();
 }
 
-void Model::loadModel(const std::string& path)
+Model::Model(const CookedModel& cooked, bool gamma)
 {
-    Assimp::Importer importer;
-    const aiScene*   scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
-    if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
-        LOG_ERROR("LoadModel: Error - {}", importer.GetErrorString());
-        return;
+    m_gammaCorrection = gamma;
+    m_directory       = cooked.getDirectory();
+
+    Timer timer;
+
+    std::vector<std::vector<Texture>> textures(cooked.getMeshCount());
+    std::vector<Material>             materials(cooked.getMeshCount());
+    for (uint32_t i = 0; i < cooked.getMeshCount(); i++) {
+        materials[i] = cooked.getMaterial(i);
+        loadMaterialTextures(cooked.getTextures(i), materials[i], textures[i]);
     }
 
-    m_directory = path.substr(0, path.find_last_of('/'));
+    m_importStats.textureMs = timer.getDeltaTime() * 1000.0f;
 
-    processNode(scene->mRootNode, scene);
+    for (uint32_t i = 0; i < cooked.getMeshCount(); i++) {
+        m_importStats.vertexCount += cooked.getVertices(i).size();
+        m_importStats.indexCount += cooked.getIndices(i).size();
+    }
+    allocateGeometry(m_importStats.vertexCount, m_importStats.indexCount);
 
-    LOG_INFO("Finished loading model: {}", path);
+    // Vertex and index data go from the mapping to GL without an intermediate copy.
+    m_meshes.reserve(cooked.getMeshCount());
+    for (uint32_t i = 0; i < cooked.getMeshCount(); i++) {
+        m_meshes.emplace_back(*m_geometry, cooked.getVertices(i), cooked.getIndices(i), std::move(textures[i]), materials[i], cooked.getLods(i));
+    }
+
+    m_importStats.uploadMs  = timer.getDeltaTime() * 1000.0f;
+    m_importStats.meshCount = m_meshes.size();
+    computeBounds();
 }
 
-void Model::processNode(aiNode* node, const aiScene* scene)
+void Model::draw(Shader* shader)
 {
-    for (uint32_t i = 0; i < node->mNumMeshes; i++) {
-        aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-        m_meshes.push_back(processMesh(mesh, scene));
-    }
-
-    for (uint32_t i = 0; i < node->mNumChildren; i++) {
-        processNode(node->mChildren[i], scene);
+    shader->use();
+    for (uint32_t i = 0; i < m_meshes.size(); i++) {
+        m_meshes[i].draw();
     }
 }
 
-Mesh Model::processMesh(aiMesh* mesh, const aiScene* scene)
+void Model::submit(RenderQueue& queue, std::span<const glm::mat4> transforms, const glm::mat4& view, Shader* shader, const FrustumCuller* culler, std::span<const uint32_t> firstBoxes,
+                   const LodSelector* lodSelector) const
 {
-    std::vector<Vertex>   vertices;
-    std::vector<uint32_t> indices;
-    std::vector<Texture>  textures;
-
-    for (uint32_t i = 0; i < mesh->mNumVertices; i++) {
-        Vertex    vertex;
-        glm::vec3 vector;
-
-        vector.x   = mesh->mVertices[i].x;
-        vector.y   = mesh->mVertices[i].y;
-        vector.z   = mesh->mVertices[i].z;
-        vertex.pos = vector;
-
-        if (mesh->HasNormals()) {
-            vector.x      = mesh->mNormals[i].x;
-            vector.y      = mesh->mNormals[i].y;
-            vector.z      = mesh->mNormals[i].z;
-            vertex.normal = vector;
+    std::array<std::vector<glm::mat4>, MeshLod::MAX_COUNT> visible;
+    std::array<float, MeshLod::MAX_COUNT>                  nearest;
+
+    for (uint32_t i = 0; i < m_meshes.size(); i++) {
+        const Mesh& mesh        = m_meshes[i];
+        bool        transparent = mesh.getMaterial().transparency < 1.0f;
+
+        for (uint32_t lod = 0; lod < MeshLod::MAX_COUNT; lod++) {
+            visible[lod].clear();
+            nearest[lod] = FLT_MAX;
         }
 
-        if (mesh->mTextureCoords[0]) {
-            glm::vec2 vec;
-            vec.x            = mesh->mTextureCoords[0][i].x;
-            vec.y            = mesh->mTextureCoords[0][i].y;
-            vertex.texCoords = vec;
-
-            vector.x       = mesh->mTangents[i].x;
-            vector.y       = mesh->mTangents[i].y;
-            vector.z       = mesh->mTangents[i].z;
-            vertex.tangent = vector;
-
-            vector.x         = mesh->mBitangents[i].x;
-            vector.y         = mesh->mBitangents[i].y;
-            vector.z         = mesh->mBitangents[i].z;
-            vertex.bitangent = vector;
-        } else {
-            vertex.texCoords = glm::vec2(0.0f, 0.0f);
+        for (size_t j = 0; j < transforms.size(); j++) {
+            if (culler && !culler->isVisible(firstBoxes[j] + i)) {
+                continue;
+            }
+
+            glm::vec3 center = glm::vec3(view * (transforms[j] * glm::vec4(mesh.getCenter(), 1.0f)));
+            float     depth  = -center.z;
+            uint32_t  lod    = lodSelector ? lodSelector->select(mesh.getLods(), center, mesh.getRadius(), transforms[j]) : 0;
+
+            if (transparent) {
+                queue.submit(mesh, {&transforms[j], 1}, shader, depth, RenderPass::Transparent, lod);
+                continue;
+            }
+
+            visible[lod].push_back(transforms[j]);
+            nearest[lod] = std::min(nearest[lod], depth);
+        }
+
+        for (uint32_t lod = 0; lod < MeshLod::MAX_COUNT; lod++) {
+            queue.submit(mesh, visible[lod], shader, nearest[lod], RenderPass::Opaque, lod);
         }
+    }
+}
 
-        vertices.push_back(vertex);
+void Model::addMeshBounds(FrustumCuller& culler, const glm::mat4& transform) const
+{
+    for (const auto& mesh : m_meshes) {
+        culler.add(mesh.getBoundsMin(), mesh.getBoundsMax(), transform);
     }
+}
 
-    for (uint32_t i = 0; i < mesh->mNumFaces; i++) {
-        aiFace face = mesh->mFaces[i];
-        for (uint32_t j = 0; j < face.mNumIndices; j++) {
-            indices.push_back(face.mIndices[j]);
-        }
+size_t Model::getMemoryUsage() const
+{
+    size_t bytes = 0;
+    for (const auto& mesh : m_meshes) {
+        bytes += mesh.getMemoryUsage();
     }
+    return bytes;
+}
 
-    aiMaterial* aiMat = scene->mMaterials[mesh->mMaterialIndex];
-    // LOG_INFO("Processing mesh: {} with material: {}", mesh->mName.C_Str(), aiMat->GetName().C_Str());
+void Model::loadModel(const std::string& path)
+{
+    ImportedModel imported;
+    ModelImporter importer;
+    if (!importer.import(path, imported)) {
+        LOG_ERROR("LoadModel: Failed to import {}", path);
+        return;
+    }
 
-    Material mat = convertAiMaterialToPBR(aiMat);
-    loadMaterialTextures(aiMat, mat, textures);
+    m_directory = imported.directory;
 
-    // LOG_INFO("Mesh {} final material: A({:.2f},{:.2f},{:.2f}) M:{:.2f} R:{:.2f} Textures: A:{} M:{} R:{} N:{}", mesh->mName.C_Str(), mat.albedo.r, mat.albedo.g, mat.albedo.b, mat.metallic, mat.roughness,
-    // mat.hasAlbedoTexture, mat.hasMetallicTexture, mat.hasRoughnessTexture, mat.hasNormalTexture);
+    uploadMeshes(imported);
 
-    // LOG_INFO("Loaded mesh {}.", mesh->mName.C_Str());
-    return Mesh(vertices, indices, textures, mat);
+    m_importStats = imported.stats;
+    LOG_INFO("Finished loading model: {} ({} meshes, {} vertices) - read {:.2f}ms, process {:.2f}ms, optimize {:.2f}ms, lods {:.2f}ms, textures {:.2f}ms, upload {:.2f}ms", path,
+             m_importStats.meshCount, m_importStats.vertexCount, m_importStats.readMs, m_importStats.processMs, m_importStats.optimizeMs, m_importStats.lodMs, m_importStats.textureMs,
+             m_importStats.uploadMs);
 }
 
-Material Model::convertAiMaterialToPBR(aiMaterial* aiMat)
+void Model::uploadMeshes(ImportedModel& imported)
 {
-    Material  mat;
-    aiColor3D color;
-    float     value;
-
-    // Set better defaults for PBR
-    mat.albedo       = glm::vec3(0.7f, 0.7f, 0.7f); // Lighter default
-    mat.metallic     = 0.0f;
-    mat.roughness    = 0.8f; // More diffuse by default
-    mat.ao           = 1.0f;
-    mat.emissive     = glm::vec3(0.0f);
-    mat.transparency = 1.0f;
-
-    // Try to get PBR properties first
-    if (aiMat->Get(AI_MATKEY_BASE_COLOR, color) == AI_SUCCESS) {
-        mat.albedo = glm::vec3(color.r, color.g, color.b);
-    } else if (aiMat->Get(AI_MATKEY_COLOR_DIFFUSE, color) == AI_SUCCESS) {
-        mat.albedo = glm::vec3(color.r, color.g, color.b);
-        // Ensure albedo isn't too dark
-        float brightness = (mat.albedo.r + mat.albedo.g + mat.albedo.b) / 3.0f;
-        if (brightness < 0.1f) {
-            mat.albedo = glm::vec3(0.5f, 0.5f, 0.5f); // Fallback to gray
-        }
-    }
+    Timer timer;
 
-    // Metallic factor
-    if (aiMat->Get(AI_MATKEY_METALLIC_FACTOR, value) == AI_SUCCESS) {
-        mat.metallic = glm::clamp(value, 0.0f, 1.0f);
-    } else if (aiMat->Get(AI_MATKEY_COLOR_SPECULAR, color) == AI_SUCCESS) {
-        float specularIntensity = (color.r + color.g + color.b) / 3.0f;
-        mat.metallic            = specularIntensity > 0.5f ? 0.1f : 0.0f; // Be conservative
+    // Texture and GL object creation need the context, so this part stays on the calling thread.
+    std::vector<std::vector<Texture>> textures(imported.meshes.size());
+    for (size_t i = 0; i < imported.meshes.size(); i++) {
+        loadMaterialTextures(imported.meshes[i].textures, imported.meshes[i].material, textures[i]);
     }
 
-    // Roughness factor
-    if (aiMat->Get(AI_MATKEY_ROUGHNESS_FACTOR, value) == AI_SUCCESS) {
-        mat.roughness = glm::clamp(value, 0.01f, 1.0f);
-    } else if (aiMat->Get(AI_MATKEY_SHININESS, value) == AI_SUCCESS && value > 0) {
-        // Convert shininess to roughness more conservatively
-        mat.roughness = glm::clamp(1.0f - (value / 256.0f), 0.1f, 1.0f);
-    }
+    imported.stats.textureMs = timer.getDeltaTime() * 1000.0f;
 
-    // Emissive
-    if (aiMat->Get(AI_MATKEY_COLOR_EMISSIVE, color) == AI_SUCCESS) {
-        mat.emissive = glm::vec3(color.r, color.g, color.b);
+    size_t vertexCount = 0;
+    size_t indexCount  = 0;
+    for (const auto& mesh : imported.meshes) {
+        vertexCount += mesh.vertices.size();
+        indexCount += mesh.indices.size();
     }
+    allocateGeometry(vertexCount, indexCount);
 
-    // Transparency
-    if (aiMat->Get(AI_MATKEY_OPACITY, value) == AI_SUCCESS) {
-        mat.transparency = glm::clamp(value, 0.0f, 1.0f);
+    m_meshes.reserve(imported.meshes.size());
+    for (size_t i = 0; i < imported.meshes.size(); i++) {
+        ImportedMesh& mesh = imported.meshes[i];
+        m_meshes.emplace_back(*m_geometry, mesh.vertices, mesh.indices, std::move(textures[i]), mesh.material, mesh.lods);
     }
 
-    if (mat.albedo.r + mat.albedo.g + mat.albedo.b < 0.1f) {
-        mat.albedo = glm::vec3(0.5f, 0.5f, 0.5f);
-        LOG_INFO("Albedo is too low, setting to 0.5f, 0.5f, 0.5f");
-    }
+    // Everything the import allocated is on the GPU now, the arena goes in one step.
+    imported.meshes.clear();
+    imported.arena.reset();
 
-    if (mat.ao <= 0.0f) {
-        mat.ao = 1.0f;
-        LOG_INFO("AO is too low, setting to 1.0f");
-    }
+    imported.stats.uploadMs = timer.getDeltaTime() * 1000.0f;
+}
 
-    // LOG_INFO("Final material - Albedo: ({:.2f}, {:.2f}, {:.2f}), Metallic: {:.2f}, Roughness: {:.2f}", mat.albedo.r, mat.albedo.g, mat.albedo.b, mat.metallic, mat.roughness);
+void Model::allocateGeometry(size_t vertexCount, size_t indexCount)
+{
+    // One vertex array for the whole model instead of one per mesh, the meshes are ranges in it.
+    m_geometry = std::make_unique<GeometryBuffer>(Mesh::getDefaultVertexFormat());
+    m_geometry->allocate(static_cast<uint32_t>(vertexCount), static_cast<uint32_t>(indexCount));
+}
+
+void Model::computeBounds()
+{
+    if (m_meshes.empty()) {
+        return;
+    }
 
-    return mat;
+    m_boundsMin = m_meshes[0].getBoundsMin();
+    m_boundsMax = m_meshes[0].getBoundsMax();
+    for (const auto& mesh : m_meshes) {
+        m_boundsMin = glm::min(m_boundsMin, mesh.getBoundsMin());
+        m_boundsMax = glm::max(m_boundsMax, mesh.getBoundsMax());
+    }
 }
 
-void Model::loadMaterialTextures(aiMaterial* aiMat, Material& mat, std::vector<Texture>& textures)
+void Model::loadMaterialTextures(std::span<const ImportedTexture> slots, Material& mat, std::vector<Texture>& textures)
 {
     // Initialize all flags to false
     mat.hasAlbedoTexture    = false;
@@ -194,69 +212,66 @@ void Model::loadMaterialTextures(aiMaterial* aiMat, Material& mat, std::vector<T
     mat.hasLegacySpecular   = false;
 
     // Try PBR textures first
-    loadTextureType(aiMat, aiTextureType_BASE_COLOR, "texture_albedo", textures, mat.hasAlbedoTexture);
-    loadTextureType(aiMat, aiTextureType_METALNESS, "texture_metallic", textures, mat.hasMetallicTexture);
-    loadTextureType(aiMat, aiTextureType_DIFFUSE_ROUGHNESS, "texture_roughness", textures, mat.hasRoughnessTexture);
-    loadTextureType(aiMat, aiTextureType_NORMALS, "texture_normal", textures, mat.hasNormalTexture);
+    loadTextureType(slots, aiTextureType_BASE_COLOR, "texture_albedo", textures, mat.hasAlbedoTexture);
+    loadTextureType(slots, aiTextureType_METALNESS, "texture_metallic", textures, mat.hasMetallicTexture);
+    loadTextureType(slots, aiTextureType_DIFFUSE_ROUGHNESS, "texture_roughness", textures, mat.hasRoughnessTexture);
+    loadTextureType(slots, aiTextureType_NORMALS, "texture_normal", textures, mat.hasNormalTexture);
 
     // Legacy fallbacks
     if (!mat.hasAlbedoTexture) {
-        loadTextureType(aiMat, aiTextureType_DIFFUSE, "texture_albedo", textures, mat.hasAlbedoTexture);
+        loadTextureType(slots, aiTextureType_DIFFUSE, "texture_albedo", textures, mat.hasAlbedoTexture);
         mat.hasLegacyDiffuse = mat.hasAlbedoTexture;
     }
 
     if (!mat.hasMetallicTexture && !mat.hasRoughnessTexture) {
-        loadTextureType(aiMat, aiTextureType_SPECULAR, "texture_specular", textures, mat.hasLegacySpecular);
+        loadTextureType(slots, aiTextureType_SPECULAR, "texture_specular", textures, mat.hasLegacySpecular);
     }
 
     // Try alternative normal map types
     if (!mat.hasNormalTexture) {
-        loadTextureType(aiMat, aiTextureType_HEIGHT, "texture_normal", textures, mat.hasNormalTexture);
+        loadTextureType(slots, aiTextureType_HEIGHT, "texture_normal", textures, mat.hasNormalTexture);
     }
 
     // LOG_INFO("Texture summary - Albedo: {}, Metallic: {}, Roughness: {}, Normal: {}, LegacySpec: {}", mat.hasAlbedoTexture, mat.hasMetallicTexture, mat.hasRoughnessTexture, mat.hasNormalTexture,
     // mat.hasLegacySpecular);
 }
 
-void Model::loadTextureType(aiMaterial* mat, aiTextureType type, const std::string& typeName, std::vector<Texture>& textures, bool& hasTexture)
+void Model::loadTextureType(std::span<const ImportedTexture> slots, aiTextureType type, const std::string& typeName, std::vector<Texture>& textures, bool& hasTexture)
 {
-    for (uint32_t i = 0; i < mat->GetTextureCount(type); i++) {
-        aiString str;
-        mat->GetTexture(type, i, &str);
-
-        std::string fullPath = m_directory + '/' + str.C_Str();
-
-        // Check if we already loaded this texture
-        bool found = false;
-        for (const auto& texRes : m_textureResources) {
-            if (texRes && texRes->getPath() == fullPath) {
-                Texture texture;
-                texture.id   = texRes->getTextureId();
-                texture.type = typeName;
-                texture.path = str.C_Str();
-                textures.push_back(texture);
-                hasTexture = true;
-                found      = true;
-                break;
-            }
+    for (const auto& slot : slots) {
+        if (slot.type != type) {
+            continue;
         }
 
-        if (!found) {
-            auto textureResource = RESOURCE_MANAGER.getTexture(fullPath);
-            if (textureResource && textureResource->isLoaded()) {
-                m_textureResources.push_back(textureResource);
+        // Keyed by the canonical path, so slots spelling the same file differently share one texture and a
+        // repeat costs a hash instead of a string compare against every texture loaded so far.
+        PathId                            id(m_directory, slot.path);
+        std::shared_ptr<TextureResource>* textureResource = nullptr;
 
-                Texture texture;
-                texture.id   = textureResource->getTextureId();
-                texture.type = typeName;
-                texture.path = str.C_Str();
-                textures.push_back(texture);
-                hasTexture = true;
+        auto it = m_textureIndex.find(id);
+        if (it != m_textureIndex.end()) {
+            textureResource = &m_textureResources[it->second];
+        } else {
+            // One buffer reused for every slot of the load instead of a new string each time.
+            std::string& fullPath = m_pathScratch;
+            fullPath.assign(m_directory).append(1, '/').append(slot.path);
 
-                // LOG_INFO("Loaded texture via ResourceManager: {}", fullPath);
-            } else {
+            auto loaded = RESOURCE_MANAGER.getTexture(fullPath, slot.getRole());
+            if (!loaded || !loaded->isLoaded()) {
                 LOG_WARN("Failed to load texture: {}", fullPath);
+                continue;
             }
+
+            m_textureIndex.emplace(id, m_textureResources.size());
+            textureResource = &m_textureResources.emplace_back(std::move(loaded));
         }
+
+        Texture texture;
+        texture.id   = (*textureResource)->getTextureId();
+        texture.type = typeName;
+        texture.path   = slot.path;
+        texture.pathId = id;
+        textures.push_back(texture);
+        hasTexture = true;
     }
 }
@@ -3,15 +3,24 @@
 
 #include <string>
 #include <map>
+#include <unordered_map>
+#include <memory>
+#include <span>
 #include <vector>
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 
+#include "engine/core/path_id.h"
 #include "engine/renderer/geometry/mesh.h"
+#include "engine/renderer/geometry/model_importer.h"
 
 class Shader;
 class TextureResource;
+class CookedModel;
+class RenderQueue;
+class FrustumCuller;
+class LodSelector;
 
 struct Texture;
 
@@ -19,22 +28,41 @@ class Model
 {
   public:
     Model(const std::string& path, bool gamma = false);
+    Model(ImportedModel& imported, bool gamma = false);
+    Model(const CookedModel& cooked, bool gamma = false);
 
-    void              draw(Shader* shader);
-    std::vector<Mesh> getMeshes() const { return m_meshes; }
+    void                  draw(Shader* shader);
+    // Every mesh is submitted once per LOD for all instances as an instanced draw, transparent ones once per instance.
+    // With a culler, instance j only draws mesh i if box firstBoxes[j] + i passed, see addMeshBounds. Without a LOD
+    // selector everything draws at full detail.
+    void                  submit(RenderQueue& queue, std::span<const glm::mat4> transforms, const glm::mat4& view, Shader* shader, const FrustumCuller* culler = nullptr,
+                                 std::span<const uint32_t> firstBoxes = {}, const LodSelector* lodSelector = nullptr) const;
+    void                  addMeshBounds(FrustumCuller& culler, const glm::mat4& transform) const;
+    const glm::vec3&      getBoundsMin() const { return m_boundsMin; } // Local space, all meshes
+    const glm::vec3&      getBoundsMax() const { return m_boundsMax; }
+    size_t                getMeshCount() const { return m_meshes.size(); }
+    std::span<const Mesh> getMeshes() const { return m_meshes; }
+    const ImportStats&    getImportStats() const { return m_importStats; }
+    size_t                getMemoryUsage() const;
 
   private:
-    void     loadModel(const std::string& path);
-    void     processNode(aiNode* node, const aiScene* scene);
-    Mesh     processMesh(aiMesh* mesh, const aiScene* scene);
-    void     loadMaterialTextures(aiMaterial* aiMat, Material& mat, std::vector<Texture>& textures);
-    void     loadTextureType(aiMaterial* mat, aiTextureType type, const std::string& typeName, std::vector<Texture>& textures, bool& hasTexture);
-    Material convertAiMaterialToPBR(aiMaterial* atMat);
-
-    std::vector<std::shared_ptr<TextureResource>> m_textureResources;
-    std::vector<Mesh>                             m_meshes;
-    bool                                          m_gammaCorrection;
-    std::string                                   m_directory;
+    void loadModel(const std::string& path);
+    void uploadMeshes(ImportedModel& imported);
+    void loadMaterialTextures(std::span<const ImportedTexture> slots, Material& mat, std::vector<Texture>& textures);
+    void loadTextureType(std::span<const ImportedTexture> slots, aiTextureType type, const std::string& typeName, std::vector<Texture>& textures, bool& hasTexture);
+    void allocateGeometry(size_t vertexCount, size_t indexCount);
+    void computeBounds();
+
+    std::vector<std::shared_ptr<TextureResource>>      m_textureResources;
+    std::unordered_map<PathId, size_t, PathId::Hash>   m_textureIndex; // Into m_textureResources
+    std::unique_ptr<GeometryBuffer>                    m_geometry;     // Every mesh's vertices and indices
+    std::vector<Mesh>                                  m_meshes;
+    bool                                               m_gammaCorrection;
+    std::string                                        m_directory;
+    std::string                                        m_pathScratch;
+    ImportStats                                        m_importStats;
+    glm::vec3                                          m_boundsMin = glm::vec3(0.0f);
+    glm::vec3                                          m_boundsMax = glm::vec3(0.0f);
 };
 
 #endif // ENGINE_RENDERER_MODEL_H_
\ No newline at end of file
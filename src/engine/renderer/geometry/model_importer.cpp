@@ -0,0 +1,338 @@
+#include "pch.h"
+
+#include "engine/renderer/geometry/model_importer.h"
+#include "engine/core/thread_pool.h"
+
+#include "common/logger.h"
+#include "common/timer.h"
+
+#include <assimp/Importer.hpp>
+#include <assimp/postprocess.h>
+
+TextureRole ImportedTexture::getRole() const
+{
+    switch (type) {
+    case aiTextureType_BASE_COLOR:
+    case aiTextureType_DIFFUSE:
+        return TextureRole::Albedo;
+    case aiTextureType_NORMALS:
+    case aiTextureType_HEIGHT: // Normal map fallback for OBJ files
+        return TextureRole::Normal;
+    case aiTextureType_METALNESS:
+    case aiTextureType_DIFFUSE_ROUGHNESS:
+        return TextureRole::MetallicRoughness;
+    default:
+        return TextureRole::Generic;
+    }
+}
+
+bool ModelImporter::import(const std::string& path, ImportedModel& out)
+{
+    Timer timer;
+
+    Assimp::Importer importer;
+    const aiScene*   scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_SortByPType | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
+    if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
+        LOG_ERROR("ModelImporter: Error - {}", importer.GetErrorString());
+        return false;
+    }
+
+    out.stats.readMs = timer.getDeltaTime() * 1000.0f;
+    out.directory    = path.substr(0, path.find_last_of('/'));
+
+    std::vector<aiMesh*> meshes;
+    meshes.reserve(scene->mNumMeshes);
+    collectMeshes(scene->mRootNode, scene, meshes);
+
+    // Vertex and face counts are known before anything is converted, so the arena's first block can hold all of the
+    // geometry. Indices get room for the LOD levels too, see MeshSimplifier::buildLods.
+    size_t arenaSize = ARENA_SLACK;
+    for (const aiMesh* mesh : meshes) {
+        arenaSize += mesh->mNumVertices * sizeof(Vertex) + mesh->mNumFaces * 3 * sizeof(uint32_t) * (m_buildLods ? 2 : 1);
+    }
+
+    out.meshes.clear();
+    out.arena = std::make_unique<MemoryArena>(arenaSize);
+    std::pmr::memory_resource* arena = out.arena.get();
+
+    // Materials are shared between meshes, convert each one once.
+    std::pmr::vector<Material>                          materials(scene->mNumMaterials, arena);
+    std::pmr::vector<std::pmr::vector<ImportedTexture>> materialTextures(scene->mNumMaterials, arena);
+    for (uint32_t i = 0; i < scene->mNumMaterials; i++) {
+        materials[i] = convertAiMaterialToPBR(scene->mMaterials[i]);
+        collectTextures(scene->mMaterials[i], materialTextures[i]);
+    }
+
+    out.meshes.reserve(meshes.size());
+    for (size_t i = 0; i < meshes.size(); i++) {
+        out.meshes.emplace_back(arena);
+    }
+
+    // Split big meshes into vertex batches so a single 4k mesh still spreads across the workers.
+    struct Job {
+        uint32_t mesh;
+        uint32_t first;
+        uint32_t last;
+        bool     indices;
+    };
+
+    std::pmr::vector<Job> jobs(arena);
+    size_t                jobCount = 0;
+    for (const aiMesh* mesh : meshes) {
+        jobCount += (mesh->mNumVertices + VERTEX_BATCH_SIZE - 1) / VERTEX_BATCH_SIZE + 1;
+    }
+    jobs.reserve(jobCount);
+
+    for (uint32_t i = 0; i < meshes.size(); i++) {
+        aiMesh*       mesh     = meshes[i];
+        ImportedMesh& imported = out.meshes[i];
+
+        imported.vertices.resize(mesh->mNumVertices);
+        imported.material = materials[mesh->mMaterialIndex];
+        imported.textures = materialTextures[mesh->mMaterialIndex];
+
+        for (uint32_t first = 0; first < mesh->mNumVertices; first += VERTEX_BATCH_SIZE) {
+            jobs.push_back({i, first, std::min(first + VERTEX_BATCH_SIZE, mesh->mNumVertices), false});
+        }
+        jobs.push_back({i, 0, 0, true});
+    }
+
+    auto runJob = [&](size_t index) {
+        const Job& job = jobs[index];
+        if (job.indices) {
+            processIndices(meshes[job.mesh], out.meshes[job.mesh]);
+        } else {
+            processVertices(meshes[job.mesh], out.meshes[job.mesh], job.first, job.last);
+        }
+    };
+
+    if (m_threaded) {
+        THREAD_POOL.parallelFor(jobs.size(), runJob);
+    } else {
+        for (size_t i = 0; i < jobs.size(); i++) {
+            runJob(i);
+        }
+    }
+
+    out.stats.processMs = timer.getDeltaTime() * 1000.0f;
+
+    if (m_optimized) {
+        optimizeMeshes(out);
+        out.stats.optimizeMs = timer.getDeltaTime() * 1000.0f;
+    }
+
+    // After optimizing, so the full detail level keeps its order and the simplified ones share the reordered vertices.
+    if (m_buildLods) {
+        buildLods(out);
+        out.stats.lodMs = timer.getDeltaTime() * 1000.0f;
+    }
+
+    out.stats.meshCount = out.meshes.size();
+    for (const auto& mesh : out.meshes) {
+        out.stats.vertexCount += mesh.vertices.size();
+        out.stats.indexCount += mesh.indices.size();
+        out.stats.lodCount += mesh.lods.empty() ? 0 : mesh.lods.size() - 1;
+    }
+
+    out.stats.arenaAllocations      = out.arena->getAllocations();
+    out.stats.arenaBytes            = out.arena->getBytes();
+    out.stats.arenaBlockAllocations = out.arena->getBlockAllocations();
+    out.stats.arenaBlockBytes       = out.arena->getBlockBytes();
+    return true;
+}
+
+void ModelImporter::collectMeshes(aiNode* node, const aiScene* scene, std::vector<aiMesh*>& meshes)
+{
+    // Triangulate leaves points and lines alone, SortByPType moves them into meshes of their own. Those aren't drawn.
+    for (uint32_t i = 0; i < node->mNumMeshes; i++) {
+        aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
+        if (mesh->mPrimitiveTypes & aiPrimitiveType_TRIANGLE) {
+            meshes.push_back(mesh);
+        }
+    }
+
+    for (uint32_t i = 0; i < node->mNumChildren; i++) {
+        collectMeshes(node->mChildren[i], scene, meshes);
+    }
+}
+
+void ModelImporter::processVertices(aiMesh* mesh, ImportedMesh& out, uint32_t first, uint32_t last)
+{
+    for (uint32_t i = first; i < last; i++) {
+        Vertex&   vertex = out.vertices[i];
+        glm::vec3 vector;
+
+        vector.x   = mesh->mVertices[i].x;
+        vector.y   = mesh->mVertices[i].y;
+        vector.z   = mesh->mVertices[i].z;
+        vertex.pos = vector;
+
+        if (mesh->HasNormals()) {
+            vector.x      = mesh->mNormals[i].x;
+            vector.y      = mesh->mNormals[i].y;
+            vector.z      = mesh->mNormals[i].z;
+            vertex.normal = vector;
+        }
+
+        if (mesh->mTextureCoords[0]) {
+            glm::vec2 vec;
+            vec.x            = mesh->mTextureCoords[0][i].x;
+            vec.y            = mesh->mTextureCoords[0][i].y;
+            vertex.texCoords = vec;
+
+            vector.x       = mesh->mTangents[i].x;
+            vector.y       = mesh->mTangents[i].y;
+            vector.z       = mesh->mTangents[i].z;
+            vertex.tangent = vector;
+
+            vector.x         = mesh->mBitangents[i].x;
+            vector.y         = mesh->mBitangents[i].y;
+            vector.z         = mesh->mBitangents[i].z;
+            vertex.bitangent = vector;
+        } else {
+            vertex.texCoords = glm::vec2(0.0f, 0.0f);
+        }
+    }
+}
+
+void ModelImporter::processIndices(aiMesh* mesh, ImportedMesh& out)
+{
+    // Everything downstream expects a triangle list, so anything else that is left in the mesh is dropped.
+    out.indices.reserve(static_cast<size_t>(mesh->mNumFaces) * 3 * (m_buildLods ? 2 : 1));
+    for (uint32_t i = 0; i < mesh->mNumFaces; i++) {
+        const aiFace& face = mesh->mFaces[i];
+        if (face.mNumIndices != 3) {
+            continue;
+        }
+        out.indices.insert(out.indices.end(), face.mIndices, face.mIndices + 3);
+    }
+}
+
+void ModelImporter::optimizeMeshes(ImportedModel& out)
+{
+    std::vector<VertexCacheStats> before(out.meshes.size());
+    std::vector<VertexCacheStats> after(out.meshes.size());
+
+    // Meshes are independent and each one is optimized deterministically, so the order they finish in doesn't matter.
+    auto optimizeMesh = [&](size_t i) {
+        ImportedMesh& mesh = out.meshes[i];
+        before[i]          = MeshOptimizer::analyzeVertexCache(mesh.indices, mesh.vertices.size());
+
+        MeshOptimizer optimizer;
+        optimizer.optimize(mesh.vertices, mesh.indices);
+
+        after[i] = MeshOptimizer::analyzeVertexCache(mesh.indices, mesh.vertices.size());
+    };
+
+    if (m_threaded) {
+        THREAD_POOL.parallelFor(out.meshes.size(), optimizeMesh);
+    } else {
+        for (size_t i = 0; i < out.meshes.size(); i++) {
+            optimizeMesh(i);
+        }
+    }
+
+    for (size_t i = 0; i < out.meshes.size(); i++) {
+        out.stats.cacheBefore += before[i];
+        out.stats.cacheAfter += after[i];
+    }
+}
+
+void ModelImporter::buildLods(ImportedModel& out)
+{
+    auto buildMesh = [&](size_t i) {
+        ImportedMesh&  mesh = out.meshes[i];
+        MeshSimplifier simplifier;
+        simplifier.buildLods(mesh.vertices, mesh.indices, mesh.lods);
+    };
+
+    if (m_threaded) {
+        THREAD_POOL.parallelFor(out.meshes.size(), buildMesh);
+    } else {
+        for (size_t i = 0; i < out.meshes.size(); i++) {
+            buildMesh(i);
+        }
+    }
+}
+
+void ModelImporter::collectTextures(aiMaterial* aiMat, std::pmr::vector<ImportedTexture>& textures)
+{
+    // Every slot Model::loadMaterialTextures may look at, including the legacy fallbacks.
+    const aiTextureType types[] = {aiTextureType_BASE_COLOR, aiTextureType_METALNESS, aiTextureType_DIFFUSE_ROUGHNESS, aiTextureType_NORMALS,
+                                   aiTextureType_DIFFUSE,    aiTextureType_SPECULAR,  aiTextureType_HEIGHT};
+
+    for (aiTextureType type : types) {
+        for (uint32_t i = 0; i < aiMat->GetTextureCount(type); i++) {
+            aiString str;
+            aiMat->GetTexture(type, i, &str);
+            textures.emplace_back(type, str.C_Str());
+        }
+    }
+}
+
+Material ModelImporter::convertAiMaterialToPBR(aiMaterial* aiMat)
+{
+    Material  mat;
+    aiColor3D color;
+    float     value;
+
+    // Set better defaults for PBR
+    mat.albedo       = glm::vec3(0.7f, 0.7f, 0.7f); // Lighter default
+    mat.metallic     = 0.0f;
+    mat.roughness    = 0.8f; // More diffuse by default
+    mat.ao           = 1.0f;
+    mat.emissive     = glm::vec3(0.0f);
+    mat.transparency = 1.0f;
+
+    // Try to get PBR properties first
+    if (aiMat->Get(AI_MATKEY_BASE_COLOR, color) == AI_SUCCESS) {
+        mat.albedo = glm::vec3(color.r, color.g, color.b);
+    } else if (aiMat->Get(AI_MATKEY_COLOR_DIFFUSE, color) == AI_SUCCESS) {
+        mat.albedo = glm::vec3(color.r, color.g, color.b);
+        // Ensure albedo isn't too dark
+        float brightness = (mat.albedo.r + mat.albedo.g + mat.albedo.b) / 3.0f;
+        if (brightness < 0.1f) {
+            mat.albedo = glm::vec3(0.5f, 0.5f, 0.5f); // Fallback to gray
+        }
+    }
+
+    // Metallic factor
+    if (aiMat->Get(AI_MATKEY_METALLIC_FACTOR, value) == AI_SUCCESS) {
+        mat.metallic = glm::clamp(value, 0.0f, 1.0f);
+    } else if (aiMat->Get(AI_MATKEY_COLOR_SPECULAR, color) == AI_SUCCESS) {
+        float specularIntensity = (color.r + color.g + color.b) / 3.0f;
+        mat.metallic            = specularIntensity > 0.5f ? 0.1f : 0.0f; // Be conservative
+    }
+
+    // Roughness factor
+    if (aiMat->Get(AI_MATKEY_ROUGHNESS_FACTOR, value) == AI_SUCCESS) {
+        mat.roughness = glm::clamp(value, 0.01f, 1.0f);
+    } else if (aiMat->Get(AI_MATKEY_SHININESS, value) == AI_SUCCESS && value > 0) {
+        // Convert shininess to roughness more conservatively
+        mat.roughness = glm::clamp(1.0f - (value / 256.0f), 0.1f, 1.0f);
+    }
+
+    // Emissive
+    if (aiMat->Get(AI_MATKEY_COLOR_EMISSIVE, color) == AI_SUCCESS) {
+        mat.emissive = glm::vec3(color.r, color.g, color.b);
+    }
+
+    // Transparency
+    if (aiMat->Get(AI_MATKEY_OPACITY, value) == AI_SUCCESS) {
+        mat.transparency = glm::clamp(value, 0.0f, 1.0f);
+    }
+
+    if (mat.albedo.r + mat.albedo.g + mat.albedo.b < 0.1f) {
+        mat.albedo = glm::vec3(0.5f, 0.5f, 0.5f);
+        LOG_INFO("Albedo is too low, setting to 0.5f, 0.5f, 0.5f");
+    }
+
+    if (mat.ao <= 0.0f) {
+        mat.ao = 1.0f;
+        LOG_INFO("AO is too low, setting to 1.0f");
+    }
+
+    // LOG_INFO("Final material - Albedo: ({:.2f}, {:.2f}, {:.2f}), Metallic: {:.2f}, Roughness: {:.2f}", mat.albedo.r, mat.albedo.g, mat.albedo.b, mat.metallic, mat.roughness);
+
+    return mat;
+}
@@ -0,0 +1,111 @@
+#ifndef ENGINE_RENDERER_MODEL_IMPORTER_H_
+#define ENGINE_RENDERER_MODEL_IMPORTER_H_
+
+#include "engine/renderer/geometry/mesh.h"
+#include "engine/renderer/geometry/mesh_optimizer.h"
+#include "engine/renderer/geometry/mesh_simplifier.h"
+#include "engine/renderer/textures/texture_role.h"
+#include "common/memory_arena.h"
+
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <assimp/scene.h>
+
+// Allocator aware so the path goes into the same resource as the vector holding it, the import arena for imports.
+struct ImportedTexture {
+    using allocator_type = std::pmr::polymorphic_allocator<>;
+
+    ImportedTexture(aiTextureType type, std::string_view path, allocator_type alloc = {}) : type(type), path(path, alloc) {}
+    ImportedTexture(const ImportedTexture& other, allocator_type alloc) : type(other.type), path(other.path, alloc) {}
+    ImportedTexture(ImportedTexture&& other, allocator_type alloc) : type(other.type), path(std::move(other.path), alloc) {}
+    ImportedTexture(const ImportedTexture&)            = default;
+    ImportedTexture(ImportedTexture&&)                 = default;
+    ImportedTexture& operator=(const ImportedTexture&) = default;
+    ImportedTexture& operator=(ImportedTexture&&)      = default;
+
+    aiTextureType    type;
+    std::pmr::string path; // Relative to the model directory
+
+    TextureRole getRole() const;
+};
+
+// Geometry lives in the model's import arena, so it has to be constructed with that resource.
+struct ImportedMesh {
+    explicit ImportedMesh(std::pmr::memory_resource* resource) : vertices(resource), indices(resource), textures(resource), lods(resource) {}
+
+    std::pmr::vector<Vertex>          vertices;
+    std::pmr::vector<uint32_t>        indices; // Every LOD, one after the other
+    std::pmr::vector<ImportedTexture> textures;
+    Material                          material;
+    std::pmr::vector<MeshLod>         lods; // Empty until built, then lods[0] is the full detail range
+};
+
+struct ImportStats {
+    float readMs    = 0.0f; // Assimp parse
+    float processMs = 0.0f; // aiMesh -> vertex/index conversion
+    float optimizeMs = 0.0f; // MeshOptimizer over every mesh
+    float lodMs      = 0.0f; // MeshSimplifier over every mesh
+    float textureMs  = 0.0f; // Texture resolve, main thread
+    float uploadMs   = 0.0f; // GL buffer creation, main thread
+
+    size_t meshCount   = 0;
+    size_t vertexCount = 0;
+    size_t indexCount  = 0; // Including the simplified levels
+    size_t lodCount    = 0; // Simplified levels, summed over all meshes
+
+    // Import arena: allocations it served and the heap blocks it took for them.
+    size_t arenaAllocations      = 0;
+    size_t arenaBytes            = 0;
+    size_t arenaBlockAllocations = 0;
+    size_t arenaBlockBytes       = 0;
+
+    // Summed over all meshes, in Assimp's order and after optimizing.
+    VertexCacheStats cacheBefore;
+    VertexCacheStats cacheAfter;
+};
+
+// Everything an import allocates for its geometry comes out of one arena, sized from the vertex and face counts up
+// front. Dropping the model releases it in a single step. The arena is declared first so it outlives the meshes.
+struct ImportedModel {
+    std::unique_ptr<MemoryArena> arena;
+    std::string                  directory;
+    std::vector<ImportedMesh>    meshes;
+    ImportStats                  stats;
+};
+
+// CPU side of model loading. Runs Assimp and converts every aiMesh into vertex/index data on the thread pool, then
+// reorders it with MeshOptimizer and builds its LOD chain with MeshSimplifier. Doesn't touch GL, so it can run on any
+// thread.
+class ModelImporter
+{
+  public:
+    ModelImporter()  = default;
+    ~ModelImporter() = default;
+
+    bool import(const std::string& path, ImportedModel& out);
+
+    void setThreaded(bool threaded) { m_threaded = threaded; }
+    void setOptimized(bool optimized) { m_optimized = optimized; }
+    void setBuildLods(bool buildLods) { m_buildLods = buildLods; }
+
+  private:
+    void     collectMeshes(aiNode* node, const aiScene* scene, std::vector<aiMesh*>& meshes);
+    void     processVertices(aiMesh* mesh, ImportedMesh& out, uint32_t first, uint32_t last);
+    void     processIndices(aiMesh* mesh, ImportedMesh& out);
+    void     optimizeMeshes(ImportedModel& out);
+    void     buildLods(ImportedModel& out);
+    void     collectTextures(aiMaterial* aiMat, std::pmr::vector<ImportedTexture>& textures);
+    Material convertAiMaterialToPBR(aiMaterial* aiMat);
+
+    bool m_threaded  = true;
+    bool m_optimized = true;
+    bool m_buildLods = true;
+
+    static constexpr uint32_t VERTEX_BATCH_SIZE = 16384;
+    static constexpr size_t   ARENA_SLACK       = 64 * 1024; // Materials, texture slots, jobs and LOD ranges on top of the geometry
+};
+
+#endif // ENGINE_RENDERER_MODEL_IMPORTER_H_
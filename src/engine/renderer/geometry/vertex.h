@@ -0,0 +1,42 @@
+#ifndef ENGINE_RENDERER_VERTEX_H_
+#define ENGINE_RENDERER_VERTEX_H_
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+
+// Import and cook layout, everything as full floats.
+struct Vertex {
+    glm::vec3 pos;
+    glm::vec3 normal;
+    glm::vec2 texCoords;
+    glm::vec3 tangent;
+    glm::vec3 bitangent;
+};
+
+// Layout of the vertex buffer, the shader switches its decode on it (see ShaderBinding::VERTEX_FORMAT).
+enum class VertexFormat : int32_t {
+    Float,  // Vertex as is, 56 bytes
+    Packed, // PackedVertex, 20 bytes
+};
+
+// Positions are unorm16 inside the mesh bounds, normal and tangent octahedral snorm16, UVs half floats. The bitangent
+// is rebuilt in the shader as cross(normal, tangent) * sign, the sign rides in the unused fourth position component.
+struct PackedVertex {
+    uint16_t position[4]; // xyz in the mesh bounds, w is 0 for a flipped bitangent and 65535 otherwise
+    int16_t  normal[2];
+    int16_t  tangent[2];
+    uint16_t texCoords[2];
+};
+
+static_assert(sizeof(PackedVertex) == 20, "PackedVertex must match the attribute layout in GeometryBuffer::allocate");
+
+// position = offset + unorm * scale, per mesh.
+struct VertexQuantization {
+    glm::vec3 offset = glm::vec3(0.0f);
+    glm::vec3 scale  = glm::vec3(1.0f);
+
+    static VertexQuantization fromBounds(const glm::vec3& min, const glm::vec3& max);
+};
+
+#endif // ENGINE_RENDERER_VERTEX_H_
@@ -0,0 +1,182 @@
+#include "pch.h"
+
+#include "engine/renderer/geometry/vertex_packing.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+    const float UNORM16_MAX = 65535.0f;
+    const float SNORM16_MAX = 32767.0f;
+
+    uint16_t toUnorm16(float value)
+    {
+        return static_cast<uint16_t>(std::clamp(value, 0.0f, 1.0f) * UNORM16_MAX + 0.5f);
+    }
+
+    float fromSnorm16(int16_t value)
+    {
+        // GL maps -32768 and -32767 both to -1.
+        return std::max(static_cast<float>(value) / SNORM16_MAX, -1.0f);
+    }
+
+    glm::vec2 wrapOctahedral(const glm::vec2& v)
+    {
+        return glm::vec2((1.0f - std::abs(v.y)) * (v.x >= 0.0f ? 1.0f : -1.0f), (1.0f - std::abs(v.x)) * (v.y >= 0.0f ? 1.0f : -1.0f));
+    }
+} // namespace
+
+VertexQuantization VertexQuantization::fromBounds(const glm::vec3& min, const glm::vec3& max)
+{
+    // Flat axes still need a non-zero scale, the value is irrelevant since every vertex quantizes to 0 there.
+    VertexQuantization quantization;
+    quantization.offset = min;
+    quantization.scale  = glm::max(max - min, glm::vec3(1e-8f));
+    return quantization;
+}
+
+PackedVertex VertexPacking::pack(const Vertex& vertex, const VertexQuantization& quantization)
+{
+    PackedVertex packed;
+
+    glm::vec3 position = (vertex.pos - quantization.offset) / quantization.scale;
+    packed.position[0] = toUnorm16(position.x);
+    packed.position[1] = toUnorm16(position.y);
+    packed.position[2] = toUnorm16(position.z);
+
+    bool flipped       = glm::dot(glm::cross(vertex.normal, vertex.tangent), vertex.bitangent) < 0.0f;
+    packed.position[3] = flipped ? 0 : 0xFFFF;
+
+    encodeOctahedral(vertex.normal, packed.normal);
+    encodeOctahedral(vertex.tangent, packed.tangent);
+
+    packed.texCoords[0] = toHalf(vertex.texCoords.x);
+    packed.texCoords[1] = toHalf(vertex.texCoords.y);
+    return packed;
+}
+
+void VertexPacking::pack(std::span<const Vertex> vertices, const VertexQuantization& quantization, std::vector<PackedVertex>& out)
+{
+    out.resize(vertices.size());
+    for (size_t i = 0; i < vertices.size(); i++) {
+        out[i] = pack(vertices[i], quantization);
+    }
+}
+
+Vertex VertexPacking::unpack(const PackedVertex& vertex, const VertexQuantization& quantization)
+{
+    Vertex unpacked;
+
+    glm::vec3 position(vertex.position[0], vertex.position[1], vertex.position[2]);
+    unpacked.pos = quantization.offset + position / UNORM16_MAX * quantization.scale;
+
+    unpacked.normal    = decodeOctahedral(vertex.normal);
+    unpacked.tangent   = decodeOctahedral(vertex.tangent);
+    unpacked.bitangent = glm::cross(unpacked.normal, unpacked.tangent) * (vertex.position[3] / UNORM16_MAX * 2.0f - 1.0f);
+    unpacked.texCoords = glm::vec2(fromHalf(vertex.texCoords[0]), fromHalf(vertex.texCoords[1]));
+    return unpacked;
+}
+
+void VertexPacking::encodeOctahedral(const glm::vec3& direction, int16_t out[2])
+{
+    float length = std::abs(direction.x) + std::abs(direction.y) + std::abs(direction.z);
+    if (length == 0.0f) {
+        out[0] = out[1] = 0;
+        return;
+    }
+
+    glm::vec3 n = direction / length;
+    glm::vec2 v = n.z >= 0.0f ? glm::vec2(n.x, n.y) : wrapOctahedral(glm::vec2(n.x, n.y));
+
+    // Rounding each axis on its own isn't always closest on the sphere, so try every floor/ceil combination. Compared
+    // by distance, a dot product this close to 1 has run out of float precision.
+    glm::vec3 target = glm::normalize(direction);
+    float     best   = FLT_MAX;
+    for (int i = 0; i < 4; i++) {
+        int16_t candidate[2];
+        candidate[0] = static_cast<int16_t>(std::clamp((i & 1) ? std::ceil(v.x * SNORM16_MAX) : std::floor(v.x * SNORM16_MAX), -SNORM16_MAX, SNORM16_MAX));
+        candidate[1] = static_cast<int16_t>(std::clamp((i & 2) ? std::ceil(v.y * SNORM16_MAX) : std::floor(v.y * SNORM16_MAX), -SNORM16_MAX, SNORM16_MAX));
+
+        glm::vec3 error    = decodeOctahedral(candidate) - target;
+        float     distance = glm::dot(error, error);
+        if (distance < best) {
+            best   = distance;
+            out[0] = candidate[0];
+            out[1] = candidate[1];
+        }
+    }
+}
+
+glm::vec3 VertexPacking::decodeOctahedral(const int16_t encoded[2])
+{
+    glm::vec2 v(fromSnorm16(encoded[0]), fromSnorm16(encoded[1]));
+    glm::vec3 n(v.x, v.y, 1.0f - std::abs(v.x) - std::abs(v.y));
+
+    // Same as pbr.vs: fold the lower hemisphere back out of the corners.
+    float t = std::max(-n.z, 0.0f);
+    n.x += n.x >= 0.0f ? -t : t;
+    n.y += n.y >= 0.0f ? -t : t;
+    return glm::normalize(n);
+}
+
+uint16_t VertexPacking::toHalf(float value)
+{
+    uint32_t bits = 0;
+    std::memcpy(&bits, &value, sizeof(bits));
+
+    uint32_t sign     = (bits >> 16) & 0x8000;
+    uint32_t absolute = bits & 0x7FFFFFFF;
+
+    if (absolute >= 0x7F800000) {
+        return static_cast<uint16_t>(sign | 0x7C00 | (absolute > 0x7F800000 ? 0x200 : 0)); // Infinity or NaN
+    }
+    if (absolute >= 0x477FF000) {
+        return static_cast<uint16_t>(sign | 0x7C00); // Rounds past the largest half
+    }
+
+    uint32_t exponent = absolute >> 23;
+    if (exponent < 113) {
+        // Below the smallest normal half, shift the full mantissa down to a multiple of 2^-24.
+        if (exponent < 102) {
+            return static_cast<uint16_t>(sign);
+        }
+
+        uint32_t mantissa  = (absolute & 0x7FFFFF) | 0x800000;
+        uint32_t shift     = 126 - exponent;
+        uint32_t result    = mantissa >> shift;
+        uint32_t remainder = mantissa & ((1u << shift) - 1);
+        uint32_t halfway   = 1u << (shift - 1);
+        if (remainder > halfway || (remainder == halfway && (result & 1))) {
+            result++;
+        }
+        return static_cast<uint16_t>(sign | result);
+    }
+
+    // A carry out of the mantissa correctly bumps the exponent.
+    uint32_t result    = ((exponent - 112) << 10) | ((absolute >> 13) & 0x3FF);
+    uint32_t remainder = absolute & 0x1FFF;
+    if (remainder > 0x1000 || (remainder == 0x1000 && (result & 1))) {
+        result++;
+    }
+    return static_cast<uint16_t>(sign | result);
+}
+
+float VertexPacking::fromHalf(uint16_t value)
+{
+    uint32_t sign     = static_cast<uint32_t>(value & 0x8000) << 16;
+    uint32_t exponent = (value >> 10) & 0x1F;
+    uint32_t mantissa = value & 0x3FF;
+
+    if (exponent == 0) {
+        float result = std::ldexp(static_cast<float>(mantissa), -24);
+        return sign ? -result : result;
+    }
+
+    uint32_t bits = exponent == 31 ? sign | 0x7F800000 | (mantissa << 13) : sign | ((exponent + 112) << 23) | (mantissa << 13);
+    float    result;
+    std::memcpy(&result, &bits, sizeof(result));
+    return result;
+}
@@ -0,0 +1,31 @@
+#ifndef ENGINE_RENDERER_VERTEX_PACKING_H_
+#define ENGINE_RENDERER_VERTEX_PACKING_H_
+
+#include "engine/renderer/geometry/vertex.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// Conversions between Vertex and PackedVertex. GeometryBuffer packs at upload, the cooked blob keeps the float layout.
+class VertexPacking
+{
+  public:
+    static PackedVertex pack(const Vertex& vertex, const VertexQuantization& quantization);
+    static void         pack(std::span<const Vertex> vertices, const VertexQuantization& quantization, std::vector<PackedVertex>& out);
+
+    // Decodes the way pbr.vs does, for checking precision on the CPU.
+    static Vertex unpack(const PackedVertex& vertex, const VertexQuantization& quantization);
+
+    // Picks the best of the four nearest snorm16 codes rather than just rounding, which halves the worst case error.
+    static void      encodeOctahedral(const glm::vec3& direction, int16_t out[2]);
+    static glm::vec3 decodeOctahedral(const int16_t encoded[2]);
+
+    // IEEE half, round to nearest even. Out of range values become infinity.
+    static uint16_t toHalf(float value);
+    static float    fromHalf(uint16_t value);
+};
+
+#endif // ENGINE_RENDERER_VERTEX_PACKING_H_
@@ -13,6 +13,12 @@ Light::Light(Type type, const glm::vec3& position, const glm::vec3& color, float
     //
 }
 
+float Light::getRange() const
+{
+    float brightest = std::max(m_color.r, std::max(m_color.g, m_color.b)) * m_intensity;
+    return std::sqrt(std::max(brightest, 0.0f) / RANGE_THRESHOLD);
+}
+
 std::unique_ptr<Light> Light::createDirectionalLight(const glm::vec3& direction, const glm::vec3& color, float intensity)
 {
     auto light = std::make_unique<Light>(DIRECTIONAL, glm::vec3(0.0f), color, intensity);
@@ -20,6 +20,7 @@ class Light
     bool             isEnabled() const { return m_enabled; }
     float            getCutoff() const { return m_cutoff; }
     float            getOuterCutoff() const { return m_outerCutoff; }
+    float            getRange() const;
     std::string      getTypeName()
     {
         if (m_type == Type::DIRECTIONAL) {
@@ -32,19 +33,26 @@ class Light
         return "Unknown";
     }
 
-    void setPosition(const glm::vec3& position) { m_position = position; }
-    void setDirection(const glm::vec3& direction) { m_direction = direction; }
-    void setColor(const glm::vec3& color) { m_color = color; }
-    void setIntensity(float intensity) { m_intensity = intensity; }
-    void setEnabled(bool enabled) { m_enabled = enabled; }
-    void setCutoff(float cutoff) { m_cutoff = cutoff; }
-    void setOuterCuttoff(float cutoff) { m_outerCutoff = cutoff; }
+    // Every setter marks the light dirty, LightManager only repacks its buffer when a light is.
+    void setPosition(const glm::vec3& position) { m_position = position; m_dirty = true; }
+    void setDirection(const glm::vec3& direction) { m_direction = direction; m_dirty = true; }
+    void setColor(const glm::vec3& color) { m_color = color; m_dirty = true; }
+    void setIntensity(float intensity) { m_intensity = intensity; m_dirty = true; }
+    void setEnabled(bool enabled) { m_enabled = enabled; m_dirty = true; }
+    void setCutoff(float cutoff) { m_cutoff = cutoff; m_dirty = true; }
+    void setOuterCuttoff(float cutoff) { m_outerCutoff = cutoff; m_dirty = true; }
+
+    bool isDirty() const { return m_dirty; }
+    void clearDirty() { m_dirty = false; }
 
     static std::unique_ptr<Light> createDirectionalLight(const glm::vec3& direction, const glm::vec3& color = glm::vec3(1.0f), float intensity = 1.0f);
     static std::unique_ptr<Light> createSunLight(const glm::vec3& direction = glm::vec3(-0.3f, -0.7f, -0.2f));
     static std::unique_ptr<Light> createPointLight(const glm::vec3& position, const glm::vec3& color = glm::vec3(1.0f), float intensity = 1.0f);
     static std::unique_ptr<Light> createSpotLight(const glm::vec3& position, const glm::vec3& direction, const glm::vec3& color = glm::vec3(1.0f), float intensity = 1.0f);
 
+    // Point and spot lights are faded out where intensity / d^2 of the brightest channel drops below this.
+    static constexpr float RANGE_THRESHOLD = 0.02f;
+
   private:
     Type      m_type;
     glm::vec3 m_position;
@@ -54,6 +62,7 @@ class Light
     bool      m_enabled;
     float     m_cutoff;
     float     m_outerCutoff;
+    bool      m_dirty = true;
 };
 
 #endif // ENGINE_RENDERER_LIGHT_H_
\ No newline at end of file
@@ -0,0 +1,233 @@
+#include "pch.h"
+
+#include "engine/renderer/lighting/light_clusters.h"
+#include "engine/renderer/buffers/ring_buffer.h"
+#include "engine/core/thread_pool.h"
+#include "common/timer.h"
+
+#include <immintrin.h>
+
+#include <bit>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+    // Padding spheres sit far behind the camera with no radius, every overlap test rejects them.
+    const float PAD_DEPTH = -1.0e30f;
+
+    // Squared distance from a point to a box, 0 inside. The SIMD path does the same operations in the same order.
+    float distanceSquared(float x, float y, float z, const glm::vec3& min, const glm::vec3& max)
+    {
+        float dx = std::max(std::max(min.x - x, x - max.x), 0.0f);
+        float dy = std::max(std::max(min.y - y, y - max.y), 0.0f);
+        float dz = std::max(std::max(min.z - z, z - max.z), 0.0f);
+        return dx * dx + dy * dy + dz * dz;
+    }
+} // namespace
+
+void LightClusters::Spheres::clear()
+{
+    x.clear();
+    y.clear();
+    z.clear();
+    radius.clear();
+    lights.clear();
+}
+
+void LightClusters::Spheres::add(const Spheres& source, uint32_t index)
+{
+    x.push_back(source.x[index]);
+    y.push_back(source.y[index]);
+    z.push_back(source.z[index]);
+    radius.push_back(source.radius[index]);
+    lights.push_back(source.lights[index]);
+}
+
+void LightClusters::Spheres::pad()
+{
+    size_t padded = (lights.size() + 3) & ~size_t(3);
+    x.resize(padded, 0.0f);
+    y.resize(padded, 0.0f);
+    z.resize(padded, PAD_DEPTH);
+    radius.resize(padded, 0.0f);
+}
+
+LightClusters::LightClusters()
+{
+    m_slices.resize(GRID_Z);
+    m_clusters.resize(CLUSTER_COUNT);
+}
+
+void LightClusters::setProjection(float fovY, float aspect, float nearPlane, float farPlane)
+{
+    glm::vec4 projection(fovY, aspect, nearPlane, farPlane);
+    if (projection == m_projection) {
+        return;
+    }
+    m_projection = projection;
+
+    // slice = log(depth / near) / log(far / near) * GRID_Z, the shader computes it as log(depth) * scale + bias.
+    float logRatio = std::log(farPlane / nearPlane);
+    m_depthScale   = GRID_Z / logRatio;
+    m_depthBias    = -GRID_Z * std::log(nearPlane) / logRatio;
+
+    m_tileBounds.assign(CLUSTER_COUNT, Box{glm::vec3(FLT_MAX), glm::vec3(-FLT_MAX)});
+    m_rowBounds.assign(GRID_Y * GRID_Z, Box{glm::vec3(FLT_MAX), glm::vec3(-FLT_MAX)});
+    m_sliceBounds.assign(GRID_Z, Box{glm::vec3(FLT_MAX), glm::vec3(-FLT_MAX)});
+
+    // A tile is a frustum between two NDC lines, its box spans the corners on the slice's near and far planes.
+    float tanY = std::tan(fovY * 0.5f);
+    float tanX = tanY * aspect;
+    for (uint32_t z = 0; z < GRID_Z; z++) {
+        float depths[2] = {nearPlane * std::pow(farPlane / nearPlane, static_cast<float>(z) / GRID_Z), nearPlane * std::pow(farPlane / nearPlane, static_cast<float>(z + 1) / GRID_Z)};
+
+        for (uint32_t y = 0; y < GRID_Y; y++) {
+            float ndcY[2] = {-1.0f + 2.0f * y / GRID_Y, -1.0f + 2.0f * (y + 1) / GRID_Y};
+            Box&  row     = m_rowBounds[y + z * GRID_Y];
+
+            for (uint32_t x = 0; x < GRID_X; x++) {
+                float ndcX[2] = {-1.0f + 2.0f * x / GRID_X, -1.0f + 2.0f * (x + 1) / GRID_X};
+                Box&  tile    = m_tileBounds[x + y * GRID_X + z * TILE_COUNT];
+
+                for (float depth : depths) {
+                    for (int i = 0; i < 4; i++) {
+                        glm::vec3 corner(ndcX[i & 1] * tanX * depth, ndcY[i >> 1] * tanY * depth, depth);
+                        tile.min = glm::min(tile.min, corner);
+                        tile.max = glm::max(tile.max, corner);
+                    }
+                }
+
+                row.min = glm::min(row.min, tile.min);
+                row.max = glm::max(row.max, tile.max);
+            }
+
+            m_sliceBounds[z].min = glm::min(m_sliceBounds[z].min, row.min);
+            m_sliceBounds[z].max = glm::max(m_sliceBounds[z].max, row.max);
+        }
+    }
+}
+
+void LightClusters::assign(const std::vector<LightBlock>& lights, uint32_t firstLocal, const glm::mat4& view)
+{
+    Timer timer;
+
+    m_lights.clear();
+    for (uint32_t i = firstLocal; i < lights.size(); i++) {
+        glm::vec4 position = view * glm::vec4(lights[i].position, 1.0f);
+
+        m_lights.x.push_back(position.x);
+        m_lights.y.push_back(position.y);
+        m_lights.z.push_back(-position.z);
+        m_lights.radius.push_back(lights[i].range);
+        m_lights.lights.push_back(i);
+    }
+    m_lights.pad();
+
+    if (m_threaded) {
+        THREAD_POOL.parallelFor(GRID_Z, [this](size_t slice) { assignSlice(static_cast<uint32_t>(slice)); });
+    } else {
+        for (uint32_t slice = 0; slice < GRID_Z; slice++) {
+            assignSlice(slice);
+        }
+    }
+
+    // Slices hold their tiles in cluster order, so concatenating them gives the final index list.
+    m_lightIndices.clear();
+    m_maxLightsPerCluster = 0;
+    for (uint32_t z = 0; z < GRID_Z; z++) {
+        const Slice& slice  = m_slices[z];
+        uint32_t     offset = static_cast<uint32_t>(m_lightIndices.size());
+        for (uint32_t tile = 0; tile < TILE_COUNT; tile++) {
+            ClusterRange& range = m_clusters[tile + z * TILE_COUNT];
+            range.offset        = offset;
+            range.count         = slice.counts[tile];
+            offset += range.count;
+
+            m_maxLightsPerCluster = std::max(m_maxLightsPerCluster, range.count);
+        }
+        m_lightIndices.insert(m_lightIndices.end(), slice.indices.begin(), slice.indices.end());
+    }
+
+    m_assignMs = timer.getTime() * 1000.0f;
+}
+
+void LightClusters::assignSlice(uint32_t z)
+{
+    Slice& slice = m_slices[z];
+    slice.candidates.clear();
+    slice.indices.clear();
+
+    forEachOverlap(m_lights, m_sliceBounds[z], [&](uint32_t i) { slice.candidates.add(m_lights, i); });
+    slice.candidates.pad();
+
+    for (uint32_t y = 0; y < GRID_Y; y++) {
+        slice.row.clear();
+        forEachOverlap(slice.candidates, m_rowBounds[y + z * GRID_Y], [&](uint32_t i) { slice.row.add(slice.candidates, i); });
+        slice.row.pad();
+
+        for (uint32_t x = 0; x < GRID_X; x++) {
+            uint32_t tile   = x + y * GRID_X;
+            size_t   before = slice.indices.size();
+            forEachOverlap(slice.row, m_tileBounds[tile + z * TILE_COUNT], [&](uint32_t i) { slice.indices.push_back(slice.row.lights[i]); });
+            slice.counts[tile] = static_cast<uint32_t>(slice.indices.size() - before);
+        }
+    }
+}
+
+template <typename Emit> void LightClusters::forEachOverlap(const Spheres& spheres, const Box& box, Emit&& emit) const
+{
+    if (!m_vectorized) {
+        for (uint32_t i = 0; i < spheres.lights.size(); i++) {
+            if (distanceSquared(spheres.x[i], spheres.y[i], spheres.z[i], box.min, box.max) <= spheres.radius[i] * spheres.radius[i]) {
+                emit(i);
+            }
+        }
+        return;
+    }
+
+    __m128 minX = _mm_set1_ps(box.min.x);
+    __m128 minY = _mm_set1_ps(box.min.y);
+    __m128 minZ = _mm_set1_ps(box.min.z);
+    __m128 maxX = _mm_set1_ps(box.max.x);
+    __m128 maxY = _mm_set1_ps(box.max.y);
+    __m128 maxZ = _mm_set1_ps(box.max.z);
+    __m128 zero = _mm_setzero_ps();
+
+    uint32_t count = static_cast<uint32_t>(spheres.x.size());
+    for (uint32_t i = 0; i < count; i += 4) {
+        __m128 x = _mm_loadu_ps(&spheres.x[i]);
+        __m128 y = _mm_loadu_ps(&spheres.y[i]);
+        __m128 z = _mm_loadu_ps(&spheres.z[i]);
+        __m128 r = _mm_loadu_ps(&spheres.radius[i]);
+
+        __m128 dx = _mm_max_ps(_mm_max_ps(_mm_sub_ps(minX, x), _mm_sub_ps(x, maxX)), zero);
+        __m128 dy = _mm_max_ps(_mm_max_ps(_mm_sub_ps(minY, y), _mm_sub_ps(y, maxY)), zero);
+        __m128 dz = _mm_max_ps(_mm_max_ps(_mm_sub_ps(minZ, z), _mm_sub_ps(z, maxZ)), zero);
+        __m128 d2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+
+        int mask = _mm_movemask_ps(_mm_cmple_ps(d2, _mm_mul_ps(r, r)));
+        while (mask) {
+            emit(i + std::countr_zero(static_cast<uint32_t>(mask)));
+            mask &= mask - 1;
+        }
+    }
+}
+
+void LightClusters::bind(uint32_t viewportWidth, uint32_t viewportHeight)
+{
+    ClusterBufferHeader header;
+    header.dimensions = glm::uvec4(GRID_X, GRID_Y, GRID_Z, 0);
+    header.params     = glm::vec4(static_cast<float>(GRID_X) / std::max(viewportWidth, 1u), static_cast<float>(GRID_Y) / std::max(viewportHeight, 1u), m_depthScale, m_depthBias);
+
+    // Both are rewritten every frame, straight into the ring.
+    RingAllocation clusters = FRAME_RING.allocate(sizeof(header) + m_clusters.size() * sizeof(ClusterRange));
+    std::memcpy(clusters.data, &header, sizeof(header));
+    std::memcpy(static_cast<uint8_t*>(clusters.data) + sizeof(header), m_clusters.data(), m_clusters.size() * sizeof(ClusterRange));
+    FRAME_RING.bindRange(GL_SHADER_STORAGE_BUFFER, ShaderBinding::CLUSTER_BUFFER, clusters);
+
+    uint32_t       empty   = 0;
+    RingAllocation indices = m_lightIndices.empty() ? FRAME_RING.write(&empty, sizeof(empty)) : FRAME_RING.write(m_lightIndices.data(), m_lightIndices.size() * sizeof(uint32_t));
+    FRAME_RING.bindRange(GL_SHADER_STORAGE_BUFFER, ShaderBinding::LIGHT_INDICES, indices);
+}
@@ -0,0 +1,98 @@
+#ifndef ENGINE_RENDERER_LIGHT_CLUSTERS_H_
+#define ENGINE_RENDERER_LIGHT_CLUSTERS_H_
+
+#include "engine/renderer/shaders/shader_bindings.h"
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+// Clustered forward lighting. The view frustum is split into a froxel grid, screen tiles along x and y and
+// exponentially spaced slices along depth. Every frame each point and spot light is assigned to the clusters its
+// bounding sphere touches, so a fragment only evaluates the lights of its own cluster.
+//
+// Assignment runs on the CPU. Slices are spread over the thread pool and narrow the lights down hierarchically, slice
+// box, then each row of tiles, then each tile, testing bounding spheres against boxes four at a time with SSE.
+class LightClusters
+{
+  public:
+    static constexpr uint32_t GRID_X        = 16;
+    static constexpr uint32_t GRID_Y        = 9;
+    static constexpr uint32_t GRID_Z        = 24;
+    static constexpr uint32_t TILE_COUNT    = GRID_X * GRID_Y;
+    static constexpr uint32_t CLUSTER_COUNT = TILE_COUNT * GRID_Z;
+
+    LightClusters();
+    ~LightClusters() = default;
+
+    // Rebuilds the cluster bounds when any of the values changed. fovY is in radians.
+    void setProjection(float fovY, float aspect, float nearPlane, float farPlane);
+
+    // Assigns lights[firstLocal..], the point and spot lights, using their range as the sphere radius. CPU only.
+    void assign(const std::vector<LightBlock>& lights, uint32_t firstLocal, const glm::mat4& view);
+
+    // Writes the last assignment into this frame's FRAME_RING region and binds it to CLUSTER_BUFFER and LIGHT_INDICES.
+    // GL thread only.
+    void bind(uint32_t viewportWidth, uint32_t viewportHeight);
+
+    // Turning both off runs the scalar single threaded reference, the output is the same either way.
+    void setThreaded(bool threaded) { m_threaded = threaded; }
+    void setVectorized(bool vectorized) { m_vectorized = vectorized; }
+
+    const std::vector<ClusterRange>& getClusters() const { return m_clusters; }
+    const std::vector<uint32_t>&     getLightIndices() const { return m_lightIndices; }
+    uint32_t                         getMaxLightsPerCluster() const { return m_maxLightsPerCluster; }
+    float                            getAssignMs() const { return m_assignMs; }
+
+  private:
+    struct Box {
+        glm::vec3 min = glm::vec3(0.0f);
+        glm::vec3 max = glm::vec3(0.0f);
+    };
+
+    // View space spheres as SoA, padded to a multiple of 4 with spheres that never touch anything.
+    struct Spheres {
+        std::vector<float>    x, y, z, radius;
+        std::vector<uint32_t> lights; // Light index of each sphere, not padded
+
+        void clear();
+        void add(const Spheres& source, uint32_t index);
+        void pad();
+    };
+
+    // Scratch for one depth slice, so slices can be assigned in parallel without sharing anything.
+    struct Slice {
+        Spheres                          candidates; // Overlapping the slice
+        Spheres                          row;        // Overlapping the current row of tiles
+        std::vector<uint32_t>            indices;    // Light indices of each tile, tile after tile
+        std::array<uint32_t, TILE_COUNT> counts = {};
+    };
+
+    // View space bounds with depth positive into the screen. Rows and slices are the union of their tiles.
+    std::vector<Box> m_tileBounds;
+    std::vector<Box> m_rowBounds;
+    std::vector<Box> m_sliceBounds;
+
+    glm::vec4 m_projection = glm::vec4(0.0f); // fovY, aspect, near, far the bounds were built for
+    float     m_depthScale = 0.0f;
+    float     m_depthBias  = 0.0f;
+
+    Spheres                   m_lights;
+    std::vector<Slice>        m_slices;
+    std::vector<ClusterRange> m_clusters;
+    std::vector<uint32_t>     m_lightIndices;
+
+    bool     m_threaded            = true;
+    bool     m_vectorized          = true;
+    uint32_t m_maxLightsPerCluster = 0;
+    float    m_assignMs            = 0.0f;
+
+    void assignSlice(uint32_t slice);
+
+    // Calls emit with the index of every sphere touching the box, in order.
+    template <typename Emit> void forEachOverlap(const Spheres& spheres, const Box& box, Emit&& emit) const;
+};
+
+#endif // ENGINE_RENDERER_LIGHT_CLUSTERS_H_
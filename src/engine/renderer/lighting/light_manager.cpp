@@ -3,26 +3,31 @@
 #include "engine/renderer/lighting/light_manager.h"
 #include "common/logger.h"
 
-void LightManager::addLight(std::unique_ptr<Light> light)
+#include <cstring>
+
+LightManager::LightManager() : m_buffer(GL_SHADER_STORAGE_BUFFER)
 {
-    if (m_lights.size() >= MAX_LIGHTS) {
-        LOG_WARN("Cannot add more lights. Maximum of {} lights supported.", MAX_LIGHTS);
-        return;
-    }
+    //
+}
 
+void LightManager::addLight(std::unique_ptr<Light> light)
+{
     m_lights.push_back(std::move(light));
+    m_dirty = true;
 }
 
 void LightManager::removeLight(size_t index)
 {
     if (index < m_lights.size()) {
         m_lights.erase(m_lights.begin() + index);
+        m_dirty = true;
     }
 }
 
 void LightManager::clearLights()
 {
     m_lights.clear();
+    m_dirty = true;
 }
 
 Light* LightManager::getLight(size_t index)
@@ -35,43 +40,119 @@ Light* LightManager::getLight(size_t index)
     return m_lights[index].get();
 }
 
-void LightManager::updateShaderUniforms(Shader* shader) const
+void LightManager::addRandomLights(size_t count, const glm::vec3& boundsMin, const glm::vec3& boundsMax, uint32_t seed)
 {
-    if (!shader) return;
+    // xorshift, the same seed always gives the same scene.
+    uint32_t state  = seed ? seed : 1;
+    auto     random = [&state]() {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return static_cast<float>(state & 0xFFFFFF) / static_cast<float>(0xFFFFFF);
+    };
+
+    for (size_t i = 0; i < count; i++) {
+        glm::vec3 position = boundsMin + (boundsMax - boundsMin) * glm::vec3(random(), random(), random());
+        glm::vec3 color    = glm::vec3(0.2f) + glm::vec3(random(), random(), random()) * 0.8f;
+        float     strength = 0.5f + random() * 1.5f;
+
+        if (i % 4 == 3) {
+            glm::vec3 direction = glm::vec3(random() - 0.5f, -1.0f, random() - 0.5f);
+            m_lights.push_back(Light::createSpotLight(position, direction, color, strength * 2.0f));
+        } else {
+            m_lights.push_back(Light::createPointLight(position, color, strength));
+        }
+    }
+    m_dirty = true;
+}
 
-    int activeLightCount = 0;
-    for (const auto& light : m_lights) {
-        if (light && light->isEnabled()) {
-            activeLightCount++;
+const std::vector<LightBlock>& LightManager::getPackedLights()
+{
+    if (isDirty()) {
+        packLights();
+    }
+    return m_packed;
+}
+
+void LightManager::bindLightBuffer()
+{
+    getPackedLights();
+
+    if (m_uploadedPack != m_packCount) {
+        LightBufferHeader header;
+        header.count            = static_cast<uint32_t>(m_packed.size());
+        header.directionalCount = m_directionalCount;
+
+        m_staging.resize(sizeof(header) + m_packed.size() * sizeof(LightBlock));
+        std::memcpy(m_staging.data(), &header, sizeof(header));
+        if (!m_packed.empty()) {
+            std::memcpy(m_staging.data() + sizeof(header), m_packed.data(), m_packed.size() * sizeof(LightBlock));
         }
+
+        // Same size writes in place, the buffer is only reallocated when the light count changes.
+        if (m_buffer.getSize() != m_staging.size()) {
+            m_buffer.allocate(m_staging.size(), m_staging.data());
+        } else {
+            m_buffer.update(0, m_staging.size(), m_staging.data());
+        }
+        m_uploadedPack = m_packCount;
+        m_uploadCount++;
     }
 
-    shader->setInt("numLights", activeLightCount);
+    m_buffer.bindBase(ShaderBinding::LIGHT_BUFFER);
+}
 
-    int activeIndex = 0;
-    for (size_t i = 0; i < m_lights.size() && activeIndex < MAX_LIGHTS; ++i) {
-        const Light* light = m_lights[i].get();
-        if (!light || !light->isEnabled()) continue;
+bool LightManager::isDirty() const
+{
+    if (m_dirty) {
+        return true;
+    }
+
+    for (const auto& light : m_lights) {
+        if (light && light->isDirty()) {
+            return true;
+        }
+    }
+    return false;
+}
 
-        std::string uniformBase = "lights[" + std::to_string(i) + "]";
-
-        shader->setInt(uniformBase + ".type", static_cast<int>(light->getType()));
-        shader->setVec3(uniformBase + ".color", light->getColor());
-        shader->setFloat(uniformBase + ".intensity", light->getIntensity());
-
-        switch (light->getType()) {
-            case Light::DIRECTIONAL: shader->setVec3(uniformBase + ".direction", light->getDirection()); break;
-            case Light::POINT: shader->setVec3(uniformBase + ".position", light->getPosition()); break;
-            case Light::SPOT:
-                shader->setVec3(uniformBase + ".position", light->getPosition());
-                shader->setVec3(uniformBase + ".direction", light->getDirection());
-                shader->setFloat(uniformBase + ".cutoff", light->getCutoff());
-                shader->setFloat(uniformBase + ".outerCutoff", light->getOuterCutoff());
-                break;
+void LightManager::packLights()
+{
+    m_packed.clear();
+    m_directionalCount = 0;
+
+    // Directional lights light every fragment, the shader loops over them before the clustered ones.
+    for (bool directional : {true, false}) {
+        for (const auto& light : m_lights) {
+            if (!light || !light->isEnabled() || (light->getType() == Light::DIRECTIONAL) != directional) {
+                continue;
+            }
+
+            LightBlock block;
+            block.type        = static_cast<int32_t>(light->getType());
+            block.position    = light->getPosition();
+            block.direction   = light->getDirection();
+            block.color       = light->getColor();
+            block.intensity   = light->getIntensity();
+            block.cutoff      = light->getType() == Light::SPOT ? light->getCutoff() : 0.0f;
+            block.outerCutoff = light->getType() == Light::SPOT ? light->getOuterCutoff() : 0.0f;
+            block.range       = directional ? 0.0f : light->getRange();
+            m_packed.push_back(block);
         }
 
-        activeIndex++;
+        if (directional) {
+            m_directionalCount = static_cast<uint32_t>(m_packed.size());
+        }
     }
+
+    for (const auto& light : m_lights) {
+        if (light) {
+            light->clearDirty();
+        }
+    }
+
+    m_dirty = false;
+    m_packCount++;
 }
 
 void LightManager::renderDebugVisualization(LineRenderer* renderer, const glm::vec3& modelCenter) const
@@ -2,16 +2,19 @@
 #define ENGINE_RENDERER_LIGHT_MANAGER_H_
 
 #include "engine/renderer/lighting/light.h"
-#include "engine/renderer/shaders/shader.h"
+#include "engine/renderer/buffers/gpu_buffer.h"
+#include "engine/renderer/shaders/shader_bindings.h"
 #include "editor/tools/line_renderer.h"
 
 #include <vector>
 #include <memory>
 
+// Owns the scene's lights and their shader storage buffer. Enabled lights are packed into the buffer only when one of
+// them was changed through its setters or the list itself changed, a static setup costs nothing per frame.
 class LightManager
 {
   public:
-    LightManager()  = default;
+    LightManager();
     ~LightManager() = default;
 
     void addLight(std::unique_ptr<Light> light);
@@ -22,12 +25,32 @@ class LightManager
     Light*                                     getLight(size_t index);
     const std::vector<std::unique_ptr<Light>>& getLights() const { return m_lights; }
 
-    void updateShaderUniforms(Shader* shader) const;
+    // Spreads point lights (and every fourth one a spot light) with random colors through the box, for stress testing.
+    void addRandomLights(size_t count, const glm::vec3& boundsMin, const glm::vec3& boundsMax, uint32_t seed = 1);
+
+    // Enabled lights in the LightBuffer layout, directional ones first. Repacks if anything changed, CPU only.
+    const std::vector<LightBlock>& getPackedLights();
+    uint32_t                       getDirectionalCount() const { return m_directionalCount; }
+
+    // Uploads the packed lights if they changed since the last upload and binds them to ShaderBinding::LIGHT_BUFFER.
+    void bindLightBuffer();
     void renderDebugVisualization(LineRenderer* renderer, const glm::vec3& modelCenter) const;
 
+    size_t getUploadCount() const { return m_uploadCount; }
+
   private:
     std::vector<std::unique_ptr<Light>> m_lights;
-    static constexpr size_t             MAX_LIGHTS = 4;
+    std::vector<LightBlock>             m_packed;
+    std::vector<uint8_t>                m_staging;
+    GpuBuffer                           m_buffer;
+    uint32_t                            m_directionalCount = 0;
+    bool                                m_dirty            = true;
+    size_t                              m_packCount        = 0;
+    size_t                              m_uploadedPack     = 0;
+    size_t                              m_uploadCount      = 0;
+
+    bool isDirty() const;
+    void packLights();
 };
 
 #endif // ENGINE_RENDERER_LIGHT_MANAGER_H_
\ No newline at end of file
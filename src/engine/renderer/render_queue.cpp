@@ -0,0 +1,350 @@
+#include "pch.h"
+
+#include "engine/renderer/render_queue.h"
+#include "engine/renderer/buffers/material_buffer.h"
+#include "engine/renderer/buffers/ring_buffer.h"
+#include "engine/renderer/shaders/shader.h"
+#include "engine/renderer/shaders/shader_bindings.h"
+#include "engine/renderer/textures/texture_pool.h"
+#include "common/hash.h"
+#include "common/logger.h"
+#include "common/timer.h"
+
+#include <atomic>
+#include <cassert>
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+
+namespace
+{
+    const uint32_t INVALID_ID = ~0u;
+    const uint32_t RADIX_BITS = 8;
+    const uint32_t RADIX_SIZE = 1 << RADIX_BITS;
+
+    struct TextureSetHash {
+        size_t operator()(const std::vector<uint64_t>& units) const { return static_cast<size_t>(Hash::fnv1a(units.data(), units.size() * sizeof(uint64_t))); }
+    };
+
+    std::mutex                                                          s_idMutex;
+    std::unordered_map<std::vector<uint64_t>, uint32_t, TextureSetHash> s_textureSetIds;
+
+    std::atomic<SubmitMode> s_preferredMode = SubmitMode::MultiDrawIndirect;
+
+    // Positive floats order like their bit patterns. Dropping the sign and the low 11 mantissa bits leaves 20.
+    uint64_t quantizeDepth(float viewDepth)
+    {
+        float    depth = std::max(viewDepth, 0.0f);
+        uint32_t bits  = 0;
+        std::memcpy(&bits, &depth, sizeof(bits));
+        return bits >> 11;
+    }
+} // namespace
+
+uint64_t RenderQueue::makeKey(RenderPass pass, uint32_t shader, uint32_t material, uint32_t textureSet, float viewDepth)
+{
+    uint64_t state = (static_cast<uint64_t>(shader & 0x3FF) << 32) | (static_cast<uint64_t>(material & 0xFFFF) << 16) | (textureSet & ((1u << TEXTURE_SET_BITS) - 1));
+    uint64_t depth = quantizeDepth(viewDepth);
+
+    if (pass == RenderPass::Transparent) {
+        return (static_cast<uint64_t>(pass) << 62) | ((~depth & 0xFFFFF) << 42) | state;
+    }
+    return (static_cast<uint64_t>(pass) << 62) | (state << 20) | depth;
+}
+
+uint32_t RenderQueue::getTextureSetId(std::span<const uint64_t> units)
+{
+    std::lock_guard<std::mutex> lock(s_idMutex);
+    uint32_t                    id = s_textureSetIds.try_emplace(std::vector<uint64_t>(units.begin(), units.end()), static_cast<uint32_t>(s_textureSetIds.size())).first->second;
+    assert(id < (1u << TEXTURE_SET_BITS) && "Texture set ids past the sort key's field would share sort buckets");
+    return id;
+}
+
+void RenderQueue::clearTextureSetIds()
+{
+    std::lock_guard<std::mutex> lock(s_idMutex);
+    s_textureSetIds.clear();
+}
+
+void RenderQueue::initialize()
+{
+    SubmitMode preferred = s_preferredMode;
+
+    // Textures bound per draw can't change inside a multi-draw, and without draw parameters the shader can't tell the
+    // commands apart. glMultiDrawElementsIndirect itself is core since 4.3.
+    m_mode = SubmitMode::Direct;
+    if (preferred == SubmitMode::MultiDrawIndirect && GLAD_GL_VERSION_4_3 && GLAD_GL_ARB_shader_draw_parameters && TEXTURE_POOL.isResident()) {
+        m_mode = SubmitMode::MultiDrawIndirect;
+    }
+
+    if (m_mode != preferred) {
+        LOG_WARN("RenderQueue: {} submission needs shader draw parameters and resident textures, using {}", getModeName(preferred), getModeName(m_mode));
+    } else {
+        LOG_INFO("RenderQueue: Using {} submission", getModeName(m_mode));
+    }
+}
+
+const char* RenderQueue::getShaderDefines() const
+{
+    return m_mode == SubmitMode::MultiDrawIndirect ? "#define MULTI_DRAW\n" : "";
+}
+
+void RenderQueue::submit(const Mesh& mesh, std::span<const glm::mat4> transforms, Shader* shader, float viewDepth, RenderPass pass, uint32_t lod)
+{
+    if (transforms.empty()) {
+        return;
+    }
+
+    SortEntry entry;
+    if (m_mode == SubmitMode::MultiDrawIndirect) {
+        entry.key = makeKey(pass, shader->getProgram(), mesh.getGeometry().getVertexArray(), mesh.getTextureSetId(), viewDepth);
+    } else {
+        entry.key = makeKey(pass, shader->getProgram(), mesh.getMaterialId(), mesh.getTextureSetId(), viewDepth);
+    }
+    entry.index = static_cast<uint32_t>(m_items.size());
+
+    uint32_t count = static_cast<uint32_t>(transforms.size());
+    m_items.push_back({&mesh, shader, static_cast<uint32_t>(m_instances.size()), count, lod});
+    m_order.push_back(entry);
+    m_instances.insert(m_instances.end(), transforms.begin(), transforms.end());
+
+    // Drawing every instance mesh by mesh binds the geometry, the material, every texture and the transform each time, and
+    // without LODs every instance is full detail.
+    m_unsortedStats.drawCalls += count;
+    m_unsortedStats.instances += count;
+    m_unsortedStats.triangles += static_cast<uint64_t>(count) * mesh.getTriangleCount();
+    m_unsortedStats.geometryBinds += count;
+    m_unsortedStats.materialBinds += count;
+    m_unsortedStats.textureBinds += count * static_cast<uint32_t>(mesh.getTextureCount());
+    m_unsortedStats.transformUploads += count;
+    m_unsortedStats.shaderBinds = 1;
+}
+
+void RenderQueue::sort()
+{
+    radixSort();
+}
+
+void RenderQueue::radixSort()
+{
+    size_t count = m_order.size();
+    if (count < 2) {
+        return;
+    }
+
+    // One pass over the keys fills every digit's histogram, digits that are the same for all keys are skipped.
+    uint32_t histograms[sizeof(uint64_t)][RADIX_SIZE] = {};
+    for (const auto& entry : m_order) {
+        for (uint32_t digit = 0; digit < sizeof(uint64_t); digit++) {
+            histograms[digit][(entry.key >> (digit * RADIX_BITS)) & (RADIX_SIZE - 1)]++;
+        }
+    }
+
+    m_scratch.resize(count);
+    for (uint32_t digit = 0; digit < sizeof(uint64_t); digit++) {
+        uint32_t* histogram = histograms[digit];
+        uint32_t  shift     = digit * RADIX_BITS;
+        if (histogram[(m_order[0].key >> shift) & (RADIX_SIZE - 1)] == count) {
+            continue;
+        }
+
+        uint32_t offset = 0;
+        for (uint32_t bucket = 0; bucket < RADIX_SIZE; bucket++) {
+            uint32_t size     = histogram[bucket];
+            histogram[bucket] = offset;
+            offset += size;
+        }
+
+        for (const auto& entry : m_order) {
+            m_scratch[histogram[(entry.key >> shift) & (RADIX_SIZE - 1)]++] = entry;
+        }
+        m_order.swap(m_scratch);
+    }
+}
+
+void RenderQueue::execute()
+{
+    Timer timer;
+
+    if (m_instances.empty()) {
+        m_stats.executeMs = timer.getTime() * 1000.0f;
+        return;
+    }
+
+    RingAllocation instances = FRAME_RING.write(m_instances.data(), m_instances.size() * sizeof(glm::mat4));
+    FRAME_RING.bindRange(GL_SHADER_STORAGE_BUFFER, ShaderBinding::INSTANCES, instances);
+    MATERIAL_BUFFER.bindBuffer();
+    TEXTURE_POOL.bind();
+
+    if (m_mode == SubmitMode::MultiDrawIndirect) {
+        executeIndirect();
+    } else {
+        executeDirect();
+    }
+
+    glBindVertexArray(0);
+    glActiveTexture(GL_TEXTURE0);
+
+    m_stats.executeMs = timer.getTime() * 1000.0f;
+}
+
+void RenderQueue::executeDirect()
+{
+    Shader*               boundShader   = nullptr;
+    const Mesh*           boundMesh     = nullptr;
+    const GeometryBuffer* boundGeometry = nullptr;
+    uint32_t              boundInstance = INVALID_ID;
+    uint32_t              boundMaterial = INVALID_ID;
+    Mesh::BoundTextures   boundTextures = {};
+
+    for (const auto& entry : m_order) {
+        const DrawItem& item = m_items[entry.index];
+
+        if (item.shader != boundShader) {
+            // The first instance, vertex decode and material index are plain uniforms and belong to the program, buffer
+            // bindings survive the switch.
+            item.shader->use();
+            boundShader   = item.shader;
+            boundMesh     = nullptr;
+            boundInstance = INVALID_ID;
+            boundMaterial = INVALID_ID;
+            m_stats.shaderBinds++;
+        }
+
+        // The vertex array is shared by all meshes of a model and isn't program state.
+        if (&item.mesh->getGeometry() != boundGeometry) {
+            item.mesh->bindGeometry();
+            boundGeometry = &item.mesh->getGeometry();
+            m_stats.geometryBinds++;
+        }
+
+        // Quantization is per mesh, so only consecutive draws of the same mesh share it.
+        if (item.mesh != boundMesh) {
+            item.mesh->bindVertexFormat();
+            boundMesh = item.mesh;
+        }
+
+        if (item.firstInstance != boundInstance) {
+            item.shader->setInt(ShaderBinding::FIRST_INSTANCE, static_cast<int>(item.firstInstance));
+            boundInstance = item.firstInstance;
+            m_stats.transformUploads++;
+        }
+
+        if (item.mesh->getMaterialId() != boundMaterial) {
+            item.mesh->bindMaterial();
+            boundMaterial = item.mesh->getMaterialId();
+            m_stats.materialBinds++;
+        }
+
+        m_stats.textureBinds += item.mesh->bindTextures(boundTextures);
+
+        item.mesh->drawElements(item.instanceCount, item.lod);
+        m_stats.drawCalls++;
+        m_stats.instances += item.instanceCount;
+        m_stats.triangles += static_cast<uint64_t>(item.instanceCount) * item.mesh->getTriangleCount(item.lod);
+    }
+}
+
+void RenderQueue::executeIndirect()
+{
+    // Commands and their draw blocks are written straight into the ring, command i and draw i belong together.
+    RingAllocation commandRange = FRAME_RING.allocate(m_order.size() * sizeof(IndirectCommand));
+    RingAllocation drawRange    = FRAME_RING.allocate(m_order.size() * sizeof(DrawBlock));
+    auto*          commands     = static_cast<IndirectCommand*>(commandRange.data);
+    auto*          draws        = static_cast<DrawBlock*>(drawRange.data);
+
+    // A new batch starts wherever the program, the vertex array or the texture set changes.
+    m_batches.clear();
+    for (uint32_t i = 0; i < m_order.size(); i++) {
+        const DrawItem&       item     = m_items[m_order[i].index];
+        const GeometryBuffer* geometry = &item.mesh->getGeometry();
+
+        const Batch* last = m_batches.empty() ? nullptr : &m_batches.back();
+        if (!last || last->shader != item.shader || last->geometry != geometry || last->mesh->getTextureSetId() != item.mesh->getTextureSetId()) {
+            m_batches.push_back({item.shader, geometry, item.mesh, i, 0});
+        }
+        m_batches.back().commandCount++;
+
+        commands[i] = item.mesh->getIndirectCommand(item.instanceCount, item.firstInstance, item.lod);
+
+        const VertexQuantization& quantization = item.mesh->getQuantization();
+        DrawBlock&                draw         = draws[i];
+        draw.positionOffset = quantization.offset;
+        draw.vertexFormat   = static_cast<int32_t>(item.mesh->getVertexFormat());
+        draw.positionScale  = quantization.scale;
+        draw.materialIndex  = item.mesh->getMaterialId();
+
+        m_stats.instances += item.instanceCount;
+        m_stats.triangles += static_cast<uint64_t>(item.instanceCount) * item.mesh->getTriangleCount(item.lod);
+    }
+
+    FRAME_RING.bindRange(GL_SHADER_STORAGE_BUFFER, ShaderBinding::DRAWS, drawRange);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandRange.buffer);
+
+    Shader*               boundShader     = nullptr;
+    const GeometryBuffer* boundGeometry   = nullptr;
+    uint32_t              boundTextureSet = INVALID_ID;
+    Mesh::BoundTextures   boundTextures   = {};
+
+    for (const auto& batch : m_batches) {
+        if (batch.shader != boundShader) {
+            batch.shader->use();
+            boundShader     = batch.shader;
+            boundTextureSet = INVALID_ID;
+            m_stats.shaderBinds++;
+        }
+
+        if (batch.geometry != boundGeometry) {
+            batch.geometry->bind();
+            boundGeometry = batch.geometry;
+            m_stats.geometryBinds++;
+        }
+
+        // Slot pools are program uniforms, textures the pool couldn't take are bound like in direct submission.
+        if (batch.mesh->getTextureSetId() != boundTextureSet) {
+            batch.mesh->bindTexturePools();
+            m_stats.textureBinds += batch.mesh->bindTextures(boundTextures);
+            boundTextureSet = batch.mesh->getTextureSetId();
+        }
+
+        // Everything else the commands need is in the draw buffer.
+        batch.shader->setInt(ShaderBinding::FIRST_DRAW, static_cast<int>(batch.firstCommand));
+        m_stats.transformUploads++;
+
+        size_t offset = commandRange.offset + batch.firstCommand * sizeof(IndirectCommand);
+        glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void*)offset, static_cast<GLsizei>(batch.commandCount), 0);
+        m_stats.drawCalls++;
+        m_stats.indirectCommands += batch.commandCount;
+    }
+
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+void RenderQueue::clear()
+{
+    m_items.clear();
+    m_order.clear();
+    m_instances.clear();
+    m_stats         = {};
+    m_unsortedStats = {};
+}
+
+void RenderQueue::setPreferredMode(SubmitMode mode)
+{
+    s_preferredMode = mode;
+}
+
+SubmitMode RenderQueue::getPreferredMode()
+{
+    return s_preferredMode;
+}
+
+const char* RenderQueue::getModeName(SubmitMode mode)
+{
+    switch (mode) {
+    case SubmitMode::MultiDrawIndirect:
+        return "indirect";
+    default:
+        return "direct";
+    }
+}
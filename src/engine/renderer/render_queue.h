@@ -0,0 +1,141 @@
+#ifndef ENGINE_RENDERER_RENDER_QUEUE_H_
+#define ENGINE_RENDERER_RENDER_QUEUE_H_
+
+#include "engine/renderer/geometry/mesh.h"
+#include "engine/renderer/shaders/shader_bindings.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+class Shader;
+
+enum class RenderPass : uint32_t {
+    Opaque,
+    Transparent,
+};
+
+// How execute() hands the sorted draws to GL, best first.
+enum class SubmitMode {
+    Direct,            // One instanced draw per item, with the per-draw state as uniforms
+    MultiDrawIndirect, // Commands in an indirect buffer, one glMultiDrawElementsIndirect per shader and geometry run
+};
+
+// GL state changes issued for a frame. Material binds are material index uniforms, texture binds count glBindTexture
+// calls, with resident textures only those TexturePool couldn't take. Transform uploads are first instance uniforms, the
+// matrices themselves go up in one buffer per frame. Geometry binds are vertex array binds, one per model rather than
+// per mesh. With multi-draw indirect a draw call is one glMultiDrawElementsIndirect, the draws it carries are counted
+// as indirect commands.
+struct RenderStats {
+    uint32_t drawCalls        = 0;
+    uint32_t indirectCommands = 0;
+    uint32_t instances        = 0;
+    uint64_t triangles        = 0; // At the LOD each instance was drawn with
+    uint32_t shaderBinds      = 0;
+    uint32_t geometryBinds    = 0;
+    uint32_t materialBinds    = 0;
+    uint32_t textureBinds     = 0;
+    uint32_t transformUploads = 0;
+    float    executeMs        = 0.0f; // CPU time spent issuing the sorted draws
+
+    uint32_t getStateChanges() const { return shaderBinds + geometryBinds + materialBinds + textureBinds + transformUploads; }
+};
+
+// Collects the frame's draws, sorts them by a packed key and issues GL state only where it differs from the previous draw.
+//
+// Key layout, most significant bits first:
+//   opaque       pass:2 | shader:10 | material:16 | texture set:16 | depth:20   front to back within the same state
+//   transparent  pass:2 | depth:20 (inverted) | shader:10 | material:16 | texture set:16   back to front first
+//
+// The key only decides the order. Redundancy checks use the full ids, so ids that collide in the key never skip a bind.
+// With multi-draw indirect, materials aren't bound per draw anymore, the material field holds the geometry's vertex array
+// instead so that draws sharing one end up next to each other. The texture set still splits multi-draws: it changes with
+// the pool of a slot, whose sampler index has to be the same for the whole call, and with textures bound per draw.
+//
+// A submit with several transforms becomes one instanced draw. Transforms are copied into this frame's FRAME_RING region,
+// which the vertex shader indexes with the first instance uniform (or the command's base instance) plus gl_InstanceID.
+class RenderQueue
+{
+  public:
+    RenderQueue()  = default;
+    ~RenderQueue() = default;
+
+    // Picks the submit mode, after TEXTURE_POOL.initialize(). Multi-draw needs resident textures and shader draw parameters.
+    void initialize();
+
+    // The mesh must stay alive until execute() returns. viewDepth is the distance along the view direction, for
+    // instanced draws the nearest instance's. Transparent meshes should be submitted one instance at a time, since
+    // instances of one draw are blended in submit order. All transforms of one submit draw the same LOD.
+    void submit(const Mesh& mesh, std::span<const glm::mat4> transforms, Shader* shader, float viewDepth, RenderPass pass = RenderPass::Opaque, uint32_t lod = 0);
+    void sort();
+
+    // Expects the camera block to be bound and per-frame uniforms (lights) to be set on every shader already.
+    void execute();
+    void clear();
+
+    size_t getCount() const { return m_items.size(); }
+
+    SubmitMode  getMode() const { return m_mode; }
+    const char* getShaderDefines() const; // For Shader::setDefines, next to the texture pool's
+
+    const RenderStats& getStats() const { return m_stats; }
+    const RenderStats& getUnsortedStats() const { return m_unsortedStats; } // What drawing each instance mesh by mesh at full detail would have cost
+
+    static uint64_t makeKey(RenderPass pass, uint32_t shader, uint32_t material, uint32_t textureSet, float viewDepth);
+
+    // Stable small id for equal texture state, a kind and a value per texture unit (see Mesh::setupMesh). Assigned when a
+    // mesh is created, material ids come from MaterialBuffer. The key only has TEXTURE_SET_BITS for it.
+    static uint32_t getTextureSetId(std::span<const uint64_t> units);
+
+    // Forgets every texture set, together with TEXTURE_POOL.release() once no mesh is left to draw.
+    static void clearTextureSetIds();
+
+    static constexpr uint32_t TEXTURE_SET_BITS = 16;
+
+    // Mode initialize() tries first, multi-draw indirect unless switched back for comparison.
+    static void        setPreferredMode(SubmitMode mode);
+    static SubmitMode  getPreferredMode();
+    static const char* getModeName(SubmitMode mode);
+
+  private:
+    struct DrawItem {
+        const Mesh* mesh          = nullptr;
+        Shader*     shader        = nullptr;
+        uint32_t    firstInstance = 0;
+        uint32_t    instanceCount = 0;
+        uint32_t    lod           = 0;
+    };
+
+    struct SortEntry {
+        uint64_t key   = 0;
+        uint32_t index = 0;
+    };
+
+    // Consecutive commands drawn with one glMultiDrawElementsIndirect. Every mesh in it has the first one's texture set.
+    struct Batch {
+        Shader*               shader       = nullptr;
+        const GeometryBuffer* geometry     = nullptr;
+        const Mesh*           mesh         = nullptr;
+        uint32_t              firstCommand = 0;
+        uint32_t              commandCount = 0;
+    };
+
+    SubmitMode m_mode = SubmitMode::Direct;
+
+    std::vector<DrawItem>  m_items;
+    std::vector<SortEntry> m_order;
+    std::vector<SortEntry> m_scratch;
+    std::vector<glm::mat4> m_instances;
+    std::vector<Batch>     m_batches;
+
+    RenderStats m_stats;
+    RenderStats m_unsortedStats;
+
+    void radixSort();
+    void executeDirect();
+    void executeIndirect();
+};
+
+#endif // ENGINE_RENDERER_RENDER_QUEUE_H_
@@ -4,15 +4,30 @@
 #include "engine/renderer/scene.h"
 #include "engine/renderer/resources/resource_manager.h"
 #include "engine/renderer/shaders/shader.h"
+#include "engine/renderer/shaders/shader_bindings.h"
+#include "engine/renderer/buffers/material_buffer.h"
+#include "engine/renderer/buffers/ring_buffer.h"
+#include "engine/renderer/textures/texture_pool.h"
 #include "engine/renderer/resources/model_resource.h"
 #include "engine/renderer/camera.h"
 #include "engine/renderer/lighting/light_manager.h"
 #include "common/logger.h"
+#include "common/timer.h"
 
 #include <imgui.h>
 
+Renderer::Renderer()
+{
+    //
+}
+
 bool Renderer::initialize()
 {
+    // The texture binding and submit modes decide which variant of the shaders gets compiled.
+    TEXTURE_POOL.initialize();
+    m_renderQueue.initialize();
+    Shader::setDefines(std::string(TEXTURE_POOL.getShaderDefines()) + m_renderQueue.getShaderDefines());
+
     setupShaders();
 
     LOG_INFO("Renderer: Renderer initialized succesfully!");
@@ -23,11 +38,22 @@ void Renderer::shutdown()
 {
     deleteFramebuffer();
     m_pbrShader.reset();
+    if (m_timerQueries[0]) {
+        glDeleteQueries(2, m_timerQueries);
+        m_timerQueries[0] = m_timerQueries[1] = 0;
+    }
+    TEXTURE_POOL.release();
+    RenderQueue::clearTextureSetIds();
+    MATERIAL_BUFFER.release();
+    FRAME_RING.release();
     LOG_INFO("Renderer: Renderer shutdown complete!");
 }
 
 void Renderer::beginFrame()
 {
+    // Everything streamed this frame goes into the next ring region, waits only if the GPU is three frames behind.
+    FRAME_RING.beginFrame();
+
     // glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
     // glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 }
@@ -39,6 +65,8 @@ void Renderer::renderScene(Scene* scene)
         return;
     }
 
+    beginGpuTimer();
+
     Shader* shader = m_pbrShader->getShader();
     shader->use();
 
@@ -48,21 +76,72 @@ void Renderer::renderScene(Scene* scene)
     glm::mat4 projection  = glm::perspective(glm::radians(camera->getZoom()), aspectRatio, DEFAULT_NEAR_PLANE, DEFAULT_FAR_PLANE);
     glm::mat4 view        = camera->getViewMatrix();
 
-    shader->setMat4("projection", projection);
-    shader->setMat4("view", view);
-    shader->setVec3("viewPos", camera->getPosition());
+    CameraBlock cameraBlock;
+    cameraBlock.view           = view;
+    cameraBlock.projection     = projection;
+    cameraBlock.viewProjection = projection * view;
+    cameraBlock.viewPos        = camera->getPosition();
+
+    FRAME_RING.bindRange(GL_UNIFORM_BUFFER, ShaderBinding::CAMERA_BLOCK, FRAME_RING.write(&cameraBlock, sizeof(CameraBlock)));
+
+    LightManager* lightManager = scene->getLightManager();
+    lightManager->bindLightBuffer();
+
+    m_lightClusters.setProjection(glm::radians(camera->getZoom()), aspectRatio, DEFAULT_NEAR_PLANE, DEFAULT_FAR_PLANE);
+    m_lightClusters.assign(lightManager->getPackedLights(), lightManager->getDirectionalCount(), view);
+    m_lightClusters.bind(m_viewportWidth, m_viewportHeight);
+
+    m_viewProjection = projection * view;
+    m_lodSelector.setProjection(glm::radians(camera->getZoom()), static_cast<float>(m_viewportHeight));
+
+    m_renderQueue.clear();
+    submitVisible(scene, view, m_viewProjection, shader);
+
+    m_renderQueue.sort();
+    m_renderQueue.execute();
+
+    endGpuTimer();
+}
+
+void Renderer::beginGpuTimer()
+{
+    if (!m_timerQueries[0]) {
+        glGenQueries(2, m_timerQueries);
+    }
+
+    // The other query was issued last frame, its result is usually there by now.
+    uint32_t previous = m_timerFrame ^ 1;
+    if (m_timerPending[previous]) {
+        GLint available = 0;
+        glGetQueryObjectiv(m_timerQueries[previous], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available) {
+            GLuint64 elapsed = 0;
+            glGetQueryObjectui64v(m_timerQueries[previous], GL_QUERY_RESULT, &elapsed);
+            m_gpuFrameMs             = static_cast<float>(elapsed) / 1000000.0f;
+            m_timerPending[previous] = false;
+        }
+    }
 
-    scene->getLightManager()->updateShaderUniforms(shader);
+    // Still waiting on the last use of this one, skip timing this frame rather than stall.
+    if (!m_timerPending[m_timerFrame]) {
+        glBeginQuery(GL_TIME_ELAPSED, m_timerQueries[m_timerFrame]);
+    }
+}
 
-    for (const auto& [modelResource, transform] : scene->getModels()) {
-        renderModel(modelResource, transform, shader);
+void Renderer::endGpuTimer()
+{
+    if (!m_timerPending[m_timerFrame]) {
+        glEndQuery(GL_TIME_ELAPSED);
+        m_timerPending[m_timerFrame] = true;
     }
+    m_timerFrame ^= 1;
 }
 
 void Renderer::endFrame()
 {
     // Any post rendering cleanup
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    FRAME_RING.endFrame();
 }
 
 void Renderer::setupShaders()
@@ -73,16 +152,80 @@ void Renderer::setupShaders()
     }
 }
 
-void Renderer::renderModel(const std::shared_ptr<ModelResource>& modelResource, const glm::mat4& modelMatrix, Shader* shader)
+void Renderer::submitVisible(Scene* scene, const glm::mat4& view, const glm::mat4& viewProjection, Shader* shader)
 {
-    if (!modelResource || !modelResource->isLoaded()) {
-        return;
+    Timer timer;
+    m_cullStats = {};
+
+    // The scene BVH rejects whole groups of models, only the meshes of the models it returns are tested.
+    m_visibleIndices.clear();
+    scene->queryVisible(viewProjection, m_visibleIndices);
+    std::sort(m_visibleIndices.begin(), m_visibleIndices.end());
+
+    m_meshCuller.setFrustum(viewProjection);
+    m_meshCuller.clear();
+    m_visibleModels.clear();
+
+    const auto& models = scene->getModels();
+    for (uint32_t index : m_visibleIndices) {
+        const auto& [modelResource, transform] = models[index];
+        if (!modelResource || !modelResource->isLoaded()) {
+            continue;
+        }
+
+        const Model* model    = modelResource->getModel();
+        uint32_t     firstBox = static_cast<uint32_t>(m_meshCuller.getCount());
+        model->addMeshBounds(m_meshCuller, transform);
+        m_visibleModels.push_back({model, &transform, firstBox});
     }
+    m_meshCuller.cull();
+
+    uint32_t meshCount = 0;
+    for (const auto& [modelResource, transform] : models) {
+        if (modelResource && modelResource->isLoaded()) {
+            m_cullStats.modelsCulled++;
+            meshCount += static_cast<uint32_t>(modelResource->getModel()->getMeshCount());
+        }
+    }
+
+    m_cullStats.modelsVisible = static_cast<uint32_t>(m_visibleModels.size());
+    m_cullStats.modelsCulled -= m_cullStats.modelsVisible;
+    m_cullStats.meshesVisible = static_cast<uint32_t>(m_meshCuller.getVisibleCount());
+    m_cullStats.meshesCulled  = meshCount - m_cullStats.meshesVisible;
+    m_cullStats.cullMs        = timer.getTime() * 1000.0f;
+
+    // Group copies of the same model, each group becomes one instanced draw per mesh.
+    std::stable_sort(m_visibleModels.begin(), m_visibleModels.end(), [](const VisibleModel& a, const VisibleModel& b) { return a.model < b.model; });
 
-    shader->setMat4("model", modelMatrix);
+    for (size_t first = 0; first < m_visibleModels.size();) {
+        const Model* model = m_visibleModels[first].model;
 
-    Model* model = modelResource->getModel();
-    model->draw(shader);
+        m_instanceTransforms.clear();
+        m_instanceBoxes.clear();
+        size_t last = first;
+        for (; last < m_visibleModels.size() && m_visibleModels[last].model == model; last++) {
+            m_instanceTransforms.push_back(*m_visibleModels[last].transform);
+            m_instanceBoxes.push_back(m_visibleModels[last].firstBox);
+        }
+
+        model->submit(m_renderQueue, m_instanceTransforms, view, shader, &m_meshCuller, m_instanceBoxes, &m_lodSelector);
+        first = last;
+    }
+}
+
+void Renderer::pickModel(Scene* scene, float x, float y)
+{
+    // Viewport pixel to NDC, y points down on screen and up in NDC.
+    float ndcX = 2.0f * x / m_viewportWidth - 1.0f;
+    float ndcY = 1.0f - 2.0f * y / m_viewportHeight;
+
+    glm::mat4 inverse = glm::inverse(m_viewProjection);
+    glm::vec4 near    = inverse * glm::vec4(ndcX, ndcY, -1.0f, 1.0f);
+    glm::vec4 far     = inverse * glm::vec4(ndcX, ndcY, 1.0f, 1.0f);
+
+    glm::vec3 origin = glm::vec3(near) / near.w;
+    glm::vec3 end    = glm::vec3(far) / far.w;
+    m_selectedModel  = scene->pick(origin, end - origin);
 }
 
 void Renderer::renderSceneToViewport(Scene* scene)
@@ -118,12 +261,36 @@ void Renderer::renderSceneToViewport(Scene* scene)
         // Display the framebuffer texture in ImGui
         ImGui::Image(ImTextureRef{m_colorTexture}, viewportSize, ImVec2(0, 1), ImVec2(1, 0));
 
-        // if (ImGui::IsItemHovered() && ImGui::IsMouseClicked(ImGuiMouseButton_Left)) {
-        //     LOG_INFO("Clicked viewport!");
-        // }
+        if (ImGui::IsItemHovered() && ImGui::IsMouseClicked(ImGuiMouseButton_Left)) {
+            ImVec2 mouse = ImGui::GetMousePos();
+            ImVec2 min   = ImGui::GetItemRectMin();
+            pickModel(scene, mouse.x - min.x, mouse.y - min.y);
+        }
+
+        const RenderStats& stats    = m_renderQueue.getStats();
+        const RenderStats& unsorted = m_renderQueue.getUnsortedStats();
 
         ImGui::SetCursorPos(ImVec2(10, 30));
+        ImGui::BeginGroup();
         ImGui::Text("Viewport: %dx%d", m_viewportWidth, m_viewportHeight);
+        ImGui::Text("Draws: %u for %u instances (unsorted %u), state changes: %u (unsorted %u)", stats.drawCalls, stats.instances, unsorted.drawCalls, stats.getStateChanges(),
+                    unsorted.getStateChanges());
+        ImGui::Text("Geometry: %u/%u, materials: %u/%u, textures: %u/%u, transforms: %u/%u", stats.geometryBinds, unsorted.geometryBinds, stats.materialBinds, unsorted.materialBinds,
+                    stats.textureBinds, unsorted.textureBinds, stats.transformUploads, unsorted.transformUploads);
+        ImGui::Text("Textures: %s, %zu resident in %zu pools (%.1f MB)", TexturePool::getModeName(TEXTURE_POOL.getMode()), TEXTURE_POOL.getCount(), TEXTURE_POOL.getPoolCount(),
+                    TEXTURE_POOL.getMemoryUsage() / (1024.0f * 1024.0f));
+        ImGui::Text("Submit: %s, %u indirect commands in %u calls", RenderQueue::getModeName(m_renderQueue.getMode()), stats.indirectCommands, stats.drawCalls);
+        ImGui::Text("Frame ring: %.0f of %.0f KB, %u stalls, waited %.2f ms", FRAME_RING.getUsed() / 1024.0f, FRAME_RING.getFrameSize() / 1024.0f, FRAME_RING.getStallCount(),
+                    FRAME_RING.getWaitMs());
+        ImGui::Text("Execute: %.3f ms (%.2f us/draw), GPU: %.2f ms", stats.executeMs, stats.drawCalls ? stats.executeMs * 1000.0f / stats.drawCalls : 0.0f, m_gpuFrameMs);
+        ImGui::Text("Triangles: %.2fM (%.2fM at full detail), %.0fM/s", stats.triangles / 1000000.0, unsorted.triangles / 1000000.0,
+                    m_gpuFrameMs > 0.0f ? stats.triangles / (m_gpuFrameMs * 1000.0) : 0.0);
+        ImGui::Text("Culling: %.3f ms, models %u/%u, meshes %u/%u visible", m_cullStats.cullMs, m_cullStats.modelsVisible, m_cullStats.modelsVisible + m_cullStats.modelsCulled,
+                    m_cullStats.meshesVisible, m_cullStats.meshesVisible + m_cullStats.meshesCulled);
+        ImGui::Text("Selected model: %d", m_selectedModel);
+        ImGui::Text("Light clusters: %.3f ms, %zu assignments, max %u per cluster", m_lightClusters.getAssignMs(), m_lightClusters.getLightIndices().size(),
+                    m_lightClusters.getMaxLightsPerCluster());
+        ImGui::EndGroup();
     }
 
     ImGui::End();
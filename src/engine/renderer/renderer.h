@@ -1,6 +1,10 @@
 #ifndef ENGINE_RENDERER_RENDERER_H_
 #define ENGINE_RENDERER_RENDERER_H_
 
+#include "engine/renderer/render_queue.h"
+#include "engine/renderer/lighting/light_clusters.h"
+#include "engine/renderer/culling/frustum_culler.h"
+#include "engine/renderer/geometry/mesh_lod.h"
 #include "engine/renderer/resources/shader_resource.h"
 
 #include <memory>
@@ -8,11 +12,12 @@
 struct ImVec2;
 
 class Scene;
+class Model;
 
 class Renderer
 {
   public:
-    Renderer()  = default;
+    Renderer();
     ~Renderer() = default;
 
     bool initialize();
@@ -26,8 +31,41 @@ class Renderer
     ImVec2 getViewportSize() const;
     float  getViewportAspectRatio() const;
 
+    const RenderStats& getRenderStats() const { return m_renderQueue.getStats(); }
+    float              getGpuFrameMs() const { return m_gpuFrameMs; }
+    const CullStats&   getCullStats() const { return m_cullStats; }
+    int                getSelectedModel() const { return m_selectedModel; }
+    LodSelector&       getLodSelector() { return m_lodSelector; }
+
   private:
     std::shared_ptr<ShaderResource> m_pbrShader;
+    RenderQueue                     m_renderQueue;
+    LightClusters                   m_lightClusters;
+
+    // Models are culled through the scene BVH first, only the meshes of visible models are tested. Visible models
+    // that share a Model are then submitted together as instances.
+    struct VisibleModel {
+        const Model*     model     = nullptr;
+        const glm::mat4* transform = nullptr;
+        uint32_t         firstBox  = 0;
+    };
+
+    FrustumCuller             m_meshCuller;
+    std::vector<uint32_t>     m_visibleIndices;
+    std::vector<VisibleModel> m_visibleModels;
+    std::vector<glm::mat4>    m_instanceTransforms;
+    std::vector<uint32_t>     m_instanceBoxes;
+    CullStats                 m_cullStats;
+    LodSelector               m_lodSelector;
+
+    glm::mat4 m_viewProjection = glm::mat4(1.0f); // Of the last rendered frame, for picking
+    int       m_selectedModel  = -1;
+
+    // GPU time of renderScene, read a frame late from alternating queries so the CPU never waits on them.
+    uint32_t m_timerQueries[2] = {};
+    bool     m_timerPending[2] = {};
+    uint32_t m_timerFrame      = 0;
+    float    m_gpuFrameMs      = 0.0f;
 
     int m_viewportWidth  = 1280;
     int m_viewportHeight = 720;
@@ -44,7 +82,10 @@ class Renderer
     int      m_framebufferHeight = 0;
 
     void setupShaders();
-    void renderModel(const std::shared_ptr<class ModelResource>& model, const glm::mat4& modelMatrix, class Shader* shader);
+    void submitVisible(Scene* scene, const glm::mat4& view, const glm::mat4& viewProjection, class Shader* shader);
+    void pickModel(Scene* scene, float x, float y);
+    void beginGpuTimer();
+    void endGpuTimer();
     void createFramebuffer(int width, int height);
     void deleteFramebuffer();
 };
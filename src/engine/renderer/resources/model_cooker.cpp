@@ -0,0 +1,347 @@
+#include "pch.h"
+
+#include "engine/renderer/resources/model_cooker.h"
+#include "engine/renderer/resources/texture_cache.h"
+#include "engine/core/path_id.h"
+#include "common/file.h"
+#include "common/logger.h"
+
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <unordered_set>
+
+namespace
+{
+    const char* COOKED_DIRECTORY = "cache/models";
+
+    constexpr uint64_t alignOffset(uint64_t offset)
+    {
+        return (offset + 15) & ~uint64_t(15);
+    }
+
+    bool isHeaderValid(const CookedModelHeader& header)
+    {
+        return header.magic == ModelCooker::MAGIC && header.version == ModelCooker::VERSION && header.vertexSize == sizeof(Vertex) && header.materialSize == sizeof(Material);
+    }
+} // namespace
+
+bool CookedModel::open(const std::string& path)
+{
+    if (!m_file.open(path)) {
+        return false;
+    }
+
+    const uint8_t* data = m_file.getData();
+    size_t         size = m_file.getSize();
+
+    if (size < sizeof(CookedModelHeader)) {
+        LOG_ERROR("CookedModel: {} is truncated.", path);
+        close();
+        return false;
+    }
+
+    m_header = reinterpret_cast<const CookedModelHeader*>(data);
+    if (!isHeaderValid(*m_header)) {
+        LOG_WARN("CookedModel: {} was cooked with a different version.", path);
+        close();
+        return false;
+    }
+
+    if (m_header->meshTableOffset + m_header->meshCount * sizeof(CookedMesh) > size || m_header->textureTableOffset + m_header->textureCount * sizeof(CookedTexture) > size ||
+        m_header->stringTableOffset + m_header->stringTableSize > size) {
+        LOG_ERROR("CookedModel: {} has out of range tables.", path);
+        close();
+        return false;
+    }
+
+    m_meshes   = reinterpret_cast<const CookedMesh*>(data + m_header->meshTableOffset);
+    m_textures = reinterpret_cast<const CookedTexture*>(data + m_header->textureTableOffset);
+    m_strings  = reinterpret_cast<const char*>(data + m_header->stringTableOffset);
+
+    for (uint32_t i = 0; i < m_header->meshCount; i++) {
+        const CookedMesh& mesh = m_meshes[i];
+        if (mesh.vertexOffset + mesh.vertexCount * sizeof(Vertex) > size || mesh.indexOffset + mesh.indexCount * sizeof(uint32_t) > size ||
+            mesh.firstTexture + mesh.textureCount > m_header->textureCount || mesh.lodCount > MeshLod::MAX_COUNT) {
+            LOG_ERROR("CookedModel: {} has an out of range mesh {}.", path, i);
+            close();
+            return false;
+        }
+
+        for (uint32_t lod = 0; lod < mesh.lodCount; lod++) {
+            if (static_cast<uint64_t>(mesh.lods[lod].firstIndex) + mesh.lods[lod].indexCount > mesh.indexCount) {
+                LOG_ERROR("CookedModel: {} has an out of range LOD {} in mesh {}.", path, lod, i);
+                close();
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+std::span<const Vertex> CookedModel::getVertices(uint32_t mesh) const
+{
+    const CookedMesh& cooked = m_meshes[mesh];
+    return {reinterpret_cast<const Vertex*>(m_file.getData() + cooked.vertexOffset), cooked.vertexCount};
+}
+
+std::span<const uint32_t> CookedModel::getIndices(uint32_t mesh) const
+{
+    const CookedMesh& cooked = m_meshes[mesh];
+    return {reinterpret_cast<const uint32_t*>(m_file.getData() + cooked.indexOffset), cooked.indexCount};
+}
+
+std::vector<ImportedTexture> CookedModel::getTextures(uint32_t mesh) const
+{
+    const CookedMesh&            cooked = m_meshes[mesh];
+    std::vector<ImportedTexture> textures;
+    textures.reserve(cooked.textureCount);
+
+    for (uint32_t i = 0; i < cooked.textureCount; i++) {
+        const CookedTexture& texture = m_textures[cooked.firstTexture + i];
+        textures.emplace_back(static_cast<aiTextureType>(texture.type), getString(texture.pathOffset, texture.pathLength));
+    }
+
+    return textures;
+}
+
+std::string_view CookedModel::getString(uint32_t offset, uint32_t length) const
+{
+    if (offset + length > m_header->stringTableSize) {
+        return {};
+    }
+    return std::string_view(m_strings + offset, length);
+}
+
+std::string ModelCooker::getCookedPath(const std::string& sourcePath)
+{
+    // Same naming as TextureCache::getCachePath, flat and keyed by the PathId of the source.
+    std::string canonical = PathId::normalize(sourcePath);
+    std::string name      = std::filesystem::path(canonical).stem().string();
+    return std::format("{}/{}_{:016x}.emdl", COOKED_DIRECTORY, name, PathId(canonical).getValue());
+}
+
+std::vector<std::string> ModelCooker::collectDependencies(const std::string& sourcePath)
+{
+    std::vector<std::string> dependencies = {sourcePath};
+
+    // glTF keeps its geometry in external .bin buffers next to the .gltf.
+    std::filesystem::path source(sourcePath);
+    if (source.extension() == ".gltf" && source.has_parent_path()) {
+        std::error_code error;
+        for (const auto& entry : std::filesystem::directory_iterator(source.parent_path(), error)) {
+            if (entry.is_regular_file() && entry.path().extension() == ".bin") {
+                dependencies.push_back(entry.path().generic_string());
+            }
+        }
+        std::sort(dependencies.begin() + 1, dependencies.end());
+    }
+
+    return dependencies;
+}
+
+bool ModelCooker::isUpToDate(const std::string& sourcePath, const std::string& cookedPath)
+{
+    std::ifstream file(cookedPath, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+
+    CookedModelHeader header;
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) || !isHeaderValid(header)) {
+        return false;
+    }
+
+    auto dependencies = collectDependencies(sourcePath);
+    if (dependencies.size() != header.dependencyCount) {
+        return false;
+    }
+
+    std::vector<CookedDependency> cookedDependencies(header.dependencyCount);
+    std::string                   strings(header.stringTableSize, '\0');
+
+    file.seekg(header.dependencyTableOffset);
+    file.read(reinterpret_cast<char*>(cookedDependencies.data()), cookedDependencies.size() * sizeof(CookedDependency));
+    file.seekg(header.stringTableOffset);
+    file.read(strings.data(), strings.size());
+    if (!file) {
+        return false;
+    }
+
+    for (size_t i = 0; i < dependencies.size(); i++) {
+        const CookedDependency& cooked = cookedDependencies[i];
+        if (cooked.pathOffset + cooked.pathLength > strings.size() || strings.compare(cooked.pathOffset, cooked.pathLength, dependencies[i]) != 0) {
+            return false;
+        }
+
+        int64_t  writeTime = 0;
+        uint64_t fileSize  = 0;
+        if (!FileSystem::getFileInfo(dependencies[i], writeTime, fileSize) || writeTime != cooked.writeTime || fileSize != cooked.fileSize) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool ModelCooker::cookDirectory(const std::string& directory, bool force)
+{
+    std::error_code error;
+    if (!std::filesystem::is_directory(directory, error)) {
+        LOG_ERROR("ModelCooker: {} is not a directory", directory);
+        return false;
+    }
+
+    TextureCache                    textureCache;
+    std::unordered_set<std::string> cookedTextures; // Shared between models
+    bool                            success = true;
+    for (const auto& entry : std::filesystem::recursive_directory_iterator(directory, error)) {
+        auto extension = entry.path().extension();
+        if (!entry.is_regular_file() || (extension != ".gltf" && extension != ".glb" && extension != ".fbx")) {
+            continue;
+        }
+
+        std::string sourcePath = entry.path().generic_string();
+        std::string cookedPath = getCookedPath(sourcePath);
+        if (!force && isUpToDate(sourcePath, cookedPath)) {
+            LOG_INFO("ModelCooker: {} is up to date", cookedPath);
+            continue;
+        }
+
+        ImportedModel imported;
+        ModelImporter importer;
+        if (!importer.import(sourcePath, imported) || !cook(sourcePath, imported, cookedPath)) {
+            LOG_ERROR("ModelCooker: Failed to cook {}", sourcePath);
+            success = false;
+            continue;
+        }
+
+        // Its textures go into the texture cache, so the first run doesn't build their mips either.
+        for (const auto& mesh : imported.meshes) {
+            for (const auto& texture : mesh.textures) {
+                std::string texturePath = imported.directory + '/' + std::string(texture.path);
+                if (cookedTextures.insert(texturePath).second && !textureCache.cook(texturePath, texture.getRole(), force)) {
+                    LOG_ERROR("ModelCooker: Failed to cook texture {}", texturePath);
+                    success = false;
+                }
+            }
+        }
+    }
+
+    return success;
+}
+
+bool ModelCooker::cook(const std::string& sourcePath, const ImportedModel& model, const std::string& cookedPath)
+{
+    std::string strings;
+    auto        addString = [&strings](std::string_view value, uint32_t& offset, uint32_t& length) {
+        offset = static_cast<uint32_t>(strings.size());
+        length = static_cast<uint32_t>(value.size());
+        strings += value;
+    };
+
+    CookedModelHeader header = {};
+    header.magic             = MAGIC;
+    header.version           = VERSION;
+    header.vertexSize        = sizeof(Vertex);
+    header.materialSize      = sizeof(Material);
+    addString(model.directory, header.directoryOffset, header.directoryLength);
+
+    auto                          dependencyPaths = collectDependencies(sourcePath);
+    std::vector<CookedDependency> dependencies(dependencyPaths.size());
+    for (size_t i = 0; i < dependencyPaths.size(); i++) {
+        if (!FileSystem::getFileInfo(dependencyPaths[i], dependencies[i].writeTime, dependencies[i].fileSize)) {
+            LOG_ERROR("ModelCooker: Can't stat dependency {}", dependencyPaths[i]);
+            return false;
+        }
+        addString(dependencyPaths[i], dependencies[i].pathOffset, dependencies[i].pathLength);
+    }
+
+    std::vector<CookedMesh>    meshes(model.meshes.size());
+    std::vector<CookedTexture> textures;
+    for (size_t i = 0; i < model.meshes.size(); i++) {
+        const ImportedMesh& mesh = model.meshes[i];
+
+        meshes[i].vertexCount  = static_cast<uint32_t>(mesh.vertices.size());
+        meshes[i].indexCount   = static_cast<uint32_t>(mesh.indices.size());
+        meshes[i].firstTexture = static_cast<uint32_t>(textures.size());
+        meshes[i].textureCount = static_cast<uint32_t>(mesh.textures.size());
+        meshes[i].lodCount     = static_cast<uint32_t>(std::min<size_t>(mesh.lods.size(), MeshLod::MAX_COUNT));
+        meshes[i].material     = mesh.material;
+        std::copy_n(mesh.lods.begin(), meshes[i].lodCount, meshes[i].lods);
+
+        for (const auto& texture : mesh.textures) {
+            CookedTexture cooked;
+            cooked.type = static_cast<uint32_t>(texture.type);
+            addString(texture.path, cooked.pathOffset, cooked.pathLength);
+            textures.push_back(cooked);
+        }
+    }
+
+    header.dependencyCount = static_cast<uint32_t>(dependencies.size());
+    header.meshCount       = static_cast<uint32_t>(meshes.size());
+    header.textureCount    = static_cast<uint32_t>(textures.size());
+
+    header.dependencyTableOffset = alignOffset(sizeof(CookedModelHeader));
+    header.meshTableOffset       = alignOffset(header.dependencyTableOffset + dependencies.size() * sizeof(CookedDependency));
+    header.textureTableOffset    = alignOffset(header.meshTableOffset + meshes.size() * sizeof(CookedMesh));
+    header.stringTableOffset     = alignOffset(header.textureTableOffset + textures.size() * sizeof(CookedTexture));
+    header.stringTableSize       = strings.size();
+
+    uint64_t offset = alignOffset(header.stringTableOffset + header.stringTableSize);
+    for (size_t i = 0; i < meshes.size(); i++) {
+        meshes[i].vertexOffset = offset;
+        offset                 = alignOffset(offset + meshes[i].vertexCount * sizeof(Vertex));
+        meshes[i].indexOffset  = offset;
+        offset                 = alignOffset(offset + meshes[i].indexCount * sizeof(uint32_t));
+    }
+
+    std::error_code error;
+    std::filesystem::create_directories(std::filesystem::path(cookedPath).parent_path(), error);
+
+    // Write to a temporary file first so a crash mid-write never leaves a valid looking blob behind.
+    std::string   tempPath = cookedPath + ".tmp";
+    std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        LOG_ERROR("ModelCooker: Can't open {} for writing", tempPath);
+        return false;
+    }
+
+    auto writeAt = [&file](uint64_t offset, const void* data, size_t size) {
+        static const char padding[16] = {};
+        uint64_t          position    = static_cast<uint64_t>(file.tellp());
+        if (offset > position) {
+            file.write(padding, offset - position);
+        }
+        file.write(static_cast<const char*>(data), size);
+    };
+
+    writeAt(0, &header, sizeof(header));
+    writeAt(header.dependencyTableOffset, dependencies.data(), dependencies.size() * sizeof(CookedDependency));
+    writeAt(header.meshTableOffset, meshes.data(), meshes.size() * sizeof(CookedMesh));
+    writeAt(header.textureTableOffset, textures.data(), textures.size() * sizeof(CookedTexture));
+    writeAt(header.stringTableOffset, strings.data(), strings.size());
+
+    for (size_t i = 0; i < meshes.size(); i++) {
+        writeAt(meshes[i].vertexOffset, model.meshes[i].vertices.data(), meshes[i].vertexCount * sizeof(Vertex));
+        writeAt(meshes[i].indexOffset, model.meshes[i].indices.data(), meshes[i].indexCount * sizeof(uint32_t));
+    }
+
+    file.close();
+    if (!file) {
+        LOG_ERROR("ModelCooker: Failed writing {}", tempPath);
+        std::filesystem::remove(tempPath, error);
+        return false;
+    }
+
+    std::filesystem::rename(tempPath, cookedPath, error);
+    if (error) {
+        LOG_ERROR("ModelCooker: Failed to move {} into place - {}", cookedPath, error.message());
+        std::filesystem::remove(tempPath, error);
+        return false;
+    }
+
+    LOG_INFO("ModelCooker: Cooked {} -> {} ({} meshes, {:.2f} MB)", sourcePath, cookedPath, meshes.size(), offset / (1024.0 * 1024.0));
+    return true;
+}
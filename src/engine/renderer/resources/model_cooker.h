@@ -0,0 +1,114 @@
+#ifndef ENGINE_RENDERER_MODEL_COOKER_H_
+#define ENGINE_RENDERER_MODEL_COOKER_H_
+
+#include "engine/renderer/geometry/mesh.h"
+#include "engine/renderer/geometry/model_importer.h"
+#include "common/mapped_file.h"
+
+#include <span>
+#include <string>
+#include <vector>
+
+// Cooked model blob (.emdl), everything is little endian and 16 byte aligned:
+//
+//   CookedModelHeader
+//   CookedDependency[dependencyCount]   source files the blob was built from
+//   CookedMesh[meshCount]
+//   CookedTexture[textureCount]
+//   string table                        not null terminated, referenced by offset/length
+//   vertex data                         Vertex[], same layout as the VBO
+//   index data                          uint32_t[], same layout as the EBO, every LOD of the mesh one after the other
+
+struct CookedModelHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t vertexSize;
+    uint32_t materialSize;
+    uint32_t dependencyCount;
+    uint32_t meshCount;
+    uint32_t textureCount;
+    uint32_t directoryOffset;
+    uint32_t directoryLength;
+    uint32_t padding;
+    uint64_t dependencyTableOffset;
+    uint64_t meshTableOffset;
+    uint64_t textureTableOffset;
+    uint64_t stringTableOffset;
+    uint64_t stringTableSize;
+};
+
+struct CookedDependency {
+    int64_t  writeTime;
+    uint64_t fileSize;
+    uint32_t pathOffset;
+    uint32_t pathLength;
+};
+
+struct CookedMesh {
+    uint64_t vertexOffset;
+    uint64_t indexOffset;
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    uint32_t firstTexture;
+    uint32_t textureCount;
+    uint32_t lodCount;
+    uint32_t padding;
+    MeshLod  lods[MeshLod::MAX_COUNT]; // Index ranges relative to the mesh's index data
+    Material material;
+};
+
+struct CookedTexture {
+    uint32_t type;
+    uint32_t pathOffset;
+    uint32_t pathLength;
+};
+
+// Read-only view over a memory mapped .emdl file. Spans point straight into the mapping.
+class CookedModel
+{
+  public:
+    CookedModel()  = default;
+    ~CookedModel() = default;
+
+    bool open(const std::string& path);
+    void close() { m_file.close(); }
+
+    uint32_t                     getMeshCount() const { return m_header->meshCount; }
+    std::span<const Vertex>      getVertices(uint32_t mesh) const;
+    std::span<const uint32_t>    getIndices(uint32_t mesh) const;
+    std::span<const MeshLod>     getLods(uint32_t mesh) const { return {m_meshes[mesh].lods, m_meshes[mesh].lodCount}; }
+    const Material&              getMaterial(uint32_t mesh) const { return m_meshes[mesh].material; }
+    std::vector<ImportedTexture> getTextures(uint32_t mesh) const;
+    std::string                  getDirectory() const { return std::string(getString(m_header->directoryOffset, m_header->directoryLength)); }
+
+  private:
+    std::string_view getString(uint32_t offset, uint32_t length) const;
+
+    MappedFile               m_file;
+    const CookedModelHeader* m_header   = nullptr;
+    const CookedMesh*        m_meshes   = nullptr;
+    const CookedTexture*     m_textures = nullptr;
+    const char*              m_strings  = nullptr;
+};
+
+class ModelCooker
+{
+  public:
+    ModelCooker()  = default;
+    ~ModelCooker() = default;
+
+    static std::string getCookedPath(const std::string& sourcePath);
+
+    bool cook(const std::string& sourcePath, const ImportedModel& model, const std::string& cookedPath);
+    // Cooks every model under the directory together with the textures it references.
+    bool cookDirectory(const std::string& directory, bool force = false);
+    bool isUpToDate(const std::string& sourcePath, const std::string& cookedPath);
+
+    static constexpr uint32_t MAGIC   = 0x4C444D45; // "EMDL"
+    static constexpr uint32_t VERSION = 3; // 2: meshes are stored optimized, 3: LOD chains
+
+  private:
+    std::vector<std::string> collectDependencies(const std::string& sourcePath);
+};
+
+#endif // ENGINE_RENDERER_MODEL_COOKER_H_
@@ -2,6 +2,8 @@
 
 #include "engine/renderer/resources/model_resource.h"
 #include "common/logger.h"
+#include "common/memory_usage.h"
+#include "common/timer.h"
 
 bool ModelResource::load(const std::string& path)
 {
@@ -10,12 +12,54 @@ bool ModelResource::load(const std::string& path)
         return true;
     }
 
+    return decode(path) && upload();
+}
+
+bool ModelResource::decode(const std::string& path)
+{
     m_path = path;
 
     try {
-        m_model = std::make_unique<Model>(path);
+        Timer       timer;
+        ModelCooker cooker;
+        std::string cookedPath = ModelCooker::getCookedPath(path);
+
+        if (cooker.isUpToDate(path, cookedPath)) {
+            auto cooked = std::make_unique<CookedModel>();
+            if (cooked->open(cookedPath)) {
+                for (uint32_t i = 0; i < cooked->getMeshCount(); i++) {
+                    prefetchTextures(cooked->getDirectory(), cooked->getTextures(i));
+                }
+
+                m_cooked   = std::move(cooked);
+                m_decodeMs = timer.getTime() * 1000.0f;
+                return true;
+            }
+        }
+
+        auto          imported = std::make_unique<ImportedModel>();
+        ModelImporter importer;
+        if (!importer.import(path, *imported)) {
+            LOG_ERROR("ModelResource: Failed to import model: {}", path);
+            return false;
+        }
+
+        const ImportStats& stats = imported->stats;
+        LOG_INFO("ModelResource: Optimized {} in {:.2f}ms - ACMR {:.3f} -> {:.3f}, ATVR {:.3f} -> {:.3f}", path, stats.optimizeMs, stats.cacheBefore.getAcmr(), stats.cacheAfter.getAcmr(),
+                 stats.cacheBefore.getAtvr(), stats.cacheAfter.getAtvr());
+        LOG_INFO("ModelResource: Built {} LODs for {} meshes of {} in {:.2f}ms", stats.lodCount, stats.meshCount, path, stats.lodMs);
+        LOG_INFO("ModelResource: Import arena served {} allocations ({:.1f} MB) from {} blocks ({:.1f} MB)", stats.arenaAllocations, MemoryUsage::toMegabytes(stats.arenaBytes),
+                 stats.arenaBlockAllocations, MemoryUsage::toMegabytes(stats.arenaBlockBytes));
 
-        LOG_INFO("ModelResource: Loaded model {}", path);
+        // Cook before the upload releases the import's geometry.
+        cooker.cook(path, *imported, cookedPath);
+
+        for (const auto& mesh : imported->meshes) {
+            prefetchTextures(imported->directory, mesh.textures);
+        }
+
+        m_imported = std::move(imported);
+        m_decodeMs = timer.getTime() * 1000.0f;
         return true;
     } catch (const std::exception& e) {
         LOG_ERROR("ModelResource: Failed to load model: {} - Error: {}", path, e.what());
@@ -23,10 +67,58 @@ bool ModelResource::load(const std::string& path)
     }
 }
 
+bool ModelResource::upload()
+{
+    try {
+        Timer timer;
+
+        // Textures come out of the cache here, either already uploaded by processUploads or finished on the spot.
+        if (m_cooked) {
+            m_model = std::make_unique<Model>(*m_cooked);
+            LOG_INFO("ModelResource: Loaded cooked model {} (decode {:.2f}ms, upload {:.2f}ms) - {:.1f} MB, process peak {:.1f} MB", m_path, m_decodeMs, timer.getTime() * 1000.0f,
+                     MemoryUsage::toMegabytes(m_model->getMemoryUsage()), MemoryUsage::toMegabytes(MemoryUsage::getPeakPrivateBytes()));
+        } else if (m_imported) {
+            m_model = std::make_unique<Model>(*m_imported);
+            LOG_INFO("ModelResource: Loaded model {} (decode {:.2f}ms, upload {:.2f}ms) - {:.1f} MB, process peak {:.1f} MB", m_path, m_decodeMs, timer.getTime() * 1000.0f,
+                     MemoryUsage::toMegabytes(m_model->getMemoryUsage()), MemoryUsage::toMegabytes(MemoryUsage::getPeakPrivateBytes()));
+        }
+    } catch (const std::exception& e) {
+        LOG_ERROR("ModelResource: Failed to upload model: {} - Error: {}", m_path, e.what());
+    }
+
+    m_cooked.reset();
+    m_imported.reset();
+    m_textureLoads.clear();
+    m_requestedTextures.clear();
+
+    m_generation++;
+    return m_model != nullptr;
+}
+
+bool ModelResource::isReadyToUpload() const
+{
+    for (const auto& load : m_textureLoads) {
+        if (load.isPending()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void ModelResource::prefetchTextures(const std::string& directory, std::span<const ImportedTexture> slots)
+{
+    for (const auto& slot : slots) {
+        if (m_requestedTextures.insert(PathId(directory, slot.path)).second) {
+            m_textureLoads.push_back(RESOURCE_MANAGER.getTextureAsync(directory + '/' + std::string(slot.path), slot.getRole()));
+        }
+    }
+}
+
 void ModelResource::unload()
 {
     if (m_model) {
         m_model.reset();
+        m_generation++;
         LOG_DEBUG("Unloaded model: {}", m_path);
     }
 }
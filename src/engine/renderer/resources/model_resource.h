@@ -3,8 +3,14 @@
 
 #include "engine/core/resource.h"
 #include "engine/renderer/geometry/model.h"
+#include "engine/renderer/resources/model_cooker.h"
+#include "engine/renderer/resources/resource_manager.h"
+#include "engine/renderer/resources/texture_resource.h"
 
 #include <memory>
+#include <span>
+#include <unordered_set>
+#include <vector>
 
 class ModelResource : public IResource
 {
@@ -13,13 +19,33 @@ class ModelResource : public IResource
     ~ModelResource() override = default;
 
     bool load(const std::string& path) override;
+    bool decode(const std::string& path) override;
+    bool upload() override;
+    bool isReadyToUpload() const override;
     void unload() override;
     bool isLoaded() const override { return m_model != nullptr; }
 
+    size_t getMemoryUsage() const override { return m_model ? m_model->getMemoryUsage() : 0; }
+
     Model* getModel() const { return m_model.get(); }
 
+    // Changes whenever the model is uploaded or unloaded, so holders of its bounds can tell a reload apart from no change.
+    uint32_t getGeneration() const { return m_generation; }
+
   private:
+    void prefetchTextures(const std::string& directory, std::span<const ImportedTexture> slots);
+
     std::unique_ptr<Model> m_model;
+    uint32_t               m_generation = 0;
+
+    // Output of decode(), one of the two is set until upload() builds the model.
+    std::unique_ptr<CookedModel>   m_cooked;
+    std::unique_ptr<ImportedModel> m_imported;
+
+    // Texture loads started by decode() so they decode in parallel with each other, released after upload().
+    std::vector<ResourceHandle<TextureResource>> m_textureLoads;
+    std::unordered_set<PathId, PathId::Hash>     m_requestedTextures;
+    float                                        m_decodeMs = 0.0f;
 };
 
 #endif // ENGINE_RENDERER_MODEL_RESOURCE_H_
\ No newline at end of file
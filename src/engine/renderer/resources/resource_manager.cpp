@@ -5,63 +5,317 @@
 #include "engine/renderer/resources/shader_resource.h"
 #include "engine/renderer/resources/model_resource.h"
 
+#include "engine/core/thread_pool.h"
+
 #include "common/logger.h"
 
 template <typename T> std::shared_ptr<T> ResourceCache<T>::get(const std::string& path, ResourceCreator creator)
 {
-    std::lock_guard<std::mutex> lock(m_mutex);
+    PathId  id(path);
+    LoadPtr load;
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
 
-    cleanup();
+        reclaimExpired();
 
-    auto it = m_resources.find(path);
-    if (it != m_resources.end()) {
-        if (auto resource = it->second.lock()) {
-            LOG_DEBUG("ResourceCache: Retrieved cached resource: {}", path);
+        if (auto resource = findLoaded(id)) {
+            LOG_TRACE("ResourceCache: Retrieved cached resource: {}", path);
             return resource;
+        }
+
+        auto it = m_loading.find(id);
+        if (it == m_loading.end()) {
+            load = createLoad(path, id, creator);
+            if (!load) {
+                LOG_ERROR("ResourceCache: Failed to create resource: {}", path);
+                return nullptr;
+            }
         } else {
-            m_resources.erase(it);
+            // Someone else is already loading it, wait for the decode and take over the upload.
+            load = it->second;
+            load->decodedCv.wait(lock, [&]() { return load->decoded; });
+            if (load->state != ResourceState::Pending) {
+                return load->state == ResourceState::Ready ? load->resource : nullptr;
+            }
+
+            std::erase(m_uploadQueue, load);
+            lock.unlock();
+
+            finishUpload(load);
+            return load->state == ResourceState::Ready ? load->resource : nullptr;
+        }
+    }
+
+    // The lock is released for the load itself, lookups of other paths don't wait on it.
+    bool ok = false;
+    try {
+        ok = load->resource->load(path);
+    } catch (const std::exception& e) {
+        LOG_ERROR("ResourceCache: Exception while loading {} - {}", path, e.what());
+    }
+
+    complete(load, ok);
+    return ok ? load->resource : nullptr;
+}
+
+template <typename T> ResourceHandle<T> ResourceCache<T>::getAsync(const std::string& path, ResourceCreator creator)
+{
+    PathId  id(path);
+    LoadPtr load;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        reclaimExpired();
+
+        if (auto resource = findLoaded(id)) {
+            auto ready      = std::make_shared<ResourceLoad<T>>();
+            ready->path     = path;
+            ready->id       = id;
+            ready->resource = resource;
+            ready->state    = ResourceState::Ready;
+            ready->decoded  = true;
+            ready->decodeOk = true;
+            return ResourceHandle<T>(ready);
+        }
+
+        auto it = m_loading.find(id);
+        if (it != m_loading.end()) {
+            return ResourceHandle<T>(it->second);
+        }
+
+        load = createLoad(path, id, creator);
+        if (!load) {
+            LOG_ERROR("ResourceCache: Failed to create resource: {}", path);
+            return ResourceHandle<T>();
+        }
+    }
+
+    THREAD_POOL.submit([this, load]() {
+        bool ok = false;
+        try {
+            ok = load->resource->decode(load->path);
+        } catch (const std::exception& e) {
+            LOG_ERROR("ResourceCache: Exception while decoding {} - {}", load->path, e.what());
+        }
+        finishDecode(load, ok);
+    });
+
+    return ResourceHandle<T>(load);
+}
+
+template <typename T> void ResourceCache<T>::processUploads()
+{
+    std::vector<LoadPtr> ready;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        std::vector<LoadPtr> waiting;
+        for (auto& load : m_uploadQueue) {
+            if (load->resource->isReadyToUpload()) {
+                ready.push_back(std::move(load));
+            } else {
+                waiting.push_back(std::move(load));
+            }
+        }
+        m_uploadQueue.swap(waiting);
+    }
+
+    for (const auto& load : ready) {
+        finishUpload(load);
+    }
+
+    trimToBudget();
+}
+
+template <typename T> std::shared_ptr<T> ResourceCache<T>::findLoaded(PathId id)
+{
+    auto it = m_resources.find(id);
+    if (it != m_resources.end()) {
+        if (auto resource = it->second.resource.lock()) {
+            m_hits++;
+            return resource;
+        }
+    }
+
+    // Released but still resident, hand it out again under a fresh tracking pointer.
+    auto resident = m_lru.find(id);
+    if (resident == m_lru.end()) {
+        return nullptr;
+    }
+
+    std::shared_ptr<T> resource = track(id, std::move(resident->second.resource));
+    m_releasedBytes -= resident->second.bytes;
+    m_lruOrder.erase(resident->second.order);
+    m_lru.erase(resident);
+
+    publish(id, resource);
+    m_hits++;
+    return resource;
+}
+
+template <typename T> void ResourceCache<T>::publish(PathId id, const std::shared_ptr<T>& resource)
+{
+    Entry& entry = m_resources[id];
+    m_liveBytes -= entry.bytes;
+
+    entry.resource = resource;
+    entry.object   = resource.get();
+    entry.bytes    = resource->getMemoryUsage();
+    m_liveBytes += entry.bytes;
+}
+
+template <typename T> typename ResourceCache<T>::LoadPtr ResourceCache<T>::createLoad(const std::string& path, PathId id, ResourceCreator& creator)
+{
+    auto load  = std::make_shared<ResourceLoad<T>>();
+    load->path = path;
+    load->id   = PathId::intern(path); // Once per load, so getLoadedPaths() can name it
+
+    std::shared_ptr<T> resource = creator ? creator() : std::make_shared<T>();
+    if (!resource) {
+        return nullptr;
+    }
+
+    load->resource = track(id, std::move(resource));
+
+    m_loading[id] = load;
+    m_misses++;
+    return load;
+}
+
+template <typename T> void ResourceCache<T>::finishDecode(const LoadPtr& load, bool ok)
+{
+    if (!ok) {
+        complete(load, false);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        load->decoded  = true;
+        load->decodeOk = true;
+        m_uploadQueue.push_back(load);
+    }
+    load->decodedCv.notify_all();
+}
+
+template <typename T> void ResourceCache<T>::finishUpload(const LoadPtr& load)
+{
+    if (load->state != ResourceState::Pending) {
+        return;
+    }
+
+    bool ok = false;
+    try {
+        ok = load->resource->upload();
+    } catch (const std::exception& e) {
+        LOG_ERROR("ResourceCache: Exception while uploading {} - {}", load->path, e.what());
+    }
+
+    complete(load, ok);
+}
+
+template <typename T> void ResourceCache<T>::complete(const LoadPtr& load, bool ok)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (ok) {
+            publish(load->id, load->resource);
         }
+
+        auto it = m_loading.find(load->id);
+        if (it != m_loading.end() && it->second == load) {
+            m_loading.erase(it);
+        }
+
+        load->decoded  = true;
+        load->decodeOk = load->decodeOk || ok;
+        load->state    = ok ? ResourceState::Ready : ResourceState::Failed;
     }
+    load->decodedCv.notify_all();
 
-    std::shared_ptr<T> resource;
-    if (creator) {
-        resource = creator();
+    if (ok) {
+        LOG_INFO("ResourceCache: Loaded new resource: {}", load->path);
     } else {
-        resource = std::make_shared<T>();
+        LOG_ERROR("ResourceCache: Failed to load resource: {}", load->path);
     }
+}
 
-    if (resource && resource->load(path)) {
-        m_resources[path] = resource;
-        LOG_INFO("ResourceCache: Loaded new resource: {}", path);
-        return resource;
+template <typename T> size_t ResourceCache<T>::getCount() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    size_t                      count = 0;
+    for (const auto& pair : m_resources) {
+        if (!pair.second.resource.expired()) {
+            count++;
+        }
     }
+    return count;
+}
 
-    LOG_ERROR("ResourceCache: Failed to load resource: {}", path);
-    return nullptr;
+template <typename T> size_t ResourceCache<T>::getPendingCount() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_loading.size();
 }
 
 template <typename T> void ResourceCache<T>::remove(const std::string& path)
 {
-    std::lock_guard<std::mutex> lock(m_mutex);
-    auto                        it = m_resources.find(path);
-    if (it != m_resources.end()) {
-        if (auto resource = it->second.lock()) {
-            resource->unload();
+    std::shared_ptr<T> resident;
+    {
+        PathId                      id(path);
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto                        it = m_resources.find(id);
+        if (it != m_resources.end()) {
+            if (auto resource = it->second.resource.lock()) {
+                resource->unload();
+            }
+            m_liveBytes -= it->second.bytes;
+            m_resources.erase(it);
+            LOG_DEBUG("ResourceCache: Removed resource: {}", path);
+        }
+
+        auto lru = m_lru.find(id);
+        if (lru != m_lru.end()) {
+            resident = std::move(lru->second.resource);
+            m_releasedBytes -= lru->second.bytes;
+            m_lruOrder.erase(lru->second.order);
+            m_lru.erase(lru);
         }
-        m_resources.erase(it);
-        LOG_DEBUG("ResourceCache: Removed resource: {}", path);
     }
 }
 
 template <typename T> void ResourceCache<T>::clear()
 {
-    std::lock_guard<std::mutex> lock(m_mutex);
-    for (auto& pair : m_resources) {
-        if (auto resource = pair.second.lock()) {
-            resource->unload();
+    std::vector<std::shared_ptr<T>> doomed;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (auto& pair : m_resources) {
+            if (auto resource = pair.second.resource.lock()) {
+                resource->unload();
+            }
         }
+        m_resources.clear();
+
+        for (auto& pair : m_lru) {
+            doomed.push_back(std::move(pair.second.resource));
+        }
+        m_lru.clear();
+        m_lruOrder.clear();
+
+        {
+            std::lock_guard<std::mutex> releasedLock(m_released->mutex);
+            for (auto& released : m_released->entries) {
+                doomed.push_back(std::move(released.resource));
+            }
+            m_released->entries.clear();
+        }
+
+        doomed.insert(doomed.end(), std::make_move_iterator(m_graveyard.begin()), std::make_move_iterator(m_graveyard.end()));
+        m_graveyard.clear();
+
+        m_liveBytes     = 0;
+        m_releasedBytes = 0;
     }
-    m_resources.clear();
     LOG_DEBUG("ResourceCache: Cleared all resources from cache!");
 }
 
@@ -70,38 +324,120 @@ template <typename T> std::vector<std::string> ResourceCache<T>::getLoadedPaths(
     std::lock_guard<std::mutex> lock(m_mutex);
     std::vector<std::string>    paths;
     for (const auto& pair : m_resources) {
-        if (auto resource = pair.second.lock()) {
-            paths.push_back(pair.first);
+        if (!pair.second.resource.expired()) {
+            paths.push_back(PathId::getString(pair.first));
         }
     }
     return paths;
 }
 
-template <typename T> void ResourceCache<T>::cleanup()
+template <typename T> std::shared_ptr<T> ResourceCache<T>::track(PathId id, std::shared_ptr<T> resource)
 {
-    auto it = m_resources.begin();
-    while (it != m_resources.end()) {
-        if (it->second.expired()) {
-            it = m_resources.erase(it);
-        } else {
-            ++it;
+    // The cache hands out an aliasing pointer whose deleter owns the real resource. When the last outside
+    // reference goes away the deleter passes ownership back to the cache instead of destroying it.
+    std::weak_ptr<ReleasedList> released = m_released;
+    T*                          raw      = resource.get();
+    return std::shared_ptr<T>(raw, [id, released, owner = std::move(resource)](T*) mutable {
+        if (auto list = released.lock()) {
+            std::lock_guard<std::mutex> lock(list->mutex);
+            list->entries.push_back({id, std::move(owner)});
         }
+        owner.reset();
+    });
+}
+
+template <typename T> void ResourceCache<T>::reclaimExpired()
+{
+    std::vector<Released> entries;
+    {
+        std::lock_guard<std::mutex> lock(m_released->mutex);
+        entries.swap(m_released->entries);
     }
+
+    for (auto& released : entries) {
+        // A release only counts if the entry still belongs to it, the path may have been removed or loaded again since.
+        auto it = m_resources.find(released.id);
+        if (it == m_resources.end() || it->second.object != released.resource.get() || !it->second.resource.expired()) {
+            m_graveyard.push_back(std::move(released.resource));
+            continue;
+        }
+
+        size_t bytes = it->second.bytes;
+        m_liveBytes -= bytes;
+        m_resources.erase(it);
+
+        m_lruOrder.push_back(released.id);
+        Resident& resident = m_lru[released.id];
+        resident.resource  = std::move(released.resource);
+        resident.bytes     = bytes;
+        resident.order     = std::prev(m_lruOrder.end());
+        m_releasedBytes += bytes;
+    }
+}
+
+template <typename T> void ResourceCache<T>::trimToBudget()
+{
+    std::vector<std::shared_ptr<T>> doomed;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        reclaimExpired();
+
+        while (!m_lruOrder.empty() && m_liveBytes + m_releasedBytes > m_budget) {
+            auto resident = m_lru.find(m_lruOrder.front());
+            doomed.push_back(std::move(resident->second.resource));
+            m_releasedBytes -= resident->second.bytes;
+            m_lru.erase(resident);
+            m_lruOrder.pop_front();
+            m_evictions++;
+        }
+
+        doomed.insert(doomed.end(), std::make_move_iterator(m_graveyard.begin()), std::make_move_iterator(m_graveyard.end()));
+        m_graveyard.clear();
+    }
+
+    // Destroyed here, outside the lock and on the GL thread.
+    doomed.clear();
+}
+
+template <typename T> void ResourceCache<T>::setBudget(size_t bytes)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_budget = bytes;
+}
+
+template <typename T> ResourceCacheStats ResourceCache<T>::getStats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ResourceCacheStats          stats;
+    stats.liveBytes     = m_liveBytes;
+    stats.releasedBytes = m_releasedBytes;
+    stats.hits          = m_hits;
+    stats.misses        = m_misses;
+    stats.evictions     = m_evictions;
+    return stats;
 }
 
 template class ResourceCache<TextureResource>;
 template class ResourceCache<ShaderResource>;
 template class ResourceCache<ModelResource>;
 
+ResourceManager::ResourceManager()
+{
+    m_textureCache.setBudget(DEFAULT_TEXTURE_BUDGET);
+    m_shaderCache.setBudget(DEFAULT_SHADER_BUDGET);
+    m_modelCache.setBudget(DEFAULT_MODEL_BUDGET);
+}
+
 ResourceManager& ResourceManager::getInstance()
 {
     static ResourceManager instance;
     return instance;
 }
 
-std::shared_ptr<TextureResource> ResourceManager::getTexture(const std::string& path)
+std::shared_ptr<TextureResource> ResourceManager::getTexture(const std::string& path, TextureRole role)
 {
-    return m_textureCache.get(path);
+    return m_textureCache.get(path, [role]() { return std::make_shared<TextureResource>(role); });
 }
 
 std::shared_ptr<ShaderResource> ResourceManager::getShader(const std::string& name)
@@ -123,6 +459,24 @@ std::shared_ptr<ModelResource> ResourceManager::getModel(const std::string& path
     return m_modelCache.get(path);
 }
 
+ResourceHandle<TextureResource> ResourceManager::getTextureAsync(const std::string& path, TextureRole role)
+{
+    return m_textureCache.getAsync(path, [role]() { return std::make_shared<TextureResource>(role); });
+}
+
+ResourceHandle<ModelResource> ResourceManager::getModelAsync(const std::string& path)
+{
+    return m_modelCache.getAsync(path);
+}
+
+void ResourceManager::processUploads()
+{
+    // Textures first, models wait on their textures before they upload.
+    m_textureCache.processUploads();
+    m_shaderCache.processUploads();
+    m_modelCache.processUploads();
+}
+
 void ResourceManager::clearAll()
 {
     LOG_INFO("ResourceManager: Clearing all resource");
@@ -152,6 +506,17 @@ ResourceManager::Stats ResourceManager::getStats() const
     stats.textureCount = m_textureCache.getCount();
     stats.shaderCount  = m_shaderCache.getCount();
     stats.modelCount   = m_modelCache.getCount();
+    stats.pendingCount = m_textureCache.getPendingCount() + m_shaderCache.getPendingCount() + m_modelCache.getPendingCount();
+
+    size_t hits    = 0;
+    size_t lookups = 0;
+    for (const auto& cache : {m_textureCache.getStats(), m_shaderCache.getStats(), m_modelCache.getStats()}) {
+        stats.residentBytes += cache.liveBytes + cache.releasedBytes;
+        stats.evictions += cache.evictions;
+        hits += cache.hits;
+        lookups += cache.hits + cache.misses;
+    }
+    stats.hitRate = lookups > 0 ? static_cast<float>(hits) / static_cast<float>(lookups) : 0.0f;
     return stats;
 }
 
@@ -162,4 +527,8 @@ void ResourceManager::logStats() const
     LOG_INFO("Textures: {}", stats.textureCount);
     LOG_INFO("Shaders: {}", stats.shaderCount);
     LOG_INFO("Models: {}", stats.modelCount);
+    LOG_INFO("Pending: {}", stats.pendingCount);
+    LOG_INFO("Resident: {:.2f} MB", stats.residentBytes / (1024.0f * 1024.0f));
+    LOG_INFO("Hit rate: {:.1f}%", stats.hitRate * 100.0f);
+    LOG_INFO("Evictions: {}", stats.evictions);
 }
\ No newline at end of file
@@ -1,35 +1,157 @@
 #ifndef ENGINE_RENDERER_RESOURCE_MANAGER_H_
 #define ENGINE_RENDERER_RESOURCE_MANAGER_H_
 
+#include "engine/core/path_id.h"
 #include "engine/core/resource.h"
+#include "engine/renderer/textures/texture_role.h"
 
 #include <unordered_map>
 #include <memory>
 #include <string>
 #include <functional>
 #include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <vector>
+#include <list>
 
 class TextureResource;
 class ShaderResource;
 class ModelResource;
 
+template <typename T> class ResourceCache;
+
+// Shared between every handle for the same path while it loads.
+template <typename T> struct ResourceLoad {
+    std::string                path;
+    PathId                     id;
+    std::shared_ptr<T>         resource;
+    std::atomic<ResourceState> state{ResourceState::Pending};
+
+    // Set once decode() has returned, guarded by the cache mutex.
+    bool                    decoded  = false;
+    bool                    decodeOk = false;
+    std::condition_variable decodedCv;
+};
+
+// Result of ResourceCache::getAsync. Cheap to copy, poll it from the main thread until it stops pending.
+template <typename T> class ResourceHandle
+{
+  public:
+    ResourceHandle() = default;
+
+    ResourceState getState() const { return m_load ? m_load->state.load() : ResourceState::Failed; }
+    bool          isPending() const { return getState() == ResourceState::Pending; }
+    bool          isReady() const { return getState() == ResourceState::Ready; }
+    bool          isFailed() const { return getState() == ResourceState::Failed; }
+
+    std::shared_ptr<T> get() const { return isReady() ? m_load->resource : nullptr; }
+    const std::string& getPath() const
+    {
+        static const std::string empty;
+        return m_load ? m_load->path : empty;
+    }
+
+  private:
+    friend class ResourceCache<T>;
+
+    explicit ResourceHandle(std::shared_ptr<ResourceLoad<T>> load) : m_load(std::move(load)) {}
+
+    std::shared_ptr<ResourceLoad<T>> m_load;
+};
+
+struct ResourceCacheStats {
+    size_t liveBytes     = 0;
+    size_t releasedBytes = 0; // Held by the LRU only
+    size_t hits          = 0;
+    size_t misses        = 0;
+    size_t evictions     = 0;
+};
+
+// Every cache is keyed by the PathId of the requested path, so different spellings of one file share a single
+// resource and a lookup hashes the path once without allocating. Only the first load of a path interns its string.
 template <typename T> class ResourceCache
 {
   public:
     using ResourceCreator = std::function<std::shared_ptr<T>()>;
 
+    // Blocking load, must be called on the GL thread. Waits for an in-flight async load of the same path instead of starting another.
     std::shared_ptr<T> get(const std::string& path, ResourceCreator creator = nullptr);
-    void               remove(const std::string& path);
-    void               clear();
-    size_t             getCount() const { return m_resources.size(); }
+
+    // Decodes on the thread pool and finishes in processUploads(). Requests for a path that is already loading share the same load.
+    ResourceHandle<T> getAsync(const std::string& path, ResourceCreator creator = nullptr);
+
+    // Runs upload() for every decoded resource that is ready for it, then evicts released resources that
+    // don't fit the budget. GL thread only, this is where evicted resources are destroyed.
+    void processUploads();
+
+    void   remove(const std::string& path);
+    void   clear();
+    size_t getCount() const;
+    size_t getPendingCount() const;
+
+    // Released resources stay resident until live plus released bytes go over the budget.
+    void   setBudget(size_t bytes);
+    size_t getBudget() const { return m_budget; }
+
+    ResourceCacheStats getStats() const;
 
     std::vector<std::string> getLoadedPaths() const;
 
   private:
-    std::unordered_map<std::string, std::weak_ptr<T>> m_resources;
+    using LoadPtr = std::shared_ptr<ResourceLoad<T>>;
+
+    struct Entry {
+        std::weak_ptr<T> resource;
+        const T*         object = nullptr; // Identifies which load the entry belongs to once it has expired
+        size_t           bytes  = 0;
+    };
+
+    // Resources whose last outside reference was dropped. Filled by the shared_ptr deleter, which can run on any
+    // thread and may run while m_mutex is held, so it has its own lock.
+    struct Released {
+        PathId             id;
+        std::shared_ptr<T> resource;
+    };
+
+    struct ReleasedList {
+        std::mutex            mutex;
+        std::vector<Released> entries;
+    };
+
+    struct Resident {
+        std::shared_ptr<T>          resource;
+        size_t                      bytes = 0;
+        std::list<PathId>::iterator order;
+    };
+
+    std::unordered_map<PathId, Entry, PathId::Hash>   m_resources;
+    std::shared_ptr<ReleasedList>                     m_released = std::make_shared<ReleasedList>();
+    std::unordered_map<PathId, LoadPtr, PathId::Hash> m_loading;
+    std::vector<LoadPtr>                              m_uploadQueue;
     mutable std::mutex                                m_mutex;
 
-    void cleanup();
+    // Released resources kept for reuse, least recently released at the front.
+    std::unordered_map<PathId, Resident, PathId::Hash> m_lru;
+    std::list<PathId>                                  m_lruOrder;
+    std::vector<std::shared_ptr<T>>                    m_graveyard; // Stale releases, destroyed on the GL thread
+
+    size_t m_budget        = 0;
+    size_t m_liveBytes     = 0;
+    size_t m_releasedBytes = 0;
+    size_t m_hits          = 0;
+    size_t m_misses        = 0;
+    size_t m_evictions     = 0;
+
+    std::shared_ptr<T> findLoaded(PathId id);
+    void               publish(PathId id, const std::shared_ptr<T>& resource);
+    LoadPtr            createLoad(const std::string& path, PathId id, ResourceCreator& creator);
+    void               finishDecode(const LoadPtr& load, bool ok);
+    void               finishUpload(const LoadPtr& load);
+    void               complete(const LoadPtr& load, bool ok);
+    std::shared_ptr<T> track(PathId id, std::shared_ptr<T> resource);
+    void               reclaimExpired();
+    void               trimToBudget();
 };
 
 class ResourceManager
@@ -37,11 +159,22 @@ class ResourceManager
   public:
     static ResourceManager& getInstance();
 
-    std::shared_ptr<TextureResource> getTexture(const std::string& path);
+    // The role only matters for the first request of a path, it picks the block format when the texture gets cached compressed.
+    std::shared_ptr<TextureResource> getTexture(const std::string& path, TextureRole role = TextureRole::Generic);
     std::shared_ptr<ShaderResource>  getShader(const std::string& name);
     std::shared_ptr<ShaderResource>  getShader(const std::string& vertexPath, const std::string& fragmentPath);
     std::shared_ptr<ModelResource>   getModel(const std::string& path);
 
+    ResourceHandle<TextureResource> getTextureAsync(const std::string& path, TextureRole role = TextureRole::Generic);
+    ResourceHandle<ModelResource>   getModelAsync(const std::string& path);
+
+    void setTextureBudget(size_t bytes) { m_textureCache.setBudget(bytes); }
+    void setShaderBudget(size_t bytes) { m_shaderCache.setBudget(bytes); }
+    void setModelBudget(size_t bytes) { m_modelCache.setBudget(bytes); }
+
+    // Called once per frame from the main loop to finish async loads.
+    void processUploads();
+
     void clearAll();
     void clearTextures();
     void clearShaders();
@@ -51,15 +184,24 @@ class ResourceManager
         size_t textureCount = 0;
         size_t shaderCount  = 0;
         size_t modelCount   = 0;
+        size_t pendingCount = 0;
+
+        size_t residentBytes = 0; // Live and released resources still in memory
+        float  hitRate       = 0.0f;
+        size_t evictions     = 0;
     };
 
     Stats getStats() const;
     void  logStats() const;
 
   private:
-    ResourceManager()  = default;
+    ResourceManager();
     ~ResourceManager() = default;
 
+    static constexpr size_t DEFAULT_TEXTURE_BUDGET = 512ull * 1024 * 1024;
+    static constexpr size_t DEFAULT_SHADER_BUDGET  = 16ull * 1024 * 1024;
+    static constexpr size_t DEFAULT_MODEL_BUDGET   = 256ull * 1024 * 1024;
+
     ResourceCache<TextureResource> m_textureCache;
     ResourceCache<ShaderResource>  m_shaderCache;
     ResourceCache<ModelResource>   m_modelCache;
@@ -72,5 +214,7 @@ class ResourceManager
 #define GET_TEXTURE(path) RESOURCE_MANAGER.getTexture(path)
 #define GET_SHADER(name) RESOURCE_MANAGER.getShader(name)
 #define GET_MODEL(path) RESOURCE_MANAGER.getModel(path)
+#define GET_TEXTURE_ASYNC(path) RESOURCE_MANAGER.getTextureAsync(path)
+#define GET_MODEL_ASYNC(path) RESOURCE_MANAGER.getModelAsync(path)
 
 #endif // ENGINE_RENDERER_RESOURCE_MANAGER_H_
\ No newline at end of file
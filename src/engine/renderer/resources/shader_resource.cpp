@@ -20,6 +20,12 @@ bool ShaderResource::loadFromPaths(const std::string& vertexPath, const std::str
 
     try {
         m_shader = std::make_unique<Shader>(vertexPath, fragmentPath);
+
+        // Linked program size as the driver reports it, queried here since getMemoryUsage() can run off the GL thread.
+        GLint binaryLength = 0;
+        glGetProgramiv(m_shader->getProgram(), GL_PROGRAM_BINARY_LENGTH, &binaryLength);
+        m_memoryUsage = static_cast<size_t>(binaryLength);
+
         LOG_INFO("ShaderResrouce: {} + {} loaded.", vertexPath, fragmentPath);
         return true;
     } catch (const std::exception& e) {
@@ -32,6 +38,7 @@ void ShaderResource::unload()
 {
     if (m_shader) {
         m_shader.reset();
+        m_memoryUsage = 0;
         LOG_DEBUG("ShaderResource: {} unloaded", m_path);
     }
 }
\ No newline at end of file
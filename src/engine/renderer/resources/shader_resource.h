@@ -15,6 +15,8 @@ class ShaderResource : public IResource
     void unload() override;
     bool isLoaded() const override { return m_shader != nullptr; }
 
+    size_t getMemoryUsage() const override { return m_memoryUsage; }
+
     Shader* getShader() const { return m_shader.get(); }
     bool    loadFromPaths(const std::string& vertexPath, const std::string& fragmentPath);
 
@@ -22,6 +24,7 @@ class ShaderResource : public IResource
     std::unique_ptr<Shader> m_shader;
     std::string             m_vertexPath;
     std::string             m_fragmentPath;
+    size_t                  m_memoryUsage = 0;
 };
 
 #endif // ENGINE_RENDERER_SHADER_RESOURCE_H_
\ No newline at end of file
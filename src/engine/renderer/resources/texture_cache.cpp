@@ -0,0 +1,340 @@
+#include "pch.h"
+
+#include "engine/renderer/resources/texture_cache.h"
+#include "engine/renderer/textures/block_compressor.h"
+#include "engine/renderer/textures/mip_generator.h"
+#include "engine/core/path_id.h"
+#include "common/file.h"
+#include "common/hash.h"
+#include "common/logger.h"
+#include "common/stb_image.h"
+
+#include <glad/glad.h>
+
+#include <atomic>
+#include <filesystem>
+#include <format>
+#include <fstream>
+
+namespace
+{
+    const char* CACHE_DIRECTORY = "cache/textures";
+
+    std::atomic<bool> s_compressionEnabled = false;
+
+    constexpr uint64_t alignOffset(uint64_t offset)
+    {
+        return (offset + 15) & ~uint64_t(15);
+    }
+
+    bool isHeaderValid(const CachedTextureHeader& header)
+    {
+        return header.magic == TextureCache::MAGIC && header.version == TextureCache::VERSION;
+    }
+
+    const char* getRoleName(TextureRole role)
+    {
+        switch (role) {
+        case TextureRole::Albedo:
+            return "albedo";
+        case TextureRole::Normal:
+            return "normal";
+        case TextureRole::MetallicRoughness:
+            return "metallic_roughness";
+        default:
+            return "generic";
+        }
+    }
+
+    // The block compressor only takes RGBA8. Missing channels read like GL would return them.
+    std::vector<uint8_t> expandToRGBA(const TextureData::Level& level, uint32_t channels)
+    {
+        size_t               texelCount = static_cast<size_t>(level.width) * level.height;
+        std::vector<uint8_t> rgba(texelCount * 4);
+        for (size_t i = 0; i < texelCount; i++) {
+            for (uint32_t c = 0; c < 4; c++) {
+                rgba[i * 4 + c] = c < channels ? level.data[i * channels + c] : c == 3 ? 255 : 0;
+            }
+        }
+        return rgba;
+    }
+} // namespace
+
+bool CachedTexture::open(const std::string& path)
+{
+    if (!m_file.open(path)) {
+        return false;
+    }
+
+    const uint8_t* data = m_file.getData();
+    size_t         size = m_file.getSize();
+
+    if (size < sizeof(CachedTextureHeader)) {
+        LOG_ERROR("CachedTexture: {} is truncated.", path);
+        close();
+        return false;
+    }
+
+    m_header = reinterpret_cast<const CachedTextureHeader*>(data);
+    if (!isHeaderValid(*m_header) || m_header->levelCount == 0) {
+        LOG_WARN("CachedTexture: {} was written with a different version.", path);
+        close();
+        return false;
+    }
+
+    if (m_header->levelTableOffset + m_header->levelCount * sizeof(CachedTextureLevel) > size) {
+        LOG_ERROR("CachedTexture: {} has an out of range level table.", path);
+        close();
+        return false;
+    }
+
+    m_levels = reinterpret_cast<const CachedTextureLevel*>(data + m_header->levelTableOffset);
+    for (uint32_t i = 0; i < m_header->levelCount; i++) {
+        if (m_levels[i].offset + m_levels[i].size > size) {
+            LOG_ERROR("CachedTexture: {} has an out of range level {}.", path, i);
+            close();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+std::string TextureCache::getCachePath(const std::string& sourcePath, TextureRole role)
+{
+    // Flat and named after the PathId, so every spelling of the source shares one entry and "../" can't leave the
+    // cache directory. The file name is only kept to make the directory readable.
+    std::string canonical = PathId::normalize(sourcePath);
+    std::string name      = std::filesystem::path(canonical).stem().string();
+    return std::format("{}/{}_{:016x}.{}.etex", CACHE_DIRECTORY, name, PathId(canonical).getValue(), getRoleName(role));
+}
+
+uint64_t TextureCache::hashFile(const std::string& sourcePath)
+{
+    MappedFile file;
+    if (!file.open(sourcePath)) {
+        return 0;
+    }
+    return Hash::fnv1a(file.getData(), file.getSize());
+}
+
+uint64_t TextureCache::getSettingsHash(TextureRole role, uint32_t channels, bool compressed)
+{
+    // The format is 0 for uncompressed entries, BlockFormat + 1 otherwise.
+    uint32_t settings[] = {VERSION, static_cast<uint32_t>(MipGenerator::getDefaultFilter()), static_cast<uint32_t>(role),
+                           compressed ? static_cast<uint32_t>(BlockCompressor::chooseFormat(role, channels)) + 1 : 0};
+    return Hash::fnv1a(settings, sizeof(settings));
+}
+
+bool TextureCache::isUpToDate(const std::string& sourcePath, TextureRole role, const std::string& cachePath)
+{
+    // Read only, shipped or shared caches may not be writable and are still valid.
+    std::ifstream file(cachePath, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+
+    CachedTextureHeader header;
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) || !isHeaderValid(header)) {
+        return false;
+    }
+
+    if (header.settingsHash != getSettingsHash(role, header.channels, isCompressionEnabled())) {
+        return false;
+    }
+
+    int64_t  writeTime = 0;
+    uint64_t fileSize  = 0;
+    if (!FileSystem::getFileInfo(sourcePath, writeTime, fileSize) || fileSize != header.fileSize) {
+        return false;
+    }
+
+    if (writeTime == header.writeTime) {
+        return true;
+    }
+
+    // Touched but maybe not changed (checkout, copy), compare the contents before throwing the entry away.
+    if (hashFile(sourcePath) != header.contentHash) {
+        return false;
+    }
+
+    // Best effort, if the entry can't be written the next check just hashes the source again.
+    file.close();
+    header.writeTime = writeTime;
+    std::fstream update(cachePath, std::ios::binary | std::ios::in | std::ios::out);
+    if (update) {
+        update.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    }
+    return true;
+}
+
+bool TextureCache::write(const std::string& sourcePath, TextureRole role, uint64_t contentHash, const TextureData& data, const std::string& cachePath)
+{
+    CachedTextureHeader header = {};
+    header.magic               = MAGIC;
+    header.version             = VERSION;
+    header.width               = data.width;
+    header.height              = data.height;
+    header.channels            = data.channels;
+    header.levelCount          = static_cast<uint32_t>(data.levels.size());
+    header.internalFormat      = data.internalFormat;
+    header.format              = data.format;
+    header.contentHash         = contentHash;
+    header.settingsHash        = getSettingsHash(role, data.channels, data.isCompressed());
+    header.levelTableOffset    = alignOffset(sizeof(CachedTextureHeader));
+
+    if (!FileSystem::getFileInfo(sourcePath, header.writeTime, header.fileSize)) {
+        LOG_ERROR("TextureCache: Can't stat source {}", sourcePath);
+        return false;
+    }
+
+    std::vector<CachedTextureLevel> levels(data.levels.size());
+    uint64_t                        offset = alignOffset(header.levelTableOffset + levels.size() * sizeof(CachedTextureLevel));
+    for (size_t i = 0; i < levels.size(); i++) {
+        levels[i].offset = offset;
+        levels[i].size   = data.levels[i].data.size();
+        levels[i].width  = data.levels[i].width;
+        levels[i].height = data.levels[i].height;
+        offset           = alignOffset(offset + levels[i].size);
+    }
+
+    std::error_code error;
+    std::filesystem::create_directories(std::filesystem::path(cachePath).parent_path(), error);
+
+    // Write to a temporary file first so a crash mid-write never leaves a valid looking blob behind.
+    std::string   tempPath = cachePath + ".tmp";
+    std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        LOG_ERROR("TextureCache: Can't open {} for writing", tempPath);
+        return false;
+    }
+
+    auto writeAt = [&file](uint64_t offset, const void* data, size_t size) {
+        static const char padding[16] = {};
+        uint64_t          position    = static_cast<uint64_t>(file.tellp());
+        if (offset > position) {
+            file.write(padding, offset - position);
+        }
+        file.write(static_cast<const char*>(data), size);
+    };
+
+    writeAt(0, &header, sizeof(header));
+    writeAt(header.levelTableOffset, levels.data(), levels.size() * sizeof(CachedTextureLevel));
+    for (size_t i = 0; i < levels.size(); i++) {
+        writeAt(levels[i].offset, data.levels[i].data.data(), levels[i].size);
+    }
+
+    file.close();
+    if (!file) {
+        LOG_ERROR("TextureCache: Failed writing {}", tempPath);
+        std::filesystem::remove(tempPath, error);
+        return false;
+    }
+
+    std::filesystem::rename(tempPath, cachePath, error);
+    if (error) {
+        LOG_ERROR("TextureCache: Failed to move {} into place - {}", cachePath, error.message());
+        std::filesystem::remove(tempPath, error);
+        return false;
+    }
+
+    LOG_INFO("TextureCache: Cached {} -> {} ({} levels, {:.2f} MB{})", sourcePath, cachePath, levels.size(), offset / (1024.0 * 1024.0), data.isCompressed() ? ", compressed" : "");
+    return true;
+}
+
+bool TextureCache::build(const std::string& sourcePath, TextureRole role, TextureData& data, uint64_t& contentHash)
+{
+    MappedFile source;
+    if (!source.open(sourcePath)) {
+        LOG_ERROR("TextureCache: Texture file is not readable: {}", sourcePath);
+        return false;
+    }
+
+    int            width    = 0;
+    int            height   = 0;
+    int            channels = 0;
+    unsigned char* pixels   = stbi_load_from_memory(source.getData(), static_cast<int>(source.getSize()), &width, &height, &channels, 0);
+    if (!pixels) {
+        LOG_ERROR("stbi_load failed for texture: {} - {}", sourcePath, stbi_failure_reason());
+        return false;
+    }
+
+    contentHash         = Hash::fnv1a(source.getData(), source.getSize());
+    data.width          = static_cast<uint32_t>(width);
+    data.height         = static_cast<uint32_t>(height);
+    data.channels       = static_cast<uint32_t>(channels);
+    data.format         = channels == 1 ? GL_RED : channels == 2 ? GL_RG : channels == 4 ? GL_RGBA : GL_RGB;
+    data.internalFormat = channels == 1 ? GL_R8 : channels == 2 ? GL_RG8 : channels == 4 ? GL_RGBA8 : GL_RGB8; // Sized, TexturePool copies need it
+
+    data.levels.resize(1);
+    data.levels[0].width  = data.width;
+    data.levels[0].height = data.height;
+    data.levels[0].data.assign(pixels, pixels + static_cast<size_t>(width) * height * channels);
+    stbi_image_free(pixels);
+
+    MipGenerator generator;
+    generator.setFilter(MipGenerator::getDefaultFilter());
+    generator.setSRGB(role == TextureRole::Albedo);
+    generator.setNormalMap(role == TextureRole::Normal);
+    generator.generate(data);
+    return true;
+}
+
+TextureData TextureCache::compress(const TextureData& data, TextureRole role)
+{
+    BlockFormat     format = BlockCompressor::chooseFormat(role, data.channels);
+    BlockCompressor compressor;
+
+    TextureData compressed;
+    compressed.width          = data.width;
+    compressed.height         = data.height;
+    compressed.channels       = data.channels;
+    compressed.internalFormat = BlockCompressor::getGLFormat(format);
+    compressed.format         = 0;
+    compressed.levels.resize(data.levels.size());
+
+    for (size_t i = 0; i < data.levels.size(); i++) {
+        const TextureData::Level& level = data.levels[i];
+        compressed.levels[i].width      = level.width;
+        compressed.levels[i].height     = level.height;
+
+        if (data.channels == 4) {
+            compressor.compress(level.data.data(), level.width, level.height, format, compressed.levels[i].data);
+        } else {
+            std::vector<uint8_t> rgba = expandToRGBA(level, data.channels);
+            compressor.compress(rgba.data(), level.width, level.height, format, compressed.levels[i].data);
+        }
+    }
+
+    return compressed;
+}
+
+bool TextureCache::cook(const std::string& sourcePath, TextureRole role, bool force)
+{
+    std::string cachePath = getCachePath(sourcePath, role);
+    if (!force && isUpToDate(sourcePath, role, cachePath)) {
+        LOG_INFO("TextureCache: {} is up to date", cachePath);
+        return true;
+    }
+
+    TextureData data;
+    uint64_t    contentHash = 0;
+    if (!build(sourcePath, role, data, contentHash)) {
+        return false;
+    }
+
+    if (isCompressionEnabled()) {
+        return write(sourcePath, role, contentHash, compress(data, role), cachePath);
+    }
+    return write(sourcePath, role, contentHash, data, cachePath);
+}
+
+void TextureCache::setCompressionEnabled(bool enabled)
+{
+    s_compressionEnabled = enabled;
+}
+
+bool TextureCache::isCompressionEnabled()
+{
+    return s_compressionEnabled;
+}
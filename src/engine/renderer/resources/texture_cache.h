@@ -0,0 +1,121 @@
+#ifndef ENGINE_RENDERER_TEXTURE_CACHE_H_
+#define ENGINE_RENDERER_TEXTURE_CACHE_H_
+
+#include "common/mapped_file.h"
+#include "engine/renderer/textures/texture_role.h"
+
+#include <span>
+#include <string>
+#include <vector>
+
+// Cached texture blob (.etex), everything is little endian and 16 byte aligned:
+//
+//   CachedTextureHeader
+//   CachedTextureLevel[levelCount]   base level first
+//   level data                       exactly what glTexImage2D / glCompressedTexImage2D take
+
+struct CachedTextureHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t channels;
+    uint32_t levelCount;
+    uint32_t internalFormat; // GL internal format of the stored levels
+    uint32_t format;         // GL pixel format for uncompressed levels, 0 when compressed
+    uint64_t contentHash;    // FNV-1a of the source file
+    uint64_t settingsHash;   // TextureCache::getSettingsHash of the build
+    int64_t  writeTime;
+    uint64_t fileSize;
+    uint64_t levelTableOffset;
+};
+
+struct CachedTextureLevel {
+    uint64_t offset;
+    uint64_t size;
+    uint32_t width;
+    uint32_t height;
+};
+
+// Full mip chain of a texture in memory, the input for TextureCache::write.
+struct TextureData {
+    struct Level {
+        uint32_t             width  = 0;
+        uint32_t             height = 0;
+        std::vector<uint8_t> data;
+    };
+
+    uint32_t           width          = 0;
+    uint32_t           height         = 0;
+    uint32_t           channels       = 0;
+    uint32_t           internalFormat = 0;
+    uint32_t           format         = 0;
+    std::vector<Level> levels;
+
+    bool isCompressed() const { return format == 0; }
+};
+
+// Read-only view over a memory mapped .etex file. Level spans point straight into the mapping.
+class CachedTexture
+{
+  public:
+    CachedTexture()  = default;
+    ~CachedTexture() = default;
+
+    bool open(const std::string& path);
+    void close() { m_file.close(); }
+
+    uint32_t getWidth() const { return m_header->width; }
+    uint32_t getHeight() const { return m_header->height; }
+    uint32_t getChannels() const { return m_header->channels; }
+    uint32_t getInternalFormat() const { return m_header->internalFormat; }
+    uint32_t getFormat() const { return m_header->format; }
+    uint32_t getLevelCount() const { return m_header->levelCount; }
+    bool     isCompressed() const { return m_header->format == 0; }
+
+    const CachedTextureLevel& getLevel(uint32_t level) const { return m_levels[level]; }
+    std::span<const uint8_t>  getLevelData(uint32_t level) const { return {m_file.getData() + m_levels[level].offset, m_levels[level].size}; }
+
+  private:
+    MappedFile                 m_file;
+    const CachedTextureHeader* m_header = nullptr;
+    const CachedTextureLevel*  m_levels = nullptr;
+};
+
+class TextureCache
+{
+  public:
+    TextureCache()  = default;
+    ~TextureCache() = default;
+
+    // Keyed by the PathId of the source plus the role, a file used as both albedo and normal map is built twice.
+    static std::string getCachePath(const std::string& sourcePath, TextureRole role);
+    static uint64_t    hashFile(const std::string& sourcePath);
+
+    // Everything besides the source that changes what build and compress produce: the mip filter, the role and the
+    // compressed format if any. An entry built with other settings is a miss.
+    static uint64_t getSettingsHash(TextureRole role, uint32_t channels, bool compressed);
+
+    // Up to date when the settings and the source write time and size match. If only the write time changed, the
+    // content hash decides and a matching entry has its header refreshed so the next check is cheap again.
+    bool isUpToDate(const std::string& sourcePath, TextureRole role, const std::string& cachePath);
+    bool write(const std::string& sourcePath, TextureRole role, uint64_t contentHash, const TextureData& data, const std::string& cachePath);
+
+    // Decodes the source image and builds its mip chain on the CPU, filtered the way the role needs. No GL, any thread.
+    static bool build(const std::string& sourcePath, TextureRole role, TextureData& data, uint64_t& contentHash);
+
+    // Block compressed copy of every level, in the format BlockCompressor picks for the role.
+    static TextureData compress(const TextureData& data, TextureRole role);
+
+    // Offline version of a first load: build, compress if enabled and write, skipping entries that are up to date.
+    bool cook(const std::string& sourcePath, TextureRole role, bool force = false);
+
+    // Block compress textures on their first load before they are cached, the format follows the texture role (see BlockCompressor::chooseFormat).
+    static void setCompressionEnabled(bool enabled);
+    static bool isCompressionEnabled();
+
+    static constexpr uint32_t MAGIC   = 0x58455445; // "ETEX"
+    static constexpr uint32_t VERSION = 4; // 4: settings hash, 3: uncompressed levels have sized formats
+};
+
+#endif // ENGINE_RENDERER_TEXTURE_CACHE_H_
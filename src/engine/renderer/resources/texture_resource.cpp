@@ -1,11 +1,24 @@
 #include "pch.h"
 
 #include "engine/renderer/resources/texture_resource.h"
+#include "engine/renderer/textures/texture_pool.h"
+#include "engine/core/thread_pool.h"
 #include "common/logger.h"
-#include "common/stb_image.h"
 
 #include <filesystem>
 
+namespace
+{
+    void setSamplerState(uint32_t levelCount)
+    {
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(levelCount) - 1);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    }
+} // namespace
+
 TextureResource::~TextureResource()
 {
     unload();
@@ -18,6 +31,11 @@ bool TextureResource::load(const std::string& path)
         return true;
     }
 
+    return decode(path) && upload();
+}
+
+bool TextureResource::decode(const std::string& path)
+{
     m_path = path;
 
     if (!std::filesystem::exists(path)) {
@@ -25,44 +43,110 @@ bool TextureResource::load(const std::string& path)
         return false;
     }
 
+    // A cache hit skips the image decode and mip generation entirely, upload() takes the levels from the mapping.
+    TextureCache cache;
+    std::string  cachePath = TextureCache::getCachePath(path, m_role);
+    if (cache.isUpToDate(path, m_role, cachePath)) {
+        auto cached = std::make_unique<CachedTexture>();
+        if (cached->open(cachePath)) {
+            m_width    = static_cast<int>(cached->getWidth());
+            m_height   = static_cast<int>(cached->getHeight());
+            m_channels = static_cast<int>(cached->getChannels());
+            m_cached   = std::move(cached);
+            return true;
+        }
+    }
+
     // LOG_INFO("Loading texture: {}", path);
 
-    unsigned char* data = stbi_load(path.c_str(), &m_width, &m_height, &m_channels, 0);
-    if (!data) {
-        LOG_ERROR("stbi_load failed for texture: {} - {}", path, stbi_failure_reason());
+    auto data = std::make_shared<TextureData>();
+    if (!TextureCache::build(path, m_role, *data, m_contentHash)) {
         return false;
     }
 
+    m_width    = static_cast<int>(data->width);
+    m_height   = static_cast<int>(data->height);
+    m_channels = static_cast<int>(data->channels);
+    m_data     = data;
+
+    // The cache write, and the block compression with it, doesn't hold up the upload.
+    THREAD_POOL.submit([path, contentHash = m_contentHash, role = m_role, data]() {
+        TextureCache cache;
+        if (TextureCache::isCompressionEnabled()) {
+            cache.write(path, role, contentHash, TextureCache::compress(*data, role), TextureCache::getCachePath(path, role));
+        } else {
+            cache.write(path, role, contentHash, *data, TextureCache::getCachePath(path, role));
+        }
+    });
+
     // LOG_INFO("Texture data loaded: {}x{}x{} channels", m_width, m_height, m_channels);
+    return true;
+}
+
+bool TextureResource::upload()
+{
+    if (m_cached) {
+        return uploadCached();
+    }
+
+    if (!m_data) {
+        return false;
+    }
 
     glGenTextures(1, &m_textureId);
     glBindTexture(GL_TEXTURE_2D, m_textureId);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
 
-    GLenum format = GL_RGB;
-    if (m_channels == 1)
-        format = GL_RED;
-    else if (m_channels == 3)
-        format = GL_RGB;
-    else if (m_channels == 4)
-        format = GL_RGBA;
+    m_memoryUsage = 0;
+    for (uint32_t i = 0; i < m_data->levels.size(); i++) {
+        const TextureData::Level& level = m_data->levels[i];
+        glTexImage2D(GL_TEXTURE_2D, i, m_data->internalFormat, level.width, level.height, 0, m_data->format, GL_UNSIGNED_BYTE, level.data.data());
+        m_memoryUsage += level.data.size();
+    }
 
-    glTexImage2D(GL_TEXTURE_2D, 0, format, m_width, m_height, 0, format, GL_UNSIGNED_BYTE, data);
-    glGenerateMipmap(GL_TEXTURE_2D);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    setSamplerState(static_cast<uint32_t>(m_data->levels.size()));
 
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    m_data.reset();
 
-    stbi_image_free(data);
+    // LOG_INFO("Successfully loaded texture: {} (ID: {}, {}x{}, {} channels)", m_path, m_textureId, m_width, m_height, m_channels);
+    return true;
+}
 
-    // LOG_INFO("Successfully loaded texture: {} (ID: {}, {}x{}, {} channels)", path, m_textureId, m_width, m_height, m_channels);
+bool TextureResource::uploadCached()
+{
+    glGenTextures(1, &m_textureId);
+    glBindTexture(GL_TEXTURE_2D, m_textureId);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    m_memoryUsage = 0;
+    for (uint32_t i = 0; i < m_cached->getLevelCount(); i++) {
+        const CachedTextureLevel& level = m_cached->getLevel(i);
+        std::span<const uint8_t>  data  = m_cached->getLevelData(i);
+
+        if (m_cached->isCompressed()) {
+            glCompressedTexImage2D(GL_TEXTURE_2D, i, m_cached->getInternalFormat(), level.width, level.height, 0, static_cast<GLsizei>(data.size()), data.data());
+        } else {
+            glTexImage2D(GL_TEXTURE_2D, i, m_cached->getInternalFormat(), level.width, level.height, 0, m_cached->getFormat(), GL_UNSIGNED_BYTE, data.data());
+        }
+        m_memoryUsage += data.size();
+    }
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    setSamplerState(m_cached->getLevelCount());
+
+    m_cached.reset();
     return true;
 }
 
 void TextureResource::unload()
 {
+    m_data.reset();
+    m_cached.reset();
+    m_memoryUsage = 0;
+
     if (m_textureId != 0) {
+        TEXTURE_POOL.remove(m_textureId);
         glDeleteTextures(1, &m_textureId);
         m_textureId = 0;
         // LOG_DEBUG("Unloaded texture: {}", m_path);
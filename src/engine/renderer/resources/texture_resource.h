@@ -2,28 +2,47 @@
 #define ENGINE_RENDERER_TEXTURE_RESOURCE_H_
 
 #include "engine/core/resource.h"
+#include "engine/renderer/resources/texture_cache.h"
+#include "engine/renderer/textures/texture_role.h"
 #include <glad/glad.h>
 
+#include <memory>
+
 class TextureResource : public IResource
 {
   public:
-    TextureResource() = default;
+    explicit TextureResource(TextureRole role = TextureRole::Generic) : m_role(role) {}
     ~TextureResource() override;
 
     bool load(const std::string& path) override;
+    bool decode(const std::string& path) override;
+    bool upload() override;
     void unload() override;
     bool isLoaded() const override { return m_textureId != 0; }
 
+    size_t getMemoryUsage() const override { return m_memoryUsage; }
+
     uint32_t getTextureId() const { return m_textureId; }
     int      getWidth() const { return m_width; }
     int      getHeight() const { return m_height; }
     int      getChannels() const { return m_channels; }
 
+    TextureRole getRole() const { return m_role; }
+
   private:
     uint32_t m_textureId = 0;
     int      m_width     = 0;
     int      m_height    = 0;
     int      m_channels  = 0;
+
+    TextureRole m_role;
+
+    std::shared_ptr<TextureData>   m_data;   // Mip chain built by decode(), shared with the cache write
+    std::unique_ptr<CachedTexture> m_cached; // Set by decode() on a disk cache hit instead of m_data
+    uint64_t                       m_contentHash = 0;
+    size_t                         m_memoryUsage = 0;
+
+    bool uploadCached();
 };
 
 #endif // ENGINE_RENDERER_TEXTURE_RESOURCE_H_
\ No newline at end of file
@@ -4,6 +4,12 @@
 #include "engine/renderer/lighting/light.h"
 #include "common/logger.h"
 
+namespace
+{
+    // Refitting loosens the tree as models move apart, rebuild once its nodes cover this much more area than a fresh one.
+    const float MAX_REFIT_RATIO = 2.0f;
+} // namespace
+
 bool Scene::initialize()
 {
     m_camera       = std::make_unique<Camera>(glm::vec3(0.0f, 0.0f, 3.0f));
@@ -24,7 +30,8 @@ void Scene::addModel(std::shared_ptr<ModelResource> model, const glm::mat4& tran
 {
     if (model) {
         m_models.emplace_back(model, transform);
-        LOG_INFO("Scene: Added model to scene!");
+        m_bvhDirty = true;
+        LOG_DEBUG("Scene: Added model to scene!");
     }
 }
 
@@ -32,10 +39,96 @@ void Scene::removeModel(size_t index)
 {
     if (index < m_models.size()) {
         m_models.erase(m_models.begin() + index);
+        m_bvhDirty = true;
         LOG_INFO("Scene: Model removed from scene!");
     }
 }
 
+void Scene::setModelTransform(size_t index, const glm::mat4& transform)
+{
+    if (index >= m_models.size()) {
+        return;
+    }
+
+    m_models[index].second = transform;
+    if (!m_bvhDirty) {
+        m_bvh.update(static_cast<uint32_t>(index), getWorldBounds(index));
+        m_bvhRefitNeeded = true;
+    }
+}
+
+void Scene::queryVisible(const glm::mat4& viewProjection, std::vector<uint32_t>& out)
+{
+    updateBvh();
+    m_bvh.queryFrustum(Frustum::fromMatrix(viewProjection), out);
+}
+
+int Scene::pick(const glm::vec3& origin, const glm::vec3& direction)
+{
+    updateBvh();
+    RayHit hit = m_bvh.raycast(origin, direction);
+    return hit.isHit() ? static_cast<int>(hit.item) : -1;
+}
+
+void Scene::updateBvh()
+{
+    // Models that weren't loaded at the last build are left out of the tree, so one finishing its load needs a rebuild.
+    // So does one unloading, a refit would keep it in its leaf and queries taking whole nodes would still return it. A
+    // reload that stays loaded only moves its bounds.
+    for (size_t i = 0; i < m_models.size() && !m_bvhDirty; i++) {
+        uint32_t generation = getGeneration(i);
+        if (generation == m_bvhGenerations[i]) {
+            continue;
+        }
+
+        Aabb bounds = getWorldBounds(i);
+        if (m_bvh.hasLeaf(static_cast<uint32_t>(i)) == bounds.isEmpty()) {
+            m_bvhDirty = true;
+        } else {
+            m_bvh.update(static_cast<uint32_t>(i), bounds);
+            m_bvhGenerations[i] = generation;
+            m_bvhRefitNeeded    = true;
+        }
+    }
+
+    if (m_bvhRefitNeeded && !m_bvhDirty) {
+        m_bvh.refit();
+        m_bvhDirty = m_bvh.getRefitRatio() > MAX_REFIT_RATIO;
+    }
+    m_bvhRefitNeeded = false;
+
+    if (!m_bvhDirty) {
+        return;
+    }
+
+    std::vector<Aabb> bounds(m_models.size());
+    m_bvhGenerations.resize(m_models.size());
+    for (size_t i = 0; i < m_models.size(); i++) {
+        bounds[i]           = getWorldBounds(i);
+        m_bvhGenerations[i] = getGeneration(i);
+    }
+
+    m_bvh.build(bounds);
+    m_bvhDirty = false;
+}
+
+Aabb Scene::getWorldBounds(size_t index) const
+{
+    const auto& [modelResource, transform] = m_models[index];
+    if (!modelResource || !modelResource->isLoaded()) {
+        return Aabb();
+    }
+
+    const Model* model = modelResource->getModel();
+    return Aabb{model->getBoundsMin(), model->getBoundsMax()}.transformed(transform);
+}
+
+uint32_t Scene::getGeneration(size_t index) const
+{
+    const auto& modelResource = m_models[index].first;
+    return modelResource ? modelResource->getGeneration() : 0;
+}
+
 void Scene::setupDefaultLights()
 {
     m_lightManager->addLight(Light::createSunLight(glm::vec3(-0.3f, -0.7f, -0.2f)));
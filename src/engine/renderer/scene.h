@@ -2,6 +2,7 @@
 #define ENGINE_RENDERER_SHADERS_SCENE_H_
 
 #include "engine/renderer/camera.h"
+#include "engine/renderer/culling/bvh.h"
 #include "engine/renderer/lighting/light_manager.h"
 #include "engine/renderer/resources/model_resource.h"
 
@@ -20,6 +21,13 @@ class Scene
 
     void addModel(std::shared_ptr<ModelResource> model, const glm::mat4& transform = glm::mat4(1.0f));
     void removeModel(size_t index);
+    void setModelTransform(size_t index, const glm::mat4& transform);
+
+    // Indices into getModels() of loaded models whose world bounds touch the frustum, appended to out.
+    void queryVisible(const glm::mat4& viewProjection, std::vector<uint32_t>& out);
+
+    // Model whose world bounds the ray enters first, -1 if none. Only bounds are tested, not triangles.
+    int pick(const glm::vec3& origin, const glm::vec3& direction);
 
     LightManager* getLightManager() const { return m_lightManager.get(); }
 
@@ -30,7 +38,18 @@ class Scene
     std::unique_ptr<LightManager>                                     m_lightManager;
     std::vector<std::pair<std::shared_ptr<ModelResource>, glm::mat4>> m_models;
 
+    // Over model world bounds. Moving a model or reloading a loaded one refits it, adding or removing models and models
+    // loading or unloading rebuild it. The generation of each model's resource its bounds were taken at, see
+    // ModelResource::getGeneration().
+    Bvh                   m_bvh;
+    bool                  m_bvhDirty       = true;
+    bool                  m_bvhRefitNeeded = false;
+    std::vector<uint32_t> m_bvhGenerations;
+
     void setupDefaultLights();
+    void updateBvh();
+    Aabb getWorldBounds(size_t index) const;
+    uint32_t getGeneration(size_t index) const;
 };
 
 #endif // ENGINE_RENDERER_SHADERS_SCENE_H_
\ No newline at end of file
@@ -5,6 +5,11 @@
 #include "common/file.h"
 #include "common/logger.h"
 
+namespace
+{
+    std::string s_defines;
+} // namespace
+
 Shader::Shader(const std::string& vertexPath, const std::string& fragmentPath)
 {
     m_vertexShader = compile(vertexPath);
@@ -47,6 +52,12 @@ uint32_t Shader::compile(const std::string& shaderPath)
 
     auto shaderType = path.ends_with(".fs") ? GL_FRAGMENT_SHADER : GL_VERTEX_SHADER;
 
+    // #version has to stay the first line, the defines go right after it.
+    if (!s_defines.empty()) {
+        size_t lineEnd = shaderSource->starts_with("#version") ? shaderSource->find('\n') : std::string::npos;
+        shaderSource->insert(lineEnd == std::string::npos ? 0 : lineEnd + 1, s_defines);
+    }
+
     const char* source = shaderSource->c_str();
     uint32_t    shader = glCreateShader(shaderType);
     glShaderSource(shader, 1, &source, nullptr);
@@ -103,6 +114,11 @@ bool Shader::validate(uint32_t shader, std::string errorType, const std::string&
     return true;
 }
 
+void Shader::setDefines(const std::string& defines)
+{
+    s_defines = defines;
+}
+
 int Shader::getUniformLocation(const std::string& name) const
 {
     auto it = m_uniformLocationCache.find(name);
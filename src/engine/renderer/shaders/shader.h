@@ -15,6 +15,9 @@ class Shader
 
     uint32_t getProgram() const { return m_program; }
 
+    // Inserted after the #version line of every shader compiled from now on, e.g. "#define TEXTURE_BINDLESS\n".
+    static void setDefines(const std::string& defines);
+
     void use()
     {
         if (!m_program) {
@@ -79,6 +82,11 @@ class Shader
         glUniformMatrix4fv(getUniformLocation(name.c_str()), 1, GL_FALSE, &mat[0][0]);
     }
 
+    void setInt(int location, int value) const
+    {
+        glUniform1i(location, value);
+    }
+
     // clang-format on
 
   private:
@@ -0,0 +1,104 @@
+#ifndef ENGINE_RENDERER_SHADER_BINDINGS_H_
+#define ENGINE_RENDERER_SHADER_BINDINGS_H_
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+
+// Binding points and uniform locations fixed with layout qualifiers in assets/shaders, so nothing is looked up by
+// name at draw time. The blocks below mirror the std140/std430 declarations there and have to be kept in sync by hand.
+struct ShaderBinding {
+    static constexpr uint32_t CAMERA_BLOCK    = 0;
+    static constexpr uint32_t LIGHT_BUFFER    = 2; // Shader storage
+    static constexpr uint32_t CLUSTER_BUFFER  = 3; // Shader storage
+    static constexpr uint32_t LIGHT_INDICES   = 4; // Shader storage
+    static constexpr uint32_t INSTANCES       = 5; // Shader storage, model matrices of every instance drawn this frame
+    static constexpr uint32_t MATERIALS       = 6; // Shader storage, every registered material
+    static constexpr uint32_t TEXTURES        = 7; // Shader storage, see TexturePool
+    static constexpr uint32_t DRAWS           = 8; // Shader storage, per-command state of multi-draw indirect submission
+    static constexpr int      FIRST_INSTANCE  = 0; // Where the current draw's instances start in INSTANCES
+    static constexpr int      VERTEX_FORMAT   = 1; // VertexFormat of the bound mesh
+    static constexpr int      POSITION_OFFSET = 2; // VertexQuantization of the bound mesh
+    static constexpr int      POSITION_SCALE  = 3;
+    static constexpr int      MATERIAL_INDEX  = 4; // The current draw's entry in MATERIALS
+    static constexpr int      FIRST_DRAW      = 5; // Where the current multi-draw's commands start in DRAWS, replaces the four above
+    static constexpr int      TEXTURE_POOLS   = 6; // Pool of every texture slot for the current multi-draw, one location per slot
+};
+
+// Written once per frame.
+struct CameraBlock {
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::mat4 viewProjection;
+    glm::vec3 viewPos;
+    float     padding = 0.0f;
+};
+
+// std430 array element of MaterialBuffer, written once per unique material and texture set.
+struct MaterialBlock {
+    static constexpr uint32_t ALBEDO_TEXTURE    = 1 << 0;
+    static constexpr uint32_t METALLIC_TEXTURE  = 1 << 1;
+    static constexpr uint32_t ROUGHNESS_TEXTURE = 1 << 2;
+    static constexpr uint32_t NORMAL_TEXTURE    = 1 << 3;
+    static constexpr uint32_t LEGACY_SPECULAR   = 1 << 4;
+
+    static constexpr uint32_t TEXTURE_SLOT_COUNT = 5; // Mesh::TEXTURE_UNIT_COUNT
+
+    glm::vec3 albedo;
+    float     metallic;
+    glm::vec3 emissive;
+    float     roughness;
+    float     ao;
+    float     transparency;
+    uint32_t  flags;
+    uint32_t  textures[TEXTURE_SLOT_COUNT]; // TexturePool index per texture unit, only read with resident textures
+};
+
+// std430 array element of DrawBuffer, one per indirect command. What a direct draw sets as uniforms.
+struct DrawBlock {
+    glm::vec3 positionOffset;
+    int32_t   vertexFormat;
+    glm::vec3 positionScale;
+    uint32_t  materialIndex;
+};
+
+// std430 array element of LightBuffer, rewritten by LightManager when a light changes.
+struct LightBlock {
+    glm::vec3 position;
+    float     intensity;
+    glm::vec3 direction;
+    float     cutoff;
+    glm::vec3 color;
+    float     outerCutoff;
+    int32_t   type;
+    float     range; // Where the shader fades the light out, unused for directional lights
+    float     padding[2] = {};
+};
+
+// Precedes the light array in LightBuffer, the array is aligned to 16 bytes. Directional lights come first.
+struct LightBufferHeader {
+    uint32_t count;
+    uint32_t directionalCount;
+    uint32_t padding[2] = {};
+};
+
+// Precedes the per-cluster light ranges in ClusterBuffer, rewritten every frame by LightClusters.
+struct ClusterBufferHeader {
+    glm::uvec4 dimensions; // Clusters along x, y and z, w is unused
+    glm::vec4  params;     // Clusters per pixel along x and y, depth slice scale and bias
+};
+
+// Where a cluster's point and spot lights sit in the LightIndices buffer.
+struct ClusterRange {
+    uint32_t offset;
+    uint32_t count;
+};
+
+static_assert(sizeof(CameraBlock) == 208, "CameraBlock must match the std140 layout in pbr.vs");
+static_assert(sizeof(MaterialBlock) == 64, "MaterialBlock must match the std430 layout in pbr.fs");
+static_assert(sizeof(DrawBlock) == 32, "DrawBlock must match the std430 layout in pbr.vs");
+static_assert(sizeof(LightBlock) == 64, "LightBlock must match the std430 layout in pbr.fs");
+static_assert(sizeof(LightBufferHeader) == 16, "LightBufferHeader must match the std430 layout in pbr.fs");
+static_assert(sizeof(ClusterBufferHeader) == 32, "ClusterBufferHeader must match the std430 layout in pbr.fs");
+
+#endif // ENGINE_RENDERER_SHADER_BINDINGS_H_
@@ -0,0 +1,696 @@
+#include "pch.h"
+
+#include "engine/renderer/textures/block_compressor.h"
+#include "engine/core/thread_pool.h"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <emmintrin.h>
+
+namespace
+{
+    // One 4x4 block as structure of arrays, so four pixels of a channel fill an SSE register.
+    struct Block {
+        alignas(16) float channel[4][16];
+    };
+
+    // Mode 6 interpolation weights for the 4 bit indices.
+    const int BC7_WEIGHTS[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+    void loadBlock(const uint8_t* rgba, uint32_t width, uint32_t height, uint32_t bx, uint32_t by, Block& block)
+    {
+        for (uint32_t y = 0; y < 4; y++) {
+            uint32_t sy = std::min(by * 4 + y, height - 1);
+            for (uint32_t x = 0; x < 4; x++) {
+                uint32_t       sx    = std::min(bx * 4 + x, width - 1);
+                const uint8_t* pixel = rgba + (static_cast<size_t>(sy) * width + sx) * 4;
+                for (uint32_t c = 0; c < 4; c++) {
+                    block.channel[c][y * 4 + x] = pixel[c];
+                }
+            }
+        }
+    }
+
+    // Mean and dominant direction of the block over `count` channels, power iteration on the covariance matrix.
+    void computeAxis(const Block& block, uint32_t count, float mean[4], float axis[4])
+    {
+        float covariance[4][4] = {};
+        for (uint32_t c = 0; c < 4; c++) {
+            mean[c] = 0.0f;
+            axis[c] = 0.0f;
+        }
+
+        for (uint32_t c = 0; c < count; c++) {
+            for (uint32_t i = 0; i < 16; i++) {
+                mean[c] += block.channel[c][i];
+            }
+            mean[c] /= 16.0f;
+        }
+
+        for (uint32_t i = 0; i < 16; i++) {
+            for (uint32_t a = 0; a < count; a++) {
+                for (uint32_t b = a; b < count; b++) {
+                    covariance[a][b] += (block.channel[a][i] - mean[a]) * (block.channel[b][i] - mean[b]);
+                }
+            }
+        }
+
+        uint32_t largest = 0;
+        for (uint32_t a = 0; a < count; a++) {
+            for (uint32_t b = 0; b < a; b++) {
+                covariance[a][b] = covariance[b][a];
+            }
+            if (covariance[a][a] > covariance[largest][largest]) {
+                largest = a;
+            }
+        }
+
+        // Starting from the row of the widest channel avoids a start vector orthogonal to the answer.
+        float vector[4] = {};
+        for (uint32_t c = 0; c < count; c++) {
+            vector[c] = covariance[largest][c];
+        }
+
+        for (uint32_t iteration = 0; iteration < 8; iteration++) {
+            float next[4] = {};
+            float scale   = 0.0f;
+            for (uint32_t a = 0; a < count; a++) {
+                for (uint32_t b = 0; b < count; b++) {
+                    next[a] += covariance[a][b] * vector[b];
+                }
+                scale = std::max(scale, std::fabs(next[a]));
+            }
+
+            if (scale < 1e-8f) {
+                break;
+            }
+
+            for (uint32_t c = 0; c < count; c++) {
+                vector[c] = next[c] / scale;
+            }
+        }
+
+        float length = 0.0f;
+        for (uint32_t c = 0; c < count; c++) {
+            length += vector[c] * vector[c];
+        }
+
+        if (length > 1e-8f) {
+            length = std::sqrt(length);
+            for (uint32_t c = 0; c < count; c++) {
+                axis[c] = vector[c] / length;
+            }
+        }
+    }
+
+    // Endpoints at the extremes of the block projected onto its axis, lowest projection first.
+    void computeEndpoints(const Block& block, uint32_t count, float e0[4], float e1[4])
+    {
+        float mean[4];
+        float axis[4];
+        computeAxis(block, count, mean, axis);
+
+        float minT = FLT_MAX;
+        float maxT = -FLT_MAX;
+        for (uint32_t i = 0; i < 16; i++) {
+            float t = 0.0f;
+            for (uint32_t c = 0; c < count; c++) {
+                t += (block.channel[c][i] - mean[c]) * axis[c];
+            }
+            minT = std::min(minT, t);
+            maxT = std::max(maxT, t);
+        }
+
+        for (uint32_t c = 0; c < 4; c++) {
+            e0[c] = std::clamp(mean[c] + axis[c] * minT, 0.0f, 255.0f);
+            e1[c] = std::clamp(mean[c] + axis[c] * maxT, 0.0f, 255.0f);
+        }
+    }
+
+    // Nearest palette entry for every pixel over channels [first, first + count). Returns the summed squared error.
+    float fitIndices(const Block& block, uint32_t first, uint32_t count, const float (*palette)[4], uint32_t paletteSize, uint8_t indices[16])
+    {
+        float error = 0.0f;
+        for (uint32_t i = 0; i < 16; i += 4) {
+            __m128 best      = _mm_set1_ps(FLT_MAX);
+            __m128 bestIndex = _mm_setzero_ps();
+
+            for (uint32_t k = 0; k < paletteSize; k++) {
+                __m128 distance = _mm_setzero_ps();
+                for (uint32_t c = first; c < first + count; c++) {
+                    __m128 delta = _mm_sub_ps(_mm_load_ps(&block.channel[c][i]), _mm_set1_ps(palette[k][c]));
+                    distance     = _mm_add_ps(distance, _mm_mul_ps(delta, delta));
+                }
+
+                __m128 closer = _mm_cmplt_ps(distance, best);
+                best          = _mm_min_ps(distance, best);
+                bestIndex     = _mm_or_ps(_mm_and_ps(closer, _mm_set1_ps(static_cast<float>(k))), _mm_andnot_ps(closer, bestIndex));
+            }
+
+            alignas(16) float lane[4];
+            alignas(16) float laneError[4];
+            _mm_store_ps(lane, bestIndex);
+            _mm_store_ps(laneError, best);
+            for (uint32_t j = 0; j < 4; j++) {
+                indices[i + j] = static_cast<uint8_t>(lane[j]);
+                error += laneError[j];
+            }
+        }
+        return error;
+    }
+
+    // Least squares endpoints for fixed interpolation weights (0 is e0, 1 is e1). False when the weights are degenerate.
+    bool refitEndpoints(const Block& block, uint32_t count, const float weights[16], float e0[4], float e1[4])
+    {
+        float a     = 0.0f;
+        float b     = 0.0f;
+        float c     = 0.0f;
+        float x0[4] = {};
+        float x1[4] = {};
+
+        for (uint32_t i = 0; i < 16; i++) {
+            float w  = weights[i];
+            float iw = 1.0f - w;
+            a += iw * iw;
+            b += iw * w;
+            c += w * w;
+            for (uint32_t ch = 0; ch < count; ch++) {
+                x0[ch] += iw * block.channel[ch][i];
+                x1[ch] += w * block.channel[ch][i];
+            }
+        }
+
+        float determinant = a * c - b * b;
+        if (std::fabs(determinant) < 1e-6f) {
+            return false;
+        }
+
+        for (uint32_t ch = 0; ch < count; ch++) {
+            e0[ch] = std::clamp((c * x0[ch] - b * x1[ch]) / determinant, 0.0f, 255.0f);
+            e1[ch] = std::clamp((a * x1[ch] - b * x0[ch]) / determinant, 0.0f, 255.0f);
+        }
+        return true;
+    }
+
+    uint16_t packRGB565(const float color[4])
+    {
+        uint16_t r = static_cast<uint16_t>(std::lround(color[0] * 31.0f / 255.0f));
+        uint16_t g = static_cast<uint16_t>(std::lround(color[1] * 63.0f / 255.0f));
+        uint16_t b = static_cast<uint16_t>(std::lround(color[2] * 31.0f / 255.0f));
+        return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+    }
+
+    void unpackRGB565(uint16_t packed, float color[4])
+    {
+        uint32_t r = (packed >> 11) & 31;
+        uint32_t g = (packed >> 5) & 63;
+        uint32_t b = packed & 31;
+        color[0]   = static_cast<float>((r << 3) | (r >> 2));
+        color[1]   = static_cast<float>((g << 2) | (g >> 4));
+        color[2]   = static_cast<float>((b << 3) | (b >> 2));
+        color[3]   = 255.0f;
+    }
+
+    void buildBC1Palette(uint16_t c0, uint16_t c1, float palette[4][4])
+    {
+        unpackRGB565(c0, palette[0]);
+        unpackRGB565(c1, palette[1]);
+        for (uint32_t c = 0; c < 4; c++) {
+            if (c0 > c1) {
+                palette[2][c] = (2.0f * palette[0][c] + palette[1][c]) / 3.0f;
+                palette[3][c] = (palette[0][c] + 2.0f * palette[1][c]) / 3.0f;
+            } else {
+                palette[2][c] = (palette[0][c] + palette[1][c]) / 2.0f;
+                palette[3][c] = 0.0f;
+            }
+        }
+    }
+
+    struct BC1Result {
+        uint16_t c0      = 0;
+        uint16_t c1      = 0;
+        uint32_t indices = 0;
+        float    error   = FLT_MAX;
+    };
+
+    BC1Result encodeBC1Endpoints(const Block& block, const float e0[4], const float e1[4])
+    {
+        BC1Result result;
+        result.c0 = packRGB565(e0);
+        result.c1 = packRGB565(e1);
+        if (result.c0 < result.c1) {
+            std::swap(result.c0, result.c1);
+        }
+
+        float palette[4][4];
+        buildBC1Palette(result.c0, result.c1, palette);
+
+        uint8_t indices[16];
+        result.error = fitIndices(block, 0, 3, palette, 4, indices);
+        for (uint32_t i = 0; i < 16; i++) {
+            result.indices |= static_cast<uint32_t>(indices[i]) << (2 * i);
+        }
+        return result;
+    }
+
+    void encodeBC1(const Block& block, uint8_t* out)
+    {
+        float e0[4];
+        float e1[4];
+        computeEndpoints(block, 3, e0, e1);
+
+        BC1Result best = encodeBC1Endpoints(block, e1, e0);
+
+        // One least squares pass over the fitted indices, kept only if it actually lowers the error.
+        if (best.c0 > best.c1) {
+            const float WEIGHTS[4] = {0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f};
+            float       weights[16];
+            for (uint32_t i = 0; i < 16; i++) {
+                weights[i] = WEIGHTS[(best.indices >> (2 * i)) & 3];
+            }
+
+            if (refitEndpoints(block, 3, weights, e0, e1)) {
+                BC1Result refit = encodeBC1Endpoints(block, e0, e1);
+                if (refit.error < best.error) {
+                    best = refit;
+                }
+            }
+        }
+
+        std::memcpy(out, &best.c0, 2);
+        std::memcpy(out + 2, &best.c1, 2);
+        std::memcpy(out + 4, &best.indices, 4);
+    }
+
+    void encodeBC4(const Block& block, uint32_t channel, uint8_t* out)
+    {
+        float minValue = 255.0f;
+        float maxValue = 0.0f;
+        for (uint32_t i = 0; i < 16; i++) {
+            minValue = std::min(minValue, block.channel[channel][i]);
+            maxValue = std::max(maxValue, block.channel[channel][i]);
+        }
+
+        // e0 > e1 selects the mode with six interpolated values between the endpoints.
+        uint8_t e0 = static_cast<uint8_t>(std::lround(maxValue));
+        uint8_t e1 = static_cast<uint8_t>(std::lround(minValue));
+
+        float palette[8][4] = {};
+        for (uint32_t k = 0; k < 8; k++) {
+            float value = e0;
+            if (e0 != e1) {
+                value = k == 0 ? e0 : k == 1 ? e1 : ((8 - k) * e0 + (k - 1) * e1) / 7.0f;
+            }
+            palette[k][channel] = value;
+        }
+
+        uint8_t indices[16];
+        fitIndices(block, channel, 1, palette, 8, indices);
+
+        uint64_t bits = 0;
+        for (uint32_t i = 0; i < 16; i++) {
+            bits |= static_cast<uint64_t>(indices[i]) << (3 * i);
+        }
+
+        out[0] = e0;
+        out[1] = e1;
+        std::memcpy(out + 2, &bits, 6);
+    }
+
+    struct BitWriter {
+        uint64_t low      = 0;
+        uint64_t high     = 0;
+        uint32_t position = 0;
+
+        void write(uint64_t value, uint32_t count)
+        {
+            if (position < 64) {
+                low |= value << position;
+                if (position + count > 64) {
+                    high |= value >> (64 - position);
+                }
+            } else {
+                high |= value << (position - 64);
+            }
+            position += count;
+        }
+    };
+
+    struct BitReader {
+        uint64_t low      = 0;
+        uint64_t high     = 0;
+        uint32_t position = 0;
+
+        uint32_t read(uint32_t count)
+        {
+            uint32_t value = 0;
+            for (uint32_t i = 0; i < count; i++, position++) {
+                uint64_t bit = position < 64 ? (low >> position) & 1 : (high >> (position - 64)) & 1;
+                value |= static_cast<uint32_t>(bit) << i;
+            }
+            return value;
+        }
+    };
+
+    // 7 bit endpoint with its own p-bit as the shared low bit, keeps the p-bit with the smaller error.
+    void quantizeBC7Endpoint(const float color[4], uint8_t quantized[4], uint8_t& pbit)
+    {
+        float bestError = FLT_MAX;
+        for (uint8_t p = 0; p < 2; p++) {
+            uint8_t candidate[4];
+            float   error = 0.0f;
+            for (uint32_t c = 0; c < 4; c++) {
+                candidate[c] = static_cast<uint8_t>(std::clamp<long>(std::lround((color[c] - p) / 2.0f), 0, 127));
+                float delta  = static_cast<float>((candidate[c] << 1) | p) - color[c];
+                error += delta * delta;
+            }
+
+            if (error < bestError) {
+                bestError = error;
+                pbit      = p;
+                std::memcpy(quantized, candidate, 4);
+            }
+        }
+    }
+
+    struct BC7Result {
+        uint8_t q0[4]       = {};
+        uint8_t q1[4]       = {};
+        uint8_t p0          = 0;
+        uint8_t p1          = 0;
+        uint8_t indices[16] = {};
+        float   error       = FLT_MAX;
+    };
+
+    void buildBC7Palette(const uint8_t q0[4], uint8_t p0, const uint8_t q1[4], uint8_t p1, float palette[16][4])
+    {
+        for (uint32_t c = 0; c < 4; c++) {
+            int e0 = (q0[c] << 1) | p0;
+            int e1 = (q1[c] << 1) | p1;
+            for (uint32_t k = 0; k < 16; k++) {
+                palette[k][c] = static_cast<float>(((64 - BC7_WEIGHTS[k]) * e0 + BC7_WEIGHTS[k] * e1 + 32) >> 6);
+            }
+        }
+    }
+
+    BC7Result encodeBC7Endpoints(const Block& block, const float e0[4], const float e1[4])
+    {
+        BC7Result result;
+        quantizeBC7Endpoint(e0, result.q0, result.p0);
+        quantizeBC7Endpoint(e1, result.q1, result.p1);
+
+        float palette[16][4];
+        buildBC7Palette(result.q0, result.p0, result.q1, result.p1, palette);
+        result.error = fitIndices(block, 0, 4, palette, 16, result.indices);
+        return result;
+    }
+
+    void encodeBC7(const Block& block, uint8_t* out)
+    {
+        float e0[4];
+        float e1[4];
+        computeEndpoints(block, 4, e0, e1);
+
+        BC7Result best = encodeBC7Endpoints(block, e0, e1);
+
+        float weights[16];
+        for (uint32_t i = 0; i < 16; i++) {
+            weights[i] = BC7_WEIGHTS[best.indices[i]] / 64.0f;
+        }
+
+        if (refitEndpoints(block, 4, weights, e0, e1)) {
+            BC7Result refit = encodeBC7Endpoints(block, e0, e1);
+            if (refit.error < best.error) {
+                best = refit;
+            }
+        }
+
+        // The anchor index is stored with 3 bits, flipping the endpoints clears its top bit. The weights are symmetric so nothing else changes.
+        if (best.indices[0] & 8) {
+            std::swap(best.q0, best.q1);
+            std::swap(best.p0, best.p1);
+            for (uint32_t i = 0; i < 16; i++) {
+                best.indices[i] = static_cast<uint8_t>(15 - best.indices[i]);
+            }
+        }
+
+        BitWriter writer;
+        writer.write(1 << 6, 7);
+        for (uint32_t c = 0; c < 4; c++) {
+            writer.write(best.q0[c], 7);
+            writer.write(best.q1[c], 7);
+        }
+        writer.write(best.p0, 1);
+        writer.write(best.p1, 1);
+        writer.write(best.indices[0], 3);
+        for (uint32_t i = 1; i < 16; i++) {
+            writer.write(best.indices[i], 4);
+        }
+
+        std::memcpy(out, &writer.low, 8);
+        std::memcpy(out + 8, &writer.high, 8);
+    }
+
+    void decodeBC1(const uint8_t* in, uint8_t pixels[16][4])
+    {
+        uint16_t c0;
+        uint16_t c1;
+        uint32_t indices;
+        std::memcpy(&c0, in, 2);
+        std::memcpy(&c1, in + 2, 2);
+        std::memcpy(&indices, in + 4, 4);
+
+        float palette[4][4];
+        buildBC1Palette(c0, c1, palette);
+        for (uint32_t i = 0; i < 16; i++) {
+            const float* color = palette[(indices >> (2 * i)) & 3];
+            for (uint32_t c = 0; c < 3; c++) {
+                pixels[i][c] = static_cast<uint8_t>(std::lround(color[c]));
+            }
+            pixels[i][3] = 255;
+        }
+    }
+
+    void decodeBC4(const uint8_t* in, uint32_t channel, uint8_t pixels[16][4])
+    {
+        uint32_t e0   = in[0];
+        uint32_t e1   = in[1];
+        uint64_t bits = 0;
+        std::memcpy(&bits, in + 2, 6);
+
+        float palette[8];
+        palette[0] = static_cast<float>(e0);
+        palette[1] = static_cast<float>(e1);
+        if (e0 > e1) {
+            for (uint32_t k = 2; k < 8; k++) {
+                palette[k] = ((8 - k) * e0 + (k - 1) * e1) / 7.0f;
+            }
+        } else {
+            for (uint32_t k = 2; k < 6; k++) {
+                palette[k] = ((6 - k) * e0 + (k - 1) * e1) / 5.0f;
+            }
+            palette[6] = 0.0f;
+            palette[7] = 255.0f;
+        }
+
+        for (uint32_t i = 0; i < 16; i++) {
+            pixels[i][channel] = static_cast<uint8_t>(std::lround(palette[(bits >> (3 * i)) & 7]));
+        }
+    }
+
+    void decodeBC7(const uint8_t* in, uint8_t pixels[16][4])
+    {
+        BitReader reader;
+        std::memcpy(&reader.low, in, 8);
+        std::memcpy(&reader.high, in + 8, 8);
+
+        if (reader.read(7) != (1 << 6)) {
+            std::memset(pixels, 0, 64);
+            return;
+        }
+
+        uint8_t q0[4];
+        uint8_t q1[4];
+        for (uint32_t c = 0; c < 4; c++) {
+            q0[c] = static_cast<uint8_t>(reader.read(7));
+            q1[c] = static_cast<uint8_t>(reader.read(7));
+        }
+        uint8_t p0 = static_cast<uint8_t>(reader.read(1));
+        uint8_t p1 = static_cast<uint8_t>(reader.read(1));
+
+        float palette[16][4];
+        buildBC7Palette(q0, p0, q1, p1, palette);
+        for (uint32_t i = 0; i < 16; i++) {
+            uint32_t index = reader.read(i == 0 ? 3 : 4);
+            for (uint32_t c = 0; c < 4; c++) {
+                pixels[i][c] = static_cast<uint8_t>(palette[index][c]);
+            }
+        }
+    }
+} // namespace
+
+BlockFormat BlockCompressor::chooseFormat(TextureRole role, uint32_t channels)
+{
+    switch (role) {
+    case TextureRole::Normal:
+        return BlockFormat::BC5;
+    case TextureRole::MetallicRoughness:
+        return channels == 1 ? BlockFormat::BC4 : BlockFormat::BC7;
+    case TextureRole::Albedo:
+        return channels == 4 ? BlockFormat::BC7 : BlockFormat::BC1;
+    default:
+        break;
+    }
+
+    // Everything else by channel count, so single channel data like AO or opacity still lands in BC4.
+    switch (channels) {
+    case 1:
+        return BlockFormat::BC4;
+    case 2:
+        return BlockFormat::BC5;
+    case 3:
+        return BlockFormat::BC1;
+    default:
+        return BlockFormat::BC7;
+    }
+}
+
+uint32_t BlockCompressor::getGLFormat(BlockFormat format)
+{
+    switch (format) {
+    case BlockFormat::BC1:
+        return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    case BlockFormat::BC4:
+        return GL_COMPRESSED_RED_RGTC1;
+    case BlockFormat::BC5:
+        return GL_COMPRESSED_RG_RGTC2;
+    default:
+        return GL_COMPRESSED_RGBA_BPTC_UNORM;
+    }
+}
+
+uint32_t BlockCompressor::getBlockSize(BlockFormat format)
+{
+    return format == BlockFormat::BC1 || format == BlockFormat::BC4 ? 8 : 16;
+}
+
+size_t BlockCompressor::getCompressedSize(BlockFormat format, uint32_t width, uint32_t height)
+{
+    return static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4) * getBlockSize(format);
+}
+
+const char* BlockCompressor::getFormatName(BlockFormat format)
+{
+    switch (format) {
+    case BlockFormat::BC1:
+        return "BC1";
+    case BlockFormat::BC4:
+        return "BC4";
+    case BlockFormat::BC5:
+        return "BC5";
+    default:
+        return "BC7";
+    }
+}
+
+void BlockCompressor::compress(const uint8_t* rgba, uint32_t width, uint32_t height, BlockFormat format, std::vector<uint8_t>& out)
+{
+    uint32_t blocksX   = (width + 3) / 4;
+    uint32_t blocksY   = (height + 3) / 4;
+    uint32_t blockSize = getBlockSize(format);
+    out.resize(getCompressedSize(format, width, height));
+
+    auto compressRow = [&](size_t by) {
+        Block block;
+        for (uint32_t bx = 0; bx < blocksX; bx++) {
+            loadBlock(rgba, width, height, bx, static_cast<uint32_t>(by), block);
+
+            uint8_t* destination = out.data() + (by * blocksX + bx) * blockSize;
+            switch (format) {
+            case BlockFormat::BC1:
+                encodeBC1(block, destination);
+                break;
+            case BlockFormat::BC4:
+                encodeBC4(block, 0, destination);
+                break;
+            case BlockFormat::BC5:
+                encodeBC4(block, 0, destination);
+                encodeBC4(block, 1, destination + 8);
+                break;
+            case BlockFormat::BC7:
+                encodeBC7(block, destination);
+                break;
+            }
+        }
+    };
+
+    if (m_threaded) {
+        THREAD_POOL.parallelFor(blocksY, compressRow);
+    } else {
+        for (uint32_t by = 0; by < blocksY; by++) {
+            compressRow(by);
+        }
+    }
+}
+
+void BlockCompressor::decompress(const uint8_t* blocks, uint32_t width, uint32_t height, BlockFormat format, std::vector<uint8_t>& rgba)
+{
+    uint32_t blocksX   = (width + 3) / 4;
+    uint32_t blocksY   = (height + 3) / 4;
+    uint32_t blockSize = getBlockSize(format);
+    rgba.assign(static_cast<size_t>(width) * height * 4, 0);
+
+    for (uint32_t by = 0; by < blocksY; by++) {
+        for (uint32_t bx = 0; bx < blocksX; bx++) {
+            const uint8_t* source       = blocks + (static_cast<size_t>(by) * blocksX + bx) * blockSize;
+            uint8_t        pixels[16][4] = {};
+
+            switch (format) {
+            case BlockFormat::BC1:
+                decodeBC1(source, pixels);
+                break;
+            case BlockFormat::BC4:
+                decodeBC4(source, 0, pixels);
+                break;
+            case BlockFormat::BC5:
+                decodeBC4(source, 0, pixels);
+                decodeBC4(source + 8, 1, pixels);
+                break;
+            case BlockFormat::BC7:
+                decodeBC7(source, pixels);
+                break;
+            }
+
+            for (uint32_t y = 0; y < 4 && by * 4 + y < height; y++) {
+                for (uint32_t x = 0; x < 4 && bx * 4 + x < width; x++) {
+                    std::memcpy(&rgba[((static_cast<size_t>(by) * 4 + y) * width + bx * 4 + x) * 4], pixels[y * 4 + x], 4);
+                }
+            }
+        }
+    }
+}
+
+float BlockCompressor::computePSNR(const uint8_t* reference, const uint8_t* decoded, uint32_t width, uint32_t height, BlockFormat format)
+{
+    // Only the channels the format stores take part.
+    uint32_t channels = format == BlockFormat::BC4 ? 1 : format == BlockFormat::BC5 ? 2 : format == BlockFormat::BC1 ? 3 : 4;
+
+    double error  = 0.0;
+    size_t pixels = static_cast<size_t>(width) * height;
+    for (size_t i = 0; i < pixels; i++) {
+        for (uint32_t c = 0; c < channels; c++) {
+            double delta = static_cast<double>(reference[i * 4 + c]) - decoded[i * 4 + c];
+            error += delta * delta;
+        }
+    }
+
+    double mse = error / (static_cast<double>(pixels) * channels);
+    if (mse <= 0.0) {
+        return 99.0f;
+    }
+    return static_cast<float>(10.0 * std::log10(255.0 * 255.0 / mse));
+}
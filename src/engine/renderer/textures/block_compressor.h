@@ -0,0 +1,44 @@
+#ifndef ENGINE_RENDERER_BLOCK_COMPRESSOR_H_
+#define ENGINE_RENDERER_BLOCK_COMPRESSOR_H_
+
+#include "engine/renderer/textures/texture_role.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+enum class BlockFormat : uint32_t {
+    BC1, // RGB, 4 bpp
+    BC4, // R, 4 bpp
+    BC5, // RG, 8 bpp
+    BC7, // RGBA, 8 bpp, encoded as mode 6
+};
+
+// CPU block compression of RGBA8 images. Doesn't touch GL, so it runs on worker threads and in headless tools.
+// Block rows are spread over the thread pool and the per block fitting uses SSE.
+class BlockCompressor
+{
+  public:
+    BlockCompressor()  = default;
+    ~BlockCompressor() = default;
+
+    static BlockFormat chooseFormat(TextureRole role, uint32_t channels);
+    static uint32_t    getGLFormat(BlockFormat format);
+    static uint32_t    getBlockSize(BlockFormat format);
+    static size_t      getCompressedSize(BlockFormat format, uint32_t width, uint32_t height);
+    static const char* getFormatName(BlockFormat format);
+
+    // rgba is tightly packed RGBA8. BC4 reads red, BC5 red and green, partial edge blocks repeat the last row/column.
+    void compress(const uint8_t* rgba, uint32_t width, uint32_t height, BlockFormat format, std::vector<uint8_t>& out);
+
+    // Reference decoder for quality checks. BC7 only understands the mode 6 blocks this encoder writes.
+    static void  decompress(const uint8_t* blocks, uint32_t width, uint32_t height, BlockFormat format, std::vector<uint8_t>& rgba);
+    static float computePSNR(const uint8_t* reference, const uint8_t* decoded, uint32_t width, uint32_t height, BlockFormat format);
+
+    void setThreaded(bool threaded) { m_threaded = threaded; }
+
+  private:
+    bool m_threaded = true;
+};
+
+#endif // ENGINE_RENDERER_BLOCK_COMPRESSOR_H_
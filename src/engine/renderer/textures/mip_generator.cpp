@@ -0,0 +1,401 @@
+#include "pch.h"
+
+#include "engine/renderer/textures/mip_generator.h"
+#include "engine/core/thread_pool.h"
+#include "common/cpu_features.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <immintrin.h>
+
+namespace
+{
+    const uint32_t BAND_ROWS    = 16;
+    const uint32_t LINEAR_STEPS = 16384; // Resolution of the linear -> sRGB table, fine enough to stay exact near black
+    const float    PI           = 3.14159265358979f;
+    const float    KAISER_ALPHA = 4.0f;
+
+    std::atomic<MipFilter> s_defaultFilter = MipFilter::Kaiser;
+
+    const bool s_hasAVX = CpuFeatures::hasAVX();
+
+    float srgbToLinear(float value)
+    {
+        return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+    }
+
+    float linearToSrgb(float value)
+    {
+        return value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+    }
+
+    struct ColorTables {
+        float   unorm[256];
+        float   toLinear[256];
+        uint8_t toSRGB[LINEAR_STEPS + 1];
+    };
+
+    const ColorTables& getColorTables()
+    {
+        static const ColorTables tables = []() {
+            ColorTables result;
+            for (uint32_t i = 0; i < 256; i++) {
+                result.unorm[i]    = i / 255.0f;
+                result.toLinear[i] = srgbToLinear(i / 255.0f);
+            }
+            for (uint32_t i = 0; i <= LINEAR_STEPS; i++) {
+                result.toSRGB[i] = static_cast<uint8_t>(linearToSrgb(static_cast<float>(i) / LINEAR_STEPS) * 255.0f + 0.5f);
+            }
+            return result;
+        }();
+        return tables;
+    }
+
+    float sinc(float x)
+    {
+        if (std::fabs(x) < 1e-6f) {
+            return 1.0f;
+        }
+        x *= PI;
+        return std::sin(x) / x;
+    }
+
+    float besselI0(float x)
+    {
+        float sum  = 1.0f;
+        float term = 1.0f;
+        for (int k = 1; k < 32; k++) {
+            float factor = x / (2.0f * k);
+            term *= factor * factor;
+            sum += term;
+            if (term < sum * 1e-8f) {
+                break;
+            }
+        }
+        return sum;
+    }
+
+    // Filter radius in target texels.
+    float getSupport(MipFilter filter)
+    {
+        switch (filter) {
+        case MipFilter::Box:
+            return 0.5f;
+        case MipFilter::Kaiser:
+            return 2.0f;
+        default:
+            return 3.0f;
+        }
+    }
+
+    float evaluate(MipFilter filter, float x)
+    {
+        x             = std::fabs(x);
+        float support = getSupport(filter);
+        if (filter == MipFilter::Box) {
+            return x <= support ? 1.0f : 0.0f;
+        }
+
+        if (x >= support) {
+            return 0.0f;
+        }
+
+        if (filter == MipFilter::Kaiser) {
+            float t = x / support;
+            return sinc(x) * besselI0(KAISER_ALPHA * std::sqrt(1.0f - t * t)) / besselI0(KAISER_ALPHA);
+        }
+        return sinc(x) * sinc(x / support);
+    }
+
+    // Returns how many floats were done, the caller finishes the tail with SSE.
+    uint32_t blendRowsAVX(const float* const* rows, const float* weights, uint32_t count, uint32_t floatCount, float* out)
+    {
+        uint32_t i = 0;
+        for (; i + 8 <= floatCount; i += 8) {
+            __m256 sum = _mm256_setzero_ps();
+            for (uint32_t k = 0; k < count; k++) {
+                sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_loadu_ps(rows[k] + i), _mm256_set1_ps(weights[k])));
+            }
+            _mm256_storeu_ps(out + i, sum);
+        }
+
+        // Clear the upper halves so the SSE code after this doesn't pay the transition penalty.
+        _mm256_zeroupper();
+        return i;
+    }
+} // namespace
+
+uint32_t MipGenerator::getLevelCount(uint32_t width, uint32_t height)
+{
+    uint32_t levelCount = 1;
+    while ((std::max(width, height) >> levelCount) > 0) {
+        levelCount++;
+    }
+    return levelCount;
+}
+
+void MipGenerator::generate(TextureData& data) const
+{
+    if (data.levels.empty()) {
+        return;
+    }
+
+    data.levels.resize(getLevelCount(data.width, data.height));
+    for (size_t i = 1; i < data.levels.size(); i++) {
+        downsample(data.levels[i - 1], data.levels[i], data.channels);
+    }
+}
+
+MipGenerator::AxisTaps MipGenerator::buildTaps(uint32_t sourceSize, uint32_t targetSize) const
+{
+    AxisTaps taps;
+
+    // A side that has already reached one texel is copied through while the other keeps shrinking.
+    if (sourceSize == targetSize) {
+        taps.count = 1;
+        taps.indices.resize(targetSize);
+        taps.weights.assign(targetSize, 1.0f);
+        for (uint32_t i = 0; i < targetSize; i++) {
+            taps.indices[i] = i;
+        }
+        return taps;
+    }
+
+    float scale  = static_cast<float>(sourceSize) / targetSize;
+    float radius = getSupport(m_filter) * scale;
+
+    std::vector<std::vector<std::pair<uint32_t, float>>> perTarget(targetSize);
+    for (uint32_t i = 0; i < targetSize; i++) {
+        float center = (i + 0.5f) * scale;
+        int   first  = static_cast<int>(std::floor(center - radius));
+        int   last   = static_cast<int>(std::ceil(center + radius));
+
+        float total = 0.0f;
+        for (int j = first; j <= last; j++) {
+            float weight = evaluate(m_filter, (j + 0.5f - center) / scale);
+            if (weight == 0.0f) {
+                continue;
+            }
+
+            int wrapped = j % static_cast<int>(sourceSize);
+            if (wrapped < 0) {
+                wrapped += sourceSize;
+            }
+            perTarget[i].push_back({static_cast<uint32_t>(wrapped), weight});
+            total += weight;
+        }
+
+        for (auto& tap : perTarget[i]) {
+            tap.second /= total;
+        }
+        taps.count = std::max(taps.count, static_cast<uint32_t>(perTarget[i].size()));
+    }
+
+    // Padding repeats the last texel with zero weight, so it never pulls in a row the band doesn't need.
+    taps.indices.resize(static_cast<size_t>(targetSize) * taps.count);
+    taps.weights.resize(static_cast<size_t>(targetSize) * taps.count);
+    for (uint32_t i = 0; i < targetSize; i++) {
+        for (uint32_t k = 0; k < taps.count; k++) {
+            bool   padding     = k >= perTarget[i].size();
+            size_t slot        = static_cast<size_t>(i) * taps.count + k;
+            taps.indices[slot] = padding ? perTarget[i].back().first : perTarget[i][k].first;
+            taps.weights[slot] = padding ? 0.0f : perTarget[i][k].second;
+        }
+    }
+
+    return taps;
+}
+
+void MipGenerator::downsample(const TextureData::Level& source, TextureData::Level& target, uint32_t channels) const
+{
+    target.width  = std::max(1u, source.width >> 1);
+    target.height = std::max(1u, source.height >> 1);
+    target.data.resize(static_cast<size_t>(target.width) * target.height * channels);
+
+    AxisTaps columns = buildTaps(source.width, target.width);
+    AxisTaps rows    = buildTaps(source.height, target.height);
+
+    uint32_t bandCount  = (target.height + BAND_ROWS - 1) / BAND_ROWS;
+    auto     filterRows = [&](size_t band) {
+        uint32_t firstRow = static_cast<uint32_t>(band) * BAND_ROWS;
+        filterBand(source, target, channels, columns, rows, firstRow, std::min(firstRow + BAND_ROWS, target.height));
+    };
+
+    if (m_threaded) {
+        THREAD_POOL.parallelFor(bandCount, filterRows);
+    } else {
+        for (uint32_t band = 0; band < bandCount; band++) {
+            filterRows(band);
+        }
+    }
+}
+
+void MipGenerator::filterBand(const TextureData::Level& source, TextureData::Level& target, uint32_t channels, const AxisTaps& columns, const AxisTaps& rows, uint32_t firstRow,
+                              uint32_t lastRow) const
+{
+    // Source rows converted to linear RGBA floats. Neighbouring target rows share most of their source rows, so each
+    // one is converted once per band rather than once per tap.
+    uint32_t                  floatCount = source.width * 4;
+    std::vector<float>        cache(static_cast<size_t>(rows.count) * floatCount);
+    std::vector<int64_t>      cachedRow(rows.count, -1);
+    std::vector<const float*> rowData(rows.count);
+    std::vector<float>        vertical(floatCount);
+    std::vector<float>        horizontal(static_cast<size_t>(target.width) * 4);
+
+    for (uint32_t y = firstRow; y < lastRow; y++) {
+        const uint32_t* indices = &rows.indices[static_cast<size_t>(y) * rows.count];
+        const float*    weights = &rows.weights[static_cast<size_t>(y) * rows.count];
+
+        for (uint32_t k = 0; k < rows.count; k++) {
+            uint32_t slot = 0;
+            while (slot < rows.count && cachedRow[slot] != indices[k]) {
+                slot++;
+            }
+
+            if (slot == rows.count) {
+                // There are never more distinct rows than slots, so some slot holds a row this target row doesn't use.
+                for (slot = 0; slot < rows.count; slot++) {
+                    if (std::find(indices, indices + rows.count, cachedRow[slot]) == indices + rows.count) {
+                        break;
+                    }
+                }
+
+                loadRow(source.data.data() + static_cast<size_t>(indices[k]) * source.width * channels, source.width, channels, &cache[slot * floatCount]);
+                cachedRow[slot] = indices[k];
+            }
+
+            rowData[k] = &cache[slot * floatCount];
+        }
+
+        blendRows(rowData.data(), weights, rows.count, floatCount, vertical.data());
+        filterRow(vertical.data(), columns, target.width, horizontal.data());
+        storeRow(horizontal.data(), target.width, channels, target.data.data() + static_cast<size_t>(y) * target.width * channels);
+    }
+}
+
+void MipGenerator::loadRow(const uint8_t* source, uint32_t width, uint32_t channels, float* out) const
+{
+    const ColorTables& tables = getColorTables();
+    const float*       color  = m_srgb && channels >= 3 ? tables.toLinear : tables.unorm;
+
+    for (uint32_t x = 0; x < width; x++) {
+        const uint8_t* texel = source + static_cast<size_t>(x) * channels;
+        float*         value = out + static_cast<size_t>(x) * 4;
+        for (uint32_t c = 0; c < 4; c++) {
+            if (c < channels) {
+                value[c] = c < 3 ? color[texel[c]] : tables.unorm[texel[c]];
+            } else {
+                value[c] = c == 3 ? 1.0f : 0.0f;
+            }
+        }
+    }
+}
+
+void MipGenerator::storeRow(const float* row, uint32_t width, uint32_t channels, uint8_t* out) const
+{
+    const ColorTables& tables      = getColorTables();
+    bool               srgb        = m_srgb && channels >= 3;
+    bool               renormalize = m_normalMap && channels >= 3;
+
+    for (uint32_t x = 0; x < width; x++) {
+        float value[4] = {row[x * 4], row[x * 4 + 1], row[x * 4 + 2], row[x * 4 + 3]};
+
+        if (renormalize) {
+            float nx     = value[0] * 2.0f - 1.0f;
+            float ny     = value[1] * 2.0f - 1.0f;
+            float nz     = value[2] * 2.0f - 1.0f;
+            float length = std::sqrt(nx * nx + ny * ny + nz * nz);
+            if (length > 1e-6f) {
+                value[0] = nx / length * 0.5f + 0.5f;
+                value[1] = ny / length * 0.5f + 0.5f;
+                value[2] = nz / length * 0.5f + 0.5f;
+            }
+        }
+
+        uint8_t* texel = out + static_cast<size_t>(x) * channels;
+        for (uint32_t c = 0; c < channels; c++) {
+            // Sinc based filters ring past the input range.
+            float clamped = std::clamp(value[c], 0.0f, 1.0f);
+            if (srgb && c < 3) {
+                texel[c] = tables.toSRGB[static_cast<uint32_t>(clamped * LINEAR_STEPS + 0.5f)];
+            } else {
+                texel[c] = static_cast<uint8_t>(clamped * 255.0f + 0.5f);
+            }
+        }
+    }
+}
+
+void MipGenerator::blendRows(const float* const* rows, const float* weights, uint32_t count, uint32_t floatCount, float* out) const
+{
+    uint32_t i = 0;
+    if (m_vectorized) {
+        if (s_hasAVX) {
+            i = blendRowsAVX(rows, weights, count, floatCount, out);
+        }
+
+        for (; i + 4 <= floatCount; i += 4) {
+            __m128 sum = _mm_setzero_ps();
+            for (uint32_t k = 0; k < count; k++) {
+                sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(rows[k] + i), _mm_set1_ps(weights[k])));
+            }
+            _mm_storeu_ps(out + i, sum);
+        }
+    }
+
+    for (; i < floatCount; i++) {
+        float sum = 0.0f;
+        for (uint32_t k = 0; k < count; k++) {
+            sum += rows[k][i] * weights[k];
+        }
+        out[i] = sum;
+    }
+}
+
+void MipGenerator::filterRow(const float* row, const AxisTaps& columns, uint32_t width, float* out) const
+{
+    // One RGBA texel per SSE register, the taps of neighbouring texels don't line up well enough for wider vectors.
+    for (uint32_t x = 0; x < width; x++) {
+        const uint32_t* indices = &columns.indices[static_cast<size_t>(x) * columns.count];
+        const float*    weights = &columns.weights[static_cast<size_t>(x) * columns.count];
+
+        if (m_vectorized) {
+            __m128 sum = _mm_setzero_ps();
+            for (uint32_t k = 0; k < columns.count; k++) {
+                sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(row + indices[k] * 4), _mm_set1_ps(weights[k])));
+            }
+            _mm_storeu_ps(out + x * 4, sum);
+            continue;
+        }
+
+        for (uint32_t c = 0; c < 4; c++) {
+            float sum = 0.0f;
+            for (uint32_t k = 0; k < columns.count; k++) {
+                sum += row[indices[k] * 4 + c] * weights[k];
+            }
+            out[x * 4 + c] = sum;
+        }
+    }
+}
+
+void MipGenerator::setDefaultFilter(MipFilter filter)
+{
+    s_defaultFilter = filter;
+}
+
+MipFilter MipGenerator::getDefaultFilter()
+{
+    return s_defaultFilter;
+}
+
+const char* MipGenerator::getFilterName(MipFilter filter)
+{
+    switch (filter) {
+    case MipFilter::Box:
+        return "box";
+    case MipFilter::Kaiser:
+        return "kaiser";
+    default:
+        return "lanczos";
+    }
+}
@@ -0,0 +1,66 @@
+#ifndef ENGINE_RENDERER_MIP_GENERATOR_H_
+#define ENGINE_RENDERER_MIP_GENERATOR_H_
+
+#include "engine/renderer/resources/texture_cache.h"
+
+#include <cstdint>
+#include <vector>
+
+enum class MipFilter : uint32_t {
+    Box,     // 2x2 average, what glGenerateMipmap does
+    Kaiser,  // Kaiser windowed sinc, 2 texel support
+    Lanczos, // Lanczos 3
+};
+
+// Builds mip chains on the CPU, so they can be generated off the GL thread and cached with the texture.
+// Each level is filtered from the one above it in linear space, rows are split into bands over the thread pool.
+// Edges wrap since every texture is sampled with GL_REPEAT.
+class MipGenerator
+{
+  public:
+    MipGenerator()  = default;
+    ~MipGenerator() = default;
+
+    static uint32_t getLevelCount(uint32_t width, uint32_t height);
+
+    // Fills data.levels[1..] from data.levels[0], which holds width * height * channels bytes.
+    void generate(TextureData& data) const;
+
+    // sRGB treats RGB as sRGB encoded and filters it in linear space, alpha is always linear. Normal maps get XYZ
+    // renormalized on every level. Turning vectorization off runs the scalar reference loops.
+    void setFilter(MipFilter filter) { m_filter = filter; }
+    void setSRGB(bool srgb) { m_srgb = srgb; }
+    void setNormalMap(bool normalMap) { m_normalMap = normalMap; }
+    void setThreaded(bool threaded) { m_threaded = threaded; }
+    void setVectorized(bool vectorized) { m_vectorized = vectorized; }
+
+    static void        setDefaultFilter(MipFilter filter);
+    static MipFilter   getDefaultFilter();
+    static const char* getFilterName(MipFilter filter);
+
+  private:
+    // Source texels and weights for every output texel along one axis, padded to the same count with zero weights.
+    struct AxisTaps {
+        uint32_t              count = 0;
+        std::vector<uint32_t> indices;
+        std::vector<float>    weights;
+    };
+
+    MipFilter m_filter     = MipFilter::Kaiser;
+    bool      m_srgb       = false;
+    bool      m_normalMap  = false;
+    bool      m_threaded   = true;
+    bool      m_vectorized = true;
+
+    AxisTaps buildTaps(uint32_t sourceSize, uint32_t targetSize) const;
+    void     downsample(const TextureData::Level& source, TextureData::Level& target, uint32_t channels) const;
+    void     filterBand(const TextureData::Level& source, TextureData::Level& target, uint32_t channels, const AxisTaps& columns, const AxisTaps& rows, uint32_t firstRow,
+                        uint32_t lastRow) const;
+
+    void loadRow(const uint8_t* source, uint32_t width, uint32_t channels, float* out) const;
+    void storeRow(const float* row, uint32_t width, uint32_t channels, uint8_t* out) const;
+    void blendRows(const float* const* rows, const float* weights, uint32_t count, uint32_t floatCount, float* out) const;
+    void filterRow(const float* row, const AxisTaps& columns, uint32_t width, float* out) const;
+};
+
+#endif // ENGINE_RENDERER_MIP_GENERATOR_H_
@@ -0,0 +1,360 @@
+#include "pch.h"
+
+#include "engine/renderer/textures/texture_pool.h"
+#include "engine/renderer/shaders/shader_bindings.h"
+
+#include "common/logger.h"
+
+#include <algorithm>
+#include <atomic>
+#include <format>
+
+namespace
+{
+    std::atomic<TextureBindingMode> s_preferredMode = TextureBindingMode::Bindless;
+
+    size_t getTexelSize(uint32_t format)
+    {
+        switch (format) {
+        case GL_R8:
+            return 1;
+        case GL_RG8:
+            return 2;
+        case GL_RGB8:
+            return 3;
+        default:
+            return 4;
+        }
+    }
+
+    void setSamplerState(uint32_t levels)
+    {
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(levels) - 1);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    }
+} // namespace
+
+TexturePool& TexturePool::getInstance()
+{
+    static TexturePool instance;
+    return instance;
+}
+
+TexturePool::TexturePool() : m_buffer(GL_SHADER_STORAGE_BUFFER)
+{
+    //
+}
+
+void TexturePool::initialize()
+{
+    TextureBindingMode preferred = s_preferredMode;
+
+    m_mode = TextureBindingMode::PerDraw;
+    if (preferred == TextureBindingMode::Bindless && GLAD_GL_ARB_bindless_texture) {
+        m_mode = TextureBindingMode::Bindless;
+    } else if (preferred != TextureBindingMode::PerDraw && GLAD_GL_VERSION_4_3) {
+        // glCopyImageSubData and array storage are core since 4.3.
+        m_mode = TextureBindingMode::Arrays;
+
+        GLint units = 0;
+        glGetIntegerv(GL_MAX_TEXTURE_IMAGE_UNITS, &units);
+        m_maxPools = std::min(MAX_POOLS, static_cast<uint32_t>(std::max(units - static_cast<GLint>(FIRST_POOL_UNIT), 1)));
+    }
+
+    // The sampler array in pbr.fs is sized to the pools the units allow.
+    switch (m_mode) {
+    case TextureBindingMode::Bindless:
+        m_defines = "#define TEXTURE_BINDLESS\n";
+        break;
+    case TextureBindingMode::Arrays:
+        m_defines = std::format("#define TEXTURE_ARRAYS\n#define TEXTURE_POOL_COUNT {}\n", m_maxPools);
+        break;
+    default:
+        m_defines.clear();
+        break;
+    }
+
+    if (m_mode != preferred) {
+        LOG_WARN("TexturePool: {} textures aren't supported, using {}", getModeName(preferred), getModeName(m_mode));
+    } else {
+        LOG_INFO("TexturePool: Using {} textures", getModeName(m_mode));
+    }
+}
+
+const char* TexturePool::getShaderDefines() const
+{
+    return m_defines.c_str();
+}
+
+uint32_t TexturePool::add(uint32_t textureId)
+{
+    if (!isResident() || textureId == 0) {
+        return INVALID_INDEX;
+    }
+
+    auto it = m_indices.find(textureId);
+    if (it != m_indices.end()) {
+        return it->second.index;
+    }
+    if (m_unpooled.contains(textureId)) {
+        return INVALID_INDEX;
+    }
+
+    Entry      entry;
+    glm::uvec2 value(0);
+    if (m_mode == TextureBindingMode::Bindless) {
+        // The texture's sampler state is frozen from here on, it is set once at upload anyway.
+        entry.handle = glGetTextureHandleARB(textureId);
+        if (entry.handle == 0) {
+            LOG_ERROR("TexturePool: No bindless handle for texture {}", textureId);
+            return INVALID_INDEX;
+        }
+        glMakeTextureHandleResidentARB(entry.handle);
+        value = glm::uvec2(static_cast<uint32_t>(entry.handle), static_cast<uint32_t>(entry.handle >> 32));
+    } else {
+        if (!addToPool(textureId, entry)) {
+            m_unpooled.insert(textureId);
+            return INVALID_INDEX;
+        }
+        value = glm::uvec2(entry.pool, entry.layer);
+    }
+
+    if (!m_freeIndices.empty()) {
+        entry.index = m_freeIndices.back();
+        m_freeIndices.pop_back();
+    } else {
+        entry.index = static_cast<uint32_t>(m_entries.size());
+        m_entries.emplace_back(0);
+    }
+
+    m_indices.emplace(textureId, entry);
+    write(entry.index, value);
+    return entry.index;
+}
+
+uint32_t TexturePool::getPool(uint32_t index) const
+{
+    return m_mode == TextureBindingMode::Arrays && index < m_entries.size() ? m_entries[index].x : 0;
+}
+
+void TexturePool::remove(uint32_t textureId)
+{
+    m_unpooled.erase(textureId);
+
+    auto it = m_indices.find(textureId);
+    if (it == m_indices.end()) {
+        return;
+    }
+
+    const Entry& entry = it->second;
+    if (m_mode == TextureBindingMode::Bindless) {
+        glMakeTextureHandleNonResidentARB(entry.handle);
+    } else {
+        m_pools[entry.pool].freeLayers.push_back(entry.layer);
+    }
+
+    m_freeIndices.push_back(entry.index);
+    m_indices.erase(it);
+}
+
+void TexturePool::bind() const
+{
+    if (!isResident()) {
+        return;
+    }
+
+    m_buffer.bindBase(ShaderBinding::TEXTURES);
+
+    if (m_mode == TextureBindingMode::Arrays) {
+        for (uint32_t i = 0; i < m_pools.size(); i++) {
+            glActiveTexture(GL_TEXTURE0 + FIRST_POOL_UNIT + i);
+            glBindTexture(GL_TEXTURE_2D_ARRAY, m_pools[i].texture);
+        }
+        glActiveTexture(GL_TEXTURE0);
+    }
+}
+
+void TexturePool::release()
+{
+    if (m_mode == TextureBindingMode::Bindless) {
+        for (const auto& pair : m_indices) {
+            glMakeTextureHandleNonResidentARB(pair.second.handle);
+        }
+    }
+
+    for (auto& pool : m_pools) {
+        glDeleteTextures(1, &pool.texture);
+    }
+
+    m_buffer.release();
+    m_entries.clear();
+    m_indices.clear();
+    m_unpooled.clear();
+    m_freeIndices.clear();
+    m_pools.clear();
+    m_capacity = 0;
+}
+
+size_t TexturePool::getMemoryUsage() const
+{
+    size_t bytes = 0;
+    for (const auto& pool : m_pools) {
+        bytes += pool.capacity * pool.layerBytes;
+    }
+    return bytes;
+}
+
+void TexturePool::setPreferredMode(TextureBindingMode mode)
+{
+    s_preferredMode = mode;
+}
+
+TextureBindingMode TexturePool::getPreferredMode()
+{
+    return s_preferredMode;
+}
+
+const char* TexturePool::getModeName(TextureBindingMode mode)
+{
+    switch (mode) {
+    case TextureBindingMode::Bindless:
+        return "bindless";
+    case TextureBindingMode::Arrays:
+        return "array";
+    default:
+        return "per-draw";
+    }
+}
+
+bool TexturePool::addToPool(uint32_t textureId, Entry& entry)
+{
+    GLint width          = 0;
+    GLint height         = 0;
+    GLint internalFormat = 0;
+    GLint maxLevel       = 0;
+    GLint compressed     = 0;
+
+    glBindTexture(GL_TEXTURE_2D, textureId);
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &width);
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &height);
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_INTERNAL_FORMAT, &internalFormat);
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_COMPRESSED, &compressed);
+    glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, &maxLevel);
+
+    if (width <= 0 || height <= 0) {
+        glBindTexture(GL_TEXTURE_2D, 0);
+        LOG_ERROR("TexturePool: Texture {} has no storage", textureId);
+        return false;
+    }
+
+    // MAX_LEVEL is clamped to the levels a full chain has, uploads always set it to their last level.
+    uint32_t fullChain = 1;
+    while ((std::max(width, height) >> fullChain) > 0) {
+        fullChain++;
+    }
+    uint32_t levels = std::min(static_cast<uint32_t>(maxLevel) + 1, fullChain);
+    uint32_t format = static_cast<uint32_t>(internalFormat);
+
+    size_t layerBytes = 0;
+    for (uint32_t level = 0; level < levels; level++) {
+        if (compressed) {
+            GLint size = 0;
+            glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &size);
+            layerBytes += static_cast<size_t>(size);
+        } else {
+            layerBytes += static_cast<size_t>(std::max(width >> level, 1)) * std::max(height >> level, 1) * getTexelSize(format);
+        }
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    uint32_t poolIndex = findPool(width, height, levels, format, layerBytes);
+    if (poolIndex == INVALID_INDEX) {
+        LOG_WARN("TexturePool: All {} pools are taken, texture {} ({}x{}, format 0x{:x}) is bound per draw", m_maxPools, textureId, width, height, format);
+        return false;
+    }
+
+    Pool& pool = m_pools[poolIndex];
+    if (!pool.freeLayers.empty()) {
+        entry.layer = pool.freeLayers.back();
+        pool.freeLayers.pop_back();
+    } else {
+        if (pool.used == pool.capacity) {
+            growPool(pool, std::max(INITIAL_LAYERS, pool.capacity * 2));
+        }
+        entry.layer = pool.used++;
+    }
+    entry.pool = poolIndex;
+
+    // A GPU side copy, the compressed blocks are taken over as they are.
+    for (uint32_t level = 0; level < levels; level++) {
+        GLsizei levelWidth  = std::max(width >> level, 1);
+        GLsizei levelHeight = std::max(height >> level, 1);
+        glCopyImageSubData(textureId, GL_TEXTURE_2D, level, 0, 0, 0, pool.texture, GL_TEXTURE_2D_ARRAY, level, 0, 0, entry.layer, levelWidth, levelHeight, 1);
+    }
+
+    return true;
+}
+
+uint32_t TexturePool::findPool(uint32_t width, uint32_t height, uint32_t levels, uint32_t internalFormat, size_t layerBytes)
+{
+    for (uint32_t i = 0; i < m_pools.size(); i++) {
+        const Pool& pool = m_pools[i];
+        if (pool.width == width && pool.height == height && pool.levels == levels && pool.internalFormat == internalFormat) {
+            return i;
+        }
+    }
+
+    if (m_pools.size() >= m_maxPools) {
+        return INVALID_INDEX;
+    }
+
+    Pool& pool          = m_pools.emplace_back();
+    pool.width          = width;
+    pool.height         = height;
+    pool.levels         = levels;
+    pool.internalFormat = internalFormat;
+    pool.layerBytes     = layerBytes;
+
+    LOG_DEBUG("TexturePool: New pool {} for {}x{} textures with {} levels, format 0x{:x}", m_pools.size() - 1, width, height, levels, internalFormat);
+    return static_cast<uint32_t>(m_pools.size() - 1);
+}
+
+void TexturePool::growPool(Pool& pool, uint32_t capacity)
+{
+    // Array storage is immutable, a bigger array takes over the layers handed out so far.
+    uint32_t texture = 0;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+    glTexStorage3D(GL_TEXTURE_2D_ARRAY, static_cast<GLsizei>(pool.levels), pool.internalFormat, pool.width, pool.height, capacity);
+    setSamplerState(pool.levels);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    if (pool.texture) {
+        for (uint32_t level = 0; level < pool.levels; level++) {
+            GLsizei levelWidth  = std::max(pool.width >> level, 1u);
+            GLsizei levelHeight = std::max(pool.height >> level, 1u);
+            glCopyImageSubData(pool.texture, GL_TEXTURE_2D_ARRAY, level, 0, 0, 0, texture, GL_TEXTURE_2D_ARRAY, level, 0, 0, 0, levelWidth, levelHeight, pool.used);
+        }
+        glDeleteTextures(1, &pool.texture);
+    }
+
+    pool.texture  = texture;
+    pool.capacity = capacity;
+}
+
+void TexturePool::write(uint32_t index, glm::uvec2 value)
+{
+    m_entries[index] = value;
+
+    if (m_entries.size() > m_capacity) {
+        // Rare (doubling from 64), the whole table goes up again from the CPU copy.
+        m_capacity = std::max(INITIAL_CAPACITY, m_capacity * 2);
+        m_buffer.allocate(m_capacity * sizeof(glm::uvec2));
+        m_buffer.update(0, m_entries.size() * sizeof(glm::uvec2), m_entries.data());
+    } else {
+        m_buffer.update(index * sizeof(glm::uvec2), sizeof(glm::uvec2), &value);
+    }
+}
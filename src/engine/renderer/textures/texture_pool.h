@@ -0,0 +1,117 @@
+#ifndef ENGINE_RENDERER_TEXTURE_POOL_H_
+#define ENGINE_RENDERER_TEXTURE_POOL_H_
+
+#include "engine/renderer/buffers/gpu_buffer.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+enum class TextureBindingMode : uint32_t {
+    PerDraw,  // Every draw binds its textures to fixed units
+    Arrays,   // Textures are copied into GL_TEXTURE_2D_ARRAY pools, every pool is bound once per frame
+    Bindless, // GL_ARB_bindless_texture handles made resident once
+};
+
+// Gives every texture a material uses an index into one shader storage buffer, so materials refer to textures by
+// index and draws bind none. The entry is the bindless handle of the texture, or the pool and layer it was copied to.
+// Pools group textures of the same size, level count and internal format, MAX_POOLS of them at most. A texture that
+// gets no entry is bound per draw to its slot's unit, like in per-draw mode (see Mesh::bindTextures).
+//
+// The mode is picked once when the renderer starts, falling back from the preferred one to what the driver supports.
+// It also picks the variant of the shaders, see getShaderDefines. GL thread only.
+class TexturePool
+{
+  public:
+    static TexturePool& getInstance();
+
+    // Has to run before the shaders are compiled and the first mesh is created.
+    void initialize();
+
+    TextureBindingMode getMode() const { return m_mode; }
+    bool               isResident() const { return m_mode != TextureBindingMode::PerDraw; }
+    const char*        getShaderDefines() const;
+
+    // The same texture always gets the same index. INVALID_INDEX in per-draw mode, or when the texture can't get a
+    // layer because every pool is taken by another size or format.
+    uint32_t add(uint32_t textureId);
+
+    // Pool an index's texture was copied to, 0 unless textures are pooled in arrays.
+    uint32_t getPool(uint32_t index) const;
+
+    // Must be called before the texture is deleted, frees its index and layer for reuse.
+    void remove(uint32_t textureId);
+
+    // Once per frame before drawing: the texture buffer, and with arrays pool i on unit FIRST_POOL_UNIT + i.
+    void bind() const;
+
+    // Drops every entry, pool and handle. Materials created before must not be drawn afterwards.
+    void release();
+
+    size_t getCount() const { return m_indices.size(); }
+    size_t getPoolCount() const { return m_pools.size(); }
+    size_t getMemoryUsage() const; // Pool storage, copies of the textures. Bindless handles take none.
+
+    // Mode initialize() tries first. Bindless unless switched down for comparison.
+    static void               setPreferredMode(TextureBindingMode mode);
+    static TextureBindingMode getPreferredMode();
+    static const char*        getModeName(TextureBindingMode mode);
+
+    static constexpr uint32_t INVALID_INDEX   = ~0u;
+    static constexpr uint32_t FIRST_POOL_UNIT = 5;  // Units below are Mesh::TEXTURE_UNIT_COUNT, for textures bound per draw
+    static constexpr uint32_t MAX_POOLS       = 16; // Fewer if the driver doesn't have that many units past FIRST_POOL_UNIT
+
+  private:
+    TexturePool();
+    ~TexturePool() = default;
+
+    TexturePool(const TexturePool&)            = delete;
+    TexturePool& operator=(const TexturePool&) = delete;
+
+    struct Pool {
+        uint32_t              texture        = 0;
+        uint32_t              width          = 0;
+        uint32_t              height         = 0;
+        uint32_t              levels         = 0;
+        uint32_t              internalFormat = 0;
+        uint32_t              capacity       = 0; // Layers allocated
+        uint32_t              used           = 0; // Layers handed out so far, freed ones included
+        size_t                layerBytes     = 0;
+        std::vector<uint32_t> freeLayers;
+    };
+
+    struct Entry {
+        uint32_t index  = 0;
+        uint32_t pool   = 0;
+        uint32_t layer  = 0;
+        uint64_t handle = 0;
+    };
+
+    static constexpr size_t   INITIAL_CAPACITY = 64;
+    static constexpr uint32_t INITIAL_LAYERS   = 4;
+
+    TextureBindingMode                  m_mode = TextureBindingMode::PerDraw;
+    std::string                         m_defines;
+    GpuBuffer                           m_buffer;
+    std::vector<glm::uvec2>             m_entries; // What the shader reads, by index
+    std::unordered_map<uint32_t, Entry> m_indices;  // By GL texture
+    std::unordered_set<uint32_t>        m_unpooled; // Textures no pool could take, not tried again
+    std::vector<uint32_t>               m_freeIndices;
+    std::vector<Pool>                   m_pools;
+    uint32_t                            m_maxPools = MAX_POOLS;
+    size_t                              m_capacity = 0;
+
+    bool     addToPool(uint32_t textureId, Entry& entry);
+    uint32_t findPool(uint32_t width, uint32_t height, uint32_t levels, uint32_t internalFormat, size_t layerBytes);
+    void     growPool(Pool& pool, uint32_t capacity);
+    void     write(uint32_t index, glm::uvec2 value);
+};
+
+#define TEXTURE_POOL TexturePool::getInstance()
+
+#endif // ENGINE_RENDERER_TEXTURE_POOL_H_
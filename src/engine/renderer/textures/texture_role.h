@@ -0,0 +1,14 @@
+#ifndef ENGINE_RENDERER_TEXTURE_ROLE_H_
+#define ENGINE_RENDERER_TEXTURE_ROLE_H_
+
+#include <cstdint>
+
+// What a texture is sampled for. Decides the compressed format and how its mips are filtered.
+enum class TextureRole : uint32_t {
+    Generic,
+    Albedo,
+    Normal,
+    MetallicRoughness, // glTF packing, roughness in G and metallic in B
+};
+
+#endif // ENGINE_RENDERER_TEXTURE_ROLE_H_
@@ -4,9 +4,54 @@
 #include "editor/application.h"
 #include "bootstrap.h"
 #include "engine/core/engine.h"
+#include "engine/renderer/render_queue.h"
+#include "editor/tools/benchmark.h"
+#include "engine/renderer/resources/model_cooker.h"
+#include "engine/renderer/resources/texture_cache.h"
+#include "engine/renderer/textures/mip_generator.h"
+#include "engine/renderer/textures/texture_pool.h"
 
-int main()
+int main(int argc, char** argv)
 {
+    // Texture and renderer options apply to the editor and to --cook alike.
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--compress-textures") {
+            TextureCache::setCompressionEnabled(true);
+        } else if (arg == "--mip-filter" && i + 1 < argc) {
+            std::string name = argv[++i];
+            for (MipFilter filter : {MipFilter::Box, MipFilter::Kaiser, MipFilter::Lanczos}) {
+                if (name == MipGenerator::getFilterName(filter)) {
+                    MipGenerator::setDefaultFilter(filter);
+                }
+            }
+        } else if (arg == "--texture-binding" && i + 1 < argc) {
+            std::string name = argv[++i];
+            for (TextureBindingMode mode : {TextureBindingMode::PerDraw, TextureBindingMode::Arrays, TextureBindingMode::Bindless}) {
+                if (name == TexturePool::getModeName(mode)) {
+                    TexturePool::setPreferredMode(mode);
+                }
+            }
+        } else if (arg == "--draw-submit" && i + 1 < argc) {
+            std::string name = argv[++i];
+            for (SubmitMode mode : {SubmitMode::Direct, SubmitMode::MultiDrawIndirect}) {
+                if (name == RenderQueue::getModeName(mode)) {
+                    RenderQueue::setPreferredMode(mode);
+                }
+            }
+        }
+    }
+
+    if (argc > 2 && std::string(argv[1]) == "--bench") {
+        return Benchmark::run(argv[2]) ? 0 : -1;
+    }
+
+    if (argc > 1 && std::string(argv[1]) == "--cook") {
+        bool        hasDirectory = argc > 2 && std::string(argv[2]).rfind("--", 0) != 0;
+        ModelCooker cooker;
+        return cooker.cookDirectory(hasDirectory ? argv[2] : "assets/models", true) ? 0 : -1;
+    }
+
     std::shared_ptr<IApp> app       = std::make_shared<App>();
     auto                  bootstrap = std::make_unique<Bootstrap>();
 